@@ -8,6 +8,10 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef enum cipher_mode { AES_GCM_128, AES_GCM_192, AES_GCM_256 } armv8_cipher_mode_t;
 
 typedef enum operation_result { SUCCESSFUL_OPERATION = 0, AUTHENTICATION_FAILURE=1, INTERNAL_FAILURE, INVALID_PARAMETER } armv8_operation_result_t;
@@ -51,6 +55,53 @@ typedef struct cipher_state {
     armv8_cipher_constants_t * constants;
 } armv8_cipher_state_t;
 
+// Compact constants for large IPsec SA tables, one layout per key size - only the round keys for that key size and the
+// 4 hash key powers the IPsec kernels load (the Karatsuba terms are formed in registers), round keys first as the kernels
+// load them first, and 64B aligned so an SA never straddles more cache lines than it needs:
+// 256B (4 lines) for AES-128 and 320B (5 lines) for AES-192/256, against 344B (6-7 lines) for armv8_cipher_constants_t
+// Set up with armv8_aes_gcm_set_compact_constants_<bits> and used with the *_from_compact_IPsec_<bits> functions
+typedef struct __attribute__((aligned(64))) compact_constants_128 {
+    armv8_quadword_t expanded_aes_keys[11];
+    armv8_quadword_t expanded_hash_keys[4];
+    armv8_cipher_mode_t mode;
+    uint8_t tag_byte_length;
+} armv8_compact_constants_128_t;
+
+typedef struct __attribute__((aligned(64))) compact_constants_192 {
+    armv8_quadword_t expanded_aes_keys[13];
+    armv8_quadword_t expanded_hash_keys[4];
+    armv8_cipher_mode_t mode;
+    uint8_t tag_byte_length;
+} armv8_compact_constants_192_t;
+
+typedef struct __attribute__((aligned(64))) compact_constants_256 {
+    armv8_quadword_t expanded_aes_keys[15];
+    armv8_quadword_t expanded_hash_keys[4];
+    armv8_cipher_mode_t mode;
+    uint8_t tag_byte_length;
+} armv8_compact_constants_256_t;
+
+// MACsec (IEEE 802.1AE) secure association, set up once per SA with armv8_macsec_sa_init or armv8_macsec_xpn_sa_init
+typedef struct macsec_sa {
+    const armv8_cipher_constants_t * constants;
+    armv8_quadword_t iv_base;   // first counter block with the PN bits of the IV zeroed - SCI | 0 or Salt ^ (SSCI | 0)
+    uint8_t xpn;                // 1 for GCM-AES-XPN-128/256 (64b PN), 0 for GCM-AES-128/256 (32b PN)
+} armv8_macsec_sa_t;
+
+// TLS 1.3 (RFC 8446) record protection for one direction of a connection, set up with armv8_tls13_context_init
+typedef struct tls13_context {
+    const armv8_cipher_constants_t * constants;
+    armv8_quadword_t iv;        // first counter block from the static write_iv, the sequence number is XORed in per record
+    uint64_t sequence_number;   // sequence number of the next record, incremented by seal and by a successful open
+} armv8_tls13_context_t;
+
+// QUIC (RFC 9001) packet protection for one direction of a connection, set up with armv8_quic_context_init
+typedef struct quic_context {
+    const armv8_cipher_constants_t * constants;     // packet protection key
+    const armv8_cipher_constants_t * hp_constants;  // header protection key - only the expanded AES keys are used
+    armv8_quadword_t iv;                            // first counter block from the static iv, the packet number is XORed in per packet
+} armv8_quic_context_t;
+
 typedef struct {
 	struct {
 		uint8_t *key;
@@ -70,6 +121,10 @@ typedef struct {
  */
 void armv8_expandkeys_enc_aes_cbc_128(uint8_t *expanded_key, const uint8_t *user_key);
 void armv8_expandkeys_dec_aes_cbc_128(uint8_t *expanded_key, const uint8_t *user_key);
+void armv8_expandkeys_enc_aes_cbc_192(uint8_t *expanded_key, const uint8_t *user_key);
+void armv8_expandkeys_dec_aes_cbc_192(uint8_t *expanded_key, const uint8_t *user_key);
+void armv8_expandkeys_enc_aes_cbc_256(uint8_t *expanded_key, const uint8_t *user_key);
+void armv8_expandkeys_dec_aes_cbc_256(uint8_t *expanded_key, const uint8_t *user_key);
 int armv8_sha1_block_partial(uint8_t *init, const uint8_t *src, uint8_t *dst,
 			uint64_t len);
 int armv8_sha256_block_partial(uint8_t *init, const uint8_t *src, uint8_t *dst,
@@ -93,6 +148,38 @@ int armv8_dec_aes_cbc_sha256_128(
 			uint8_t *csrc, uint8_t *cdst, uint64_t clen,
 			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
 			armv8_cipher_digest_t *arg);
+int armv8_enc_aes_cbc_sha1_192(
+			uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+int armv8_enc_aes_cbc_sha256_192(
+			uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+int armv8_dec_aes_cbc_sha1_192(
+			uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+int armv8_dec_aes_cbc_sha256_192(
+			uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+int armv8_enc_aes_cbc_sha1_256(
+			uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+int armv8_enc_aes_cbc_sha256_256(
+			uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+int armv8_dec_aes_cbc_sha1_256(
+			uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+int armv8_dec_aes_cbc_sha256_256(
+			uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
 
 // set the cipher_constants
 armv8_operation_result_t armv8_aes_gcm_set_constants(
@@ -104,7 +191,7 @@ armv8_operation_result_t armv8_aes_gcm_set_constants(
 // set the counter based on a nonce value (will invoke GHASH if nonce_length!=96)
 armv8_operation_result_t armv8_aes_gcm_set_counter(
     uint8_t * restrict nonce, uint64_t nonce_length,
-        //assumed that nonce can be read in 16B blocks - will read (but not use) up to 15B beyond the end of the nonce
+        //only the nonce itself is read
     armv8_cipher_state_t * restrict cs);
 
 // mode indicates which AEAD is being used (currently only planning to support AES-GCM variants)
@@ -228,6 +315,201 @@ armv8_operation_result_t armv8_dec_aes_gcm_from_state(
         //assumed that plaintext can be written in 16B blocks - will write up to 15B of 0s beyond the end of the ciphertext
     );
 
+// Exact length variants of the above - nothing outside [aad, aad+aad_length), [plaintext, plaintext+plaintext_length),
+// [ciphertext, ciphertext+ciphertext_length) or [tag, tag+tag_byte_length) is read or written, so buffers can end at
+// the end of a page or mbuf without being copied
+// The final partial block goes through a 16B block on the stack, the rest runs as the variants above
+// tag_byte_length is the one in the constants for the from_state variants, and must be 4, 8 or 12 to 16
+// expected return values as the variants above, plus INVALID_PARAMETER for an invalid tag_byte_length
+armv8_operation_result_t armv8_enc_aes_gcm_full_exact(
+    //Inputs
+    armv8_cipher_mode_t mode,
+    uint8_t * restrict key,
+    uint8_t * restrict nonce, uint64_t nonce_bit_length,
+    uint8_t * restrict aad,   uint64_t aad_bit_length,
+    uint8_t * plaintext,      uint64_t plaintext_bit_length,
+    uint64_t tag_byte_length,
+    //Outputs
+    uint8_t * ciphertext,
+    uint8_t * tag
+    );
+
+armv8_operation_result_t armv8_enc_aes_gcm_from_state_exact(
+    //Inputs
+    armv8_cipher_state_t * cs,
+    uint8_t * restrict aad,   uint64_t aad_bit_length,
+    uint8_t * plaintext,      uint64_t plaintext_bit_length,
+    //Outputs
+    uint8_t * ciphertext,
+    uint8_t * tag
+    );
+
+armv8_operation_result_t armv8_dec_aes_gcm_full_exact(
+    //Inputs
+    armv8_cipher_mode_t mode,
+    uint8_t * restrict key,
+    uint8_t * restrict nonce, uint64_t nonce_bit_length,
+    uint8_t * restrict aad,   uint64_t aad_bit_length,
+    uint8_t * ciphertext,     uint64_t ciphertext_bit_length,
+    uint8_t * tag, uint64_t tag_byte_length,
+    //Output
+    uint8_t * plaintext
+    );
+
+armv8_operation_result_t armv8_dec_aes_gcm_from_state_exact(
+    //Inputs
+    armv8_cipher_state_t * cs,
+    uint8_t * restrict aad, uint64_t aad_bit_length,
+    uint8_t * ciphertext,   uint64_t ciphertext_bit_length,
+    uint8_t * tag,
+    //Output
+    uint8_t * plaintext
+    );
+
+// As armv8_enc_aes_gcm_from_state_exact and armv8_dec_aes_gcm_from_state_exact for one key size, for callers that
+// know it at compile time (e.g. AArch64cryptolib.hpp) - these go straight to that key size's kernels without the
+// switch on cs->constants->mode, and return INVALID_PARAMETER if the constants were set up for another key size
+armv8_operation_result_t armv8_enc_aes_gcm_from_state_exact_128(
+    armv8_cipher_state_t * cs,
+    uint8_t * restrict aad,   uint64_t aad_bit_length,
+    uint8_t * plaintext,      uint64_t plaintext_bit_length,
+    uint8_t * ciphertext,
+    uint8_t * tag);
+armv8_operation_result_t armv8_enc_aes_gcm_from_state_exact_192(
+    armv8_cipher_state_t * cs,
+    uint8_t * restrict aad,   uint64_t aad_bit_length,
+    uint8_t * plaintext,      uint64_t plaintext_bit_length,
+    uint8_t * ciphertext,
+    uint8_t * tag);
+armv8_operation_result_t armv8_enc_aes_gcm_from_state_exact_256(
+    armv8_cipher_state_t * cs,
+    uint8_t * restrict aad,   uint64_t aad_bit_length,
+    uint8_t * plaintext,      uint64_t plaintext_bit_length,
+    uint8_t * ciphertext,
+    uint8_t * tag);
+armv8_operation_result_t armv8_dec_aes_gcm_from_state_exact_128(
+    armv8_cipher_state_t * cs,
+    uint8_t * restrict aad, uint64_t aad_bit_length,
+    uint8_t * ciphertext,   uint64_t ciphertext_bit_length,
+    uint8_t * tag,
+    uint8_t * plaintext);
+armv8_operation_result_t armv8_dec_aes_gcm_from_state_exact_192(
+    armv8_cipher_state_t * cs,
+    uint8_t * restrict aad, uint64_t aad_bit_length,
+    uint8_t * ciphertext,   uint64_t ciphertext_bit_length,
+    uint8_t * tag,
+    uint8_t * plaintext);
+armv8_operation_result_t armv8_dec_aes_gcm_from_state_exact_256(
+    armv8_cipher_state_t * cs,
+    uint8_t * restrict aad, uint64_t aad_bit_length,
+    uint8_t * ciphertext,   uint64_t ciphertext_bit_length,
+    uint8_t * tag,
+    uint8_t * plaintext);
+
+// Bulk variants of armv8_enc_aes_gcm_from_state and armv8_dec_aes_gcm_from_state, for large messages whose output
+// won't be read again soon (e.g. on its way to disk or the network)
+// The output is written with non-temporal stores and the input prefetched as streaming, so that the message doesn't
+// evict the rest of the working set from the caches - the kernel writes each 16KB chunk to a buffer on the stack,
+// which is then streamed out
+// Messages shorter than ARMV8_AES_GCM_BULK_MIN_BYTES are processed as the variants above, where the output is likely
+// to be used while it is still cached
+// Buffer requirements and return values as the variants above
+#define ARMV8_AES_GCM_BULK_MIN_BYTES    (256u << 10)
+
+armv8_operation_result_t armv8_enc_aes_gcm_from_state_bulk(
+    //Inputs
+    armv8_cipher_state_t * cs,
+    uint8_t * restrict aad,   uint64_t aad_bit_length,
+    uint8_t * plaintext,      uint64_t plaintext_bit_length,
+    //Outputs
+    uint8_t * ciphertext,
+    uint8_t * tag
+    );
+
+armv8_operation_result_t armv8_dec_aes_gcm_from_state_bulk(
+    //Inputs
+    armv8_cipher_state_t * cs,
+    uint8_t * restrict aad, uint64_t aad_bit_length,
+    uint8_t * ciphertext,   uint64_t ciphertext_bit_length,
+    uint8_t * tag,
+    //Output
+    uint8_t * plaintext
+    );
+
+// Random access to a large message, e.g. serving range reads of an encrypted object
+// cs is as set up by armv8_aes_gcm_set_counter for the whole message (the counter is J0) and is not changed, so one
+// cipher_state_t can serve any number of ranges, from any number of threads
+
+// Decrypt bytes [range_bit_offset/8, range_bit_offset/8 + ciphertext_bit_length/8) of the message, given only the
+// ciphertext of that range, at a cost in proportion to the range rather than the message
+// The tag is NOT checked - the plaintext is unauthenticated until the whole message is verified, e.g. with
+// armv8_aes_gcm_verify_segments
+// Only reads ciphertext_bit_length/8 bytes of ciphertext and writes as many of plaintext, which may be the same buffer
+// expected return value is SUCCESSFUL_OPERATION, or INVALID_PARAMETER if the offset or length isn't whole bytes or the
+// range runs beyond the longest GCM message (2^32-2 blocks)
+armv8_operation_result_t armv8_dec_aes_gcm_range(
+    //Inputs
+    const armv8_cipher_state_t * cs,
+    uint64_t range_bit_offset,
+    uint8_t * ciphertext,   uint64_t ciphertext_bit_length,
+    //Output
+    uint8_t * plaintext
+    );
+
+// Encrypt bytes [range_bit_offset/8, range_bit_offset/8 + plaintext_bit_length/8) of the message on their own, e.g.
+// to split a large message between threads - no tag is computed, the message tag comes from
+// armv8_aes_gcm_tag_segments over the ciphertext segments
+// Buffers and return value as armv8_dec_aes_gcm_range
+armv8_operation_result_t armv8_enc_aes_gcm_range(
+    //Inputs
+    const armv8_cipher_state_t * cs,
+    uint64_t range_bit_offset,
+    uint8_t * plaintext,    uint64_t plaintext_bit_length,
+    //Output
+    uint8_t * ciphertext
+    );
+
+// GHASH of one segment of the ciphertext on its own, so the segments of a message can be hashed in parallel
+// Segments are hashed with armv8_aes_gcm_ghash_segment (in any order, on any thread) and then combined, in message
+// order, by armv8_aes_gcm_verify_segments or armv8_aes_gcm_tag_segments, costing O(log(segment length)) per segment
+// on top of the hashing
+// Every segment but the last must be a whole number of 16B blocks
+typedef struct aes_gcm_segment {
+    armv8_quadword_t hash;      // GHASH of the segment from zero, in the library's internal form
+    uint64_t bit_length;
+} armv8_aes_gcm_segment_t;
+
+// Only reads ciphertext_bit_length/8 bytes of ciphertext
+armv8_operation_result_t armv8_aes_gcm_ghash_segment(
+    //Inputs
+    armv8_cipher_constants_t * cc,
+    uint8_t * ciphertext,   uint64_t ciphertext_bit_length,
+    //Output
+    armv8_aes_gcm_segment_t * segment
+    );
+
+// Combine the segment hashes with the aad into the whole message tag, writing exactly tag_byte_length bytes
+// expected return value is SUCCESSFUL_OPERATION, or INVALID_PARAMETER as armv8_aes_gcm_verify_segments
+armv8_operation_result_t armv8_aes_gcm_tag_segments(
+    //Inputs
+    const armv8_cipher_state_t * cs,
+    uint8_t * aad,          uint64_t aad_bit_length,
+    const armv8_aes_gcm_segment_t * segments, uint32_t segment_count,
+    //Output
+    uint8_t * tag
+    );
+
+// Combine the segment hashes with the aad and check the whole message tag
+// expected return value is SUCCESSFUL_OPERATION, AUTHENTICATION_FAILURE if the tag doesn't match, or INVALID_PARAMETER
+// for an invalid tag length or a segment other than the last which isn't whole blocks
+armv8_operation_result_t armv8_aes_gcm_verify_segments(
+    //Inputs
+    const armv8_cipher_state_t * cs,
+    uint8_t * aad,          uint64_t aad_bit_length,
+    const armv8_aes_gcm_segment_t * segments, uint32_t segment_count,
+    uint8_t * tag
+    );
+
 // Given a set up cipher_constants_t and the IPsec salt and ESPIV, perform decryption in place
 // Compute checksum of the plaintext at the same time
 armv8_operation_result_t armv8_dec_aes_gcm_from_constants_IPsec(
@@ -250,4 +532,688 @@ armv8_operation_result_t armv8_dec_aes_gcm_from_constants_IPsec(
         //one's complement sum of all 64b words in the plaintext
     );
 
+// Given a set up cipher_constants_t and the IPsec salt and ESPIV, authenticate an ESP packet using
+// NULL encryption with AES-GMAC integrity (RFC 4543) - the payload is only authenticated, never encrypted
+// The ESPIV is authenticated between the aad and the payload, as it appears on the wire
+// Compute checksum of the payload at the same time
+armv8_operation_result_t armv8_gmac_from_constants_IPsec(
+    //Inputs
+    const armv8_cipher_constants_t * cc,
+    uint32_t salt,
+    uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+        //aad_byte_length 8 or 12 (SPI | SN or SPI | ESN high | ESN low)
+    const uint8_t * payload,        uint32_t payload_byte_length,
+        //payload is unmodified
+        //assumed that payload can be read in 16B blocks - will read (but not use) up to 15B beyond the end of the payload
+    //Outputs
+    uint8_t * tag,
+        //tag written after payload, so tag will be produced correctly if directly after payload
+        //will always write 16B of tag, regardless of the tag_byte_length specified in cc
+        //caller must ensure that this region is accessible and must preserve any important data
+    uint64_t * checksum
+        //one's complement sum of all 64b words in the payload, not computed if NULL
+    );
+
+// Given a set up cipher_constants_t and the IPsec salt and ESPIV, check the AES-GMAC (RFC 4543) tag of an ESP packet
+// expected return value is SUCCESSFUL_OPERATION or AUTHENTICATION_FAILURE (if the provided tag does not match the computed tag)
+armv8_operation_result_t armv8_gmac_verify_from_constants_IPsec(
+    //Inputs
+    const armv8_cipher_constants_t * cc,
+    uint32_t salt,
+    uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+        //aad_byte_length 8 or 12 (SPI | SN or SPI | ESN high | ESN low)
+    const uint8_t * payload,        uint32_t payload_byte_length,
+        //payload is unmodified
+        //assumed that payload can be read in 16B blocks - will read (but not use) up to 15B beyond the end of the payload
+    const uint8_t * tag,
+        //tag_byte_length specified in cipher_constants, precisely the size specified will be read
+    //Output
+    uint64_t * checksum
+        //one's complement sum of all 64b words in the payload, not computed if NULL
+    );
+
+// Set up compact constants for one key size - key is the 16B, 24B or 32B master key
+armv8_operation_result_t armv8_aes_gcm_set_compact_constants_128(
+    uint8_t tag_byte_length,
+    uint8_t * restrict key,
+    armv8_compact_constants_128_t * restrict cc);
+armv8_operation_result_t armv8_aes_gcm_set_compact_constants_192(
+    uint8_t tag_byte_length,
+    uint8_t * restrict key,
+    armv8_compact_constants_192_t * restrict cc);
+armv8_operation_result_t armv8_aes_gcm_set_compact_constants_256(
+    uint8_t tag_byte_length,
+    uint8_t * restrict key,
+    armv8_compact_constants_256_t * restrict cc);
+
+// As armv8_enc_aes_gcm_from_constants_IPsec and armv8_dec_aes_gcm_from_constants_IPsec, with the same requirements on
+// the buffers, but reading the keys from compact constants - the kernels are the same, so the performance is too
+armv8_operation_result_t armv8_enc_aes_gcm_from_compact_IPsec_128(
+    const armv8_compact_constants_128_t * cc,
+    uint32_t salt, uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+    uint8_t * plaintext,            uint32_t plaintext_byte_length,
+    uint8_t * tag);
+armv8_operation_result_t armv8_enc_aes_gcm_from_compact_IPsec_192(
+    const armv8_compact_constants_192_t * cc,
+    uint32_t salt, uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+    uint8_t * plaintext,            uint32_t plaintext_byte_length,
+    uint8_t * tag);
+armv8_operation_result_t armv8_enc_aes_gcm_from_compact_IPsec_256(
+    const armv8_compact_constants_256_t * cc,
+    uint32_t salt, uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+    uint8_t * plaintext,            uint32_t plaintext_byte_length,
+    uint8_t * tag);
+
+armv8_operation_result_t armv8_dec_aes_gcm_from_compact_IPsec_128(
+    const armv8_compact_constants_128_t * cc,
+    uint32_t salt, uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+    uint8_t * ciphertext,   uint32_t ciphertext_byte_length,
+    const uint8_t * tag,
+    uint64_t * checksum);
+armv8_operation_result_t armv8_dec_aes_gcm_from_compact_IPsec_192(
+    const armv8_compact_constants_192_t * cc,
+    uint32_t salt, uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+    uint8_t * ciphertext,   uint32_t ciphertext_byte_length,
+    const uint8_t * tag,
+    uint64_t * checksum);
+armv8_operation_result_t armv8_dec_aes_gcm_from_compact_IPsec_256(
+    const armv8_compact_constants_256_t * cc,
+    uint32_t salt, uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+    uint8_t * ciphertext,   uint32_t ciphertext_byte_length,
+    const uint8_t * tag,
+    uint64_t * checksum);
+
+// Set up a MACsec SA for GCM-AES-128/256 - sci is the 8B Secure Channel Identifier as transmitted
+armv8_operation_result_t armv8_macsec_sa_init(
+    armv8_macsec_sa_t * sa,
+    const armv8_cipher_constants_t * cc,
+    const uint8_t * sci);
+
+// Set up a MACsec SA for GCM-AES-XPN-128/256 - ssci is the Short SCI, salt the 12B salt from the key agreement
+armv8_operation_result_t armv8_macsec_xpn_sa_init(
+    armv8_macsec_sa_t * sa,
+    const armv8_cipher_constants_t * cc,
+    uint32_t ssci,
+    const uint8_t * salt);
+
+// Protect a MACsec frame in place (confidentiality offset 0)
+// frame is DA | SA | SecTAG | User Data, with the SecTAG already filled in by the caller
+// The SecTAG is 8B, or 16B if the SC bit of the TCI is set, so the AAD (DA through SecTAG) is a fixed 20B or 28B
+// PN is the packet number - only the low 32b are used unless the SA is XPN
+// expected return value is SUCCESSFUL_OPERATION, or INVALID_PARAMETER if the frame is shorter than its AAD
+armv8_operation_result_t armv8_macsec_protect(
+    //Inputs
+    const armv8_macsec_sa_t * sa,
+    uint64_t PN,
+    uint8_t * frame,    uint32_t frame_byte_length,
+        //frame_byte_length is DA through the end of User Data, excluding the ICV
+        //in place operation - User Data becomes Secure Data
+        //assumed that frame can be read and written in 16B blocks - will read (but not use) up to 15B beyond the end of the frame
+    //Output
+    uint8_t * icv
+        //16B ICV, produced correctly if directly after the frame
+    );
+
+// Validate a MACsec frame in place (confidentiality offset 0)
+// expected return value is SUCCESSFUL_OPERATION or AUTHENTICATION_FAILURE (if the ICV does not match)
+armv8_operation_result_t armv8_macsec_validate(
+    //Inputs
+    const armv8_macsec_sa_t * sa,
+    uint64_t PN,
+        //for XPN SAs the caller recovers the high 32b of the PN as described in IEEE 802.1AE
+    uint8_t * frame,    uint32_t frame_byte_length,
+        //frame_byte_length is DA through the end of Secure Data, excluding the ICV
+        //in place operation - Secure Data becomes User Data
+        //assumed that frame can be read and written in 16B blocks - will read (but not use) up to 15B beyond the end of the frame
+    const uint8_t * icv
+        //16B ICV, read before the frame is decrypted so it is preserved if directly after the frame
+    );
+
+// Burst variants - process count frames of the same SA
+// protect returns SUCCESSFUL_OPERATION if all frames were protected
+// validate returns SUCCESSFUL_OPERATION if all frames were valid, with the result for each frame in results
+// ICVs are expected directly after each frame
+armv8_operation_result_t armv8_macsec_protect_burst(
+    const armv8_macsec_sa_t * sa,
+    const uint64_t * PN,
+    uint8_t * const * frames, const uint32_t * frame_byte_lengths,
+    uint32_t count);
+
+armv8_operation_result_t armv8_macsec_validate_burst(
+    const armv8_macsec_sa_t * sa,
+    const uint64_t * PN,
+    uint8_t * const * frames, const uint32_t * frame_byte_lengths,
+    uint32_t count,
+    armv8_operation_result_t * results);
+
+// Set up a TLS 1.3 context for TLS_AES_128_GCM_SHA256 or TLS_AES_256_GCM_SHA384
+// static_iv is the 12B write_iv from the key schedule, the sequence number starts at 0
+armv8_operation_result_t armv8_tls13_context_init(
+    armv8_tls13_context_t * ctx,
+    const armv8_cipher_constants_t * cc,
+    const uint8_t * static_iv);
+
+// Seal a TLS 1.3 record in place
+// record is 5B of space for the header followed by content_byte_length (up to 2^14) bytes of content
+// The header, inner content type and 16B tag are written here, leaving a TLSCiphertext of
+// 5 + content_byte_length + 1 + 16 bytes
+// expected return value is SUCCESSFUL_OPERATION, or INVALID_PARAMETER if the content is too long or the
+// sequence number is exhausted
+armv8_operation_result_t armv8_tls13_seal(
+    //Inputs
+    armv8_tls13_context_t * ctx,
+    uint8_t content_type,
+    uint8_t * record,   uint32_t content_byte_length,
+        //assumed that record can be read and written in 16B blocks - will read (but not use) up to 15B beyond the end of the content
+    //Output
+    uint32_t * record_byte_length);
+
+// Open a TLS 1.3 record in place
+// record is a TLSCiphertext of record_byte_length bytes, the content is decrypted in place starting 5B into record
+// content_type and content_byte_length are returned with any zero padding removed
+// expected return value is SUCCESSFUL_OPERATION, AUTHENTICATION_FAILURE (if the tag does not match),
+// or INVALID_PARAMETER if the header is malformed or there is no non-zero content type
+armv8_operation_result_t armv8_tls13_open(
+    //Inputs
+    armv8_tls13_context_t * ctx,
+    uint8_t * record,   uint32_t record_byte_length,
+        //assumed that record can be read and written in 16B blocks - will read (but not use) up to 15B beyond the end of the record
+    //Outputs
+    uint8_t * content_type,
+    uint32_t * content_byte_length);
+
+// Set up a QUIC context for AEAD_AES_128_GCM or AEAD_AES_256_GCM
+// cc and hp_cc are set up by armv8_aes_gcm_set_constants from the quic key and quic hp key, and must use the same mode
+// static_iv is the 12B quic iv
+armv8_operation_result_t armv8_quic_context_init(
+    armv8_quic_context_t * ctx,
+    const armv8_cipher_constants_t * cc,
+    const armv8_cipher_constants_t * hp_cc,
+    const uint8_t * static_iv);
+
+// Protect a QUIC packet in place - AEAD over the payload, then header protection
+// packet is header | payload, where the header ends with the truncated packet number, whose length is given by the
+// low 2 bits of the first byte
+// The 16B tag is written after the payload, then the first byte and packet number are masked
+// expected return value is SUCCESSFUL_OPERATION, or INVALID_PARAMETER if the packet is too short to sample
+armv8_operation_result_t armv8_quic_protect(
+    //Inputs
+    const armv8_quic_context_t * ctx,
+    uint64_t packet_number,
+        //full packet number, which must match the truncated packet number in the header
+    uint8_t * packet,   uint32_t header_byte_length,    uint32_t payload_byte_length
+        //assumed that packet can be read and written in 16B blocks - will read (but not use) up to 15B beyond the end of the payload
+    );
+
+// Unprotect a QUIC packet in place - remove header protection, then decrypt and authenticate the payload
+// pn_offset is the offset of the packet number in the header and packet_byte_length includes the 16B tag
+// largest_pn is the largest packet number successfully processed so far in this packet number space (UINT64_MAX if none)
+// The header is always unprotected in place, the payload is only valid if SUCCESSFUL_OPERATION is returned
+// expected return value is SUCCESSFUL_OPERATION, AUTHENTICATION_FAILURE (if the tag does not match),
+// or INVALID_PARAMETER if the packet is too short
+armv8_operation_result_t armv8_quic_unprotect(
+    //Inputs
+    const armv8_quic_context_t * ctx,
+    uint64_t largest_pn,
+    uint8_t * packet,   uint32_t pn_offset,     uint32_t packet_byte_length,
+        //assumed that packet can be read and written in 16B blocks - will read (but not use) up to 15B beyond the end of the packet
+    //Outputs
+    uint64_t * packet_number,
+    uint32_t * header_byte_length,
+    uint32_t * payload_byte_length);
+
+// Burst variants for packet trains (e.g. GSO) of the same connection
+// protect returns SUCCESSFUL_OPERATION if all packets were protected
+// unprotect returns SUCCESSFUL_OPERATION if all packets were valid, with the result for each packet in results, and
+// updates largest_pn as packets are authenticated
+armv8_operation_result_t armv8_quic_protect_burst(
+    const armv8_quic_context_t * ctx,
+    const uint64_t * packet_numbers,
+    uint8_t * const * packets, const uint32_t * header_byte_lengths, const uint32_t * payload_byte_lengths,
+    uint32_t count);
+
+armv8_operation_result_t armv8_quic_unprotect_burst(
+    const armv8_quic_context_t * ctx,
+    uint64_t * largest_pn,
+    uint8_t * const * packets, const uint32_t * pn_offsets, const uint32_t * packet_byte_lengths,
+    uint32_t count,
+    uint64_t * packet_numbers,
+    uint32_t * header_byte_lengths,
+    uint32_t * payload_byte_lengths,
+    armv8_operation_result_t * results);
+
+// Context pool - fixed size contexts (armv8_cipher_constants_t, armv8_compact_constants_*_t or any other per key
+// state) carved 64B aligned from 2MB hugepages bound to one NUMA node, so that a large table of keys costs few TLB
+// entries and no remote memory accesses
+// A context is named by a 32 bit handle, and armv8_ctx_pool_ptr turns it into a pointer with one multiply-add
+// Allocation and free are lock-free - each thread has its own small free list in the pool, refilled from and
+// spilled to a shared lock-free free list in batches. Once a thread exits, its free lists are passed on to a later
+// thread, so only threads that are alive at the same time count towards ARMV8_CTX_POOL_MAX_THREADS
+typedef uint32_t armv8_ctx_handle_t;
+#define ARMV8_CTX_HANDLE_INVALID        0xffffffffu
+#define ARMV8_CTX_POOL_MAX_THREADS      256     // live threads beyond this use the shared free list directly
+#define ARMV8_CTX_POOL_CACHE_HANDLES    31
+
+typedef struct __attribute__((aligned(64))) ctx_pool_cache {
+    uint32_t count;
+    armv8_ctx_handle_t handles[ARMV8_CTX_POOL_CACHE_HANDLES];
+} armv8_ctx_pool_cache_t;
+
+typedef struct ctx_pool {
+    uint8_t * base;                 // context 0
+    uint32_t stride;                // bytes between contexts, context_byte_length rounded up to 64B
+    uint32_t capacity;
+    uint32_t hugepages;             // 1 if backed by reserved 2MB hugepages, 0 if by transparent hugepages
+    int32_t numa_node;              // -1 if not bound
+    // internal
+    void * mapping;
+    size_t mapping_byte_length;
+    uint64_t free_head __attribute__((aligned(64)));    // ABA tag << 32 | first free handle
+    armv8_ctx_pool_cache_t caches[ARMV8_CTX_POOL_MAX_THREADS];
+} armv8_ctx_pool_t;
+
+// Create a pool of capacity contexts of context_byte_length bytes each, on numa_node (or wherever the first touch
+// happens to be if numa_node is -1)
+// Reserved hugepages (vm.nr_hugepages) are used if there are enough, otherwise the pool is 2MB aligned and
+// transparent hugepages are requested
+// All of the memory is touched (zeroed) here, so nothing is faulted in on the data path
+// expected return value is SUCCESSFUL_OPERATION, INVALID_PARAMETER if the sizes or node are out of range or the
+// memory can't be bound to the node, or INTERNAL_FAILURE if the memory can't be mapped
+armv8_operation_result_t armv8_ctx_pool_create(
+    uint32_t context_byte_length,
+    uint32_t capacity,
+    int32_t numa_node,
+    armv8_ctx_pool_t ** pool);
+
+// Unmap the pool - all handles and pointers into it become invalid
+void armv8_ctx_pool_destroy(armv8_ctx_pool_t * pool);
+
+// expected return value is SUCCESSFUL_OPERATION, or INTERNAL_FAILURE (with *handle set to ARMV8_CTX_HANDLE_INVALID)
+// if every context is in use or held in other threads' free lists (at most ARMV8_CTX_POOL_CACHE_HANDLES each)
+// A context that has been freed and allocated again still holds whatever was last written to it
+armv8_operation_result_t armv8_ctx_pool_alloc(
+    armv8_ctx_pool_t * pool,
+    armv8_ctx_handle_t * handle);
+
+void armv8_ctx_pool_free(
+    armv8_ctx_pool_t * pool,
+    armv8_ctx_handle_t handle);
+
+// Return the contexts held in the calling thread's free list to the shared free list, e.g. before the thread exits
+void armv8_ctx_pool_flush(armv8_ctx_pool_t * pool);
+
+static inline void * armv8_ctx_pool_ptr(const armv8_ctx_pool_t * pool, armv8_ctx_handle_t handle)
+{
+    return pool->base + (size_t) handle * pool->stride;
+}
+
+// Allocate a context and set up AES-GCM constants directly in it, the pool's contexts must be at least
+// sizeof(armv8_cipher_constants_t) bytes
+// expected return value is SUCCESSFUL_OPERATION, or as armv8_ctx_pool_alloc and armv8_aes_gcm_set_constants
+armv8_operation_result_t armv8_ctx_pool_alloc_constants(
+    armv8_ctx_pool_t * pool,
+    armv8_cipher_mode_t mode,
+    uint8_t tag_byte_length,
+    uint8_t * restrict key,
+    armv8_ctx_handle_t * handle);
+
+// Re-keying - two armv8_cipher_constants_t slots, one of which is active
+// armv8_rekey_set sets up the new key in the inactive slot and publishes it, while readers that picked up the old
+// slot keep using it until they pass a quiescent state (armv8_rekey_quiescent, e.g. once per packet burst)
+// armv8_rekey_reclaim scrubs the old slot once every registered reader has passed a quiescent state since it was
+// replaced, after which the next armv8_rekey_set can reuse it
+// On the data path readers only do loads and a store to their own cache line - no locks and no atomic RMW
+// Only one thread at a time may call armv8_rekey_init, armv8_rekey_set, armv8_rekey_reclaim or armv8_rekey_synchronize
+// on a handle
+#define ARMV8_REKEY_MAX_READERS         64
+#define ARMV8_REKEY_OFFLINE             UINT64_MAX
+
+typedef struct __attribute__((aligned(64))) rekey_reader {
+    uint64_t epoch;                 // last epoch this reader saw in a quiescent state, or ARMV8_REKEY_OFFLINE
+    uint32_t registered;
+} armv8_rekey_reader_t;
+
+typedef struct rekey_handle {
+    armv8_cipher_constants_t slots[2];
+    uint32_t active __attribute__((aligned(64)));   // slot readers pick up
+    uint64_t epoch;                 // incremented each time a slot is published
+    uint64_t retired_epoch;         // epoch at which the inactive slot was replaced, 0 once it has been scrubbed
+    armv8_rekey_reader_t readers[ARMV8_REKEY_MAX_READERS];
+} armv8_rekey_handle_t;
+
+// Set up the first key in slot 0, with no readers registered
+armv8_operation_result_t armv8_rekey_init(
+    armv8_rekey_handle_t * handle,
+    armv8_cipher_mode_t mode,
+    uint8_t tag_byte_length,
+    uint8_t * restrict key);
+
+// Set up a new key in the inactive slot with armv8_aes_gcm_set_constants and make it the active slot
+// expected return value is SUCCESSFUL_OPERATION, or INTERNAL_FAILURE (with nothing changed) if the inactive slot may
+// still be in use since the previous armv8_rekey_set (see armv8_rekey_reclaim) or armv8_aes_gcm_set_constants fails
+armv8_operation_result_t armv8_rekey_set(
+    armv8_rekey_handle_t * handle,
+    armv8_cipher_mode_t mode,
+    uint8_t tag_byte_length,
+    uint8_t * restrict key);
+
+// Scrub the replaced slot if every registered reader has passed a quiescent state since armv8_rekey_set
+// expected return value is SUCCESSFUL_OPERATION if the inactive slot is free (including if it already was), or
+// INTERNAL_FAILURE if some reader may still be using it
+armv8_operation_result_t armv8_rekey_reclaim(armv8_rekey_handle_t * handle);
+
+// armv8_rekey_reclaim, waiting for the readers - must not be called by a registered reader that is online
+void armv8_rekey_synchronize(armv8_rekey_handle_t * handle);
+
+// Claim a reader slot for the calling thread, online from now on
+// expected return value is SUCCESSFUL_OPERATION, or INTERNAL_FAILURE if all ARMV8_REKEY_MAX_READERS are taken
+armv8_operation_result_t armv8_rekey_reader_register(
+    armv8_rekey_handle_t * handle,
+    uint32_t * reader);
+
+void armv8_rekey_reader_unregister(
+    armv8_rekey_handle_t * handle,
+    uint32_t reader);
+
+// The constants to use until the reader's next quiescent state
+static inline armv8_cipher_constants_t * armv8_rekey_constants(armv8_rekey_handle_t * handle)
+{
+    return &handle->slots[__atomic_load_n(&handle->active, __ATOMIC_ACQUIRE)];
+}
+
+// The reader holds no pointer from armv8_rekey_constants
+static inline void armv8_rekey_quiescent(armv8_rekey_handle_t * handle, uint32_t reader)
+{
+    __atomic_store_n(&handle->readers[reader].epoch, __atomic_load_n(&handle->epoch, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+}
+
+// A reader that will be idle for a while can go offline so that it doesn't hold up armv8_rekey_reclaim, and must go
+// online again before its next armv8_rekey_constants
+static inline void armv8_rekey_offline(armv8_rekey_handle_t * handle, uint32_t reader)
+{
+    __atomic_store_n(&handle->readers[reader].epoch, ARMV8_REKEY_OFFLINE, __ATOMIC_RELEASE);
+}
+
+static inline void armv8_rekey_online(armv8_rekey_handle_t * handle, uint32_t reader)
+{
+    armv8_rekey_quiescent(handle, reader);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+// Chunked AES-GCM stream format, after the STREAM construction (Hoang, Reyhanitabar, Rogaway and Vizar)
+// A stream is a 32B header followed by chunks of ciphertext, each chunk_byte_length bytes but the last (which may be
+// shorter, and is empty only for an empty stream) and each followed by its 16B tag
+// Chunk i is sealed with the nonce nonce_prefix (7B) | i (4B big endian) | last (1B, 1 for the last chunk, else 0)
+// and with the header as its aad, so chunks can't be reordered, dropped, moved between streams or have their parameters
+// changed, and a stream can't be truncated or extended at a chunk boundary without a chunk failing to open
+// Each chunk is independent of the others, so chunks can be sealed and opened in any order on any number of threads,
+// and a stream can be decrypted with memory for only a few chunks at a time
+// Header: "A64S" | version (1) | mode (1) | 0 (2) | chunk_byte_length (4B little endian) | nonce_prefix (7) | 0 (13)
+#define ARMV8_STREAM_HEADER_BYTES       32
+#define ARMV8_STREAM_NONCE_PREFIX_BYTES 7
+#define ARMV8_STREAM_TAG_BYTES          16
+#define ARMV8_STREAM_MAX_CHUNKS         (1ull << 32)
+
+typedef struct stream_context {
+    armv8_cipher_constants_t constants;
+    uint8_t header[ARMV8_STREAM_HEADER_BYTES];
+    uint32_t chunk_byte_length;
+} armv8_stream_context_t;
+
+// Set up a context to seal a new stream, and its header (ctx->header) to write out first
+// nonce_prefix must never be repeated with the same key - e.g. 7 random bytes per stream
+// chunk_byte_length must be a non-zero multiple of 16B, at most 1GB
+// expected return value is SUCCESSFUL_OPERATION, or INVALID_PARAMETER
+armv8_operation_result_t armv8_stream_init_seal(
+    armv8_stream_context_t * ctx,
+    armv8_cipher_mode_t mode,
+    uint8_t * restrict key,
+    const uint8_t * nonce_prefix,
+    uint32_t chunk_byte_length);
+
+// Set up a context to open a stream from its header
+// expected return value is SUCCESSFUL_OPERATION, or INVALID_PARAMETER if the header is not a valid stream header
+// (the header is only authenticated when the first chunk is opened)
+armv8_operation_result_t armv8_stream_init_open(
+    armv8_stream_context_t * ctx,
+    uint8_t * restrict key,
+    const uint8_t * header);
+
+// Seal chunk chunk_index, which must be chunk_byte_length bytes unless last
+// Buffers are read and written exactly (as the _exact variants), ctx is only read, so it can be shared by threads
+// expected return value is SUCCESSFUL_OPERATION, or INVALID_PARAMETER for a chunk of the wrong length
+armv8_operation_result_t armv8_stream_seal_chunk(
+    //Inputs
+    armv8_stream_context_t * ctx,
+    uint64_t chunk_index, int last,
+    uint8_t * plaintext,    uint64_t plaintext_bit_length,
+    //Outputs
+    uint8_t * ciphertext,
+    uint8_t * tag
+    );
+
+// Open chunk chunk_index - last must be set for the chunk at the end of the stream as stored, so that a truncated
+// stream fails
+// expected return value is SUCCESSFUL_OPERATION, AUTHENTICATION_FAILURE (the plaintext must then not be used), or
+// INVALID_PARAMETER for a chunk of the wrong length
+armv8_operation_result_t armv8_stream_open_chunk(
+    //Inputs
+    armv8_stream_context_t * ctx,
+    uint64_t chunk_index, int last,
+    uint8_t * ciphertext,   uint64_t ciphertext_bit_length,
+    uint8_t * tag,
+    //Output
+    uint8_t * plaintext
+    );
+
+// Asynchronous job queue, in the style of the intel-ipsec-mb job manager
+// Jobs are filled in directly in a ring slot (armv8_job_get_next) and queued (armv8_job_submit); once batch_size jobs
+// are queued they are run as one batch, and their results become available from armv8_job_get_completed, always in
+// the order they were submitted
+// In builds with ARMV8_JOB_GCM_LANES_ENABLED (make JOB_LANES=1), AES-GCM jobs of a batch of at most
+// ARMV8_JOB_GCM_LANE_MAX_BYTES with 96 bit nonces and whole bytes of AAD and data are run ARMV8_JOB_GCM_LANES at a
+// time with others of the same key size, interleaving their AES and GHASH so that one job's dependency chains fill
+// the gaps in another's. Lanes are off by default on every PERF_GCM_* target, as they replace the tuned single
+// message kernels for these jobs and have not yet been measured to beat them on any core; aes_test_jobs reports
+// both. All other jobs, and all jobs without lanes, run one after another, as they would if called directly
+// armv8_job_flush runs whatever is queued without waiting for a full batch, bounding the latency of a partial batch
+// The ring is single producer, single consumer with no locks - one thread submits and flushes (and runs the jobs),
+// and one thread, which may be the same one, takes the completions. Use one manager per submitting thread
+// Nothing a job points to may be changed or freed until it has completed
+#define ARMV8_JOB_RING_SIZE             256     // power of 2
+#define ARMV8_JOB_MAX_BATCH             64
+#define ARMV8_JOB_GCM_LANES             4
+#define ARMV8_JOB_GCM_LANE_MAX_BYTES    512
+
+typedef enum job_type {
+    ARMV8_JOB_AES_GCM_ENC,          // armv8_enc_aes_gcm_from_state after armv8_aes_gcm_set_counter
+    ARMV8_JOB_AES_GCM_DEC,          // armv8_dec_aes_gcm_from_state after armv8_aes_gcm_set_counter
+    ARMV8_JOB_AES_GCM_ENC_IPSEC,    // armv8_enc_aes_gcm_from_constants_IPsec (LITTLE and big builds, otherwise
+                                    // IPsec jobs complete with INVALID_PARAMETER)
+    ARMV8_JOB_AES_GCM_DEC_IPSEC,    // armv8_dec_aes_gcm_from_constants_IPsec
+    ARMV8_JOB_AES_CBC_SHA1_ENC,     // armv8_enc_aes_cbc_sha1_128
+    ARMV8_JOB_AES_CBC_SHA256_ENC,   // armv8_enc_aes_cbc_sha256_128
+    ARMV8_JOB_AES_CBC_SHA1_DEC,     // armv8_dec_aes_cbc_sha1_128
+    ARMV8_JOB_AES_CBC_SHA256_DEC    // armv8_dec_aes_cbc_sha256_128
+} armv8_job_type_t;
+
+// The parameters of each job type are those of the call it runs, with the same buffer requirements
+typedef struct job_desc {
+    armv8_job_type_t type;
+    armv8_operation_result_t result;    // set on completion, INTERNAL_FAILURE if a CBC/SHA call fails
+    void * user_data;                   // not used by the library
+    union {
+        struct {
+            armv8_cipher_constants_t * cc;
+            uint8_t * nonce;            uint64_t nonce_bit_length;
+            uint8_t * aad;              uint64_t aad_bit_length;
+            uint8_t * input;            uint64_t bit_length;
+            uint8_t * output;
+            uint8_t * tag;              // written by encryption, read by decryption
+        } gcm;
+        struct {
+            const armv8_cipher_constants_t * cc;
+            uint32_t salt;
+            uint64_t ESPIV;
+            const uint8_t * aad;        uint32_t aad_byte_length;
+            uint8_t * data;             uint32_t byte_length;   // in place
+            uint8_t * tag;
+            uint64_t checksum;          // set by decryption
+        } ipsec;
+        struct {
+            uint8_t * csrc;             uint8_t * cdst;         uint64_t clen;
+            uint8_t * dsrc;             uint8_t * ddst;         uint64_t dlen;
+            armv8_cipher_digest_t * arg;
+        } cbc_sha;
+    };
+} armv8_job_t;
+
+typedef struct job_mgr {
+    armv8_job_t jobs[ARMV8_JOB_RING_SIZE];
+    uint32_t batch_size;
+    // internal - jobs before completed have run, jobs before retired have been taken by the consumer
+    uint64_t submitted __attribute__((aligned(64)));
+    uint64_t completed;
+    uint64_t retired __attribute__((aligned(64)));
+} armv8_job_mgr_t;
+
+// Set up an empty manager that runs jobs in batches of batch_size (1 runs every job as it is submitted)
+// expected return value is SUCCESSFUL_OPERATION, or INVALID_PARAMETER if batch_size is 0 or above ARMV8_JOB_MAX_BATCH
+armv8_operation_result_t armv8_job_mgr_init(
+    armv8_job_mgr_t * mgr,
+    uint32_t batch_size);
+
+// The ring slot to fill in for the next job, or NULL if all ARMV8_JOB_RING_SIZE slots hold jobs that are queued or
+// whose completions have not been taken yet
+// Calling it again without armv8_job_submit returns the same slot
+armv8_job_t * armv8_job_get_next(armv8_job_mgr_t * mgr);
+
+// Queue the job filled in since armv8_job_get_next, running a batch if batch_size jobs are now queued
+// Returns the number of jobs that completed during the call
+uint32_t armv8_job_submit(armv8_job_mgr_t * mgr);
+
+// Run every queued job
+// Returns the number of jobs that completed during the call
+uint32_t armv8_job_flush(armv8_job_mgr_t * mgr);
+
+// Copy out up to max_jobs completed jobs, oldest first, freeing their ring slots
+// Returns the number copied, 0 if no job has completed since the last call
+uint32_t armv8_job_get_completed(
+    armv8_job_mgr_t * mgr,
+    armv8_job_t * jobs,
+    uint32_t max_jobs);
+
+// Worker thread offload - a pool of dedicated worker threads, optionally pinned to cores, that run jobs for other
+// threads, e.g. so that an event loop can hand off the encryption of large responses
+// Any number of threads submit requests, through a lock-free multi producer, single consumer queue per worker
+// AES-GCM jobs (ARMV8_JOB_AES_GCM_ENC/DEC) of at least twice ARMV8_OFFLOAD_SPLIT_MIN_BYTES are split by counter range
+// between up to ARMV8_OFFLOAD_MAX_PARTS workers - each part encrypts or decrypts its range with
+// armv8_{enc,dec}_aes_gcm_range and hashes its ciphertext with armv8_aes_gcm_ghash_segment, and the last part to
+// finish combines the hashes into the tag (written as exactly tag_byte_length bytes) or checks it
+// Idle workers spin for a short while, then sleep until a request arrives
+#define ARMV8_OFFLOAD_MAX_WORKERS       64
+#define ARMV8_OFFLOAD_QUEUE_SIZE        1024            // requests (or parts) queued per worker, power of 2
+#define ARMV8_OFFLOAD_MAX_PARTS         16
+#define ARMV8_OFFLOAD_SPLIT_MIN_BYTES   (256u << 10)    // smallest part of a split request
+
+typedef struct offload_pool armv8_offload_pool_t;
+typedef struct offload_request armv8_offload_request_t;
+typedef void (*armv8_offload_callback_t)(armv8_offload_request_t * request);
+
+// On completion job.result is set, then the done flag (armv8_offload_done), then the callback is called on the worker
+// and the eventfd is written, if given
+// The request and everything its job points to belong to the pool from armv8_offload_submit until completion - the
+// request may be reused or freed once done is seen or in the callback, so a submitter that polls done should not
+// also give a callback
+struct offload_request {
+    armv8_job_t job;                    // as for the job queue
+    armv8_offload_callback_t callback;  // or NULL
+    int eventfd;                        // written with a count of 1, or -1
+    // internal
+    uint32_t done;
+    uint32_t parts;
+    uint32_t parts_pending;
+    uint32_t parts_result;
+    uint64_t part_byte_length;
+    armv8_cipher_state_t cs;
+    armv8_aes_gcm_segment_t segments[ARMV8_OFFLOAD_MAX_PARTS];
+};
+
+// Start worker_count workers, worker i pinned to cpus[i] if cpus is not NULL
+// expected return value is SUCCESSFUL_OPERATION, INVALID_PARAMETER if worker_count is 0 or above
+// ARMV8_OFFLOAD_MAX_WORKERS or a worker can't be pinned to its cpu, or INTERNAL_FAILURE if memory or threads run out
+armv8_operation_result_t armv8_offload_create(
+    uint32_t worker_count,
+    const int32_t * cpus,
+    armv8_offload_pool_t ** pool);
+
+// Complete every queued request, then stop the workers and free the pool
+void armv8_offload_destroy(armv8_offload_pool_t * pool);
+
+// Queue a request for the workers
+// If the queues fill up part way through queueing a split request, its remaining parts run on the calling thread
+// expected return value is SUCCESSFUL_OPERATION, INTERNAL_FAILURE (with nothing queued) if every worker's queue is
+// full, or INVALID_PARAMETER or the failure of armv8_aes_gcm_set_counter for a job that can't be run
+armv8_operation_result_t armv8_offload_submit(
+    armv8_offload_pool_t * pool,
+    armv8_offload_request_t * request);
+
+static inline int armv8_offload_done(const armv8_offload_request_t * request)
+{
+    return __atomic_load_n(&request->done, __ATOMIC_ACQUIRE);
+}
+
+// Runtime statistics, counted per thread by the AES-GCM (including IPsec, GMAC, MACsec, TLS 1.3 and QUIC) and
+// AES-CBC/SHA entry points when the library is built with STATS=1 (ARMV8_CRYPTO_STATS), and compiled out otherwise
+typedef enum crypto_stats_op {
+    ARMV8_STATS_GCM_ENC,            // armv8_enc_aes_gcm_full and armv8_enc_aes_gcm_from_state, and armv8_enc_aes_gcm_range
+    ARMV8_STATS_GCM_DEC,            // armv8_dec_aes_gcm_full and armv8_dec_aes_gcm_from_state, and armv8_dec_aes_gcm_range
+    ARMV8_STATS_IPSEC_ENC,
+    ARMV8_STATS_IPSEC_DEC,
+    ARMV8_STATS_GMAC,
+    ARMV8_STATS_GMAC_VERIFY,
+    ARMV8_STATS_MACSEC_PROTECT,     // per frame, including bursts
+    ARMV8_STATS_MACSEC_VALIDATE,
+    ARMV8_STATS_TLS13_SEAL,
+    ARMV8_STATS_TLS13_OPEN,
+    ARMV8_STATS_QUIC_PROTECT,       // per packet, including bursts
+    ARMV8_STATS_QUIC_UNPROTECT,
+    ARMV8_STATS_CBC_SHA1_ENC,
+    ARMV8_STATS_CBC_SHA1_DEC,
+    ARMV8_STATS_CBC_SHA256_ENC,
+    ARMV8_STATS_CBC_SHA256_DEC,
+    ARMV8_STATS_OP_COUNT
+} armv8_crypto_stats_op_t;
+
+typedef struct crypto_stats {
+    uint64_t calls[ARMV8_STATS_OP_COUNT];
+    uint64_t bytes[ARMV8_STATS_OP_COUNT];           // sum of the length argument - message, payload, frame, record or packet bytes
+    uint64_t tail_calls[ARMV8_STATS_OP_COUNT];      // calls ending in a partial 16B block, which take the tail path
+    uint64_t generic_calls[ARMV8_STATS_OP_COUNT];   // calls handled by the generic C kernels rather than optimized asm
+    uint64_t auth_failures[ARMV8_STATS_OP_COUNT];   // AUTHENTICATION_FAILURE returned
+    uint64_t errors[ARMV8_STATS_OP_COUNT];          // any other failure, e.g. INVALID_PARAMETER
+} armv8_crypto_stats_t;
+
+// Sum of the counters over all threads, including threads that have exited
+// Each thread only writes its own counters, so this can be called at any time from any thread, but values from
+// threads that are running may be a few calls behind
+// expected return value is SUCCESSFUL_OPERATION, or INTERNAL_FAILURE (with stats zeroed) if the library was built
+// without statistics
+armv8_operation_result_t armv8_crypto_stats_snapshot(armv8_crypto_stats_t * stats);
+
+// Name of an operation for reporting, e.g. "gcm_enc", or NULL if op is out of range
+const char * armv8_crypto_stats_op_name(armv8_crypto_stats_op_t op);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
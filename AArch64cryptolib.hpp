@@ -0,0 +1,330 @@
+//Copyright (c) 2018-2019, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+// C++ interface to the AES-GCM functions of the library, header only
+// The key size is a template parameter, so each call goes straight to that key size's kernels (through the
+// armv8_*_aes_gcm_from_state_exact_<bits> entry points) rather than switching on the mode at run time, and the tag
+// length is a template parameter checked at compile time
+// Buffers are std::span, read and written exactly as the _exact variants - nothing outside a span is touched
+// Lengths are in bytes here, where the C interface takes bits
+// Results are armv8_operation_result_t as in the C interface - nothing here throws
+
+#ifndef AARCH64CRYPTOLIB_HPP
+#define AARCH64CRYPTOLIB_HPP
+
+#if __cplusplus < 202002L
+#error "AArch64cryptolib.hpp needs C++20 (std::span)"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+// The C header uses C99 restrict, which C++ spells __restrict__
+#pragma push_macro("restrict")
+#undef restrict
+#define restrict __restrict__
+#include "AArch64cryptolib.h"
+#pragma pop_macro("restrict")
+
+namespace armv8 {
+
+using result_t = armv8_operation_result_t;
+
+// Tag lengths GCM allows (NIST SP 800-38D), as checked by the C interface at run time
+constexpr bool valid_tag_length(std::size_t tag_bytes)
+{
+    return tag_bytes == 4 || tag_bytes == 8 || (tag_bytes >= 12 && tag_bytes <= 16);
+}
+
+namespace detail {
+
+template <unsigned KeyBits> struct aes_gcm_key;
+
+template <> struct aes_gcm_key<128> {
+    static constexpr armv8_cipher_mode_t mode = AES_GCM_128;
+    static constexpr auto encrypt = armv8_enc_aes_gcm_from_state_exact_128;
+    static constexpr auto decrypt = armv8_dec_aes_gcm_from_state_exact_128;
+};
+
+template <> struct aes_gcm_key<192> {
+    static constexpr armv8_cipher_mode_t mode = AES_GCM_192;
+    static constexpr auto encrypt = armv8_enc_aes_gcm_from_state_exact_192;
+    static constexpr auto decrypt = armv8_dec_aes_gcm_from_state_exact_192;
+};
+
+template <> struct aes_gcm_key<256> {
+    static constexpr armv8_cipher_mode_t mode = AES_GCM_256;
+    static constexpr auto encrypt = armv8_enc_aes_gcm_from_state_exact_256;
+    static constexpr auto decrypt = armv8_dec_aes_gcm_from_state_exact_256;
+};
+
+// The C interface takes inputs through non-const pointers, but never writes through them
+inline std::uint8_t * input(std::span<const std::uint8_t> buffer)
+{
+    return const_cast<std::uint8_t *>(buffer.data());
+}
+
+inline std::uint64_t bits(std::size_t bytes)
+{
+    return static_cast<std::uint64_t>(bytes) << 3;
+}
+
+// Zero key material in a way the compiler can't drop as a dead store
+inline void scrub(void * p, std::size_t bytes)
+{
+    std::memset(p, 0, bytes);
+    __asm__ __volatile__("" : : "r" (p) : "memory");
+}
+
+} // namespace detail
+
+// An AES-GCM key, expanded once in the constructor and scrubbed in the destructor
+// Only read after construction, so one object can be used by any number of threads
+// Neither copyable nor movable, so that copies of the key schedule aren't left behind
+template <unsigned KeyBits, std::size_t TagBytes = 16>
+class AesGcm {
+    static_assert(KeyBits == 128 || KeyBits == 192 || KeyBits == 256, "AES keys are 128, 192 or 256 bits");
+    static_assert(valid_tag_length(TagBytes), "GCM tags are 4, 8 or 12 to 16 bytes");
+
+    using key_t = detail::aes_gcm_key<KeyBits>;
+
+public:
+    static constexpr std::size_t key_bytes = KeyBits / 8;
+    static constexpr std::size_t tag_bytes = TagBytes;
+    static constexpr armv8_cipher_mode_t mode = key_t::mode;
+
+    // One message of a burst - tag is written by seal_burst and read by open_burst
+    struct message {
+        std::span<const std::uint8_t> nonce;
+        std::span<const std::uint8_t> aad;
+        std::span<const std::uint8_t> input;
+        std::span<std::uint8_t> output;
+        std::span<std::uint8_t, TagBytes> tag;
+    };
+
+    // armv8_aes_gcm_set_constants only fails for a mode or tag length, and both are checked above
+    explicit AesGcm(std::span<const std::uint8_t, key_bytes> key) noexcept
+    {
+        armv8_aes_gcm_set_constants(mode, TagBytes, detail::input(key), &constants_);
+    }
+
+    ~AesGcm()
+    {
+        detail::scrub(&constants_, sizeof(constants_));
+    }
+
+    AesGcm(const AesGcm &) = delete;
+    AesGcm & operator=(const AesGcm &) = delete;
+
+    // Encrypt plaintext into the first plaintext.size() bytes of ciphertext, which may be the same buffer
+    // expected return value is SUCCESSFUL_OPERATION, or INVALID_PARAMETER if ciphertext is too short or the nonce is
+    // empty
+    result_t seal(
+        std::span<const std::uint8_t> nonce,
+        std::span<const std::uint8_t> aad,
+        std::span<const std::uint8_t> plaintext,
+        std::span<std::uint8_t> ciphertext,
+        std::span<std::uint8_t, TagBytes> tag) const noexcept
+    {
+        if(ciphertext.size() < plaintext.size()) {
+            return INVALID_PARAMETER;
+        }
+        armv8_cipher_state_t cs = {};
+        result_t result = set_counter(nonce, &cs);
+        if(result != SUCCESSFUL_OPERATION) {
+            return result;
+        }
+        return key_t::encrypt(&cs, detail::input(aad), detail::bits(aad.size()),
+                              detail::input(plaintext), detail::bits(plaintext.size()), ciphertext.data(), tag.data());
+    }
+
+    // Decrypt ciphertext into the first ciphertext.size() bytes of plaintext, which may be the same buffer
+    // expected return value is SUCCESSFUL_OPERATION, AUTHENTICATION_FAILURE (the plaintext must then not be used), or
+    // INVALID_PARAMETER as seal
+    result_t open(
+        std::span<const std::uint8_t> nonce,
+        std::span<const std::uint8_t> aad,
+        std::span<const std::uint8_t> ciphertext,
+        std::span<const std::uint8_t, TagBytes> tag,
+        std::span<std::uint8_t> plaintext) const noexcept
+    {
+        if(plaintext.size() < ciphertext.size()) {
+            return INVALID_PARAMETER;
+        }
+        armv8_cipher_state_t cs = {};
+        result_t result = set_counter(nonce, &cs);
+        if(result != SUCCESSFUL_OPERATION) {
+            return result;
+        }
+        return key_t::decrypt(&cs, detail::input(aad), detail::bits(aad.size()),
+                              detail::input(ciphertext), detail::bits(ciphertext.size()),
+                              const_cast<std::uint8_t *>(tag.data()), plaintext.data());
+    }
+
+    // Seal each message in turn, prefetching the next one's input
+    // expected return value is SUCCESSFUL_OPERATION if all messages were sealed, otherwise the first failure (the
+    // remaining messages are still sealed)
+    result_t seal_burst(std::span<const message> messages) const noexcept
+    {
+        result_t burst_result = SUCCESSFUL_OPERATION;
+        for( std::size_t i=0; i<messages.size(); ++i )
+        {
+            if(i + 1 < messages.size()) {
+                __builtin_prefetch(messages[i + 1].input.data(), 0, 3);
+            }
+            const message & m = messages[i];
+            result_t result = seal(m.nonce, m.aad, m.input, m.output, m.tag);
+            if(burst_result == SUCCESSFUL_OPERATION) {
+                burst_result = result;
+            }
+        }
+        return burst_result;
+    }
+
+    // Open each message in turn, with the result for each message in results
+    // expected return value is SUCCESSFUL_OPERATION if all messages were valid, AUTHENTICATION_FAILURE if any
+    // wasn't, or INVALID_PARAMETER (with nothing opened) if results is shorter than messages
+    result_t open_burst(std::span<const message> messages, std::span<result_t> results) const noexcept
+    {
+        if(results.size() < messages.size()) {
+            return INVALID_PARAMETER;
+        }
+        result_t burst_result = SUCCESSFUL_OPERATION;
+        for( std::size_t i=0; i<messages.size(); ++i )
+        {
+            if(i + 1 < messages.size()) {
+                __builtin_prefetch(messages[i + 1].input.data(), 0, 3);
+            }
+            const message & m = messages[i];
+            results[i] = open(m.nonce, m.aad, m.input, m.tag, m.output);
+            if(results[i] != SUCCESSFUL_OPERATION) {
+                burst_result = AUTHENTICATION_FAILURE;
+            }
+        }
+        return burst_result;
+    }
+
+    // The expanded key, for use with the rest of the C interface
+    const armv8_cipher_constants_t & constants() const noexcept
+    {
+        return constants_;
+    }
+
+private:
+    result_t set_counter(std::span<const std::uint8_t> nonce, armv8_cipher_state_t * cs) const noexcept
+    {
+        if(nonce.empty()) {
+            return INVALID_PARAMETER;
+        }
+        cs->constants = const_cast<armv8_cipher_constants_t *>(&constants_);
+        return armv8_aes_gcm_set_counter(detail::input(nonce), detail::bits(nonce.size()), cs);
+    }
+
+    armv8_cipher_constants_t constants_;
+};
+
+// A chunked AES-GCM stream (armv8_stream_*) of one key size, scrubbed in the destructor
+// Set up with init_seal or init_open, after which chunks can be sealed or opened in any order on any number of
+// threads
+template <unsigned KeyBits>
+class AesGcmStream {
+    static_assert(KeyBits == 128 || KeyBits == 192 || KeyBits == 256, "AES keys are 128, 192 or 256 bits");
+
+public:
+    static constexpr std::size_t key_bytes = KeyBits / 8;
+    static constexpr std::size_t header_bytes = ARMV8_STREAM_HEADER_BYTES;
+    static constexpr std::size_t tag_bytes = ARMV8_STREAM_TAG_BYTES;
+    static constexpr armv8_cipher_mode_t mode = detail::aes_gcm_key<KeyBits>::mode;
+
+    AesGcmStream() noexcept = default;
+
+    ~AesGcmStream()
+    {
+        detail::scrub(&ctx_, sizeof(ctx_));
+    }
+
+    AesGcmStream(const AesGcmStream &) = delete;
+    AesGcmStream & operator=(const AesGcmStream &) = delete;
+
+    // Start a new stream, whose header() is to be written out first
+    // expected return value as armv8_stream_init_seal
+    result_t init_seal(
+        std::span<const std::uint8_t, key_bytes> key,
+        std::span<const std::uint8_t, ARMV8_STREAM_NONCE_PREFIX_BYTES> nonce_prefix,
+        std::uint32_t chunk_byte_length) noexcept
+    {
+        return armv8_stream_init_seal(&ctx_, mode, detail::input(key), nonce_prefix.data(), chunk_byte_length);
+    }
+
+    // Open a stream from its header
+    // expected return value as armv8_stream_init_open, which includes INVALID_PARAMETER for a stream of another key
+    // size
+    result_t init_open(
+        std::span<const std::uint8_t, key_bytes> key,
+        std::span<const std::uint8_t, ARMV8_STREAM_HEADER_BYTES> header) noexcept
+    {
+        result_t result = armv8_stream_init_open(&ctx_, detail::input(key), header.data());
+        if(result == SUCCESSFUL_OPERATION && ctx_.constants.mode != mode) {
+            detail::scrub(&ctx_, sizeof(ctx_));
+            return INVALID_PARAMETER;
+        }
+        return result;
+    }
+
+    std::span<const std::uint8_t, ARMV8_STREAM_HEADER_BYTES> header() const noexcept
+    {
+        return std::span<const std::uint8_t, ARMV8_STREAM_HEADER_BYTES>(ctx_.header);
+    }
+
+    std::uint32_t chunk_byte_length() const noexcept
+    {
+        return ctx_.chunk_byte_length;
+    }
+
+    // Seal chunk chunk_index into the first plaintext.size() bytes of ciphertext
+    // expected return value as armv8_stream_seal_chunk, plus INVALID_PARAMETER if ciphertext is too short
+    result_t seal_chunk(
+        std::uint64_t chunk_index, bool last,
+        std::span<const std::uint8_t> plaintext,
+        std::span<std::uint8_t> ciphertext,
+        std::span<std::uint8_t, ARMV8_STREAM_TAG_BYTES> tag) const noexcept
+    {
+        if(ciphertext.size() < plaintext.size()) {
+            return INVALID_PARAMETER;
+        }
+        return armv8_stream_seal_chunk(context(), chunk_index, last, detail::input(plaintext),
+                                       detail::bits(plaintext.size()), ciphertext.data(), tag.data());
+    }
+
+    // Open chunk chunk_index into the first ciphertext.size() bytes of plaintext - last must be set for the chunk at
+    // the end of the stream as stored
+    // expected return value as armv8_stream_open_chunk, plus INVALID_PARAMETER if plaintext is too short
+    result_t open_chunk(
+        std::uint64_t chunk_index, bool last,
+        std::span<const std::uint8_t> ciphertext,
+        std::span<const std::uint8_t, ARMV8_STREAM_TAG_BYTES> tag,
+        std::span<std::uint8_t> plaintext) const noexcept
+    {
+        if(plaintext.size() < ciphertext.size()) {
+            return INVALID_PARAMETER;
+        }
+        return armv8_stream_open_chunk(context(), chunk_index, last, detail::input(ciphertext),
+                                       detail::bits(ciphertext.size()), detail::input(tag), plaintext.data());
+    }
+
+private:
+    // armv8_stream_{seal,open}_chunk only read the context
+    armv8_stream_context_t * context() const noexcept
+    {
+        return const_cast<armv8_stream_context_t *>(&ctx_);
+    }
+
+    armv8_stream_context_t ctx_ = {};
+};
+
+} // namespace armv8
+
+#endif
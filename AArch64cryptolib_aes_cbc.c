@@ -35,93 +35,210 @@
 #define likely(x)	__builtin_expect((x),1)
 #define unlikely(x)	__builtin_expect((x),0)
 
-int
-armv8_enc_aes_cbc_sha1_128(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
-	uint8_t *dsrc, uint8_t *ddst, uint64_t dlen, armv8_cipher_digest_t *arg)
+/*
+ * Length checks shared by all key sizes, non-zero if the lengths are invalid
+ */
+static inline int
+enc_lengths_invalid(uint64_t clen, uint64_t dlen)
 {
-
 	/* Digest source length has to be equal to or exceed cipher length */
 	if (unlikely(dlen < clen))
-		return -1;
+		return 1;
 	/* Digest length has to be a multiple of 8 bytes */
 	if (unlikely((dlen % 8) != 0))
-		return -1;
+		return 1;
 	/* Cipher length for this cipher has to be a multiple of 16 bytes */
 	if (unlikely((clen % 16) != 0))
-		return -1;
-
-	return (asm_aes128cbc_sha1_hmac(csrc, cdst, clen,
-						dsrc, ddst, dlen, arg));
+		return 1;
+	return 0;
 }
 
-int
-armv8_enc_aes_cbc_sha256_128(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
-	uint8_t *dsrc, uint8_t *ddst, uint64_t dlen, armv8_cipher_digest_t *arg)
+static inline int
+dec_lengths_invalid(uint64_t clen, uint64_t dlen)
 {
-
 	/* Digest source length has to be equal to or exceed cipher length */
 	if (unlikely(dlen < clen))
-		return -1;
+		return 1;
+	/*
+	 * The difference between digest source length and cipher source cannot
+	 * exceed 64 bytes, or the digest source may be overwritten if it
+	 * overlaps with the cipher destination.
+	 */
+	if (unlikely((dlen - clen) > 64))
+		return 1;
 	/* Digest length has to be a multiple of 8 bytes */
 	if (unlikely((dlen % 8) != 0))
-		return -1;
+		return 1;
 	/* Cipher length for this cipher has to be a multiple of 16 bytes */
 	if (unlikely((clen % 16) != 0))
-		return -1;
+		return 1;
+	return 0;
+}
+
+int
+armv8_enc_aes_cbc_sha1_128(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+	uint8_t *dsrc, uint8_t *ddst, uint64_t dlen, armv8_cipher_digest_t *arg)
+{
+	TRACE_ENTRY(cbc_sha1_enc, clen, dlen);
+
+	if (unlikely(enc_lengths_invalid(clen, dlen)))
+		return API_RETURN(cbc_sha1_enc, ARMV8_STATS_CBC_SHA1_ENC, clen, 0, -1);
+
+	return API_RETURN(cbc_sha1_enc, ARMV8_STATS_CBC_SHA1_ENC, clen, 0,
+			asm_aes128cbc_sha1_hmac(csrc, cdst, clen,
+				dsrc, ddst, dlen, arg));
+}
+
+int
+armv8_enc_aes_cbc_sha256_128(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+	uint8_t *dsrc, uint8_t *ddst, uint64_t dlen, armv8_cipher_digest_t *arg)
+{
+	TRACE_ENTRY(cbc_sha256_enc, clen, dlen);
+
+	if (unlikely(enc_lengths_invalid(clen, dlen)))
+		return API_RETURN(cbc_sha256_enc, ARMV8_STATS_CBC_SHA256_ENC, clen, 0, -1);
 
-	return (asm_aes128cbc_sha256_hmac(csrc, cdst, clen,
-						dsrc, ddst, dlen, arg));
+	return API_RETURN(cbc_sha256_enc, ARMV8_STATS_CBC_SHA256_ENC, clen, 0,
+			asm_aes128cbc_sha256_hmac(csrc, cdst, clen,
+				dsrc, ddst, dlen, arg));
 }
 
 int
 armv8_dec_aes_cbc_sha1_128(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
 	uint8_t *dsrc, uint8_t *ddst, uint64_t dlen, armv8_cipher_digest_t *arg)
 {
+	TRACE_ENTRY(cbc_sha1_dec, clen, dlen);
 
-	/* Digest source length has to be equal to or exceed cipher length */
-	if (unlikely(dlen < clen))
-		return -1;
-	/*
-	 * The difference between digest source length and cipher source cannot
-	 * exceed 64 bytes, or the digest source may be overwritten if it
-	 * overlaps with the cipher destination.
-	 */
-	if (unlikely((dlen - clen) > 64))
-		return -1;
-	/* Digest length has to be a multiple of 8 bytes */
-	if (unlikely((dlen % 8) != 0))
-		return -1;
-	/* Cipher length for this cipher has to be a multiple of 16 bytes */
-	if (unlikely((clen % 16) != 0))
-		return -1;
+	if (unlikely(dec_lengths_invalid(clen, dlen)))
+		return API_RETURN(cbc_sha1_dec, ARMV8_STATS_CBC_SHA1_DEC, clen, 0, -1);
 
-	return (asm_sha1_hmac_aes128cbc_dec(csrc, cdst, clen,
-						dsrc, ddst, dlen, arg));
+	return API_RETURN(cbc_sha1_dec, ARMV8_STATS_CBC_SHA1_DEC, clen, 0,
+			asm_sha1_hmac_aes128cbc_dec(csrc, cdst, clen,
+				dsrc, ddst, dlen, arg));
 }
 
 int
 armv8_dec_aes_cbc_sha256_128(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
 	uint8_t *dsrc, uint8_t *ddst, uint64_t dlen, armv8_cipher_digest_t *arg)
 {
+	TRACE_ENTRY(cbc_sha256_dec, clen, dlen);
 
-	/* Digest source length has to be equal to or exceed cipher length */
-	if (unlikely(dlen < clen))
-		return -1;
-	/*
-	 * The difference between digest source length and cipher source cannot
-	 * exceed 64 bytes, or the digest source may be overwritten if it
-	 * overlaps with the cipher destination.
-	 */
-	if (unlikely((dlen - clen) > 64))
-		return -1;
-	/* Digest length has to be a multiple of 8 bytes */
-	if (unlikely((dlen % 8) != 0))
-		return -1;
-	/* Cipher length for this cipher has to be a multiple of 16 bytes */
-	if (unlikely((clen % 16) != 0))
-		return -1;
+	if (unlikely(dec_lengths_invalid(clen, dlen)))
+		return API_RETURN(cbc_sha256_dec, ARMV8_STATS_CBC_SHA256_DEC, clen, 0, -1);
 
-	return (asm_sha256_hmac_aes128cbc_dec(csrc, cdst, clen,
-						dsrc, ddst, dlen, arg));
+	return API_RETURN(cbc_sha256_dec, ARMV8_STATS_CBC_SHA256_DEC, clen, 0,
+			asm_sha256_hmac_aes128cbc_dec(csrc, cdst, clen,
+				dsrc, ddst, dlen, arg));
 }
 
+int
+armv8_enc_aes_cbc_sha1_192(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+	uint8_t *dsrc, uint8_t *ddst, uint64_t dlen, armv8_cipher_digest_t *arg)
+{
+	TRACE_ENTRY(cbc_sha1_enc, clen, dlen);
+
+	if (unlikely(enc_lengths_invalid(clen, dlen)))
+		return API_RETURN(cbc_sha1_enc, ARMV8_STATS_CBC_SHA1_ENC, clen, 0, -1);
+
+	return API_RETURN(cbc_sha1_enc, ARMV8_STATS_CBC_SHA1_ENC, clen, 0,
+			asm_aes192cbc_sha1_hmac(csrc, cdst, clen,
+				dsrc, ddst, dlen, arg));
+}
+
+int
+armv8_enc_aes_cbc_sha256_192(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+	uint8_t *dsrc, uint8_t *ddst, uint64_t dlen, armv8_cipher_digest_t *arg)
+{
+	TRACE_ENTRY(cbc_sha256_enc, clen, dlen);
+
+	if (unlikely(enc_lengths_invalid(clen, dlen)))
+		return API_RETURN(cbc_sha256_enc, ARMV8_STATS_CBC_SHA256_ENC, clen, 0, -1);
+
+	return API_RETURN(cbc_sha256_enc, ARMV8_STATS_CBC_SHA256_ENC, clen, 0,
+			asm_aes192cbc_sha256_hmac(csrc, cdst, clen,
+				dsrc, ddst, dlen, arg));
+}
+
+int
+armv8_dec_aes_cbc_sha1_192(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+	uint8_t *dsrc, uint8_t *ddst, uint64_t dlen, armv8_cipher_digest_t *arg)
+{
+	TRACE_ENTRY(cbc_sha1_dec, clen, dlen);
+
+	if (unlikely(dec_lengths_invalid(clen, dlen)))
+		return API_RETURN(cbc_sha1_dec, ARMV8_STATS_CBC_SHA1_DEC, clen, 0, -1);
+
+	return API_RETURN(cbc_sha1_dec, ARMV8_STATS_CBC_SHA1_DEC, clen, 0,
+			asm_sha1_hmac_aes192cbc_dec(csrc, cdst, clen,
+				dsrc, ddst, dlen, arg));
+}
+
+int
+armv8_dec_aes_cbc_sha256_192(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+	uint8_t *dsrc, uint8_t *ddst, uint64_t dlen, armv8_cipher_digest_t *arg)
+{
+	TRACE_ENTRY(cbc_sha256_dec, clen, dlen);
+
+	if (unlikely(dec_lengths_invalid(clen, dlen)))
+		return API_RETURN(cbc_sha256_dec, ARMV8_STATS_CBC_SHA256_DEC, clen, 0, -1);
+
+	return API_RETURN(cbc_sha256_dec, ARMV8_STATS_CBC_SHA256_DEC, clen, 0,
+			asm_sha256_hmac_aes192cbc_dec(csrc, cdst, clen,
+				dsrc, ddst, dlen, arg));
+}
+
+int
+armv8_enc_aes_cbc_sha1_256(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+	uint8_t *dsrc, uint8_t *ddst, uint64_t dlen, armv8_cipher_digest_t *arg)
+{
+	TRACE_ENTRY(cbc_sha1_enc, clen, dlen);
+
+	if (unlikely(enc_lengths_invalid(clen, dlen)))
+		return API_RETURN(cbc_sha1_enc, ARMV8_STATS_CBC_SHA1_ENC, clen, 0, -1);
+
+	return API_RETURN(cbc_sha1_enc, ARMV8_STATS_CBC_SHA1_ENC, clen, 0,
+			asm_aes256cbc_sha1_hmac(csrc, cdst, clen,
+				dsrc, ddst, dlen, arg));
+}
+
+int
+armv8_enc_aes_cbc_sha256_256(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+	uint8_t *dsrc, uint8_t *ddst, uint64_t dlen, armv8_cipher_digest_t *arg)
+{
+	TRACE_ENTRY(cbc_sha256_enc, clen, dlen);
+
+	if (unlikely(enc_lengths_invalid(clen, dlen)))
+		return API_RETURN(cbc_sha256_enc, ARMV8_STATS_CBC_SHA256_ENC, clen, 0, -1);
+
+	return API_RETURN(cbc_sha256_enc, ARMV8_STATS_CBC_SHA256_ENC, clen, 0,
+			asm_aes256cbc_sha256_hmac(csrc, cdst, clen,
+				dsrc, ddst, dlen, arg));
+}
+
+int
+armv8_dec_aes_cbc_sha1_256(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+	uint8_t *dsrc, uint8_t *ddst, uint64_t dlen, armv8_cipher_digest_t *arg)
+{
+	TRACE_ENTRY(cbc_sha1_dec, clen, dlen);
+
+	if (unlikely(dec_lengths_invalid(clen, dlen)))
+		return API_RETURN(cbc_sha1_dec, ARMV8_STATS_CBC_SHA1_DEC, clen, 0, -1);
+
+	return API_RETURN(cbc_sha1_dec, ARMV8_STATS_CBC_SHA1_DEC, clen, 0,
+			asm_sha1_hmac_aes256cbc_dec(csrc, cdst, clen,
+				dsrc, ddst, dlen, arg));
+}
+
+int
+armv8_dec_aes_cbc_sha256_256(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+	uint8_t *dsrc, uint8_t *ddst, uint64_t dlen, armv8_cipher_digest_t *arg)
+{
+	TRACE_ENTRY(cbc_sha256_dec, clen, dlen);
+
+	if (unlikely(dec_lengths_invalid(clen, dlen)))
+		return API_RETURN(cbc_sha256_dec, ARMV8_STATS_CBC_SHA256_DEC, clen, 0, -1);
+
+	return API_RETURN(cbc_sha256_dec, ARMV8_STATS_CBC_SHA256_DEC, clen, 0,
+			asm_sha256_hmac_aes256cbc_dec(csrc, cdst, clen,
+				dsrc, ddst, dlen, arg));
+}
@@ -2,9 +2,11 @@
 //
 //SPDX-License-Identifier:        BSD-3-Clause
 
-#include "AArch64cryptolib.h"
+#include "AArch64cryptolib_private.h"
 
 #include "arm_neon.h"
+#include <stdbool.h>
+#include <stddef.h>
 #include <string.h> //want to use memcpy in certain corners
 #include <stdio.h>
 
@@ -39,6 +41,7 @@
 #define quadword_t                      armv8_quadword_t
 #define cipher_constants_t              armv8_cipher_constants_t
 #define cipher_state_t                  armv8_cipher_state_t
+#define aes_gcm_segment_t               armv8_aes_gcm_segment_t
 
 #define encrypt_full                    armv8_enc_aes_gcm_full
 #define encrypt_from_state              armv8_enc_aes_gcm_from_state
@@ -46,6 +49,58 @@
 #define decrypt_full                    armv8_dec_aes_gcm_full
 #define decrypt_from_state              armv8_dec_aes_gcm_from_state
 #define decrypt_from_constants_IPsec    armv8_dec_aes_gcm_from_constants_IPsec
+#define encrypt_full_exact              armv8_enc_aes_gcm_full_exact
+#define encrypt_from_state_exact        armv8_enc_aes_gcm_from_state_exact
+#define decrypt_full_exact              armv8_dec_aes_gcm_full_exact
+#define decrypt_from_state_exact        armv8_dec_aes_gcm_from_state_exact
+#define encrypt_from_state_bulk         armv8_enc_aes_gcm_from_state_bulk
+#define decrypt_from_state_bulk         armv8_dec_aes_gcm_from_state_bulk
+#define encrypt_from_state_exact_128    armv8_enc_aes_gcm_from_state_exact_128
+#define encrypt_from_state_exact_192    armv8_enc_aes_gcm_from_state_exact_192
+#define encrypt_from_state_exact_256    armv8_enc_aes_gcm_from_state_exact_256
+#define decrypt_from_state_exact_128    armv8_dec_aes_gcm_from_state_exact_128
+#define decrypt_from_state_exact_192    armv8_dec_aes_gcm_from_state_exact_192
+#define decrypt_from_state_exact_256    armv8_dec_aes_gcm_from_state_exact_256
+#define encrypt_range                   armv8_enc_aes_gcm_range
+#define decrypt_range                   armv8_dec_aes_gcm_range
+#define ghash_segment                   armv8_aes_gcm_ghash_segment
+#define tag_segments                    armv8_aes_gcm_tag_segments
+#define verify_segments                 armv8_aes_gcm_verify_segments
+#define gmac_from_constants_IPsec       armv8_gmac_from_constants_IPsec
+#define gmac_verify_from_constants_IPsec armv8_gmac_verify_from_constants_IPsec
+#define set_compact_constants_128       armv8_aes_gcm_set_compact_constants_128
+#define set_compact_constants_192       armv8_aes_gcm_set_compact_constants_192
+#define set_compact_constants_256       armv8_aes_gcm_set_compact_constants_256
+#define encrypt_from_compact_IPsec_128  armv8_enc_aes_gcm_from_compact_IPsec_128
+#define encrypt_from_compact_IPsec_192  armv8_enc_aes_gcm_from_compact_IPsec_192
+#define encrypt_from_compact_IPsec_256  armv8_enc_aes_gcm_from_compact_IPsec_256
+#define decrypt_from_compact_IPsec_128  armv8_dec_aes_gcm_from_compact_IPsec_128
+#define decrypt_from_compact_IPsec_192  armv8_dec_aes_gcm_from_compact_IPsec_192
+#define decrypt_from_compact_IPsec_256  armv8_dec_aes_gcm_from_compact_IPsec_256
+#define macsec_sa_t                     armv8_macsec_sa_t
+#define macsec_sa_init                  armv8_macsec_sa_init
+#define macsec_xpn_sa_init              armv8_macsec_xpn_sa_init
+#define macsec_protect                  armv8_macsec_protect
+#define macsec_validate                 armv8_macsec_validate
+#define macsec_protect_burst            armv8_macsec_protect_burst
+#define macsec_validate_burst           armv8_macsec_validate_burst
+#define tls13_context_t                 armv8_tls13_context_t
+#define tls13_context_init              armv8_tls13_context_init
+#define tls13_seal                      armv8_tls13_seal
+#define tls13_open                      armv8_tls13_open
+#define quic_context_t                  armv8_quic_context_t
+#define quic_context_init               armv8_quic_context_init
+#define quic_protect                    armv8_quic_protect
+#define quic_unprotect                  armv8_quic_unprotect
+#define quic_protect_burst              armv8_quic_protect_burst
+#define quic_unprotect_burst            armv8_quic_unprotect_burst
+
+// For the statistics counters - without one of the optimized builds, the enc/dec kernels are the generic C ones
+#if defined PERF_GCM_LITTLE || defined PERF_GCM_BIG || defined PERF_GCM_BIGGER || defined PERF_GCM_BIGGEREOR3
+#define STATS_GENERIC_GCM               0
+#else
+#define STATS_GENERIC_GCM               1
+#endif
 
 
 // expands the input key to the keys for each AES round and generates the hash key from the AES round keys
@@ -58,6 +113,12 @@ static operation_result_t aes_gcm_expandkeys_256_kernel(uint8_t * restrict key,
 // also used to append the hash with len(A)_64 | len(C)_64 after merged auth and enc/dec
 // NOTE - this reads and overwrites the current_tag variable in the cipher state
 static operation_result_t ghash_kernel(uint8_t * restrict input, uint64_t input_length, cipher_state_t * restrict cs);
+// as ghash_kernel, but never reads beyond the end of the input
+static operation_result_t ghash_exact_kernel(uint8_t * restrict input, uint64_t input_length, cipher_state_t * restrict cs);
+
+// as ghash_kernel, but also computes the one's complement sum of all 64b words of the input in the same pass
+// used for authentication only (GMAC) traffic, where there is no AES-CTR pass to merge the checksum into
+static operation_result_t ghash_checksum_kernel(const uint8_t * restrict input, uint64_t input_length, cipher_state_t * restrict cs, uint64_t * restrict checksum);
 
 // generate some number of consecutive blocks of aes_ctr values (usually XORed with plaintext or ciphertext) using and updating current counter value
 // this is used just with block_count == 1 for "encrypting" our ghash result to form our tag
@@ -76,6 +137,16 @@ static operation_result_t aes_gcm_dec_256_kernel(uint8_t * ciphertext, uint64_t
 //reverse the authentication tag and output it
 static operation_result_t aes_gcm_finalize(cipher_state_t * restrict cs, quadword_t final_block, uint8_t * restrict output_tag);
 
+//compare tag_byte_length bytes of a provided tag with a computed tag in constant time
+static operation_result_t aes_gcm_compare_tag(const uint8_t * restrict tag, const uint8_t * restrict computed_tag, uint32_t tag_byte_length);
+
+// Single block AES encrypt with the expanded keys in cc, rounds is 10, 12 or 14
+static inline uint8x16_t aes_block_kernel(const cipher_constants_t * restrict cc, uint32_t rounds, uint8x16_t block);
+
+// Per message setup for protocols with up to 32B of AAD - first aes-ctr block from counter_block (J0) and GHASH of the AAD
+// leaves cs ready for the enc/dec kernels, so no separate set_counter/ghash_kernel/aes_ctr_blk calls are needed
+static inline void short_aad_prologue_kernel(const cipher_constants_t * restrict cc, quadword_t counter_block, const uint8_t * restrict aad, uint32_t aad_byte_length, uint32_t rounds, cipher_state_t * restrict cs, uint8_t * restrict final_aes_ctr_block);
+
 
 uint8_t rcon[16] = { 0x8d, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36, 0, 0, 0, 0, 0 };
 
@@ -105,6 +176,7 @@ operation_result_t armv8_aes_gcm_set_constants(
     uint8_t * restrict key,
     armv8_cipher_constants_t * restrict cc)
 {
+    TRACE_ENTRY(gcm_set_constants, mode, tag_byte_length);
     cc->tag_byte_length = tag_byte_length;
     cc->mode = mode;
     operation_result_t result;
@@ -122,7 +194,7 @@ operation_result_t armv8_aes_gcm_set_constants(
             result = INTERNAL_FAILURE;
             break;
     }
-    return result;
+    return TRACE_EXIT(gcm_set_constants, result);
 }
 
 #define expand_hash_keys \
@@ -442,6 +514,7 @@ static operation_result_t aes_gcm_expandkeys_256_kernel(uint8_t * restrict key,
 
 operation_result_t armv8_aes_gcm_set_counter(uint8_t * restrict nonce, uint64_t nonce_length, cipher_state_t * restrict cs)
 {
+    TRACE_ENTRY(gcm_set_counter, nonce_length);
     if(nonce_length == 96) { //normal case - only case for IPsec
         #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
             cs->counter.d[0] = ((uint64_t *) nonce)[0];
@@ -454,7 +527,7 @@ operation_result_t armv8_aes_gcm_set_counter(uint8_t * restrict nonce, uint64_t
             cs->counter.s[2] = (((uint32_t *) nonce)[2]);
             cs->counter.s[3] = __builtin_bswap32(1u);
         #endif
-        return SUCCESSFUL_OPERATION;
+        return TRACE_EXIT(gcm_set_counter, SUCCESSFUL_OPERATION);
     } else {
         operation_result_t result_status = SUCCESSFUL_OPERATION;
         quadword_t final_block; // [0]_64 | [len(IV)]_64
@@ -471,14 +544,14 @@ operation_result_t armv8_aes_gcm_set_counter(uint8_t * restrict nonce, uint64_t
             final_block.d[1] = __builtin_bswap64(nonce_length);
         #endif
 
-        result_status |= ghash_kernel(nonce, nonce_length, cs);
+        result_status |= ghash_exact_kernel(nonce, nonce_length, cs);
         result_status |= ghash_kernel(final_block.b, 128, cs);
 
         cs->counter.d[0] = __builtin_bswap64(cs->current_tag.d[1]);
         cs->counter.d[1] = __builtin_bswap64(cs->current_tag.d[0]);
         cs->current_tag.d[0] = 0;
         cs->current_tag.d[1] = 0;
-        return result_status;
+        return TRACE_EXIT(gcm_set_counter, result_status);
     }
 }
 
@@ -645,6 +718,144 @@ static operation_result_t ghash_kernel(uint8_t * restrict input, uint64_t input_
     return SUCCESSFUL_OPERATION;
 }
 
+//Assume input_length is a multiple of 8 (bit_length but describing a byte string)
+//Assume we can read up to 15 bytes beyond the end of input
+//Bytes beyond the end of a partial last block are treated as zero for both the hash and the checksum
+static operation_result_t ghash_checksum_kernel(const uint8_t * restrict input, uint64_t input_length, cipher_state_t * restrict cs, uint64_t * restrict checksum)
+{
+    uint64_t full_blocks = input_length >> 7;
+    uint64_t last_block_bytes = (input_length & 127ul)>>3;
+    const uint8_t tag_mask[32] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+                                   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    const uint8_t * in_ptr = input;
+
+    // 64b words are accumulated without folding the carries back in until the end
+    // this can't overflow for anything addressable
+    unsigned __int128 sum = 0;
+
+    poly64x2_t hash_key_0 = (poly64x2_t) vld1q_u64(cs->constants->expanded_hash_keys[0].d);
+    poly64_t hash_karat_0 = (poly64_t) veor_u64(vget_high_u64(hash_key_0), vget_low_u64(hash_key_0));
+    poly64_t modulo_const = (poly64_t) 0xC200000000000000ul;
+    uint8x16_t low_acc = vld1q_u8(cs->current_tag.b);
+#if MAX_UNROLL_FACTOR >= 4
+    // Aggregated reduction over 4 blocks as in ghash_kernel, with the checksum adds in the scalar pipe alongside the PMULLs
+    poly64x2_t hash_key_1 = (poly64x2_t) vld1q_u64(cs->constants->expanded_hash_keys[1].d);
+    poly64_t hash_karat_1 = (poly64_t) veor_u64(vget_high_u64(hash_key_1), vget_low_u64(hash_key_1));
+    poly64x2_t hash_key_2 = (poly64x2_t) vld1q_u64(cs->constants->expanded_hash_keys[2].d);
+    poly64_t hash_karat_2 = (poly64_t) veor_u64(vget_high_u64(hash_key_2), vget_low_u64(hash_key_2));
+    poly64x2_t hash_key_3 = (poly64x2_t) vld1q_u64(cs->constants->expanded_hash_keys[3].d);
+    poly64_t hash_karat_3 = (poly64_t) veor_u64(vget_high_u64(hash_key_3), vget_low_u64(hash_key_3));
+
+    while( full_blocks >= 4 )
+    {
+        full_blocks -= 4;
+        low_acc = vextq_u8(low_acc, low_acc, 8);
+        uint64x2_t raw_3 = vld1q_u64((const uint64_t *) in_ptr);
+        uint64x2_t raw_2 = vld1q_u64((const uint64_t *) (in_ptr+16));
+        uint64x2_t raw_1 = vld1q_u64((const uint64_t *) (in_ptr+32));
+        uint64x2_t raw_0 = vld1q_u64((const uint64_t *) (in_ptr+48));
+        sum += vgetq_lane_u64(raw_3, 0); sum += vgetq_lane_u64(raw_3, 1);
+        sum += vgetq_lane_u64(raw_2, 0); sum += vgetq_lane_u64(raw_2, 1);
+        sum += vgetq_lane_u64(raw_1, 0); sum += vgetq_lane_u64(raw_1, 1);
+        sum += vgetq_lane_u64(raw_0, 0); sum += vgetq_lane_u64(raw_0, 1);
+        poly64x2_t block_3 = vrev64q_u8(vreinterpretq_u8_u64(raw_3));
+        poly64x2_t block_2 = vrev64q_u8(vreinterpretq_u8_u64(raw_2));
+        poly64x2_t block_1 = vrev64q_u8(vreinterpretq_u8_u64(raw_1));
+        poly64x2_t block_0 = vrev64q_u8(vreinterpretq_u8_u64(raw_0));
+        block_3 = veorq_u64(block_3, low_acc);
+        poly64_t block_karat_3 = (poly64_t) veor_u64(vget_high_u64(block_3),vget_low_u64(block_3));
+        poly64_t block_karat_2 = (poly64_t) veor_u64(vget_high_u64(block_2),vget_low_u64(block_2));
+        poly64_t block_karat_1 = (poly64_t) veor_u64(vget_high_u64(block_1),vget_low_u64(block_1));
+        poly64_t block_karat_0 = (poly64_t) veor_u64(vget_high_u64(block_0),vget_low_u64(block_0));
+
+        //multiply
+        poly128_t t_high_3 = vmull_high_p64(block_3, hash_key_3);
+        poly128_t t_low_3  = vmull_p64((poly64_t) vget_low_p64(block_3), (poly64_t) vget_low_p64(hash_key_3));
+        poly128_t t_mid_3  = vmull_p64(block_karat_3, hash_karat_3);
+        poly128_t t_high_2 = vmull_high_p64(block_2, hash_key_2);
+        poly128_t t_low_2  = vmull_p64((poly64_t) vget_low_p64(block_2), (poly64_t) vget_low_p64(hash_key_2));
+        poly128_t t_mid_2  = vmull_p64(block_karat_2, hash_karat_2);
+        poly128_t t_high_1 = vmull_high_p64(block_1, hash_key_1);
+        poly128_t t_low_1  = vmull_p64((poly64_t) vget_low_p64(block_1), (poly64_t) vget_low_p64(hash_key_1));
+        poly128_t t_mid_1  = vmull_p64(block_karat_1, hash_karat_1);
+        poly128_t t_high_0 = vmull_high_p64(block_0, hash_key_0);
+        poly128_t t_low_0  = vmull_p64((poly64_t) vget_low_p64(block_0), (poly64_t) vget_low_p64(hash_key_0));
+        poly128_t t_mid_0  = vmull_p64(block_karat_0, hash_karat_0);
+
+        //accumulate up temps
+        poly64x2_t high_acc_2 = veorq_u64(vreinterpretq_u64_p128(t_high_3), vreinterpretq_u64_p128(t_high_2));
+        poly64x2_t mid_acc_2  = veorq_u64(vreinterpretq_u64_p128(t_mid_3) , vreinterpretq_u64_p128(t_mid_2) );
+        poly64x2_t low_acc_2  = veorq_u64(vreinterpretq_u64_p128(t_low_3) , vreinterpretq_u64_p128(t_low_2) );
+        poly64x2_t high_acc = veorq_u64(vreinterpretq_u64_p128(t_high_1), vreinterpretq_u64_p128(t_high_0));
+        poly64x2_t mid_acc  = veorq_u64(vreinterpretq_u64_p128(t_mid_1) , vreinterpretq_u64_p128(t_mid_0) );
+        low_acc  = veorq_u64(vreinterpretq_u64_p128(t_low_1) , vreinterpretq_u64_p128(t_low_0) );
+        high_acc = veorq_u64(high_acc, high_acc_2);
+        mid_acc  = veorq_u64(mid_acc , mid_acc_2 );
+        low_acc  = veorq_u64(low_acc , low_acc_2 );
+        //tidy up karatsuba
+        mid_acc  = veorq_u64(mid_acc, high_acc);
+        mid_acc  = veorq_u64(mid_acc, low_acc );
+
+        //modulo reduction
+        poly128_t tmp_mid_0 = vmull_p64((poly64_t) vget_low_p64(vreinterpretq_u64_p128(high_acc)), modulo_const);
+        high_acc = vextq_u8(high_acc, high_acc, 8);
+        mid_acc = veorq_u64(mid_acc, vreinterpretq_u64_p128(tmp_mid_0));
+        mid_acc = veorq_u64(mid_acc, high_acc);
+
+        poly128_t tmp_low_0 = vmull_p64((poly64_t) vget_low_p64(mid_acc), modulo_const);
+        mid_acc = vextq_u8(mid_acc, mid_acc, 8);
+        low_acc = veorq_u64(low_acc, vreinterpretq_u64_p128(tmp_low_0));
+        low_acc = veorq_u64(low_acc, mid_acc);
+        in_ptr += 64;
+    }
+#endif
+    //deal with tail, masking the last block if it is not a full block
+    if(last_block_bytes) {
+        full_blocks++;
+    }
+    for( uint64_t i=0; i<full_blocks; ++i )
+    {
+        low_acc = vextq_u8(low_acc, low_acc, 8);
+        uint64x2_t raw = vld1q_u64((const uint64_t *) in_ptr);
+        if( (i+1 == full_blocks) && last_block_bytes ) {
+            raw = vandq_u64(raw, vreinterpretq_u64_u8(vld1q_u8(tag_mask+16-last_block_bytes)));
+        }
+        sum += vgetq_lane_u64(raw, 0); sum += vgetq_lane_u64(raw, 1);
+        poly64x2_t block = vrev64q_u8(vreinterpretq_u8_u64(raw));
+        block = veorq_u64(block, low_acc);
+        poly64_t block_karat = (poly64_t) veor_u64(vget_high_u64(block),vget_low_u64(block));
+
+        //multiply
+        poly128_t t_high = vmull_high_p64(block, hash_key_0);
+        poly128_t t_low  = vmull_p64((poly64_t) vget_low_p64(block), (poly64_t) vget_low_p64(hash_key_0));
+        poly128_t t_mid  = vmull_p64(block_karat, hash_karat_0);
+
+        //tidy up karatsuba
+        poly64x2_t mid_acc = veorq_u64(vreinterpretq_u64_p128(t_mid), vreinterpretq_u64_p128(t_high));
+        mid_acc = veorq_u64(mid_acc, vreinterpretq_u64_p128(t_low));
+
+        //modulo reduction
+        poly128_t tmp_mid_0 = vmull_p64((poly64_t) vget_low_p64(vreinterpretq_u64_p128(t_high)), modulo_const);
+        uint8x16_t high_acc = vextq_u8(vreinterpretq_u8_p128(t_high), vreinterpretq_u8_p128(t_high), 8);
+        mid_acc = veorq_u64(mid_acc, vreinterpretq_u64_p128(tmp_mid_0));
+        mid_acc = veorq_u64(mid_acc, high_acc);
+
+        poly128_t tmp_low_0 = vmull_p64((poly64_t) vget_low_p64(mid_acc), modulo_const);
+        mid_acc = vextq_u8(mid_acc, mid_acc, 8);
+        low_acc = veorq_u64(vreinterpretq_u64_p128(t_low), vreinterpretq_u64_p128(tmp_low_0));
+        low_acc = veorq_u64(low_acc, mid_acc);
+        in_ptr += 16;
+    }
+
+    vst1q_u8(cs->current_tag.b, low_acc);
+
+    //fold the carries back in (end around carry)
+    uint64_t folded = (uint64_t) sum + (uint64_t) (sum >> 64);
+    if( folded < (uint64_t) sum ) folded++;
+    *checksum = folded;
+    return SUCCESSFUL_OPERATION;
+}
+
 static operation_result_t aes_ctr_blk_128_kernel(uint64_t block_count, cipher_state_t * restrict cs, uint8_t * restrict blocks)
 {
     uint8x16_t counter = vld1q_u8(cs->counter.b);
@@ -1889,6 +2100,55 @@ static operation_result_t aes_gcm_finalize(cipher_state_t * restrict cs, quadwor
     return SUCCESSFUL_OPERATION;
 }
 
+static operation_result_t aes_gcm_compare_tag(const uint8_t * restrict tag, const uint8_t * restrict computed_tag, uint32_t tag_byte_length)
+{
+    uint64_t mismatch = 0;
+    uint32_t len = tag_byte_length;
+    const uint8_t *cur = computed_tag;
+    if (len >= sizeof(__int128))
+    {
+	__int128 a, b;
+	memcpy(&a, tag, sizeof(__int128)); tag += sizeof(__int128);
+	memcpy(&b, cur, sizeof(__int128)); cur += sizeof(__int128);
+	mismatch |= (uint64_t)(a >> 64) ^ (uint64_t)(b >> 64);
+	mismatch |= (uint64_t)a ^ (uint64_t)b;
+	len -= sizeof(__int128);
+    }
+    if (len >= sizeof(uint64_t))
+    {
+	uint64_t a, b;
+	memcpy(&a, tag, sizeof(uint64_t)); tag += sizeof(uint64_t);
+	memcpy(&b, cur, sizeof(uint64_t)); cur += sizeof(uint64_t);
+	mismatch |= a ^ b;
+	len -= sizeof(uint64_t);
+    }
+    if (len >= sizeof(uint32_t))
+    {
+	uint32_t a, b;
+	memcpy(&a, tag, sizeof(uint32_t)); tag += sizeof(uint32_t);
+	memcpy(&b, cur, sizeof(uint32_t)); cur += sizeof(uint32_t);
+	mismatch |= a ^ b;
+	len -= sizeof(uint32_t);
+    }
+    if (len >= sizeof(uint16_t))
+    {
+	uint16_t a, b;
+	memcpy(&a, tag, sizeof(uint16_t)); tag += sizeof(uint16_t);
+	memcpy(&b, cur, sizeof(uint16_t)); cur += sizeof(uint16_t);
+	mismatch |= a ^ b;
+	len -= sizeof(uint16_t);
+    }
+    if (len >= sizeof(uint8_t))
+    {
+	uint8_t a, b;
+	memcpy(&a, tag, sizeof(uint8_t)); tag += sizeof(uint8_t);
+	memcpy(&b, cur, sizeof(uint8_t)); cur += sizeof(uint8_t);
+	mismatch |= a ^ b;
+	len -= sizeof(uint8_t);
+    }
+    return mismatch ? AUTHENTICATION_FAILURE : SUCCESSFUL_OPERATION;
+}
+
 operation_result_t encrypt_full(
     cipher_mode_t mode,
     uint8_t * key,
@@ -1898,6 +2158,7 @@ operation_result_t encrypt_full(
     uint8_t * ciphertext,
     uint8_t * tag)                              //Outputs
 {
+    TRACE_ENTRY(gcm_enc_full, mode, plaintext_length, aad_length);
     operation_result_t result_status = SUCCESSFUL_OPERATION;
     cipher_constants_t cc = { .mode = mode };
     cipher_state_t cs = { .counter = { .d = {0,0} } };
@@ -1914,21 +2175,151 @@ operation_result_t encrypt_full(
             result_status |= aes_gcm_expandkeys_256_kernel(key, &cc); //set expanded keys and hash key in cc
             break;
 	default :
-	    return INVALID_PARAMETER;
+	    return API_RETURN(gcm_enc_full, ARMV8_STATS_GCM_ENC, plaintext_length >> 3, STATS_GENERIC_GCM, INVALID_PARAMETER);
     }
     result_status |= armv8_aes_gcm_set_counter(nonce, nonce_length, &cs); //set counter value in cs
-    if( result_status != SUCCESSFUL_OPERATION ) return result_status; //if we have failed in setup, don't continue
+    if( result_status != SUCCESSFUL_OPERATION ) return API_RETURN(gcm_enc_full, ARMV8_STATS_GCM_ENC, plaintext_length >> 3, STATS_GENERIC_GCM, result_status); //if we have failed in setup, don't continue
 
-    return encrypt_from_state(&cs, aad, aad_length, plaintext, plaintext_length, ciphertext, tag);
+    return TRACE_EXIT(gcm_enc_full, encrypt_from_state(&cs, aad, aad_length, plaintext, plaintext_length, ciphertext, tag));
 }
 
-operation_result_t encrypt_from_state(
+// Exact length helpers - the kernels above are run on the whole 16B blocks directly, and on the final partial block
+// through a zero padded 16B block on the stack, so nothing outside [input, input+length) is read and nothing outside
+// [output, output+length) is written
+// The asm kernels only load and store whole blocks until the tail, so the cost is one branch for whole block messages
+static operation_result_t ghash_exact_kernel(uint8_t * restrict input, uint64_t input_length, cipher_state_t * restrict cs)
+{
+    uint64_t whole_length = input_length & ~127ul;
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+    if(whole_length) {
+        result_status |= ghash_kernel(input, whole_length, cs);
+    }
+    if(input_length & 127ul) {
+        quadword_t tail = { .d = {0,0} };
+        memcpy(tail.b, input + (whole_length>>3), (input_length & 127ul)>>3);
+        result_status |= ghash_kernel(tail.b, input_length & 127ul, cs);
+    }
+    return result_status;
+}
+
+static inline operation_result_t aes_gcm_exact_kernel(
+    operation_result_t (*kernel)(uint8_t *, uint64_t, cipher_state_t * restrict, uint8_t *),
+    uint8_t * input, uint64_t input_length, cipher_state_t * restrict cs, uint8_t * output)
+{
+    uint64_t whole_length = input_length & ~127ul;
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+    if(whole_length) {
+        result_status |= kernel(input, whole_length, cs, output);
+    }
+    if(input_length & 127ul) {
+        uint64_t tail_bytes = (input_length & 127ul)>>3;
+        quadword_t tail = { .d = {0,0} };
+        memcpy(tail.b, input + (whole_length>>3), tail_bytes);
+        result_status |= kernel(tail.b, input_length & 127ul, cs, tail.b);
+        memcpy(output + (whole_length>>3), tail.b, tail_bytes);
+    }
+    return result_status;
+}
+
+// Bulk helpers - each chunk of output is written by the kernel into a buffer that stays in L1, and then streamed out
+// with STNP non-temporal stores, so a large output doesn't displace the caller's working set from the caches
+// The input is prefetched a couple of chunks ahead with PLDL2STRM, so it arrives in L2 marked as streaming and is
+// the first to be evicted
+// Messages shorter than ARMV8_AES_GCM_BULK_MIN_BYTES, and the part of a message after the last whole chunk, go
+// straight through the kernel
+#define BULK_CHUNK_BYTES        (16u << 10)
+#define BULK_PREFETCH_CHUNKS    2
+
+static inline void bulk_prefetch_input(const uint8_t * input, uint64_t byte_length)
+{
+    for( uint64_t i=0; i<byte_length; i+=64 )
+    {
+        __asm__ __volatile__("prfm pldl2strm, [%[p]]" : : [p] "r" (input + i));
+    }
+}
+
+// byte_length is a multiple of 64
+static inline void bulk_stream_output(uint8_t * output, const uint8_t * chunk, uint64_t byte_length)
+{
+    for( uint64_t i=0; i<byte_length; i+=64 )
+    {
+        __asm__ __volatile__(
+            "ldp     q0, q1, [%[src]]               \n"
+            "ldp     q2, q3, [%[src], #32]          \n"
+            "stnp    q0, q1, [%[dst]]               \n"
+            "stnp    q2, q3, [%[dst], #32]          \n"
+            : : [dst] "r" (output + i), [src] "r" (chunk + i) : "v0", "v1", "v2", "v3", "memory");
+    }
+}
+
+static inline operation_result_t aes_gcm_bulk_kernel(
+    operation_result_t (*kernel)(uint8_t *, uint64_t, cipher_state_t * restrict, uint8_t *),
+    uint8_t * input, uint64_t input_length, cipher_state_t * restrict cs, uint8_t * output)
+{
+    if(input_length < ((uint64_t) ARMV8_AES_GCM_BULK_MIN_BYTES << 3)) {
+        return kernel(input, input_length, cs, output);
+    }
+
+    uint8_t chunk[BULK_CHUNK_BYTES] __attribute__((aligned(64)));
+    uint64_t chunks = (input_length >> 3) / BULK_CHUNK_BYTES;
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+
+    bulk_prefetch_input(input, BULK_PREFETCH_CHUNKS * BULK_CHUNK_BYTES);
+    for( uint64_t i=0; i<chunks; ++i )
+    {
+        uint8_t * in_ptr  = input  + i * BULK_CHUNK_BYTES;
+        uint8_t * out_ptr = output + i * BULK_CHUNK_BYTES;
+        if(i + BULK_PREFETCH_CHUNKS < chunks) {
+            bulk_prefetch_input(in_ptr + BULK_PREFETCH_CHUNKS * BULK_CHUNK_BYTES, BULK_CHUNK_BYTES);
+        }
+        result_status |= kernel(in_ptr, (uint64_t) BULK_CHUNK_BYTES << 3, cs, chunk);
+        bulk_stream_output(out_ptr, chunk, BULK_CHUNK_BYTES);
+    }
+    uint64_t done_length = chunks * ((uint64_t) BULK_CHUNK_BYTES << 3);
+    if(input_length > done_length) {
+        result_status |= kernel(input + (done_length >> 3), input_length - done_length, cs, output + (done_length >> 3));
+    }
+    // order the non-temporal stores before anything the caller does to publish the output
+    __asm__ __volatile__("dmb ishst" : : : "memory");
+    return result_status;
+}
+
+#undef BULK_CHUNK_BYTES
+#undef BULK_PREFETCH_CHUNKS
+
+typedef enum from_state_variant { FROM_STATE_PADDED, FROM_STATE_EXACT, FROM_STATE_BULK } from_state_variant_t;
+
+static inline operation_result_t aes_gcm_variant_kernel(
+    const from_state_variant_t variant,
+    operation_result_t (*kernel)(uint8_t *, uint64_t, cipher_state_t * restrict, uint8_t *),
+    uint8_t * input, uint64_t input_length, cipher_state_t * restrict cs, uint8_t * output)
+{
+    switch(variant) {
+        case FROM_STATE_EXACT:
+            return aes_gcm_exact_kernel(kernel, input, input_length, cs, output);
+        case FROM_STATE_BULK:
+            return aes_gcm_bulk_kernel(kernel, input, input_length, cs, output);
+        default:
+            return kernel(input, input_length, cs, output);
+    }
+}
+
+// Shared by encrypt_from_state and its _exact, _bulk and per key size variants - variant is a constant, so each gets
+// its own copy, and so is mode in the per key size variants, which then skip the switch on the mode
+static inline operation_result_t encrypt_from_state_body(
     cipher_state_t * cs,
     uint8_t * aad,       uint64_t aad_length,
     uint8_t * plaintext, uint64_t plaintext_length,
     uint8_t * ciphertext,
-    uint8_t * restrict tag)
+    uint8_t * restrict tag,
+    const from_state_variant_t variant,
+    const cipher_mode_t mode)
 {
+    if(variant == FROM_STATE_EXACT && (cs->constants->tag_byte_length < 12 || cs->constants->tag_byte_length > 16) &&
+       (cs->constants->tag_byte_length != 4 && cs->constants->tag_byte_length != 8))
+    {
+        return INVALID_PARAMETER;
+    }
     operation_result_t result_status = SUCCESSFUL_OPERATION;
     quadword_t final_aes_ctr_block = { .d = {0,0} };
     quadword_t final_block; // [len(A)]_64 | [len(C)]_64
@@ -1943,37 +2334,55 @@ operation_result_t encrypt_from_state(
         final_block.d[1] = __builtin_bswap64(plaintext_length);
     #endif
 
-    result_status |= ghash_kernel(aad, aad_length, cs); //update current_tag value in cs with aad
+    result_status |= (variant == FROM_STATE_EXACT) ? ghash_exact_kernel(aad, aad_length, cs) : ghash_kernel(aad, aad_length, cs); //update current_tag value in cs with aad
 
-    switch(cs->constants->mode)
+    switch(mode)
     {
         case AES_GCM_128:
             result_status |= aes_ctr_blk_128_kernel(1, cs, final_aes_ctr_block.b); //compute first aes-ctr block for "encrypting" tag
             if( result_status != SUCCESSFUL_OPERATION ) return result_status; //if we have failed in authenticating aad or computing first aes-ctr block, don't continue
 
-            result_status |= aes_gcm_enc_128_kernel(plaintext, plaintext_length, cs, ciphertext); //set ciphertext to encrypted plaintext whilst updating current_tag value in cs
+            result_status |= aes_gcm_variant_kernel(variant, aes_gcm_enc_128_kernel, plaintext, plaintext_length, cs, ciphertext); //set ciphertext to encrypted plaintext whilst updating current_tag value in cs
             break;
         case AES_GCM_192:
             result_status |= aes_ctr_blk_192_kernel(1, cs, final_aes_ctr_block.b); //compute first aes-ctr block for "encrypting" tag
             if( result_status != SUCCESSFUL_OPERATION ) return result_status; //if we have failed in authenticating aad or computing first aes-ctr block, don't continue
 
-            result_status |= aes_gcm_enc_192_kernel(plaintext, plaintext_length, cs, ciphertext); //set ciphertext to encrypted plaintext whilst updating current_tag value in cs
+            result_status |= aes_gcm_variant_kernel(variant, aes_gcm_enc_192_kernel, plaintext, plaintext_length, cs, ciphertext); //set ciphertext to encrypted plaintext whilst updating current_tag value in cs
             break;
         case AES_GCM_256:
             result_status |= aes_ctr_blk_256_kernel(1, cs, final_aes_ctr_block.b); //compute first aes-ctr block for "encrypting" tag
             if( result_status != SUCCESSFUL_OPERATION ) return result_status; //if we have failed in authenticating aad or computing first aes-ctr block, don't continue
 
-            result_status |= aes_gcm_enc_256_kernel(plaintext, plaintext_length, cs, ciphertext); //set ciphertext to encrypted plaintext whilst updating current_tag value in cs
+            result_status |= aes_gcm_variant_kernel(variant, aes_gcm_enc_256_kernel, plaintext, plaintext_length, cs, ciphertext); //set ciphertext to encrypted plaintext whilst updating current_tag value in cs
             break;
 	default :
 	    return INVALID_PARAMETER;
     }
     result_status |= ghash_kernel(final_block.b, 128, cs); //update current_tag value in cs with final_block
-    result_status |= aes_gcm_finalize(cs, final_aes_ctr_block, tag); //finalize current_tag
+    if(variant == FROM_STATE_EXACT) {
+        quadword_t full_tag;
+        result_status |= aes_gcm_finalize(cs, final_aes_ctr_block, full_tag.b); //finalize current_tag
+        memcpy(tag, full_tag.b, cs->constants->tag_byte_length);
+    } else {
+        result_status |= aes_gcm_finalize(cs, final_aes_ctr_block, tag); //finalize current_tag
+    }
 
     return result_status;
 }
 
+operation_result_t encrypt_from_state(
+    cipher_state_t * cs,
+    uint8_t * aad,       uint64_t aad_length,
+    uint8_t * plaintext, uint64_t plaintext_length,
+    uint8_t * ciphertext,
+    uint8_t * restrict tag)
+{
+    TRACE_ENTRY(gcm_enc, cs->constants->mode, plaintext_length, aad_length);
+    return API_RETURN(gcm_enc, ARMV8_STATS_GCM_ENC, plaintext_length >> 3, STATS_GENERIC_GCM,
+                      encrypt_from_state_body(cs, aad, aad_length, plaintext, plaintext_length, ciphertext, tag, FROM_STATE_PADDED, cs->constants->mode));
+}
+
 operation_result_t decrypt_full(
     cipher_mode_t mode,
     uint8_t * key,
@@ -1983,11 +2392,12 @@ operation_result_t decrypt_full(
     uint8_t * tag,         uint64_t tag_byte_length,   //Inputs
     uint8_t * plaintext)                               //Outputs
 {
+    TRACE_ENTRY(gcm_dec_full, mode, ciphertext_length, aad_length);
     //Check for invalid tag sizes
     if ((tag_byte_length < 12 || tag_byte_length > 16) &&
 	(tag_byte_length != 4 && tag_byte_length != 8))
     {
-	return INVALID_PARAMETER;
+	return API_RETURN(gcm_dec_full, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, STATS_GENERIC_GCM, INVALID_PARAMETER);
     }
     operation_result_t result_status = SUCCESSFUL_OPERATION;
     cipher_constants_t cc = { .mode = mode, .tag_byte_length = tag_byte_length };
@@ -2005,20 +2415,23 @@ operation_result_t decrypt_full(
             result_status |= aes_gcm_expandkeys_256_kernel(key, &cc); //set expanded keys and hash key in cc
             break;
 	default :
-	    return INVALID_PARAMETER;
+	    return API_RETURN(gcm_dec_full, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, STATS_GENERIC_GCM, INVALID_PARAMETER);
     }
     result_status |= armv8_aes_gcm_set_counter(nonce, nonce_length, &cs); //set counter value in cs
-    if( result_status != SUCCESSFUL_OPERATION ) return result_status; //if we have failed in setup, don't continue
+    if( result_status != SUCCESSFUL_OPERATION ) return API_RETURN(gcm_dec_full, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, STATS_GENERIC_GCM, result_status); //if we have failed in setup, don't continue
 
-    return decrypt_from_state(&cs, aad, aad_length, ciphertext, ciphertext_length, tag, plaintext);
+    return TRACE_EXIT(gcm_dec_full, decrypt_from_state(&cs, aad, aad_length, ciphertext, ciphertext_length, tag, plaintext));
 }
 
-operation_result_t decrypt_from_state(
+// Shared by decrypt_from_state and its _exact, _bulk and per key size variants, as encrypt_from_state_body
+static inline operation_result_t decrypt_from_state_body(
     cipher_state_t * restrict cs,
     uint8_t * aad,        uint64_t aad_length,
     uint8_t * ciphertext, uint64_t ciphertext_length,
     uint8_t * restrict tag,
-    uint8_t * plaintext)
+    uint8_t * plaintext,
+    const from_state_variant_t variant,
+    const cipher_mode_t mode)
 {
     //Check for invalid tag sizes
     if ((cs->constants->tag_byte_length < 12 || cs->constants->tag_byte_length > 16) &&
@@ -2040,27 +2453,27 @@ operation_result_t decrypt_from_state(
         final_block.d[1] = __builtin_bswap64(ciphertext_length);
     #endif
 
-    result_status |= ghash_kernel(aad, aad_length, cs); //update current_tag value in cs with aad
+    result_status |= (variant == FROM_STATE_EXACT) ? ghash_exact_kernel(aad, aad_length, cs) : ghash_kernel(aad, aad_length, cs); //update current_tag value in cs with aad
 
-    switch(cs->constants->mode)
+    switch(mode)
     {
         case AES_GCM_128:
             result_status |= aes_ctr_blk_128_kernel(1, cs, final_aes_ctr_block.b); //compute first aes-ctr block for "encrypting" tag
             if( result_status != SUCCESSFUL_OPERATION ) return result_status; //if we have failed in authenticating aad or computing first aes-ctr block, don't continue
 
-            result_status |= aes_gcm_dec_128_kernel(ciphertext, ciphertext_length, cs, plaintext); //set plaintext to decrypted ciphertext whilst updating current_tag value in cs
+            result_status |= aes_gcm_variant_kernel(variant, aes_gcm_dec_128_kernel, ciphertext, ciphertext_length, cs, plaintext); //set plaintext to decrypted ciphertext whilst updating current_tag value in cs
             break;
         case AES_GCM_192:
             result_status |= aes_ctr_blk_192_kernel(1, cs, final_aes_ctr_block.b); //compute first aes-ctr block for "encrypting" tag
             if( result_status != SUCCESSFUL_OPERATION ) return result_status; //if we have failed in authenticating aad or computing first aes-ctr block, don't continue
 
-            result_status |= aes_gcm_dec_192_kernel(ciphertext, ciphertext_length, cs, plaintext); //set plaintext to decrypted ciphertext whilst updating current_tag value in cs
+            result_status |= aes_gcm_variant_kernel(variant, aes_gcm_dec_192_kernel, ciphertext, ciphertext_length, cs, plaintext); //set plaintext to decrypted ciphertext whilst updating current_tag value in cs
             break;
         case AES_GCM_256:
             result_status |= aes_ctr_blk_256_kernel(1, cs, final_aes_ctr_block.b); //compute first aes-ctr block for "encrypting" tag
             if( result_status != SUCCESSFUL_OPERATION ) return result_status; //if we have failed in authenticating aad or computing first aes-ctr block, don't continue
 
-            result_status |= aes_gcm_dec_256_kernel(ciphertext, ciphertext_length, cs, plaintext); //set plaintext to decrypted ciphertext whilst updating current_tag value in cs
+            result_status |= aes_gcm_variant_kernel(variant, aes_gcm_dec_256_kernel, ciphertext, ciphertext_length, cs, plaintext); //set plaintext to decrypted ciphertext whilst updating current_tag value in cs
             break;
 	default :
 	    return INVALID_PARAMETER;
@@ -2069,191 +2482,2141 @@ operation_result_t decrypt_from_state(
     result_status |= aes_gcm_finalize(cs, final_aes_ctr_block, cs->current_tag.b); //finalize current_tag
     if( result_status != SUCCESSFUL_OPERATION ) return result_status; //if we have failed in aes-gcm decryption or computing doing final ghash, don't continue
 
-    uint64_t mismatch = 0;
-    uint32_t len = cs->constants->tag_byte_length;
-    uint8_t *cur = cs->current_tag.b;
-    if (len >= sizeof(__int128))
-    {
-	__int128 a, b;
-	memcpy(&a, tag, sizeof(__int128)); tag += sizeof(__int128);
-	memcpy(&b, cur, sizeof(__int128)); cur += sizeof(__int128);
-	mismatch |= (uint64_t)(a >> 64) ^ (uint64_t)(b >> 64);
-	mismatch |= (uint64_t)a ^ (uint64_t)b;
-	len -= sizeof(__int128);
+    return aes_gcm_compare_tag(tag, cs->current_tag.b, cs->constants->tag_byte_length);
+}
+
+operation_result_t decrypt_from_state(
+    cipher_state_t * restrict cs,
+    uint8_t * aad,        uint64_t aad_length,
+    uint8_t * ciphertext, uint64_t ciphertext_length,
+    uint8_t * restrict tag,
+    uint8_t * plaintext)
+{
+    TRACE_ENTRY(gcm_dec, cs->constants->mode, ciphertext_length, aad_length);
+    return API_RETURN(gcm_dec, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, STATS_GENERIC_GCM,
+                      decrypt_from_state_body(cs, aad, aad_length, ciphertext, ciphertext_length, tag, plaintext, FROM_STATE_PADDED, cs->constants->mode));
+}
+
+operation_result_t encrypt_full_exact(
+    cipher_mode_t mode,
+    uint8_t * key,
+    uint8_t * nonce,       uint64_t nonce_length,
+    uint8_t * aad,         uint64_t aad_length,
+    uint8_t * plaintext,   uint64_t plaintext_length,
+    uint64_t tag_byte_length,                   //Inputs
+    uint8_t * ciphertext,
+    uint8_t * tag)                              //Outputs
+{
+    TRACE_ENTRY(gcm_enc_full_exact, mode, plaintext_length, aad_length);
+    if((mode != AES_GCM_128 && mode != AES_GCM_192 && mode != AES_GCM_256) || tag_byte_length > 16) {
+        return API_RETURN(gcm_enc_full_exact, ARMV8_STATS_GCM_ENC, plaintext_length >> 3, STATS_GENERIC_GCM, INVALID_PARAMETER);
     }
-    if (len >= sizeof(uint64_t))
-    {
-	uint64_t a, b;
-	memcpy(&a, tag, sizeof(uint64_t)); tag += sizeof(uint64_t);
-	memcpy(&b, cur, sizeof(uint64_t)); cur += sizeof(uint64_t);
-	mismatch |= a ^ b;
-	len -= sizeof(uint64_t);
+    cipher_constants_t cc;
+    cipher_state_t cs = { .counter = { .d = {0,0} } };
+    cs.constants = &cc;
+
+    operation_result_t result_status = armv8_aes_gcm_set_constants(mode, tag_byte_length, key, &cc);
+    result_status |= armv8_aes_gcm_set_counter(nonce, nonce_length, &cs);
+    if( result_status != SUCCESSFUL_OPERATION ) return API_RETURN(gcm_enc_full_exact, ARMV8_STATS_GCM_ENC, plaintext_length >> 3, STATS_GENERIC_GCM, result_status); //if we have failed in setup, don't continue
+
+    return TRACE_EXIT(gcm_enc_full_exact, encrypt_from_state_exact(&cs, aad, aad_length, plaintext, plaintext_length, ciphertext, tag));
+}
+
+operation_result_t encrypt_from_state_exact(
+    cipher_state_t * cs,
+    uint8_t * aad,       uint64_t aad_length,
+    uint8_t * plaintext, uint64_t plaintext_length,
+    uint8_t * ciphertext,
+    uint8_t * restrict tag)
+{
+    TRACE_ENTRY(gcm_enc_exact, cs->constants->mode, plaintext_length, aad_length);
+    return API_RETURN(gcm_enc_exact, ARMV8_STATS_GCM_ENC, plaintext_length >> 3, STATS_GENERIC_GCM,
+                      encrypt_from_state_body(cs, aad, aad_length, plaintext, plaintext_length, ciphertext, tag, FROM_STATE_EXACT, cs->constants->mode));
+}
+
+operation_result_t decrypt_full_exact(
+    cipher_mode_t mode,
+    uint8_t * key,
+    uint8_t * nonce,       uint64_t nonce_length,
+    uint8_t * aad,         uint64_t aad_length,
+    uint8_t * ciphertext,  uint64_t ciphertext_length,
+    uint8_t * tag,         uint64_t tag_byte_length,   //Inputs
+    uint8_t * plaintext)                               //Outputs
+{
+    TRACE_ENTRY(gcm_dec_full_exact, mode, ciphertext_length, aad_length);
+    if((mode != AES_GCM_128 && mode != AES_GCM_192 && mode != AES_GCM_256) || tag_byte_length > 16) {
+        return API_RETURN(gcm_dec_full_exact, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    cipher_constants_t cc;
+    cipher_state_t cs = { .counter = { .d = {0,0} } };
+    cs.constants = &cc;
+
+    operation_result_t result_status = armv8_aes_gcm_set_constants(mode, tag_byte_length, key, &cc);
+    result_status |= armv8_aes_gcm_set_counter(nonce, nonce_length, &cs);
+    if( result_status != SUCCESSFUL_OPERATION ) return API_RETURN(gcm_dec_full_exact, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, STATS_GENERIC_GCM, result_status); //if we have failed in setup, don't continue
+
+    return TRACE_EXIT(gcm_dec_full_exact, decrypt_from_state_exact(&cs, aad, aad_length, ciphertext, ciphertext_length, tag, plaintext));
+}
+
+operation_result_t decrypt_from_state_exact(
+    cipher_state_t * restrict cs,
+    uint8_t * aad,        uint64_t aad_length,
+    uint8_t * ciphertext, uint64_t ciphertext_length,
+    uint8_t * restrict tag,
+    uint8_t * plaintext)
+{
+    TRACE_ENTRY(gcm_dec_exact, cs->constants->mode, ciphertext_length, aad_length);
+    return API_RETURN(gcm_dec_exact, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, STATS_GENERIC_GCM,
+                      decrypt_from_state_body(cs, aad, aad_length, ciphertext, ciphertext_length, tag, plaintext, FROM_STATE_EXACT, cs->constants->mode));
+}
+
+operation_result_t encrypt_from_state_bulk(
+    cipher_state_t * cs,
+    uint8_t * aad,       uint64_t aad_length,
+    uint8_t * plaintext, uint64_t plaintext_length,
+    uint8_t * ciphertext,
+    uint8_t * restrict tag)
+{
+    TRACE_ENTRY(gcm_enc_bulk, cs->constants->mode, plaintext_length, aad_length);
+    return API_RETURN(gcm_enc_bulk, ARMV8_STATS_GCM_ENC, plaintext_length >> 3, STATS_GENERIC_GCM,
+                      encrypt_from_state_body(cs, aad, aad_length, plaintext, plaintext_length, ciphertext, tag, FROM_STATE_BULK, cs->constants->mode));
+}
+
+operation_result_t decrypt_from_state_bulk(
+    cipher_state_t * restrict cs,
+    uint8_t * aad,        uint64_t aad_length,
+    uint8_t * ciphertext, uint64_t ciphertext_length,
+    uint8_t * restrict tag,
+    uint8_t * plaintext)
+{
+    TRACE_ENTRY(gcm_dec_bulk, cs->constants->mode, ciphertext_length, aad_length);
+    return API_RETURN(gcm_dec_bulk, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, STATS_GENERIC_GCM,
+                      decrypt_from_state_body(cs, aad, aad_length, ciphertext, ciphertext_length, tag, plaintext, FROM_STATE_BULK, cs->constants->mode));
+}
+
+operation_result_t encrypt_from_state_exact_128(
+    cipher_state_t * cs,
+    uint8_t * aad,       uint64_t aad_length,
+    uint8_t * plaintext, uint64_t plaintext_length,
+    uint8_t * ciphertext,
+    uint8_t * restrict tag)
+{
+    TRACE_ENTRY(gcm_enc_exact, AES_GCM_128, plaintext_length, aad_length);
+    if(cs->constants->mode != AES_GCM_128) {
+        return API_RETURN(gcm_enc_exact, ARMV8_STATS_GCM_ENC, plaintext_length >> 3, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    return API_RETURN(gcm_enc_exact, ARMV8_STATS_GCM_ENC, plaintext_length >> 3, STATS_GENERIC_GCM,
+                      encrypt_from_state_body(cs, aad, aad_length, plaintext, plaintext_length, ciphertext, tag, FROM_STATE_EXACT, AES_GCM_128));
+}
+
+operation_result_t encrypt_from_state_exact_192(
+    cipher_state_t * cs,
+    uint8_t * aad,       uint64_t aad_length,
+    uint8_t * plaintext, uint64_t plaintext_length,
+    uint8_t * ciphertext,
+    uint8_t * restrict tag)
+{
+    TRACE_ENTRY(gcm_enc_exact, AES_GCM_192, plaintext_length, aad_length);
+    if(cs->constants->mode != AES_GCM_192) {
+        return API_RETURN(gcm_enc_exact, ARMV8_STATS_GCM_ENC, plaintext_length >> 3, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    return API_RETURN(gcm_enc_exact, ARMV8_STATS_GCM_ENC, plaintext_length >> 3, STATS_GENERIC_GCM,
+                      encrypt_from_state_body(cs, aad, aad_length, plaintext, plaintext_length, ciphertext, tag, FROM_STATE_EXACT, AES_GCM_192));
+}
+
+operation_result_t encrypt_from_state_exact_256(
+    cipher_state_t * cs,
+    uint8_t * aad,       uint64_t aad_length,
+    uint8_t * plaintext, uint64_t plaintext_length,
+    uint8_t * ciphertext,
+    uint8_t * restrict tag)
+{
+    TRACE_ENTRY(gcm_enc_exact, AES_GCM_256, plaintext_length, aad_length);
+    if(cs->constants->mode != AES_GCM_256) {
+        return API_RETURN(gcm_enc_exact, ARMV8_STATS_GCM_ENC, plaintext_length >> 3, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    return API_RETURN(gcm_enc_exact, ARMV8_STATS_GCM_ENC, plaintext_length >> 3, STATS_GENERIC_GCM,
+                      encrypt_from_state_body(cs, aad, aad_length, plaintext, plaintext_length, ciphertext, tag, FROM_STATE_EXACT, AES_GCM_256));
+}
+
+operation_result_t decrypt_from_state_exact_128(
+    cipher_state_t * restrict cs,
+    uint8_t * aad,        uint64_t aad_length,
+    uint8_t * ciphertext, uint64_t ciphertext_length,
+    uint8_t * restrict tag,
+    uint8_t * plaintext)
+{
+    TRACE_ENTRY(gcm_dec_exact, AES_GCM_128, ciphertext_length, aad_length);
+    if(cs->constants->mode != AES_GCM_128) {
+        return API_RETURN(gcm_dec_exact, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    return API_RETURN(gcm_dec_exact, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, STATS_GENERIC_GCM,
+                      decrypt_from_state_body(cs, aad, aad_length, ciphertext, ciphertext_length, tag, plaintext, FROM_STATE_EXACT, AES_GCM_128));
+}
+
+operation_result_t decrypt_from_state_exact_192(
+    cipher_state_t * restrict cs,
+    uint8_t * aad,        uint64_t aad_length,
+    uint8_t * ciphertext, uint64_t ciphertext_length,
+    uint8_t * restrict tag,
+    uint8_t * plaintext)
+{
+    TRACE_ENTRY(gcm_dec_exact, AES_GCM_192, ciphertext_length, aad_length);
+    if(cs->constants->mode != AES_GCM_192) {
+        return API_RETURN(gcm_dec_exact, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    return API_RETURN(gcm_dec_exact, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, STATS_GENERIC_GCM,
+                      decrypt_from_state_body(cs, aad, aad_length, ciphertext, ciphertext_length, tag, plaintext, FROM_STATE_EXACT, AES_GCM_192));
+}
+
+operation_result_t decrypt_from_state_exact_256(
+    cipher_state_t * restrict cs,
+    uint8_t * aad,        uint64_t aad_length,
+    uint8_t * ciphertext, uint64_t ciphertext_length,
+    uint8_t * restrict tag,
+    uint8_t * plaintext)
+{
+    TRACE_ENTRY(gcm_dec_exact, AES_GCM_256, ciphertext_length, aad_length);
+    if(cs->constants->mode != AES_GCM_256) {
+        return API_RETURN(gcm_dec_exact, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    return API_RETURN(gcm_dec_exact, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, STATS_GENERIC_GCM,
+                      decrypt_from_state_body(cs, aad, aad_length, ciphertext, ciphertext_length, tag, plaintext, FROM_STATE_EXACT, AES_GCM_256));
+}
+
+// Random access - a message is encrypted with counter blocks inc32(J0), inc32(J0)+1, ..., so the counter for any
+// 16B block can be derived from J0 and decrypted on its own with the AES-CTR kernels, and GHASH is linear, so the
+// hash of a message can be assembled from the hashes of its segments
+// A message can't be longer than 2^32-2 blocks, as the 32b counter would wrap round to J0
+#define GCM_MAX_BYTE_LENGTH     ((((uint64_t) 1 << 32) - 2) * 16)
+#define RANGE_CHUNK_BLOCKS      64
+
+// Multiply two values in the twisted form of expanded_hash_keys, as in expand_hash_keys, without the final swap of
+// halves - with a in the form ghash_kernel loads a block in, the result is in the form it leaves in current_tag
+static inline uint8x16_t gf128_mul_kernel(poly64x2_t a, poly64x2_t b)
+{
+    poly64_t modulo_const = (poly64_t) 0xC200000000000000ul;
+    poly64_t a_karat = (poly64_t) veor_u64(vget_high_u64(a), vget_low_u64(a));
+    poly64_t b_karat = (poly64_t) veor_u64(vget_high_u64(b), vget_low_u64(b));
+
+    //multiply
+    poly128_t t_high = vmull_high_p64(a, b);
+    poly128_t t_low  = vmull_p64((poly64_t) vget_low_p64(a), (poly64_t) vget_low_p64(b));
+    poly128_t t_mid  = vmull_p64(a_karat, b_karat);
+
+    //tidy up karatsuba
+    poly64x2_t mid_acc = veorq_u64(vreinterpretq_u64_p128(t_mid), vreinterpretq_u64_p128(t_high));
+    mid_acc = veorq_u64(mid_acc, vreinterpretq_u64_p128(t_low));
+
+    //modulo reduction
+    poly128_t tmp_mid_0 = vmull_p64((poly64_t) vget_low_p64(vreinterpretq_u64_p128(t_high)), modulo_const);
+    uint8x16_t high_acc = vextq_u8(vreinterpretq_u8_p128(t_high), vreinterpretq_u8_p128(t_high), 8);
+    mid_acc = veorq_u64(mid_acc, vreinterpretq_u64_p128(tmp_mid_0));
+    mid_acc = veorq_u64(mid_acc, high_acc);
+
+    poly128_t tmp_low_0 = vmull_p64((poly64_t) vget_low_p64(mid_acc), modulo_const);
+    mid_acc = vextq_u8(mid_acc, mid_acc, 8);
+    uint8x16_t result = veorq_u64(vreinterpretq_u64_p128(t_low), vreinterpretq_u64_p128(tmp_low_0));
+    return veorq_u64(result, mid_acc);
+}
+
+// H^power in twisted form, by square and multiply from H (power > 0)
+static poly64x2_t hash_key_power_kernel(const cipher_constants_t * restrict cc, uint64_t power)
+{
+    poly64x2_t square = (poly64x2_t) vld1q_u64(cc->expanded_hash_keys[0].d);
+    poly64x2_t result = square;
+    bool have_result = false;
+    while(power) {
+        if(power & 1) {
+            if(have_result) {
+                uint8x16_t product = gf128_mul_kernel(result, square);
+                result = vreinterpretq_p64_u8(vextq_u8(product, product, 8));
+            } else {
+                result = square;
+                have_result = true;
+            }
+        }
+        power >>= 1;
+        if(power) {
+            uint8x16_t product = gf128_mul_kernel(square, square);
+            square = vreinterpretq_p64_u8(vextq_u8(product, product, 8));
+        }
+    }
+    return result;
+}
+
+// current_tag = current_tag * H^blocks, i.e. the hash so far moved past blocks more blocks of zeros
+static void ghash_skip_kernel(cipher_state_t * restrict cs, uint64_t blocks)
+{
+    if(blocks == 0) {
+        return;
+    }
+    uint8x16_t acc = vld1q_u8(cs->current_tag.b);
+    acc = vextq_u8(acc, acc, 8);
+    vst1q_u8(cs->current_tag.b, gf128_mul_kernel(vreinterpretq_p64_u8(acc), hash_key_power_kernel(cs->constants, blocks)));
+}
+
+// CTR mode over one byte range of the message - the same for encryption and decryption
+static operation_result_t aes_gcm_ctr_range(
+    const cipher_state_t * cs,
+    uint64_t range_offset,
+    uint8_t * input, uint64_t input_length,
+    uint8_t * output)
+{
+    operation_result_t (*ctr_kernel)(uint64_t, cipher_state_t * restrict, uint8_t * restrict);
+    switch(cs->constants->mode) {
+        case AES_GCM_128:
+            ctr_kernel = aes_ctr_blk_128_kernel;
+            break;
+        case AES_GCM_192:
+            ctr_kernel = aes_ctr_blk_192_kernel;
+            break;
+        case AES_GCM_256:
+            ctr_kernel = aes_ctr_blk_256_kernel;
+            break;
+        default:
+            return INVALID_PARAMETER;
+    }
+    uint64_t offset_bytes = range_offset >> 3;
+    uint64_t remaining = input_length >> 3;
+    if((range_offset & 7) || (input_length & 7) ||
+       offset_bytes > GCM_MAX_BYTE_LENGTH || remaining > GCM_MAX_BYTE_LENGTH - offset_bytes) {
+        return INVALID_PARAMETER;
+    }
+
+    // counter for the block holding the first byte of the range - inc32 only touches the last word
+    cipher_state_t range_cs = { .counter = cs->counter, .constants = cs->constants };
+    uint32_t counter_word;
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        counter_word = cs->counter.s[3] + 1 + (uint32_t) (offset_bytes >> 4);
+        range_cs.counter.s[3] = counter_word;
+    #else
+        counter_word = __builtin_bswap32(cs->counter.s[3]) + 1 + (uint32_t) (offset_bytes >> 4);
+        range_cs.counter.s[3] = __builtin_bswap32(counter_word);
+    #endif
+
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+    uint8_t keystream[RANGE_CHUNK_BLOCKS * 16];
+    uint64_t skip = offset_bytes & 15;
+    uint8_t * in_ptr = input;
+    uint8_t * out_ptr = output;
+    while(remaining) {
+        uint64_t blocks = (skip + remaining + 15) >> 4;
+        if(blocks > RANGE_CHUNK_BLOCKS) blocks = RANGE_CHUNK_BLOCKS;
+        result_status |= ctr_kernel(blocks, &range_cs, keystream);
+
+        uint64_t bytes = blocks * 16 - skip;
+        if(bytes > remaining) bytes = remaining;
+        uint64_t i = 0;
+        for( ; i+16<=bytes; i+=16 )
+        {
+            vst1q_u8(out_ptr + i, veorq_u8(vld1q_u8(in_ptr + i), vld1q_u8(keystream + skip + i)));
+        }
+        for( ; i<bytes; ++i )
+        {
+            out_ptr[i] = in_ptr[i] ^ keystream[skip + i];
+        }
+        in_ptr += bytes;
+        out_ptr += bytes;
+        remaining -= bytes;
+        skip = 0;
+    }
+    return result_status;
+}
+
+operation_result_t encrypt_range(
+    const cipher_state_t * cs,
+    uint64_t range_offset,
+    uint8_t * plaintext, uint64_t plaintext_length,
+    uint8_t * ciphertext)
+{
+    TRACE_ENTRY(gcm_enc_range, cs->constants->mode, plaintext_length, range_offset);
+    return API_RETURN(gcm_enc_range, ARMV8_STATS_GCM_ENC, plaintext_length >> 3, 1,
+                      aes_gcm_ctr_range(cs, range_offset, plaintext, plaintext_length, ciphertext));
+}
+
+operation_result_t decrypt_range(
+    const cipher_state_t * cs,
+    uint64_t range_offset,
+    uint8_t * ciphertext, uint64_t ciphertext_length,
+    uint8_t * plaintext)
+{
+    TRACE_ENTRY(gcm_dec_range, cs->constants->mode, ciphertext_length, range_offset);
+    return API_RETURN(gcm_dec_range, ARMV8_STATS_GCM_DEC, ciphertext_length >> 3, 1,
+                      aes_gcm_ctr_range(cs, range_offset, ciphertext, ciphertext_length, plaintext));
+}
+
+operation_result_t ghash_segment(
+    cipher_constants_t * cc,
+    uint8_t * ciphertext, uint64_t ciphertext_length,
+    aes_gcm_segment_t * segment)
+{
+    TRACE_ENTRY(gcm_ghash_segment, cc->mode, ciphertext_length);
+    if((ciphertext_length & 7) || (ciphertext_length >> 3) > GCM_MAX_BYTE_LENGTH) {
+        return TRACE_EXIT(gcm_ghash_segment, INVALID_PARAMETER);
+    }
+    cipher_state_t cs = { .current_tag = { .d = {0,0} }, .constants = cc };
+    operation_result_t result_status = ghash_exact_kernel(ciphertext, ciphertext_length, &cs);
+    segment->hash = cs.current_tag;
+    segment->bit_length = ciphertext_length;
+    return TRACE_EXIT(gcm_ghash_segment, result_status);
+}
+
+// The whole message tag (all 16B) from the aad and the segment hashes
+static operation_result_t aes_gcm_segments_tag(
+    const cipher_state_t * cs,
+    uint8_t * aad, uint64_t aad_length,
+    const aes_gcm_segment_t * segments, uint32_t segment_count,
+    uint8_t * full_tag)
+{
+    // every segment but the last must be whole blocks, or the blocks of the segments after it would be misaligned
+    uint64_t ciphertext_length = 0;
+    for( uint32_t i=0; i<segment_count; ++i )
+    {
+        if((i+1 < segment_count && (segments[i].bit_length & 127)) ||
+           segments[i].bit_length > (GCM_MAX_BYTE_LENGTH << 3) - ciphertext_length) {
+            return INVALID_PARAMETER;
+        }
+        ciphertext_length += segments[i].bit_length;
+    }
+
+    cipher_state_t verify_cs = { .counter = cs->counter, .current_tag = { .d = {0,0} }, .constants = cs->constants };
+    quadword_t final_aes_ctr_block = { .d = {0,0} };
+    quadword_t final_block; // [len(A)]_64 | [len(C)]_64
+                            // MSB --> LSB | MSB --> LSB
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        final_block.d[0] = ciphertext_length;
+        final_block.d[1] = aad_length;
+    #else
+        final_block.d[0] = __builtin_bswap64(aad_length);
+        final_block.d[1] = __builtin_bswap64(ciphertext_length);
+    #endif
+
+    operation_result_t result_status = ghash_exact_kernel(aad, aad_length, &verify_cs);
+    // the hash of the message so far is carried past each segment, then the segment's own hash added in
+    for( uint32_t i=0; i<segment_count; ++i )
+    {
+        ghash_skip_kernel(&verify_cs, (segments[i].bit_length + 127) >> 7);
+        verify_cs.current_tag.d[0] ^= segments[i].hash.d[0];
+        verify_cs.current_tag.d[1] ^= segments[i].hash.d[1];
+    }
+    result_status |= ghash_kernel(final_block.b, 128, &verify_cs); //update current_tag value with final_block
+
+    switch(cs->constants->mode)
+    {
+        case AES_GCM_128:
+            result_status |= aes_ctr_blk_128_kernel(1, &verify_cs, final_aes_ctr_block.b);
+            break;
+        case AES_GCM_192:
+            result_status |= aes_ctr_blk_192_kernel(1, &verify_cs, final_aes_ctr_block.b);
+            break;
+        case AES_GCM_256:
+            result_status |= aes_ctr_blk_256_kernel(1, &verify_cs, final_aes_ctr_block.b);
+            break;
+	default :
+	    return INVALID_PARAMETER;
+    }
+    result_status |= aes_gcm_finalize(&verify_cs, final_aes_ctr_block, full_tag); //finalize current_tag
+    return result_status;
+}
+
+operation_result_t tag_segments(
+    const cipher_state_t * cs,
+    uint8_t * aad, uint64_t aad_length,
+    const aes_gcm_segment_t * segments, uint32_t segment_count,
+    uint8_t * tag)
+{
+    TRACE_ENTRY(gcm_tag_segments, cs->constants->mode, segment_count, aad_length);
+    //Check for invalid tag sizes
+    if ((cs->constants->tag_byte_length < 12 || cs->constants->tag_byte_length > 16) &&
+	(cs->constants->tag_byte_length != 4 && cs->constants->tag_byte_length != 8))
+    {
+	return TRACE_EXIT(gcm_tag_segments, INVALID_PARAMETER);
+    }
+    quadword_t full_tag;
+    operation_result_t result_status = aes_gcm_segments_tag(cs, aad, aad_length, segments, segment_count, full_tag.b);
+    if( result_status != SUCCESSFUL_OPERATION ) return TRACE_EXIT(gcm_tag_segments, result_status);
+
+    memcpy(tag, full_tag.b, cs->constants->tag_byte_length);
+    return TRACE_EXIT(gcm_tag_segments, SUCCESSFUL_OPERATION);
+}
+
+operation_result_t verify_segments(
+    const cipher_state_t * cs,
+    uint8_t * aad, uint64_t aad_length,
+    const aes_gcm_segment_t * segments, uint32_t segment_count,
+    uint8_t * tag)
+{
+    TRACE_ENTRY(gcm_verify_segments, cs->constants->mode, segment_count, aad_length);
+    //Check for invalid tag sizes
+    if ((cs->constants->tag_byte_length < 12 || cs->constants->tag_byte_length > 16) &&
+	(cs->constants->tag_byte_length != 4 && cs->constants->tag_byte_length != 8))
+    {
+	return TRACE_EXIT(gcm_verify_segments, INVALID_PARAMETER);
+    }
+    quadword_t full_tag;
+    operation_result_t result_status = aes_gcm_segments_tag(cs, aad, aad_length, segments, segment_count, full_tag.b);
+    if( result_status != SUCCESSFUL_OPERATION ) return TRACE_EXIT(gcm_verify_segments, result_status);
+
+    return TRACE_EXIT(gcm_verify_segments, aes_gcm_compare_tag(tag, full_tag.b, cs->constants->tag_byte_length));
+}
+
+#undef GCM_MAX_BYTE_LENGTH
+#undef RANGE_CHUNK_BLOCKS
+
+#ifdef ARMV8_JOB_GCM_LANES_ENABLED
+// Multi-buffer AES-GCM for the job manager - one message has a single GHASH dependency chain, and a short one has too
+// few blocks to keep the AES and PMULL pipelines busy, so up to ARMV8_JOB_GCM_LANES jobs of the same key size run in
+// lock step, each lane with its own keys, counter and hash. Each lane hashes GCM_LANE_HASH_BLOCKS blocks at a time
+// with H^n..H^1 and reduces once, as ghash_kernel does
+// Lanes drop out as their jobs run out of blocks and the rest carry on with one lane fewer. The partial last block of
+// each job goes through the single message kernel, so the outputs are exactly those of armv8_*_aes_gcm_from_state
+#if MAX_UNROLL_FACTOR >= 4
+#define GCM_LANE_HASH_BLOCKS    4
+#else
+#define GCM_LANE_HASH_BLOCKS    1
+#endif
+
+typedef struct gcm_lane {
+    armv8_job_t * job;
+    cipher_state_t cs;
+    quadword_t final_aes_ctr_block;
+    quadword_t aad_tail;                // partial last block of the AAD, zero padded
+    const uint8_t * aad;
+    uint64_t aad_whole_blocks;
+    uint64_t aad_blocks;                // whole blocks, and aad_tail if there is one
+    uint64_t aad_done;
+    uint8_t * in;
+    uint8_t * out;
+    uint64_t blocks;                    // whole message blocks left
+    bool decrypt;
+} gcm_lane_t;
+
+static inline void gcm_lane_hash_keys(const gcm_lane_t * lane, poly64x2_t * hash_key)
+{
+    for( uint32_t k=0; k<GCM_LANE_HASH_BLOCKS; ++k )
+    {
+        hash_key[k] = (poly64x2_t) vld1q_u64(lane->cs.constants->expanded_hash_keys[k].d);
+    }
+}
+
+// Hash count (1 to GCM_LANE_HASH_BLOCKS) blocks into acc with one reduction - block k is multiplied by H^(count-k)
+static inline __attribute__((always_inline)) uint8x16_t gcm_lane_ghash_kernel(uint8x16_t acc, const uint8x16_t * block, uint32_t count, const poly64x2_t * hash_key)
+{
+    poly64_t modulo_const = (poly64_t) 0xC200000000000000ul;
+    poly64x2_t high_acc = vdupq_n_u64(0);
+    poly64x2_t mid_acc  = vdupq_n_u64(0);
+    poly64x2_t low_acc  = vdupq_n_u64(0);
+    for( uint32_t k=0; k<count; ++k )
+    {
+        poly64x2_t a = vreinterpretq_p64_u8(vrev64q_u8(block[k]));
+        if(k == 0) {
+            a = veorq_u64(a, vextq_u8(acc, acc, 8));
+        }
+        poly64x2_t b = hash_key[count - 1 - k];
+        poly64_t a_karat = (poly64_t) veor_u64(vget_high_u64(a), vget_low_u64(a));
+        poly64_t b_karat = (poly64_t) veor_u64(vget_high_u64(b), vget_low_u64(b));
+
+        //multiply
+        high_acc = veorq_u64(high_acc, vreinterpretq_u64_p128(vmull_high_p64(a, b)));
+        low_acc  = veorq_u64(low_acc , vreinterpretq_u64_p128(vmull_p64((poly64_t) vget_low_p64(a), (poly64_t) vget_low_p64(b))));
+        mid_acc  = veorq_u64(mid_acc , vreinterpretq_u64_p128(vmull_p64(a_karat, b_karat)));
+    }
+
+    //tidy up karatsuba
+    mid_acc = veorq_u64(mid_acc, high_acc);
+    mid_acc = veorq_u64(mid_acc, low_acc);
+
+    //modulo reduction
+    poly128_t tmp_mid_0 = vmull_p64((poly64_t) vget_low_p64(high_acc), modulo_const);
+    uint8x16_t high_swap = vextq_u8(high_acc, high_acc, 8);
+    mid_acc = veorq_u64(mid_acc, vreinterpretq_u64_p128(tmp_mid_0));
+    mid_acc = veorq_u64(mid_acc, high_swap);
+
+    poly128_t tmp_low_0 = vmull_p64((poly64_t) vget_low_p64(mid_acc), modulo_const);
+    mid_acc = vextq_u8(mid_acc, mid_acc, 8);
+    uint8x16_t result = veorq_u64(low_acc, vreinterpretq_u64_p128(tmp_low_0));
+    return veorq_u64(result, mid_acc);
+}
+
+// Hash the next blocks AAD blocks of each lane
+static inline __attribute__((always_inline)) void gcm_lanes_aad_kernel(gcm_lane_t ** lane, const uint32_t lanes, uint64_t blocks)
+{
+    uint8x16_t acc[ARMV8_JOB_GCM_LANES];
+    poly64x2_t hash_key[ARMV8_JOB_GCM_LANES][GCM_LANE_HASH_BLOCKS];
+    for( uint32_t l=0; l<lanes; ++l )
+    {
+        acc[l] = vld1q_u8(lane[l]->cs.current_tag.b);
+        gcm_lane_hash_keys(lane[l], hash_key[l]);
+    }
+    for( uint64_t i=0; i<blocks; i+=GCM_LANE_HASH_BLOCKS )
+    {
+        uint32_t count = blocks - i < GCM_LANE_HASH_BLOCKS ? (uint32_t) (blocks - i) : GCM_LANE_HASH_BLOCKS;
+        for( uint32_t l=0; l<lanes; ++l )
+        {
+            uint8x16_t block[GCM_LANE_HASH_BLOCKS];
+            for( uint32_t k=0; k<count; ++k )
+            {
+                uint64_t b = lane[l]->aad_done + i + k;
+                block[k] = vld1q_u8(b < lane[l]->aad_whole_blocks ? lane[l]->aad + b * 16 : lane[l]->aad_tail.b);
+            }
+            acc[l] = gcm_lane_ghash_kernel(acc[l], block, count, hash_key[l]);
+        }
+    }
+    for( uint32_t l=0; l<lanes; ++l )
+    {
+        vst1q_u8(lane[l]->cs.current_tag.b, acc[l]);
+        lane[l]->aad_done += blocks;
+    }
+}
+
+// Encrypt or decrypt the next blocks whole message blocks of each lane, hashing the ciphertext
+static inline __attribute__((always_inline)) void gcm_lanes_crypt_kernel(gcm_lane_t ** lane, const uint32_t lanes, const uint32_t rounds, uint64_t blocks)
+{
+    uint8x16_t counter[ARMV8_JOB_GCM_LANES];
+    uint32_t counter_word[ARMV8_JOB_GCM_LANES];
+    uint8x16_t acc[ARMV8_JOB_GCM_LANES];
+    poly64x2_t hash_key[ARMV8_JOB_GCM_LANES][GCM_LANE_HASH_BLOCKS];
+    const uint8_t * keys[ARMV8_JOB_GCM_LANES];
+    for( uint32_t l=0; l<lanes; ++l )
+    {
+        counter[l] = vld1q_u8(lane[l]->cs.counter.b);
+        #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            counter_word[l] = lane[l]->cs.counter.s[3];
+        #else
+            counter_word[l] = __builtin_bswap32(lane[l]->cs.counter.s[3]);
+        #endif
+        acc[l] = vld1q_u8(lane[l]->cs.current_tag.b);
+        gcm_lane_hash_keys(lane[l], hash_key[l]);
+        keys[l] = lane[l]->cs.constants->expanded_aes_keys[0].b;
+    }
+    for( uint64_t i=0; i<blocks; i+=GCM_LANE_HASH_BLOCKS )
+    {
+        uint32_t count = blocks - i < GCM_LANE_HASH_BLOCKS ? (uint32_t) (blocks - i) : GCM_LANE_HASH_BLOCKS;
+        uint8x16_t hash_block[ARMV8_JOB_GCM_LANES][GCM_LANE_HASH_BLOCKS];
+        for( uint32_t k=0; k<count; ++k )
+        {
+            uint8x16_t block[ARMV8_JOB_GCM_LANES];
+            for( uint32_t l=0; l<lanes; ++l )
+            {
+                block[l] = vsetq_lane_u32(__builtin_bswap32(counter_word[l]), counter[l], 3);
+                counter_word[l]++;
+            }
+            for( uint32_t r=0; r<rounds-1; ++r )
+            {
+                for( uint32_t l=0; l<lanes; ++l )
+                {
+                    block[l] = vaeseq_u8(block[l], vld1q_u8(keys[l] + r * 16));
+                    block[l] = vaesmcq_u8(block[l]);
+                }
+            }
+            for( uint32_t l=0; l<lanes; ++l )
+            {
+                block[l] = vaeseq_u8(block[l], vld1q_u8(keys[l] + (rounds - 1) * 16));
+                block[l] = veorq_u8(block[l], vld1q_u8(keys[l] + rounds * 16));
+
+                uint8x16_t in_block = vld1q_u8(lane[l]->in + (i + k) * 16);
+                uint8x16_t out_block = veorq_u8(block[l], in_block);
+                vst1q_u8(lane[l]->out + (i + k) * 16, out_block);
+                hash_block[l][k] = lane[l]->decrypt ? in_block : out_block;
+            }
+        }
+        for( uint32_t l=0; l<lanes; ++l )
+        {
+            acc[l] = gcm_lane_ghash_kernel(acc[l], hash_block[l], count, hash_key[l]);
+        }
+    }
+    for( uint32_t l=0; l<lanes; ++l )
+    {
+        #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            lane[l]->cs.counter.s[3] = counter_word[l];
+        #else
+            lane[l]->cs.counter.s[3] = __builtin_bswap32(counter_word[l]);
+        #endif
+        vst1q_u8(lane[l]->cs.current_tag.b, acc[l]);
+        lane[l]->in += blocks * 16;
+        lane[l]->out += blocks * 16;
+        lane[l]->blocks -= blocks;
+    }
+}
+
+// One copy of the lock step loops for each number of lanes, so that the loops over the lanes unroll
+static void gcm_lanes_aad(gcm_lane_t ** lane, uint32_t lanes, uint64_t blocks)
+{
+    switch(lanes) {
+        case 4:  gcm_lanes_aad_kernel(lane, 4, blocks); break;
+        case 3:  gcm_lanes_aad_kernel(lane, 3, blocks); break;
+        case 2:  gcm_lanes_aad_kernel(lane, 2, blocks); break;
+        default: gcm_lanes_aad_kernel(lane, 1, blocks); break;
+    }
+}
+
+#define gcm_lanes_crypt_rounds(bits, rounds) \
+static void gcm_lanes_crypt_##bits(gcm_lane_t ** lane, uint32_t lanes, uint64_t blocks) \
+{ \
+    switch(lanes) { \
+        case 4:  gcm_lanes_crypt_kernel(lane, 4, rounds, blocks); break; \
+        case 3:  gcm_lanes_crypt_kernel(lane, 3, rounds, blocks); break; \
+        case 2:  gcm_lanes_crypt_kernel(lane, 2, rounds, blocks); break; \
+        default: gcm_lanes_crypt_kernel(lane, 1, rounds, blocks); break; \
+    } \
+}
+
+gcm_lanes_crypt_rounds(128, 10)
+gcm_lanes_crypt_rounds(192, 12)
+gcm_lanes_crypt_rounds(256, 14)
+
+#undef gcm_lanes_crypt_rounds
+
+static inline uint64_t gcm_lane_blocks_left(const gcm_lane_t * lane, bool aad)
+{
+    return aad ? lane->aad_blocks - lane->aad_done : lane->blocks;
+}
+
+// Run the AAD or message blocks of the lanes in lock step, as many blocks at a time as the shortest lane has left,
+// dropping lanes once they have none left
+static void gcm_lanes_phase(gcm_lane_t * lanes, uint32_t count, bool aad,
+                            void (*crypt)(gcm_lane_t **, uint32_t, uint64_t))
+{
+    gcm_lane_t * active[ARMV8_JOB_GCM_LANES];
+    uint32_t n = 0;
+    for( uint32_t l=0; l<count; ++l )
+    {
+        if(gcm_lane_blocks_left(&lanes[l], aad)) active[n++] = &lanes[l];
+    }
+    while(n > 0) {
+        uint64_t blocks = gcm_lane_blocks_left(active[0], aad);
+        for( uint32_t l=1; l<n; ++l )
+        {
+            uint64_t left = gcm_lane_blocks_left(active[l], aad);
+            blocks = left < blocks ? left : blocks;
+        }
+        if(aad) {
+            gcm_lanes_aad(active, n, blocks);
+        } else {
+            crypt(active, n, blocks);
+        }
+        for( uint32_t l=0; l<n; )
+        {
+            if(gcm_lane_blocks_left(active[l], aad) == 0) {
+                active[l] = active[--n];
+            } else {
+                ++l;
+            }
+        }
+    }
+}
+
+void armv8_job_run_gcm_lanes(armv8_job_t * const * jobs, uint32_t count)
+{
+    gcm_lane_t lanes[ARMV8_JOB_GCM_LANES];
+    const cipher_mode_t mode = jobs[0]->gcm.cc->mode;
+    const uint32_t rounds = mode == AES_GCM_128 ? 10 : (mode == AES_GCM_192 ? 12 : 14);
+    uint32_t n = 0;
+
+    for( uint32_t j=0; j<count; ++j )
+    {
+        armv8_job_t * job = jobs[j];
+        gcm_lane_t * lane = &lanes[n];
+        uint8_t tag_byte_length = job->gcm.cc->tag_byte_length;
+        if(job->type == ARMV8_JOB_AES_GCM_DEC) {
+            TRACE_ENTRY(gcm_dec, mode, job->gcm.bit_length, job->gcm.aad_bit_length);
+            if((tag_byte_length < 12 || tag_byte_length > 16) && (tag_byte_length != 4 && tag_byte_length != 8)) {
+                job->result = API_RETURN(gcm_dec, ARMV8_STATS_GCM_DEC, job->gcm.bit_length >> 3, STATS_GENERIC_GCM, INVALID_PARAMETER);
+                continue;
+            }
+        } else {
+            TRACE_ENTRY(gcm_enc, mode, job->gcm.bit_length, job->gcm.aad_bit_length);
+        }
+        lane->job = job;
+        lane->decrypt = job->type == ARMV8_JOB_AES_GCM_DEC;
+        lane->cs = (cipher_state_t) { .constants = job->gcm.cc };
+        armv8_aes_gcm_set_counter(job->gcm.nonce, 96, &lane->cs);
+
+        uint64_t aad_byte_length = job->gcm.aad_bit_length >> 3;
+        lane->aad = job->gcm.aad;
+        lane->aad_whole_blocks = aad_byte_length / 16;
+        lane->aad_blocks = (aad_byte_length + 15) / 16;
+        lane->aad_done = 0;
+        lane->aad_tail = (quadword_t) { .d = {0,0} };
+        memcpy(lane->aad_tail.b, job->gcm.aad + lane->aad_whole_blocks * 16, aad_byte_length & 15);
+
+        lane->in = job->gcm.input;
+        lane->out = job->gcm.output;
+        lane->blocks = job->gcm.bit_length >> 7;
+        n++;
+    }
+
+    // E(K, J0) for the tag, after which each counter starts at J0 + 1 - as aes_ctr_blk_*_kernel(1, ...)
+    for( uint32_t l=0; l<n; ++l )
+    {
+        vst1q_u8(lanes[l].final_aes_ctr_block.b, aes_block_kernel(lanes[l].cs.constants, rounds, vld1q_u8(lanes[l].cs.counter.b)));
+        #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            lanes[l].cs.counter.s[3]++;
+        #else
+            lanes[l].cs.counter.s[3] = __builtin_bswap32(__builtin_bswap32(lanes[l].cs.counter.s[3]) + 1);
+        #endif
+    }
+
+    gcm_lanes_phase(lanes, n, true, NULL);
+    gcm_lanes_phase(lanes, n, false, mode == AES_GCM_128 ? gcm_lanes_crypt_128 :
+                                     (mode == AES_GCM_192 ? gcm_lanes_crypt_192 : gcm_lanes_crypt_256));
+
+    for( uint32_t l=0; l<n; ++l )
+    {
+        gcm_lane_t * lane = &lanes[l];
+        armv8_job_t * job = lane->job;
+        uint64_t tail_length = job->gcm.bit_length & 127ul;
+        operation_result_t result_status = SUCCESSFUL_OPERATION;
+        quadword_t final_block; // [len(A)]_64 | [len(C)]_64
+                                // MSB --> LSB | MSB --> LSB
+
+        #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            final_block.d[0] = job->gcm.bit_length;
+            final_block.d[1] = job->gcm.aad_bit_length;
+        #else
+            final_block.d[0] = __builtin_bswap64(job->gcm.aad_bit_length);
+            final_block.d[1] = __builtin_bswap64(job->gcm.bit_length);
+        #endif
+
+        if(tail_length) {
+            switch(mode) {
+                case AES_GCM_128:
+                    result_status |= lane->decrypt ? aes_gcm_dec_128_kernel(lane->in, tail_length, &lane->cs, lane->out)
+                                                   : aes_gcm_enc_128_kernel(lane->in, tail_length, &lane->cs, lane->out);
+                    break;
+                case AES_GCM_192:
+                    result_status |= lane->decrypt ? aes_gcm_dec_192_kernel(lane->in, tail_length, &lane->cs, lane->out)
+                                                   : aes_gcm_enc_192_kernel(lane->in, tail_length, &lane->cs, lane->out);
+                    break;
+                default:
+                    result_status |= lane->decrypt ? aes_gcm_dec_256_kernel(lane->in, tail_length, &lane->cs, lane->out)
+                                                   : aes_gcm_enc_256_kernel(lane->in, tail_length, &lane->cs, lane->out);
+                    break;
+            }
+        }
+        result_status |= ghash_kernel(final_block.b, 128, &lane->cs);
+        if(lane->decrypt) {
+            result_status |= aes_gcm_finalize(&lane->cs, lane->final_aes_ctr_block, lane->cs.current_tag.b);
+            if(result_status == SUCCESSFUL_OPERATION) {
+                result_status = aes_gcm_compare_tag(job->gcm.tag, lane->cs.current_tag.b, job->gcm.cc->tag_byte_length);
+            }
+            job->result = API_RETURN(gcm_dec, ARMV8_STATS_GCM_DEC, job->gcm.bit_length >> 3, STATS_GENERIC_GCM, result_status);
+        } else {
+            result_status |= aes_gcm_finalize(&lane->cs, lane->final_aes_ctr_block, job->gcm.tag);
+            job->result = API_RETURN(gcm_enc, ARMV8_STATS_GCM_ENC, job->gcm.bit_length >> 3, STATS_GENERIC_GCM, result_status);
+        }
+    }
+}
+
+#undef GCM_LANE_HASH_BLOCKS
+#endif
+
+// IPsec versions enabled when targeting LITTLE or big cores
+#ifdef IPSEC_ENABLED
+// Byte offset of H^1 (followed by H^2..H^4) from the constants pointer given to the IPsec kernels
+#define IPSEC_HASH_KEYS "240"
+_Static_assert(offsetof(cipher_constants_t, expanded_hash_keys) == 240, "IPsec kernels expect H^1 at 240B");
+
+#ifdef PERF_GCM_LITTLE
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_128__interleaved.c"
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_192__interleaved.c"
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_256__interleaved.c"
+#else
+    #ifdef PERF_GCM_BIG
+        #include "AArch64cryptolib_opt_big/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_128__interleaved.c"
+        #include "AArch64cryptolib_opt_big/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_192__interleaved.c"
+        #include "AArch64cryptolib_opt_big/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_256__interleaved.c"
+    #endif
+#endif
+
+operation_result_t encrypt_from_constants_IPsec(
+    //Inputs
+    const cipher_constants_t * cc,
+    uint32_t salt,
+    uint64_t ESPIV,
+    const uint8_t * restrict aad,   uint32_t aad_byte_length,
+        //assumes aad zero padded to 16B and 0 < aad_byte_length <=16
+    uint8_t * plaintext,            uint32_t plaintext_byte_length,
+        //in place operation - plaintext becomes ciphertext
+        //assumed that ciphertext can be written in 16B blocks - will write up to 15B of 0s beyond the end of the plaintext
+    //Output
+    uint8_t * tag
+        //tag_byte_length specified in cipher_constants
+        //tag written after ciphertext, so tag will be produced correctly if directly after plaintext
+    )
+{
+    TRACE_ENTRY(ipsec_enc, cc->mode, plaintext_byte_length, aad_byte_length);
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+    switch(cc->mode)
+    {
+        case AES_GCM_128:
+            result_status |= encrypt_from_constants_IPsec_128(
+                    cc,
+                    salt,
+                    ESPIV,
+                    aad, aad_byte_length, //aad_byte_length 8 or 12
+                    plaintext, plaintext_byte_length, //Inputs
+                    tag);
+            break;
+        case AES_GCM_192:
+            result_status |= encrypt_from_constants_IPsec_192(
+                    cc,
+                    salt,
+                    ESPIV,
+                    aad, aad_byte_length, //aad_byte_length 8 or 12
+                    plaintext, plaintext_byte_length, //Inputs
+                    tag);
+            break;
+        case AES_GCM_256:
+            result_status |= encrypt_from_constants_IPsec_256(
+                    cc,
+                    salt,
+                    ESPIV,
+                    aad, aad_byte_length, //aad_byte_length 8 or 12
+                    plaintext, plaintext_byte_length, //Inputs
+                    tag);
+            break;
+    }
+    return API_RETURN(ipsec_enc, ARMV8_STATS_IPSEC_ENC, plaintext_byte_length, 0, result_status);
+}
+
+#ifdef PERF_GCM_LITTLE
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_128__interleaved.c"
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_192__interleaved.c"
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_256__interleaved.c"
+#else
+    #ifdef PERF_GCM_BIG
+        #include "AArch64cryptolib_opt_big/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_128__interleaved.c"
+        #include "AArch64cryptolib_opt_big/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_192__interleaved.c"
+        #include "AArch64cryptolib_opt_big/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_256__interleaved.c"
+    #endif
+#endif
+
+operation_result_t decrypt_from_constants_IPsec(
+    //Inputs
+    const armv8_cipher_constants_t * cc,
+    uint32_t salt,
+    uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+        //aad zero padded to 16B, aad_byte_length 8 or 12
+    uint8_t * ciphertext,   uint32_t ciphertext_byte_length,
+        //in place operation - ciphertext becomes plaintext
+        //assumed that plaintext can be written in 8B blocks - will write up to 7B of 0s beyond the end of the ciphertext
+    const uint8_t * tag,
+        //tag_byte_length specified in cipher_constants
+        //tag is read before last block of plaintext is written and written back afterwards, so tag will be preserved
+        //supported tag sizes are 8B, 12B and 16B, and precisely the size specified will be read
+    //Output
+    uint64_t * checksum
+        //one's complement sum of all 64b words in the plaintext
+    )
+{
+    TRACE_ENTRY(ipsec_dec, cc->mode, ciphertext_byte_length, aad_byte_length);
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+    switch(cc->mode)
+    {
+        case AES_GCM_128:
+            result_status |= decrypt_from_constants_IPsec_128(
+                    cc,
+                    salt,
+                    ESPIV,
+                    aad, aad_byte_length, //aad_byte_length 8 or 12
+                    ciphertext, ciphertext_byte_length, //Inputs
+                    tag,
+                    checksum);
+            break;
+        case AES_GCM_192:
+            result_status |= decrypt_from_constants_IPsec_192(
+                    cc,
+                    salt,
+                    ESPIV,
+                    aad, aad_byte_length, //aad_byte_length 8 or 12
+                    ciphertext, ciphertext_byte_length, //Inputs
+                    tag,
+                    checksum);
+            break;
+        case AES_GCM_256:
+            result_status |= decrypt_from_constants_IPsec_256(
+                    cc,
+                    salt,
+                    ESPIV,
+                    aad, aad_byte_length, //aad_byte_length 8 or 12
+                    ciphertext, ciphertext_byte_length, //Inputs
+                    tag,
+                    checksum);
+            break;
+    }
+    return API_RETURN(ipsec_dec, ARMV8_STATS_IPSEC_DEC, ciphertext_byte_length, 0, result_status);
+}
+
+// Compact constants - the same IPsec kernels again, with the constants type and the hash key offset swapped for each
+// key size, so the round keys are still at the start and only the hash keys move
+#undef cipher_constants_t
+#undef IPSEC_HASH_KEYS
+
+#define cipher_constants_t                  armv8_compact_constants_128_t
+#define IPSEC_HASH_KEYS                     "176"
+#define encrypt_from_constants_IPsec_128    encrypt_from_compact_IPsec_128_kernel
+#define decrypt_from_constants_IPsec_128    decrypt_from_compact_IPsec_128_kernel
+_Static_assert(offsetof(cipher_constants_t, expanded_hash_keys) == 176, "IPsec kernels expect H^1 at 176B");
+#ifdef PERF_GCM_LITTLE
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_128__interleaved.c"
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_128__interleaved.c"
+#else
+    #include "AArch64cryptolib_opt_big/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_128__interleaved.c"
+    #include "AArch64cryptolib_opt_big/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_128__interleaved.c"
+#endif
+#undef cipher_constants_t
+#undef IPSEC_HASH_KEYS
+#undef encrypt_from_constants_IPsec_128
+#undef decrypt_from_constants_IPsec_128
+
+#define cipher_constants_t                  armv8_compact_constants_192_t
+#define IPSEC_HASH_KEYS                     "208"
+#define encrypt_from_constants_IPsec_192    encrypt_from_compact_IPsec_192_kernel
+#define decrypt_from_constants_IPsec_192    decrypt_from_compact_IPsec_192_kernel
+_Static_assert(offsetof(cipher_constants_t, expanded_hash_keys) == 208, "IPsec kernels expect H^1 at 208B");
+#ifdef PERF_GCM_LITTLE
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_192__interleaved.c"
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_192__interleaved.c"
+#else
+    #include "AArch64cryptolib_opt_big/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_192__interleaved.c"
+    #include "AArch64cryptolib_opt_big/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_192__interleaved.c"
+#endif
+#undef cipher_constants_t
+#undef IPSEC_HASH_KEYS
+#undef encrypt_from_constants_IPsec_192
+#undef decrypt_from_constants_IPsec_192
+
+#define cipher_constants_t                  armv8_compact_constants_256_t
+#define IPSEC_HASH_KEYS                     "240"
+#define encrypt_from_constants_IPsec_256    encrypt_from_compact_IPsec_256_kernel
+#define decrypt_from_constants_IPsec_256    decrypt_from_compact_IPsec_256_kernel
+_Static_assert(offsetof(cipher_constants_t, expanded_hash_keys) == 240, "IPsec kernels expect H^1 at 240B");
+#ifdef PERF_GCM_LITTLE
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_256__interleaved.c"
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_256__interleaved.c"
+#else
+    #include "AArch64cryptolib_opt_big/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_256__interleaved.c"
+    #include "AArch64cryptolib_opt_big/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_256__interleaved.c"
+#endif
+#undef cipher_constants_t
+#undef IPSEC_HASH_KEYS
+#undef encrypt_from_constants_IPsec_256
+#undef decrypt_from_constants_IPsec_256
+
+#define cipher_constants_t              armv8_cipher_constants_t
+
+// Expand into full constants (hash keys up to H^MAX_UNROLL_FACTOR == H^4 here) and keep what the IPsec kernels use
+#define set_compact_constants_body(rounds, compact_mode) \
+    cipher_constants_t full; \
+    operation_result_t result = aes_gcm_expandkeys_##rounds##_kernel(key, &full); \
+    memcpy(cc->expanded_aes_keys, full.expanded_aes_keys, sizeof(cc->expanded_aes_keys)); \
+    memcpy(cc->expanded_hash_keys, full.expanded_hash_keys, sizeof(cc->expanded_hash_keys)); \
+    cc->mode = compact_mode; \
+    cc->tag_byte_length = tag_byte_length; \
+    /* don't leave the full key schedule and hash key powers on the stack */ \
+    memset(&full, 0, sizeof(full)); \
+    __asm__ __volatile__("" : : "r" (&full) : "memory");
+
+operation_result_t set_compact_constants_128(
+    uint8_t tag_byte_length,
+    uint8_t * restrict key,
+    armv8_compact_constants_128_t * restrict cc)
+{
+    TRACE_ENTRY(gcm_set_compact_constants, AES_GCM_128, tag_byte_length);
+    set_compact_constants_body(128, AES_GCM_128)
+    return TRACE_EXIT(gcm_set_compact_constants, result);
+}
+
+operation_result_t set_compact_constants_192(
+    uint8_t tag_byte_length,
+    uint8_t * restrict key,
+    armv8_compact_constants_192_t * restrict cc)
+{
+    TRACE_ENTRY(gcm_set_compact_constants, AES_GCM_192, tag_byte_length);
+    set_compact_constants_body(192, AES_GCM_192)
+    return TRACE_EXIT(gcm_set_compact_constants, result);
+}
+
+operation_result_t set_compact_constants_256(
+    uint8_t tag_byte_length,
+    uint8_t * restrict key,
+    armv8_compact_constants_256_t * restrict cc)
+{
+    TRACE_ENTRY(gcm_set_compact_constants, AES_GCM_256, tag_byte_length);
+    set_compact_constants_body(256, AES_GCM_256)
+    return TRACE_EXIT(gcm_set_compact_constants, result);
+}
+
+#undef set_compact_constants_body
+
+operation_result_t encrypt_from_compact_IPsec_128(
+    const armv8_compact_constants_128_t * cc,
+    uint32_t salt, uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+    uint8_t * plaintext,            uint32_t plaintext_byte_length,
+    uint8_t * tag)
+{
+    TRACE_ENTRY(ipsec_enc_compact, AES_GCM_128, plaintext_byte_length, aad_byte_length);
+    return API_RETURN(ipsec_enc_compact, ARMV8_STATS_IPSEC_ENC, plaintext_byte_length, 0,
+        encrypt_from_compact_IPsec_128_kernel(cc, salt, ESPIV, aad, aad_byte_length, plaintext, plaintext_byte_length, tag));
+}
+
+operation_result_t encrypt_from_compact_IPsec_192(
+    const armv8_compact_constants_192_t * cc,
+    uint32_t salt, uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+    uint8_t * plaintext,            uint32_t plaintext_byte_length,
+    uint8_t * tag)
+{
+    TRACE_ENTRY(ipsec_enc_compact, AES_GCM_192, plaintext_byte_length, aad_byte_length);
+    return API_RETURN(ipsec_enc_compact, ARMV8_STATS_IPSEC_ENC, plaintext_byte_length, 0,
+        encrypt_from_compact_IPsec_192_kernel(cc, salt, ESPIV, aad, aad_byte_length, plaintext, plaintext_byte_length, tag));
+}
+
+operation_result_t encrypt_from_compact_IPsec_256(
+    const armv8_compact_constants_256_t * cc,
+    uint32_t salt, uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+    uint8_t * plaintext,            uint32_t plaintext_byte_length,
+    uint8_t * tag)
+{
+    TRACE_ENTRY(ipsec_enc_compact, AES_GCM_256, plaintext_byte_length, aad_byte_length);
+    return API_RETURN(ipsec_enc_compact, ARMV8_STATS_IPSEC_ENC, plaintext_byte_length, 0,
+        encrypt_from_compact_IPsec_256_kernel(cc, salt, ESPIV, aad, aad_byte_length, plaintext, plaintext_byte_length, tag));
+}
+
+operation_result_t decrypt_from_compact_IPsec_128(
+    const armv8_compact_constants_128_t * cc,
+    uint32_t salt, uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+    uint8_t * ciphertext,   uint32_t ciphertext_byte_length,
+    const uint8_t * tag,
+    uint64_t * checksum)
+{
+    TRACE_ENTRY(ipsec_dec_compact, AES_GCM_128, ciphertext_byte_length, aad_byte_length);
+    return API_RETURN(ipsec_dec_compact, ARMV8_STATS_IPSEC_DEC, ciphertext_byte_length, 0,
+        decrypt_from_compact_IPsec_128_kernel(cc, salt, ESPIV, aad, aad_byte_length, ciphertext, ciphertext_byte_length, tag, checksum));
+}
+
+operation_result_t decrypt_from_compact_IPsec_192(
+    const armv8_compact_constants_192_t * cc,
+    uint32_t salt, uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+    uint8_t * ciphertext,   uint32_t ciphertext_byte_length,
+    const uint8_t * tag,
+    uint64_t * checksum)
+{
+    TRACE_ENTRY(ipsec_dec_compact, AES_GCM_192, ciphertext_byte_length, aad_byte_length);
+    return API_RETURN(ipsec_dec_compact, ARMV8_STATS_IPSEC_DEC, ciphertext_byte_length, 0,
+        decrypt_from_compact_IPsec_192_kernel(cc, salt, ESPIV, aad, aad_byte_length, ciphertext, ciphertext_byte_length, tag, checksum));
+}
+
+operation_result_t decrypt_from_compact_IPsec_256(
+    const armv8_compact_constants_256_t * cc,
+    uint32_t salt, uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+    uint8_t * ciphertext,   uint32_t ciphertext_byte_length,
+    const uint8_t * tag,
+    uint64_t * checksum)
+{
+    TRACE_ENTRY(ipsec_dec_compact, AES_GCM_256, ciphertext_byte_length, aad_byte_length);
+    return API_RETURN(ipsec_dec_compact, ARMV8_STATS_IPSEC_DEC, ciphertext_byte_length, 0,
+        decrypt_from_compact_IPsec_256_kernel(cc, salt, ESPIV, aad, aad_byte_length, ciphertext, ciphertext_byte_length, tag, checksum));
+}
+#endif
+
+// AES-GMAC for ESP (RFC 4543) - authentication only, so no AES-CTR over the payload and
+// the only AES work is the single block that "encrypts" the tag
+// The authenticated data is aad | ESPIV | payload, and the GHASH over the payload is merged with the checksum
+static operation_result_t gmac_IPsec_kernel(
+    const cipher_constants_t * cc,
+    uint32_t salt,
+    uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+    const uint8_t * payload,      uint32_t payload_byte_length,
+    uint8_t * restrict computed_tag,
+    uint64_t * checksum)
+{
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+    cipher_state_t cs = { .current_tag = { .d = {0,0} }, .constants = (cipher_constants_t *) cc };
+    quadword_t final_aes_ctr_block = { .d = {0,0} };
+    quadword_t final_block; // [len(A)]_64 | [len(C)]_64 with len(C) == 0
+    uint64_t payload_sum = 0;
+
+    if(aad_byte_length != 8 && aad_byte_length != 12) {
+        return INVALID_PARAMETER;
     }
-    if (len >= sizeof(uint32_t))
+
+    // aad and ESPIV are always fully contained in the leading blocks
+    // with an extended sequence number, the first 12B of the payload are pulled forward to fill out the second block
+    uint8_t leading_blocks[32] = { 0 };
+    uint32_t leading_payload_bytes = (aad_byte_length == 12) ? 12 : 0;
+    if(leading_payload_bytes > payload_byte_length) {
+        leading_payload_bytes = payload_byte_length;
+    }
+    memcpy(leading_blocks, aad, aad_byte_length);
+    memcpy(leading_blocks+aad_byte_length, &ESPIV, 8);
+    memcpy(leading_blocks+aad_byte_length+8, payload, leading_payload_bytes);
+
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        final_block.d[0] = 0;
+        final_block.d[1] = ((uint64_t) aad_byte_length + 8 + payload_byte_length) << 3;
+    #else
+        final_block.d[0] = __builtin_bswap64(((uint64_t) aad_byte_length + 8 + payload_byte_length) << 3);
+        final_block.d[1] = 0;
+    #endif
+
+    cs.counter.s[0] = salt;
+    cs.counter.s[1] = (uint32_t) ESPIV;
+    cs.counter.s[2] = (uint32_t) (ESPIV >> 32);
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        cs.counter.s[3] = 1;
+    #else
+        cs.counter.s[3] = __builtin_bswap32(1u);
+    #endif
+
+    result_status |= ghash_kernel(leading_blocks, ((uint64_t) aad_byte_length + 8 + leading_payload_bytes) << 3, &cs);
+    result_status |= ghash_checksum_kernel(payload + leading_payload_bytes,
+                                           ((uint64_t) payload_byte_length - leading_payload_bytes) << 3, &cs, &payload_sum);
+    if(leading_payload_bytes) {
+        // The checksum above is over 64b words starting 12B (== 4B mod 8B) into the payload
+        // Rotating by 32b is multiplication by 2^32 in one's complement arithmetic, so after adding in the word
+        // starting 4B into the payload, a rotate realigns everything and we only need to add in the first 4B
+        uint64_t word, head;
+        uint32_t head_word;
+        memcpy(&word, leading_blocks+aad_byte_length+12, 8);
+        memcpy(&head_word, leading_blocks+aad_byte_length+8, 4);
+        head = head_word;
+        payload_sum += word;
+        if(payload_sum < word) payload_sum++;
+        payload_sum = (payload_sum >> 32) | (payload_sum << 32);
+        payload_sum += head;
+        if(payload_sum < head) payload_sum++;
+    }
+    result_status |= ghash_kernel(final_block.b, 128, &cs);
+
+    switch(cc->mode)
     {
-	uint32_t a, b;
-	memcpy(&a, tag, sizeof(uint32_t)); tag += sizeof(uint32_t);
-	memcpy(&b, cur, sizeof(uint32_t)); cur += sizeof(uint32_t);
-	mismatch |= a ^ b;
-	len -= sizeof(uint32_t);
+        case AES_GCM_128:
+            result_status |= aes_ctr_blk_128_kernel(1, &cs, final_aes_ctr_block.b);
+            break;
+        case AES_GCM_192:
+            result_status |= aes_ctr_blk_192_kernel(1, &cs, final_aes_ctr_block.b);
+            break;
+        case AES_GCM_256:
+            result_status |= aes_ctr_blk_256_kernel(1, &cs, final_aes_ctr_block.b);
+            break;
+        default :
+            return INVALID_PARAMETER;
     }
-    if (len >= sizeof(uint16_t))
+    result_status |= aes_gcm_finalize(&cs, final_aes_ctr_block, computed_tag);
+
+    if(checksum != NULL) {
+        *checksum = payload_sum;
+    }
+    return result_status;
+}
+
+operation_result_t gmac_from_constants_IPsec(
+    //Inputs
+    const cipher_constants_t * cc,
+    uint32_t salt,
+    uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+        //aad_byte_length 8 or 12
+    const uint8_t * payload,        uint32_t payload_byte_length,
+        //assumed that payload can be read in 16B blocks - will read (but not use) up to 15B beyond the end of the payload
+    //Outputs
+    uint8_t * tag,
+        //will always write 16B of tag, regardless of the tag_byte_length specified in cc
+    uint64_t * checksum
+        //one's complement sum of all 64b words in the payload, not computed if NULL
+    )
+{
+    TRACE_ENTRY(gmac, cc->mode, payload_byte_length, aad_byte_length);
+    quadword_t computed_tag;
+    operation_result_t result_status = gmac_IPsec_kernel(cc, salt, ESPIV, aad, aad_byte_length,
+                                                         payload, payload_byte_length, computed_tag.b, checksum);
+    if( result_status != SUCCESSFUL_OPERATION ) return API_RETURN(gmac, ARMV8_STATS_GMAC, payload_byte_length, STATS_GENERIC_GCM, result_status);
+
+    memcpy(tag, computed_tag.b, 16);
+    return API_RETURN(gmac, ARMV8_STATS_GMAC, payload_byte_length, STATS_GENERIC_GCM, SUCCESSFUL_OPERATION);
+}
+
+operation_result_t gmac_verify_from_constants_IPsec(
+    //Inputs
+    const cipher_constants_t * cc,
+    uint32_t salt,
+    uint64_t ESPIV,
+    const uint8_t * restrict aad, uint32_t aad_byte_length,
+        //aad_byte_length 8 or 12
+    const uint8_t * payload,        uint32_t payload_byte_length,
+        //assumed that payload can be read in 16B blocks - will read (but not use) up to 15B beyond the end of the payload
+    const uint8_t * tag,
+        //tag_byte_length specified in cipher_constants
+    //Output
+    uint64_t * checksum
+        //one's complement sum of all 64b words in the payload, not computed if NULL
+    )
+{
+    TRACE_ENTRY(gmac_verify, cc->mode, payload_byte_length, aad_byte_length);
+    //Check for invalid tag sizes
+    if ((cc->tag_byte_length < 12 || cc->tag_byte_length > 16) &&
+        (cc->tag_byte_length != 4 && cc->tag_byte_length != 8))
+    {
+        return API_RETURN(gmac_verify, ARMV8_STATS_GMAC_VERIFY, payload_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    quadword_t computed_tag;
+    operation_result_t result_status = gmac_IPsec_kernel(cc, salt, ESPIV, aad, aad_byte_length,
+                                                         payload, payload_byte_length, computed_tag.b, checksum);
+    if( result_status != SUCCESSFUL_OPERATION ) return API_RETURN(gmac_verify, ARMV8_STATS_GMAC_VERIFY, payload_byte_length, STATS_GENERIC_GCM, result_status);
+
+    return API_RETURN(gmac_verify, ARMV8_STATS_GMAC_VERIFY, payload_byte_length, STATS_GENERIC_GCM, aes_gcm_compare_tag(tag, computed_tag.b, cc->tag_byte_length));
+}
+
+static inline uint8x16_t aes_block_kernel(const cipher_constants_t * restrict cc, uint32_t rounds, uint8x16_t block)
+{
+    for( uint32_t i=0; i<rounds-1; ++i )
+    {
+        block = vaeseq_u8(block, vld1q_u8(cc->expanded_aes_keys[i].b));
+        block = vaesmcq_u8(block);
+    }
+    block = vaeseq_u8(block, vld1q_u8(cc->expanded_aes_keys[rounds-1].b));
+    return veorq_u8(block, vld1q_u8(cc->expanded_aes_keys[rounds].b));
+}
+
+//Assume 0 < aad_byte_length <= 32, and we can read 16B (aad_byte_length <= 16) or 32B from aad
+static inline void short_aad_prologue_kernel(const cipher_constants_t * restrict cc, quadword_t counter_block, const uint8_t * restrict aad, uint32_t aad_byte_length, uint32_t rounds, cipher_state_t * restrict cs, uint8_t * restrict final_aes_ctr_block)
+{
+    const uint8_t tag_mask[32] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+                                   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+    // One or two blocks of AAD, the last of which may be partial
+    uint32_t last_block_bytes = (aad_byte_length > 16) ? aad_byte_length - 16 : aad_byte_length;
+    uint8x16_t last_mask = vld1q_u8(tag_mask+16-last_block_bytes);
+    poly64x2_t block_1 = vreinterpretq_p64_u8(vld1q_u8(aad));
+    poly64x2_t block_0 = vdupq_n_u64(0);
+    if(aad_byte_length > 16) {
+        block_0 = vreinterpretq_p64_u8(vandq_u8(vld1q_u8(aad+16), last_mask));
+    } else {
+        block_1 = vreinterpretq_p64_u8(vandq_u8(vreinterpretq_u8_p64(block_1), last_mask));
+    }
+    block_1 = vrev64q_u8(block_1);
+    block_0 = vrev64q_u8(block_0);
+
+    // Independent of the GHASH below, so the AES and PMULL pipelines can overlap
+    uint8x16_t first_block = aes_block_kernel(cc, rounds, vld1q_u8(counter_block.b));
+
+    poly64x2_t hash_key_0 = (poly64x2_t) vld1q_u64(cc->expanded_hash_keys[0].d);
+    poly64_t hash_karat_0 = (poly64_t) veor_u64(vget_high_u64(hash_key_0), vget_low_u64(hash_key_0));
+    poly64_t modulo_const = (poly64_t) 0xC200000000000000ul;
+    uint8x16_t low_acc = vdupq_n_u8(0);
+    uint32_t blocks = (aad_byte_length > 16) ? 2 : 1;
+#if MAX_UNROLL_FACTOR >= 4
+    if(blocks == 2)
+    {
+        // current_tag starts at 0, so the two blocks are multiplied by H^2 and H and reduced once
+        poly64x2_t hash_key_1 = (poly64x2_t) vld1q_u64(cc->expanded_hash_keys[1].d);
+        poly64_t hash_karat_1 = (poly64_t) veor_u64(vget_high_u64(hash_key_1), vget_low_u64(hash_key_1));
+        poly64_t block_karat_1 = (poly64_t) veor_u64(vget_high_u64(block_1),vget_low_u64(block_1));
+        poly64_t block_karat_0 = (poly64_t) veor_u64(vget_high_u64(block_0),vget_low_u64(block_0));
+
+        //multiply
+        poly128_t t_high_1 = vmull_high_p64(block_1, hash_key_1);
+        poly128_t t_low_1  = vmull_p64((poly64_t) vget_low_p64(block_1), (poly64_t) vget_low_p64(hash_key_1));
+        poly128_t t_mid_1  = vmull_p64(block_karat_1, hash_karat_1);
+        poly128_t t_high_0 = vmull_high_p64(block_0, hash_key_0);
+        poly128_t t_low_0  = vmull_p64((poly64_t) vget_low_p64(block_0), (poly64_t) vget_low_p64(hash_key_0));
+        poly128_t t_mid_0  = vmull_p64(block_karat_0, hash_karat_0);
+
+        //accumulate up temps
+        poly64x2_t high_acc = veorq_u64(vreinterpretq_u64_p128(t_high_1), vreinterpretq_u64_p128(t_high_0));
+        poly64x2_t mid_acc  = veorq_u64(vreinterpretq_u64_p128(t_mid_1) , vreinterpretq_u64_p128(t_mid_0) );
+        low_acc  = veorq_u64(vreinterpretq_u64_p128(t_low_1) , vreinterpretq_u64_p128(t_low_0) );
+        //tidy up karatsuba
+        mid_acc  = veorq_u64(mid_acc, high_acc);
+        mid_acc  = veorq_u64(mid_acc, low_acc );
+
+        //modulo reduction
+        poly128_t tmp_mid_0 = vmull_p64((poly64_t) vget_low_p64(vreinterpretq_u64_p128(high_acc)), modulo_const);
+        high_acc = vextq_u8(high_acc, high_acc, 8);
+        mid_acc = veorq_u64(mid_acc, vreinterpretq_u64_p128(tmp_mid_0));
+        mid_acc = veorq_u64(mid_acc, high_acc);
+
+        poly128_t tmp_low_0 = vmull_p64((poly64_t) vget_low_p64(mid_acc), modulo_const);
+        mid_acc = vextq_u8(mid_acc, mid_acc, 8);
+        low_acc = veorq_u64(low_acc, vreinterpretq_u64_p128(tmp_low_0));
+        low_acc = veorq_u64(low_acc, mid_acc);
+        blocks = 0;
+    }
+#endif
+    // Otherwise hash the blocks in turn with H
+    for( uint32_t i=0; i<blocks; ++i )
+    {
+        poly64x2_t block = (i == 0) ? block_1 : veorq_u64(block_0, vextq_u8(low_acc, low_acc, 8));
+        poly64_t block_karat = (poly64_t) veor_u64(vget_high_u64(block),vget_low_u64(block));
+
+        //multiply
+        poly128_t t_high = vmull_high_p64(block, hash_key_0);
+        poly128_t t_low  = vmull_p64((poly64_t) vget_low_p64(block), (poly64_t) vget_low_p64(hash_key_0));
+        poly128_t t_mid  = vmull_p64(block_karat, hash_karat_0);
+
+        //tidy up karatsuba
+        poly64x2_t mid_acc = veorq_u64(vreinterpretq_u64_p128(t_mid), vreinterpretq_u64_p128(t_high));
+        mid_acc = veorq_u64(mid_acc, vreinterpretq_u64_p128(t_low));
+
+        //modulo reduction
+        poly128_t tmp_mid_0 = vmull_p64((poly64_t) vget_low_p64(vreinterpretq_u64_p128(t_high)), modulo_const);
+        uint8x16_t high_acc = vextq_u8(vreinterpretq_u8_p128(t_high), vreinterpretq_u8_p128(t_high), 8);
+        mid_acc = veorq_u64(mid_acc, vreinterpretq_u64_p128(tmp_mid_0));
+        mid_acc = veorq_u64(mid_acc, high_acc);
+
+        poly128_t tmp_low_0 = vmull_p64((poly64_t) vget_low_p64(mid_acc), modulo_const);
+        mid_acc = vextq_u8(mid_acc, mid_acc, 8);
+        low_acc = veorq_u64(vreinterpretq_u64_p128(t_low), vreinterpretq_u64_p128(tmp_low_0));
+        low_acc = veorq_u64(low_acc, mid_acc);
+    }
+
+    vst1q_u8(final_aes_ctr_block, first_block);
+    vst1q_u8(cs->current_tag.b, low_acc);
+    // Payload starts from the second counter block
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        counter_block.s[3] = 2;
+    #else
+        counter_block.s[3] = __builtin_bswap32(2u);
+    #endif
+    cs->counter = counter_block;
+    cs->constants = (cipher_constants_t *) cc;
+}
+
+// MACsec (IEEE 802.1AE) - confidentiality offset 0, so the AAD is DA | SA | SecTAG and the rest of the frame is encrypted
+// The SecTAG carries an SCI (SC bit of the TCI set) or not, making the AAD a fixed 20B or 28B
+#define MACSEC_TCI_OFFSET   14
+#define MACSEC_TCI_SC       0x20
+#define MACSEC_TCI_E        0x08
+#define MACSEC_TCI_C        0x04
+#define MACSEC_ICV_LENGTH   16
+
+static inline uint32_t macsec_aad_byte_length(const uint8_t * frame)
+{
+    return (frame[MACSEC_TCI_OFFSET] & MACSEC_TCI_SC) ? 28 : 20;
+}
+
+operation_result_t macsec_sa_init(
+    macsec_sa_t * sa,
+    const cipher_constants_t * cc,
+    const uint8_t * sci)
+{
+    TRACE_ENTRY(macsec_sa_init, cc->mode);
+    if(cc->mode != AES_GCM_128 && cc->mode != AES_GCM_256) {
+        return TRACE_EXIT(macsec_sa_init, INVALID_PARAMETER);
+    }
+    sa->constants = cc;
+    sa->xpn = 0;
+    // IV is SCI | PN
+    memcpy(sa->iv_base.b, sci, 8);
+    sa->iv_base.s[2] = 0;
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        sa->iv_base.s[3] = 1;
+    #else
+        sa->iv_base.s[3] = __builtin_bswap32(1u);
+    #endif
+    return TRACE_EXIT(macsec_sa_init, SUCCESSFUL_OPERATION);
+}
+
+operation_result_t macsec_xpn_sa_init(
+    macsec_sa_t * sa,
+    const cipher_constants_t * cc,
+    uint32_t ssci,
+    const uint8_t * salt)
+{
+    TRACE_ENTRY(macsec_xpn_sa_init, cc->mode);
+    if(cc->mode != AES_GCM_128 && cc->mode != AES_GCM_256) {
+        return TRACE_EXIT(macsec_xpn_sa_init, INVALID_PARAMETER);
+    }
+    sa->constants = cc;
+    sa->xpn = 1;
+    // IV is (SSCI | PN) ^ Salt, the PN part is applied per frame
+    memcpy(sa->iv_base.b, salt, 12);
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        sa->iv_base.s[0] ^= ssci;
+        sa->iv_base.s[3] = 1;
+    #else
+        sa->iv_base.s[0] ^= __builtin_bswap32(ssci);
+        sa->iv_base.s[3] = __builtin_bswap32(1u);
+    #endif
+    return TRACE_EXIT(macsec_xpn_sa_init, SUCCESSFUL_OPERATION);
+}
+
+// Counter block for a frame - PN goes into the low 32b (or 64b for XPN) of the 96b IV
+static inline quadword_t macsec_counter_block(const macsec_sa_t * restrict sa, uint64_t PN)
+{
+    quadword_t counter_block = sa->iv_base;
+    uint32_t pn_high = sa->xpn ? (uint32_t) (PN >> 32) : 0;
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        counter_block.s[1] ^= pn_high;
+        counter_block.s[2] ^= (uint32_t) PN;
+    #else
+        counter_block.s[1] ^= __builtin_bswap32(pn_high);
+        counter_block.s[2] ^= __builtin_bswap32((uint32_t) PN);
+    #endif
+    return counter_block;
+}
+
+operation_result_t macsec_protect(
+    //Inputs
+    const macsec_sa_t * sa,
+    uint64_t PN,
+    uint8_t * frame,    uint32_t frame_byte_length,
+    //Output
+    uint8_t * icv)
+{
+    TRACE_ENTRY(macsec_protect, sa->constants->mode, frame_byte_length);
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+    cipher_state_t cs;
+    quadword_t final_aes_ctr_block;
+    quadword_t final_block; // [len(A)]_64 | [len(C)]_64
+    uint32_t aad_byte_length = macsec_aad_byte_length(frame);
+
+    if( frame_byte_length < aad_byte_length ||
+        (frame[MACSEC_TCI_OFFSET] & (MACSEC_TCI_E | MACSEC_TCI_C)) != (MACSEC_TCI_E | MACSEC_TCI_C) ) {
+        return API_RETURN(macsec_protect, ARMV8_STATS_MACSEC_PROTECT, frame_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    uint8_t * user_data = frame + aad_byte_length;
+    uint64_t user_data_length = (uint64_t) (frame_byte_length - aad_byte_length) << 3;
+
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        final_block.d[0] = user_data_length;
+        final_block.d[1] = (uint64_t) aad_byte_length << 3;
+    #else
+        final_block.d[0] = __builtin_bswap64((uint64_t) aad_byte_length << 3);
+        final_block.d[1] = __builtin_bswap64(user_data_length);
+    #endif
+
+    switch(sa->constants->mode)
+    {
+        case AES_GCM_128:
+            short_aad_prologue_kernel(sa->constants, macsec_counter_block(sa, PN), frame, aad_byte_length, 10, &cs, final_aes_ctr_block.b);
+            result_status |= aes_gcm_enc_128_kernel(user_data, user_data_length, &cs, user_data);
+            break;
+        case AES_GCM_256:
+            short_aad_prologue_kernel(sa->constants, macsec_counter_block(sa, PN), frame, aad_byte_length, 14, &cs, final_aes_ctr_block.b);
+            result_status |= aes_gcm_enc_256_kernel(user_data, user_data_length, &cs, user_data);
+            break;
+        default :
+            return API_RETURN(macsec_protect, ARMV8_STATS_MACSEC_PROTECT, frame_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    result_status |= ghash_kernel(final_block.b, 128, &cs);
+    result_status |= aes_gcm_finalize(&cs, final_aes_ctr_block, icv);
+
+    return API_RETURN(macsec_protect, ARMV8_STATS_MACSEC_PROTECT, frame_byte_length, STATS_GENERIC_GCM, result_status);
+}
+
+operation_result_t macsec_validate(
+    //Inputs
+    const macsec_sa_t * sa,
+    uint64_t PN,
+    uint8_t * frame,    uint32_t frame_byte_length,
+    const uint8_t * icv)
+{
+    TRACE_ENTRY(macsec_validate, sa->constants->mode, frame_byte_length);
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+    cipher_state_t cs;
+    quadword_t final_aes_ctr_block;
+    quadword_t final_block; // [len(A)]_64 | [len(C)]_64
+    quadword_t received_icv;
+    quadword_t computed_icv;
+    uint32_t aad_byte_length = macsec_aad_byte_length(frame);
+
+    if( frame_byte_length < aad_byte_length ||
+        (frame[MACSEC_TCI_OFFSET] & (MACSEC_TCI_E | MACSEC_TCI_C)) != (MACSEC_TCI_E | MACSEC_TCI_C) ) {
+        return API_RETURN(macsec_validate, ARMV8_STATS_MACSEC_VALIDATE, frame_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    uint8_t * secure_data = frame + aad_byte_length;
+    uint64_t secure_data_length = (uint64_t) (frame_byte_length - aad_byte_length) << 3;
+
+    // The ICV normally follows the Secure Data, where the decrypt kernels may write
+    memcpy(received_icv.b, icv, MACSEC_ICV_LENGTH);
+
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        final_block.d[0] = secure_data_length;
+        final_block.d[1] = (uint64_t) aad_byte_length << 3;
+    #else
+        final_block.d[0] = __builtin_bswap64((uint64_t) aad_byte_length << 3);
+        final_block.d[1] = __builtin_bswap64(secure_data_length);
+    #endif
+
+    switch(sa->constants->mode)
+    {
+        case AES_GCM_128:
+            short_aad_prologue_kernel(sa->constants, macsec_counter_block(sa, PN), frame, aad_byte_length, 10, &cs, final_aes_ctr_block.b);
+            result_status |= aes_gcm_dec_128_kernel(secure_data, secure_data_length, &cs, secure_data);
+            break;
+        case AES_GCM_256:
+            short_aad_prologue_kernel(sa->constants, macsec_counter_block(sa, PN), frame, aad_byte_length, 14, &cs, final_aes_ctr_block.b);
+            result_status |= aes_gcm_dec_256_kernel(secure_data, secure_data_length, &cs, secure_data);
+            break;
+        default :
+            return API_RETURN(macsec_validate, ARMV8_STATS_MACSEC_VALIDATE, frame_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    result_status |= ghash_kernel(final_block.b, 128, &cs);
+    result_status |= aes_gcm_finalize(&cs, final_aes_ctr_block, computed_icv.b);
+    if( result_status != SUCCESSFUL_OPERATION ) return API_RETURN(macsec_validate, ARMV8_STATS_MACSEC_VALIDATE, frame_byte_length, STATS_GENERIC_GCM, result_status);
+
+    return API_RETURN(macsec_validate, ARMV8_STATS_MACSEC_VALIDATE, frame_byte_length, STATS_GENERIC_GCM, aes_gcm_compare_tag(received_icv.b, computed_icv.b, MACSEC_ICV_LENGTH));
+}
+
+operation_result_t macsec_protect_burst(
+    const macsec_sa_t * sa,
+    const uint64_t * PN,
+    uint8_t * const * frames, const uint32_t * frame_byte_lengths,
+    uint32_t count)
+{
+    TRACE_ENTRY(macsec_protect_burst, sa->constants->mode, count);
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+    for( uint32_t i=0; i<count; ++i )
     {
-	uint16_t a, b;
-	memcpy(&a, tag, sizeof(uint16_t)); tag += sizeof(uint16_t);
-	memcpy(&b, cur, sizeof(uint16_t)); cur += sizeof(uint16_t);
-	mismatch |= a ^ b;
-	len -= sizeof(uint16_t);
+        result_status |= macsec_protect(sa, PN[i], frames[i], frame_byte_lengths[i], frames[i] + frame_byte_lengths[i]);
     }
-    if (len >= sizeof(uint8_t))
+    return TRACE_EXIT(macsec_protect_burst, result_status);
+}
+
+operation_result_t macsec_validate_burst(
+    const macsec_sa_t * sa,
+    const uint64_t * PN,
+    uint8_t * const * frames, const uint32_t * frame_byte_lengths,
+    uint32_t count,
+    operation_result_t * results)
+{
+    TRACE_ENTRY(macsec_validate_burst, sa->constants->mode, count);
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+    for( uint32_t i=0; i<count; ++i )
     {
-	uint8_t a, b;
-	memcpy(&a, tag, sizeof(uint8_t)); tag += sizeof(uint8_t);
-	memcpy(&b, cur, sizeof(uint8_t)); cur += sizeof(uint8_t);
-	mismatch |= a ^ b;
-	len -= sizeof(uint8_t);
+        results[i] = macsec_validate(sa, PN[i], frames[i], frame_byte_lengths[i], frames[i] + frame_byte_lengths[i]);
+        result_status |= results[i];
     }
-    return mismatch ? AUTHENTICATION_FAILURE : SUCCESSFUL_OPERATION;
+    return TRACE_EXIT(macsec_validate_burst, result_status);
 }
 
-// IPsec versions enabled when targeting LITTLE or big cores
-#ifdef IPSEC_ENABLED
-#ifdef PERF_GCM_LITTLE
-    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_128__interleaved.c"
-    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_192__interleaved.c"
-    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_256__interleaved.c"
-#else
-    #ifdef PERF_GCM_BIG
-        #include "AArch64cryptolib_opt_big/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_128__interleaved.c"
-        #include "AArch64cryptolib_opt_big/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_192__interleaved.c"
-        #include "AArch64cryptolib_opt_big/aes_gcm/enc_IPsec/aes_gcm_enc_from_consts_IPsec_256__interleaved.c"
+#undef MACSEC_TCI_OFFSET
+#undef MACSEC_TCI_SC
+#undef MACSEC_TCI_E
+#undef MACSEC_TCI_C
+#undef MACSEC_ICV_LENGTH
+
+// TLS 1.3 (RFC 8446) - the AAD is the 5B record header and the inner content type is appended to the content,
+// so the whole record is handled from a single short AAD prologue with no separate state setup
+#define TLS13_HEADER_LENGTH             5
+#define TLS13_TAG_LENGTH                16
+#define TLS13_APPLICATION_DATA          23
+#define TLS13_MAX_PLAINTEXT_LENGTH      (1u << 14)
+#define TLS13_MAX_CIPHERTEXT_LENGTH     ((1u << 14) + 256)
+
+operation_result_t tls13_context_init(
+    tls13_context_t * ctx,
+    const cipher_constants_t * cc,
+    const uint8_t * static_iv)
+{
+    TRACE_ENTRY(tls13_context_init, cc->mode);
+    if(cc->mode != AES_GCM_128 && cc->mode != AES_GCM_256) {
+        return TRACE_EXIT(tls13_context_init, INVALID_PARAMETER);
+    }
+    ctx->constants = cc;
+    ctx->sequence_number = 0;
+    memcpy(ctx->iv.b, static_iv, 12);
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        ctx->iv.s[3] = 1;
+    #else
+        ctx->iv.s[3] = __builtin_bswap32(1u);
     #endif
-#endif
+    return TRACE_EXIT(tls13_context_init, SUCCESSFUL_OPERATION);
+}
 
-operation_result_t encrypt_from_constants_IPsec(
+// Counter block for a record - the 64b sequence number is XORed into the low 64b of the static IV
+static inline quadword_t tls13_counter_block(const tls13_context_t * restrict ctx)
+{
+    quadword_t counter_block = ctx->iv;
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        counter_block.s[1] ^= (uint32_t) (ctx->sequence_number >> 32);
+        counter_block.s[2] ^= (uint32_t) ctx->sequence_number;
+    #else
+        counter_block.s[1] ^= __builtin_bswap32((uint32_t) (ctx->sequence_number >> 32));
+        counter_block.s[2] ^= __builtin_bswap32((uint32_t) ctx->sequence_number);
+    #endif
+    return counter_block;
+}
+
+operation_result_t tls13_seal(
     //Inputs
-    const cipher_constants_t * cc,
-    uint32_t salt,
-    uint64_t ESPIV,
-    const uint8_t * restrict aad,   uint32_t aad_byte_length,
-        //assumes aad zero padded to 16B and 0 < aad_byte_length <=16
-    uint8_t * plaintext,            uint32_t plaintext_byte_length,
-        //in place operation - plaintext becomes ciphertext
-        //assumed that ciphertext can be written in 16B blocks - will write up to 15B of 0s beyond the end of the plaintext
+    tls13_context_t * ctx,
+    uint8_t content_type,
+    uint8_t * record,   uint32_t content_byte_length,
     //Output
-    uint8_t * tag
-        //tag_byte_length specified in cipher_constants
-        //tag written after ciphertext, so tag will be produced correctly if directly after plaintext
-    )
+    uint32_t * record_byte_length)
 {
+    TRACE_ENTRY(tls13_seal, ctx->constants->mode, content_byte_length);
     operation_result_t result_status = SUCCESSFUL_OPERATION;
-    switch(cc->mode)
+    cipher_state_t cs;
+    quadword_t final_aes_ctr_block;
+    quadword_t final_block; // [len(A)]_64 | [len(C)]_64
+
+    if(content_byte_length > TLS13_MAX_PLAINTEXT_LENGTH || ctx->sequence_number == UINT64_MAX) {
+        return API_RETURN(tls13_seal, ARMV8_STATS_TLS13_SEAL, content_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    uint32_t inner_byte_length = content_byte_length + 1;
+    uint32_t length_field = inner_byte_length + TLS13_TAG_LENGTH;
+    uint8_t * inner_plaintext = record + TLS13_HEADER_LENGTH;
+
+    // opaque_type | legacy_record_version | length
+    record[0] = TLS13_APPLICATION_DATA;
+    record[1] = 0x03;
+    record[2] = 0x03;
+    record[3] = (uint8_t) (length_field >> 8);
+    record[4] = (uint8_t) length_field;
+    inner_plaintext[content_byte_length] = content_type;
+
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        final_block.d[0] = (uint64_t) inner_byte_length << 3;
+        final_block.d[1] = TLS13_HEADER_LENGTH << 3;
+    #else
+        final_block.d[0] = __builtin_bswap64(TLS13_HEADER_LENGTH << 3);
+        final_block.d[1] = __builtin_bswap64((uint64_t) inner_byte_length << 3);
+    #endif
+
+    switch(ctx->constants->mode)
     {
         case AES_GCM_128:
-            result_status |= encrypt_from_constants_IPsec_128(
-                    cc,
-                    salt,
-                    ESPIV,
-                    aad, aad_byte_length, //aad_byte_length 8 or 12
-                    plaintext, plaintext_byte_length, //Inputs
-                    tag);
+            short_aad_prologue_kernel(ctx->constants, tls13_counter_block(ctx), record, TLS13_HEADER_LENGTH, 10, &cs, final_aes_ctr_block.b);
+            result_status |= aes_gcm_enc_128_kernel(inner_plaintext, (uint64_t) inner_byte_length << 3, &cs, inner_plaintext);
             break;
-        case AES_GCM_192:
-            result_status |= encrypt_from_constants_IPsec_192(
-                    cc,
-                    salt,
-                    ESPIV,
-                    aad, aad_byte_length, //aad_byte_length 8 or 12
-                    plaintext, plaintext_byte_length, //Inputs
-                    tag);
+        case AES_GCM_256:
+            short_aad_prologue_kernel(ctx->constants, tls13_counter_block(ctx), record, TLS13_HEADER_LENGTH, 14, &cs, final_aes_ctr_block.b);
+            result_status |= aes_gcm_enc_256_kernel(inner_plaintext, (uint64_t) inner_byte_length << 3, &cs, inner_plaintext);
+            break;
+        default :
+            return API_RETURN(tls13_seal, ARMV8_STATS_TLS13_SEAL, content_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    result_status |= ghash_kernel(final_block.b, 128, &cs);
+    result_status |= aes_gcm_finalize(&cs, final_aes_ctr_block, inner_plaintext + inner_byte_length);
+    if( result_status != SUCCESSFUL_OPERATION ) return API_RETURN(tls13_seal, ARMV8_STATS_TLS13_SEAL, content_byte_length, STATS_GENERIC_GCM, result_status);
+
+    ctx->sequence_number++;
+    *record_byte_length = TLS13_HEADER_LENGTH + length_field;
+    return API_RETURN(tls13_seal, ARMV8_STATS_TLS13_SEAL, content_byte_length, STATS_GENERIC_GCM, SUCCESSFUL_OPERATION);
+}
+
+operation_result_t tls13_open(
+    //Inputs
+    tls13_context_t * ctx,
+    uint8_t * record,   uint32_t record_byte_length,
+    //Outputs
+    uint8_t * content_type,
+    uint32_t * content_byte_length)
+{
+    TRACE_ENTRY(tls13_open, ctx->constants->mode, record_byte_length);
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+    cipher_state_t cs;
+    quadword_t final_aes_ctr_block;
+    quadword_t final_block; // [len(A)]_64 | [len(C)]_64
+    quadword_t received_tag;
+    quadword_t computed_tag;
+
+    if(record_byte_length < TLS13_HEADER_LENGTH + TLS13_TAG_LENGTH + 1 ||
+       record_byte_length > TLS13_HEADER_LENGTH + TLS13_MAX_CIPHERTEXT_LENGTH ||
+       record[0] != TLS13_APPLICATION_DATA ||
+       (((uint32_t) record[3] << 8) | record[4]) != record_byte_length - TLS13_HEADER_LENGTH ||
+       ctx->sequence_number == UINT64_MAX) {
+        return API_RETURN(tls13_open, ARMV8_STATS_TLS13_OPEN, record_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    uint32_t inner_byte_length = record_byte_length - TLS13_HEADER_LENGTH - TLS13_TAG_LENGTH;
+    uint8_t * inner_plaintext = record + TLS13_HEADER_LENGTH;
+
+    // The tag follows the encrypted record, where the decrypt kernels may write
+    memcpy(received_tag.b, inner_plaintext + inner_byte_length, TLS13_TAG_LENGTH);
+
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        final_block.d[0] = (uint64_t) inner_byte_length << 3;
+        final_block.d[1] = TLS13_HEADER_LENGTH << 3;
+    #else
+        final_block.d[0] = __builtin_bswap64(TLS13_HEADER_LENGTH << 3);
+        final_block.d[1] = __builtin_bswap64((uint64_t) inner_byte_length << 3);
+    #endif
+
+    switch(ctx->constants->mode)
+    {
+        case AES_GCM_128:
+            short_aad_prologue_kernel(ctx->constants, tls13_counter_block(ctx), record, TLS13_HEADER_LENGTH, 10, &cs, final_aes_ctr_block.b);
+            result_status |= aes_gcm_dec_128_kernel(inner_plaintext, (uint64_t) inner_byte_length << 3, &cs, inner_plaintext);
             break;
         case AES_GCM_256:
-            result_status |= encrypt_from_constants_IPsec_256(
-                    cc,
-                    salt,
-                    ESPIV,
-                    aad, aad_byte_length, //aad_byte_length 8 or 12
-                    plaintext, plaintext_byte_length, //Inputs
-                    tag);
+            short_aad_prologue_kernel(ctx->constants, tls13_counter_block(ctx), record, TLS13_HEADER_LENGTH, 14, &cs, final_aes_ctr_block.b);
+            result_status |= aes_gcm_dec_256_kernel(inner_plaintext, (uint64_t) inner_byte_length << 3, &cs, inner_plaintext);
             break;
+        default :
+            return API_RETURN(tls13_open, ARMV8_STATS_TLS13_OPEN, record_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
     }
-    return result_status;
+    result_status |= ghash_kernel(final_block.b, 128, &cs);
+    result_status |= aes_gcm_finalize(&cs, final_aes_ctr_block, computed_tag.b);
+    if( result_status != SUCCESSFUL_OPERATION ) return API_RETURN(tls13_open, ARMV8_STATS_TLS13_OPEN, record_byte_length, STATS_GENERIC_GCM, result_status);
+
+    result_status = aes_gcm_compare_tag(received_tag.b, computed_tag.b, TLS13_TAG_LENGTH);
+    if( result_status != SUCCESSFUL_OPERATION ) return API_RETURN(tls13_open, ARMV8_STATS_TLS13_OPEN, record_byte_length, STATS_GENERIC_GCM, result_status);
+    ctx->sequence_number++;
+
+    // The content type is the last non-zero byte, anything after it is padding
+    while(inner_byte_length > 0 && inner_plaintext[inner_byte_length-1] == 0) {
+        inner_byte_length--;
+    }
+    if(inner_byte_length == 0) {
+        return API_RETURN(tls13_open, ARMV8_STATS_TLS13_OPEN, record_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    *content_type = inner_plaintext[inner_byte_length-1];
+    *content_byte_length = inner_byte_length-1;
+    return API_RETURN(tls13_open, ARMV8_STATS_TLS13_OPEN, record_byte_length, STATS_GENERIC_GCM, SUCCESSFUL_OPERATION);
 }
 
-#ifdef PERF_GCM_LITTLE
-    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_128__interleaved.c"
-    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_192__interleaved.c"
-    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_256__interleaved.c"
-#else
-    #ifdef PERF_GCM_BIG
-        #include "AArch64cryptolib_opt_big/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_128__interleaved.c"
-        #include "AArch64cryptolib_opt_big/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_192__interleaved.c"
-        #include "AArch64cryptolib_opt_big/aes_gcm/dec_IPsec/aes_gcm_dec_from_consts_IPsec_256__interleaved.c"
+#undef TLS13_HEADER_LENGTH
+#undef TLS13_TAG_LENGTH
+#undef TLS13_APPLICATION_DATA
+#undef TLS13_MAX_PLAINTEXT_LENGTH
+#undef TLS13_MAX_CIPHERTEXT_LENGTH
+
+// QUIC (RFC 9001) - the AAD is the packet header, which is short (up to 25B) for 1-RTT packets, and header protection
+// is a single AES block over a 16B sample of the ciphertext, so it is issued alongside the tag computation (protect)
+// or folded into the per packet setup (unprotect), which needs the unmasked packet number before anything else
+#define QUIC_TAG_LENGTH         16
+#define QUIC_SAMPLE_OFFSET      4
+#define QUIC_LONG_HEADER        0x80
+
+operation_result_t quic_context_init(
+    quic_context_t * ctx,
+    const cipher_constants_t * cc,
+    const cipher_constants_t * hp_cc,
+    const uint8_t * static_iv)
+{
+    TRACE_ENTRY(quic_context_init, cc->mode);
+    if((cc->mode != AES_GCM_128 && cc->mode != AES_GCM_256) || hp_cc->mode != cc->mode) {
+        return TRACE_EXIT(quic_context_init, INVALID_PARAMETER);
+    }
+    ctx->constants = cc;
+    ctx->hp_constants = hp_cc;
+    memcpy(ctx->iv.b, static_iv, 12);
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        ctx->iv.s[3] = 1;
+    #else
+        ctx->iv.s[3] = __builtin_bswap32(1u);
     #endif
-#endif
+    return TRACE_EXIT(quic_context_init, SUCCESSFUL_OPERATION);
+}
 
-operation_result_t decrypt_from_constants_IPsec(
+// Counter block for a packet - the packet number is XORed into the low 64b of the static IV
+static inline quadword_t quic_counter_block(const quic_context_t * restrict ctx, uint64_t packet_number)
+{
+    quadword_t counter_block = ctx->iv;
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        counter_block.s[1] ^= (uint32_t) (packet_number >> 32);
+        counter_block.s[2] ^= (uint32_t) packet_number;
+    #else
+        counter_block.s[1] ^= __builtin_bswap32((uint32_t) (packet_number >> 32));
+        counter_block.s[2] ^= __builtin_bswap32((uint32_t) packet_number);
+    #endif
+    return counter_block;
+}
+
+static inline void quic_prologue_kernel(const quic_context_t * restrict ctx, uint64_t packet_number, uint8_t * header, uint32_t header_byte_length, uint32_t rounds, cipher_state_t * restrict cs, uint8_t * restrict final_aes_ctr_block)
+{
+    quadword_t counter_block = quic_counter_block(ctx, packet_number);
+    if(header_byte_length <= 32) {
+        short_aad_prologue_kernel(ctx->constants, counter_block, header, header_byte_length, rounds, cs, final_aes_ctr_block);
+        return;
+    }
+    // Long headers (connection IDs and tokens) go through ghash_kernel
+    cs->constants = (cipher_constants_t *) ctx->constants;
+    cs->current_tag.d[0] = 0;
+    cs->current_tag.d[1] = 0;
+    ghash_kernel(header, (uint64_t) header_byte_length << 3, cs);
+    vst1q_u8(final_aes_ctr_block, aes_block_kernel(ctx->constants, rounds, vld1q_u8(counter_block.b)));
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        counter_block.s[3] = 2;
+    #else
+        counter_block.s[3] = __builtin_bswap32(2u);
+    #endif
+    cs->counter = counter_block;
+}
+
+// GHASH of the final block and the tag, with the header protection AES block in between when the sample is already
+// complete - it is only in the tag for the shortest packets
+static inline void quic_protect_epilogue_kernel(cipher_state_t * restrict cs, quadword_t final_block, quadword_t final_aes_ctr_block, uint8_t * tag, const cipher_constants_t * restrict hp_cc, uint32_t rounds, const uint8_t * sample, uint8_t * restrict hp_mask)
+{
+    int sample_in_tag = (sample + 16 > tag);
+    uint8x16_t mask = vdupq_n_u8(0);
+    if(!sample_in_tag) {
+        mask = aes_block_kernel(hp_cc, rounds, vld1q_u8(sample));
+    }
+
+    poly64x2_t hash_key_0 = (poly64x2_t) vld1q_u64(cs->constants->expanded_hash_keys[0].d);
+    poly64_t hash_karat_0 = (poly64_t) veor_u64(vget_high_u64(hash_key_0), vget_low_u64(hash_key_0));
+    poly64_t modulo_const = (poly64_t) 0xC200000000000000ul;
+    uint8x16_t low_acc = vld1q_u8(cs->current_tag.b);
+    low_acc = vextq_u8(low_acc, low_acc, 8);
+    poly64x2_t block = vreinterpretq_p64_u8(vld1q_u8(final_block.b));
+    block = vrev64q_u8(block);
+    block = veorq_u64(block, low_acc);
+    poly64_t block_karat = (poly64_t) veor_u64(vget_high_u64(block),vget_low_u64(block));
+
+    //multiply
+    poly128_t t_high = vmull_high_p64(block, hash_key_0);
+    poly128_t t_low  = vmull_p64((poly64_t) vget_low_p64(block), (poly64_t) vget_low_p64(hash_key_0));
+    poly128_t t_mid  = vmull_p64(block_karat, hash_karat_0);
+
+    //tidy up karatsuba
+    poly64x2_t mid_acc = veorq_u64(vreinterpretq_u64_p128(t_mid), vreinterpretq_u64_p128(t_high));
+    mid_acc = veorq_u64(mid_acc, vreinterpretq_u64_p128(t_low));
+
+    //modulo reduction
+    poly128_t tmp_mid_0 = vmull_p64((poly64_t) vget_low_p64(vreinterpretq_u64_p128(t_high)), modulo_const);
+    uint8x16_t high_acc = vextq_u8(vreinterpretq_u8_p128(t_high), vreinterpretq_u8_p128(t_high), 8);
+    mid_acc = veorq_u64(mid_acc, vreinterpretq_u64_p128(tmp_mid_0));
+    mid_acc = veorq_u64(mid_acc, high_acc);
+
+    poly128_t tmp_low_0 = vmull_p64((poly64_t) vget_low_p64(mid_acc), modulo_const);
+    mid_acc = vextq_u8(mid_acc, mid_acc, 8);
+    low_acc = veorq_u64(vreinterpretq_u64_p128(t_low), vreinterpretq_u64_p128(tmp_low_0));
+    low_acc = veorq_u64(low_acc, mid_acc);
+
+    //finalize
+    low_acc = vrev64q_u8(low_acc);
+    low_acc = vextq_u8(low_acc, low_acc, 8);
+    low_acc = veorq_u8(low_acc, vld1q_u8(final_aes_ctr_block.b));
+    vst1q_u8(tag, low_acc);
+
+    if(sample_in_tag) {
+        mask = aes_block_kernel(hp_cc, rounds, vld1q_u8(sample));
+    }
+    vst1q_u8(hp_mask, mask);
+}
+
+// Mask (or unmask) the first byte and the packet number, returns the packet number length
+static inline uint32_t quic_mask_header(uint8_t * packet, uint32_t pn_offset, const uint8_t * hp_mask, int unmask)
+{
+    uint8_t first_byte_mask = (packet[0] & QUIC_LONG_HEADER) ? 0x0f : 0x1f;
+    uint32_t pn_length = (packet[0] & 0x03) + 1;
+    packet[0] ^= hp_mask[0] & first_byte_mask;
+    if(unmask) {
+        pn_length = (packet[0] & 0x03) + 1;
+    }
+    for( uint32_t i=0; i<pn_length; ++i )
+    {
+        packet[pn_offset+i] ^= hp_mask[1+i];
+    }
+    return pn_length;
+}
+
+// RFC 9000 Appendix A.3
+static inline uint64_t quic_decode_packet_number(uint64_t largest_pn, uint64_t truncated_pn, uint32_t pn_length)
+{
+    uint64_t expected_pn = largest_pn + 1;
+    uint64_t pn_win = 1ull << (pn_length * 8);
+    uint64_t pn_hwin = pn_win / 2;
+    uint64_t pn_mask = pn_win - 1;
+    uint64_t candidate_pn = (expected_pn & ~pn_mask) | truncated_pn;
+    if(candidate_pn + pn_hwin <= expected_pn && candidate_pn < (1ull << 62) - pn_win) {
+        return candidate_pn + pn_win;
+    }
+    if(candidate_pn > expected_pn + pn_hwin && candidate_pn >= pn_win) {
+        return candidate_pn - pn_win;
+    }
+    return candidate_pn;
+}
+
+operation_result_t quic_protect(
     //Inputs
-    const armv8_cipher_constants_t * cc,
-    uint32_t salt,
-    uint64_t ESPIV,
-    const uint8_t * restrict aad, uint32_t aad_byte_length,
-        //aad zero padded to 16B, aad_byte_length 8 or 12
-    uint8_t * ciphertext,   uint32_t ciphertext_byte_length,
-        //in place operation - ciphertext becomes plaintext
-        //assumed that plaintext can be written in 8B blocks - will write up to 7B of 0s beyond the end of the ciphertext
-    const uint8_t * tag,
-        //tag_byte_length specified in cipher_constants
-        //tag is read before last block of plaintext is written and written back afterwards, so tag will be preserved
-        //supported tag sizes are 8B, 12B and 16B, and precisely the size specified will be read
-    //Output
-    uint64_t * checksum
-        //one's complement sum of all 64b words in the plaintext
-    )
+    const quic_context_t * ctx,
+    uint64_t packet_number,
+    uint8_t * packet,   uint32_t header_byte_length,    uint32_t payload_byte_length)
 {
+    TRACE_ENTRY(quic_protect, ctx->constants->mode, payload_byte_length, header_byte_length);
     operation_result_t result_status = SUCCESSFUL_OPERATION;
-    switch(cc->mode)
+    cipher_state_t cs;
+    quadword_t final_aes_ctr_block;
+    quadword_t final_block; // [len(A)]_64 | [len(C)]_64
+    quadword_t hp_mask;
+    uint32_t rounds;
+
+    uint32_t pn_length = (packet[0] & 0x03) + 1;
+    if(header_byte_length < pn_length + 1 || payload_byte_length + pn_length < QUIC_SAMPLE_OFFSET) {
+        return API_RETURN(quic_protect, ARMV8_STATS_QUIC_PROTECT, payload_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    uint32_t pn_offset = header_byte_length - pn_length;
+    uint8_t * payload = packet + header_byte_length;
+    uint64_t payload_length = (uint64_t) payload_byte_length << 3;
+
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        final_block.d[0] = payload_length;
+        final_block.d[1] = (uint64_t) header_byte_length << 3;
+    #else
+        final_block.d[0] = __builtin_bswap64((uint64_t) header_byte_length << 3);
+        final_block.d[1] = __builtin_bswap64(payload_length);
+    #endif
+
+    switch(ctx->constants->mode)
     {
         case AES_GCM_128:
-            result_status |= decrypt_from_constants_IPsec_128(
-                    cc,
-                    salt,
-                    ESPIV,
-                    aad, aad_byte_length, //aad_byte_length 8 or 12
-                    ciphertext, ciphertext_byte_length, //Inputs
-                    tag,
-                    checksum);
+            rounds = 10;
+            quic_prologue_kernel(ctx, packet_number, packet, header_byte_length, rounds, &cs, final_aes_ctr_block.b);
+            result_status |= aes_gcm_enc_128_kernel(payload, payload_length, &cs, payload);
             break;
-        case AES_GCM_192:
-            result_status |= decrypt_from_constants_IPsec_192(
-                    cc,
-                    salt,
-                    ESPIV,
-                    aad, aad_byte_length, //aad_byte_length 8 or 12
-                    ciphertext, ciphertext_byte_length, //Inputs
-                    tag,
-                    checksum);
+        case AES_GCM_256:
+            rounds = 14;
+            quic_prologue_kernel(ctx, packet_number, packet, header_byte_length, rounds, &cs, final_aes_ctr_block.b);
+            result_status |= aes_gcm_enc_256_kernel(payload, payload_length, &cs, payload);
+            break;
+        default :
+            return API_RETURN(quic_protect, ARMV8_STATS_QUIC_PROTECT, payload_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    quic_protect_epilogue_kernel(&cs, final_block, final_aes_ctr_block, payload + payload_byte_length,
+                                 ctx->hp_constants, rounds, packet + pn_offset + QUIC_SAMPLE_OFFSET, hp_mask.b);
+    quic_mask_header(packet, pn_offset, hp_mask.b, 0);
+
+    return API_RETURN(quic_protect, ARMV8_STATS_QUIC_PROTECT, payload_byte_length, STATS_GENERIC_GCM, result_status);
+}
+
+operation_result_t quic_unprotect(
+    //Inputs
+    const quic_context_t * ctx,
+    uint64_t largest_pn,
+    uint8_t * packet,   uint32_t pn_offset,     uint32_t packet_byte_length,
+    //Outputs
+    uint64_t * packet_number,
+    uint32_t * header_byte_length,
+    uint32_t * payload_byte_length)
+{
+    TRACE_ENTRY(quic_unprotect, ctx->constants->mode, packet_byte_length, pn_offset);
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+    cipher_state_t cs;
+    quadword_t final_aes_ctr_block;
+    quadword_t final_block; // [len(A)]_64 | [len(C)]_64
+    quadword_t received_tag;
+    quadword_t computed_tag;
+    quadword_t hp_mask;
+    uint32_t rounds;
+
+    if(pn_offset == 0 || pn_offset + QUIC_SAMPLE_OFFSET + 16 > packet_byte_length) {
+        return API_RETURN(quic_unprotect, ARMV8_STATS_QUIC_UNPROTECT, packet_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    switch(ctx->constants->mode)
+    {
+        case AES_GCM_128:
+            rounds = 10;
             break;
         case AES_GCM_256:
-            result_status |= decrypt_from_constants_IPsec_256(
-                    cc,
-                    salt,
-                    ESPIV,
-                    aad, aad_byte_length, //aad_byte_length 8 or 12
-                    ciphertext, ciphertext_byte_length, //Inputs
-                    tag,
-                    checksum);
+            rounds = 14;
             break;
+        default :
+            return API_RETURN(quic_unprotect, ARMV8_STATS_QUIC_UNPROTECT, packet_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
     }
-    return result_status;
+
+    // Everything else depends on the packet number, so header protection comes first
+    vst1q_u8(hp_mask.b, aes_block_kernel(ctx->hp_constants, rounds, vld1q_u8(packet + pn_offset + QUIC_SAMPLE_OFFSET)));
+    uint32_t pn_length = quic_mask_header(packet, pn_offset, hp_mask.b, 1);
+    uint64_t truncated_pn = 0;
+    for( uint32_t i=0; i<pn_length; ++i )
+    {
+        truncated_pn = (truncated_pn << 8) | packet[pn_offset+i];
+    }
+    uint64_t full_pn = quic_decode_packet_number(largest_pn, truncated_pn, pn_length);
+
+    uint32_t header_length = pn_offset + pn_length;
+    if(header_length + QUIC_TAG_LENGTH > packet_byte_length) {
+        return API_RETURN(quic_unprotect, ARMV8_STATS_QUIC_UNPROTECT, packet_byte_length, STATS_GENERIC_GCM, INVALID_PARAMETER);
+    }
+    uint32_t payload_length_bytes = packet_byte_length - header_length - QUIC_TAG_LENGTH;
+    uint8_t * payload = packet + header_length;
+    uint64_t payload_length = (uint64_t) payload_length_bytes << 3;
+
+    // The tag follows the payload, where the decrypt kernels may write
+    memcpy(received_tag.b, payload + payload_length_bytes, QUIC_TAG_LENGTH);
+
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        final_block.d[0] = payload_length;
+        final_block.d[1] = (uint64_t) header_length << 3;
+    #else
+        final_block.d[0] = __builtin_bswap64((uint64_t) header_length << 3);
+        final_block.d[1] = __builtin_bswap64(payload_length);
+    #endif
+
+    quic_prologue_kernel(ctx, full_pn, packet, header_length, rounds, &cs, final_aes_ctr_block.b);
+    switch(ctx->constants->mode)
+    {
+        case AES_GCM_128:
+            result_status |= aes_gcm_dec_128_kernel(payload, payload_length, &cs, payload);
+            break;
+        default :
+            result_status |= aes_gcm_dec_256_kernel(payload, payload_length, &cs, payload);
+            break;
+    }
+    result_status |= ghash_kernel(final_block.b, 128, &cs);
+    result_status |= aes_gcm_finalize(&cs, final_aes_ctr_block, computed_tag.b);
+    if( result_status != SUCCESSFUL_OPERATION ) return API_RETURN(quic_unprotect, ARMV8_STATS_QUIC_UNPROTECT, packet_byte_length, STATS_GENERIC_GCM, result_status);
+
+    *packet_number = full_pn;
+    *header_byte_length = header_length;
+    *payload_byte_length = payload_length_bytes;
+    return API_RETURN(quic_unprotect, ARMV8_STATS_QUIC_UNPROTECT, packet_byte_length, STATS_GENERIC_GCM, aes_gcm_compare_tag(received_tag.b, computed_tag.b, QUIC_TAG_LENGTH));
 }
-#endif
+
+operation_result_t quic_protect_burst(
+    const quic_context_t * ctx,
+    const uint64_t * packet_numbers,
+    uint8_t * const * packets, const uint32_t * header_byte_lengths, const uint32_t * payload_byte_lengths,
+    uint32_t count)
+{
+    TRACE_ENTRY(quic_protect_burst, ctx->constants->mode, count);
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+    for( uint32_t i=0; i<count; ++i )
+    {
+        result_status |= quic_protect(ctx, packet_numbers[i], packets[i], header_byte_lengths[i], payload_byte_lengths[i]);
+    }
+    return TRACE_EXIT(quic_protect_burst, result_status);
+}
+
+operation_result_t quic_unprotect_burst(
+    const quic_context_t * ctx,
+    uint64_t * largest_pn,
+    uint8_t * const * packets, const uint32_t * pn_offsets, const uint32_t * packet_byte_lengths,
+    uint32_t count,
+    uint64_t * packet_numbers,
+    uint32_t * header_byte_lengths,
+    uint32_t * payload_byte_lengths,
+    operation_result_t * results)
+{
+    TRACE_ENTRY(quic_unprotect_burst, ctx->constants->mode, count);
+    operation_result_t result_status = SUCCESSFUL_OPERATION;
+    for( uint32_t i=0; i<count; ++i )
+    {
+        results[i] = quic_unprotect(ctx, *largest_pn, packets[i], pn_offsets[i], packet_byte_lengths[i],
+                                    &packet_numbers[i], &header_byte_lengths[i], &payload_byte_lengths[i]);
+        if(results[i] == SUCCESSFUL_OPERATION && (*largest_pn == UINT64_MAX || packet_numbers[i] > *largest_pn)) {
+            *largest_pn = packet_numbers[i];
+        }
+        result_status |= results[i];
+    }
+    return TRACE_EXIT(quic_unprotect_burst, result_status);
+}
+
+#undef QUIC_TAG_LENGTH
+#undef QUIC_SAMPLE_OFFSET
+#undef QUIC_LONG_HEADER
 
 #undef cipher_mode_t
 #undef operation_result_t
 #undef quadword_t
 #undef cipher_constants_t
 #undef cipher_state_t
+#undef aes_gcm_segment_t
 
 #undef encrypt_full
 #undef encrypt_from_state
@@ -2261,6 +4624,53 @@ operation_result_t decrypt_from_constants_IPsec(
 #undef decrypt_full
 #undef decrypt_from_state
 #undef decrypt_from_constants_IPsec
+#undef encrypt_full_exact
+#undef encrypt_from_state_exact
+#undef decrypt_full_exact
+#undef decrypt_from_state_exact
+#undef encrypt_from_state_bulk
+#undef decrypt_from_state_bulk
+#undef encrypt_from_state_exact_128
+#undef encrypt_from_state_exact_192
+#undef encrypt_from_state_exact_256
+#undef decrypt_from_state_exact_128
+#undef decrypt_from_state_exact_192
+#undef decrypt_from_state_exact_256
+#undef encrypt_range
+#undef decrypt_range
+#undef ghash_segment
+#undef tag_segments
+#undef verify_segments
+#undef gmac_from_constants_IPsec
+#undef gmac_verify_from_constants_IPsec
+#undef set_compact_constants_128
+#undef set_compact_constants_192
+#undef set_compact_constants_256
+#undef encrypt_from_compact_IPsec_128
+#undef encrypt_from_compact_IPsec_192
+#undef encrypt_from_compact_IPsec_256
+#undef decrypt_from_compact_IPsec_128
+#undef decrypt_from_compact_IPsec_192
+#undef decrypt_from_compact_IPsec_256
+#undef macsec_sa_t
+#undef macsec_sa_init
+#undef macsec_xpn_sa_init
+#undef macsec_protect
+#undef macsec_validate
+#undef macsec_protect_burst
+#undef macsec_validate_burst
+#undef tls13_context_t
+#undef tls13_context_init
+#undef tls13_seal
+#undef tls13_open
+#undef quic_context_t
+#undef quic_context_init
+#undef quic_protect
+#undef quic_unprotect
+#undef quic_protect_burst
+#undef quic_unprotect_burst
+
+#undef STATS_GENERIC_GCM
 
 #undef expand_hash_keys
 
@@ -2269,6 +4679,7 @@ operation_result_t decrypt_from_constants_IPsec(
 #undef aes_gcm_expandkeys_256_kernel
 
 #undef ghash_kernel
+#undef ghash_checksum_kernel
 
 #undef aes_ctr_blk_128_kernel
 #undef aes_ctr_blk_192_kernel
@@ -2283,6 +4694,18 @@ operation_result_t decrypt_from_constants_IPsec(
 #undef aes_gcm_dec_256_kernel
 
 #undef aes_gcm_finalize
+#undef aes_gcm_compare_tag
+
+#undef aes_block_kernel
+#undef short_aad_prologue_kernel
+#undef macsec_counter_block
+#undef macsec_aad_byte_length
+#undef tls13_counter_block
+#undef quic_counter_block
+#undef quic_prologue_kernel
+#undef quic_protect_epilogue_kernel
+#undef quic_mask_header
+#undef quic_decode_packet_number
 
 #undef rcon
 
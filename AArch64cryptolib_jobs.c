@@ -0,0 +1,216 @@
+//Copyright (c) 2018-2019, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+#include "AArch64cryptolib_private.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define JOB_RING_MASK           (ARMV8_JOB_RING_SIZE - 1)
+
+static armv8_operation_result_t run_gcm_job(armv8_job_t * job)
+{
+    armv8_cipher_state_t cs = { .constants = job->gcm.cc };
+    armv8_operation_result_t result = armv8_aes_gcm_set_counter(job->gcm.nonce, job->gcm.nonce_bit_length, &cs);
+    if(result != SUCCESSFUL_OPERATION) {
+        return result;
+    }
+    if(job->type == ARMV8_JOB_AES_GCM_ENC) {
+        return armv8_enc_aes_gcm_from_state(&cs, job->gcm.aad, job->gcm.aad_bit_length,
+                                            job->gcm.input, job->gcm.bit_length, job->gcm.output, job->gcm.tag);
+    }
+    return armv8_dec_aes_gcm_from_state(&cs, job->gcm.aad, job->gcm.aad_bit_length,
+                                        job->gcm.input, job->gcm.bit_length, job->gcm.tag, job->gcm.output);
+}
+
+void armv8_job_run(armv8_job_t * job)
+{
+    int cbc_result;
+    switch(job->type) {
+    case ARMV8_JOB_AES_GCM_ENC:
+    case ARMV8_JOB_AES_GCM_DEC:
+        job->result = run_gcm_job(job);
+        return;
+#ifdef IPSEC_ENABLED
+    case ARMV8_JOB_AES_GCM_ENC_IPSEC:
+        job->result = armv8_enc_aes_gcm_from_constants_IPsec(job->ipsec.cc, job->ipsec.salt, job->ipsec.ESPIV,
+                                                             job->ipsec.aad, job->ipsec.aad_byte_length,
+                                                             job->ipsec.data, job->ipsec.byte_length, job->ipsec.tag);
+        return;
+    case ARMV8_JOB_AES_GCM_DEC_IPSEC:
+        job->result = armv8_dec_aes_gcm_from_constants_IPsec(job->ipsec.cc, job->ipsec.salt, job->ipsec.ESPIV,
+                                                             job->ipsec.aad, job->ipsec.aad_byte_length,
+                                                             job->ipsec.data, job->ipsec.byte_length, job->ipsec.tag,
+                                                             &job->ipsec.checksum);
+        return;
+#endif
+    case ARMV8_JOB_AES_CBC_SHA1_ENC:
+        cbc_result = armv8_enc_aes_cbc_sha1_128(job->cbc_sha.csrc, job->cbc_sha.cdst, job->cbc_sha.clen,
+                                                job->cbc_sha.dsrc, job->cbc_sha.ddst, job->cbc_sha.dlen, job->cbc_sha.arg);
+        break;
+    case ARMV8_JOB_AES_CBC_SHA256_ENC:
+        cbc_result = armv8_enc_aes_cbc_sha256_128(job->cbc_sha.csrc, job->cbc_sha.cdst, job->cbc_sha.clen,
+                                                  job->cbc_sha.dsrc, job->cbc_sha.ddst, job->cbc_sha.dlen, job->cbc_sha.arg);
+        break;
+    case ARMV8_JOB_AES_CBC_SHA1_DEC:
+        cbc_result = armv8_dec_aes_cbc_sha1_128(job->cbc_sha.csrc, job->cbc_sha.cdst, job->cbc_sha.clen,
+                                                job->cbc_sha.dsrc, job->cbc_sha.ddst, job->cbc_sha.dlen, job->cbc_sha.arg);
+        break;
+    case ARMV8_JOB_AES_CBC_SHA256_DEC:
+        cbc_result = armv8_dec_aes_cbc_sha256_128(job->cbc_sha.csrc, job->cbc_sha.cdst, job->cbc_sha.clen,
+                                                  job->cbc_sha.dsrc, job->cbc_sha.ddst, job->cbc_sha.dlen, job->cbc_sha.arg);
+        break;
+    default:
+        job->result = INVALID_PARAMETER;
+        return;
+    }
+    job->result = cbc_result == 0 ? SUCCESSFUL_OPERATION : INTERNAL_FAILURE;
+}
+
+// Start pulling in the key schedule and the first input of a job while the one before it runs
+static void prefetch_job(const armv8_job_t * job)
+{
+    const uint8_t * keys;
+    const uint8_t * input;
+    switch(job->type) {
+    case ARMV8_JOB_AES_GCM_ENC:
+    case ARMV8_JOB_AES_GCM_DEC:
+        keys = (const uint8_t *) job->gcm.cc;
+        input = job->gcm.input;
+        break;
+    case ARMV8_JOB_AES_GCM_ENC_IPSEC:
+    case ARMV8_JOB_AES_GCM_DEC_IPSEC:
+        keys = (const uint8_t *) job->ipsec.cc;
+        input = job->ipsec.data;
+        break;
+    case ARMV8_JOB_AES_CBC_SHA1_ENC:
+    case ARMV8_JOB_AES_CBC_SHA256_ENC:
+    case ARMV8_JOB_AES_CBC_SHA1_DEC:
+    case ARMV8_JOB_AES_CBC_SHA256_DEC:
+        keys = job->cbc_sha.arg->cipher.key;
+        input = job->cbc_sha.csrc;
+        break;
+    default:
+        return;
+    }
+    for( uint32_t i=0; i<256; i+=64 )
+    {
+        __builtin_prefetch(keys + i, 0, 3);
+    }
+    __builtin_prefetch(input, 0, 3);
+    __builtin_prefetch(input + 64, 0, 3);
+}
+
+#ifdef ARMV8_JOB_GCM_LANES_ENABLED
+// AES-GCM jobs that armv8_job_run_gcm_lanes can take - short, with a 96 bit nonce and whole bytes of AAD and data
+static inline bool gcm_lane_job(const armv8_job_t * job)
+{
+    return (job->type == ARMV8_JOB_AES_GCM_ENC || job->type == ARMV8_JOB_AES_GCM_DEC) &&
+           job->gcm.nonce_bit_length == 96 &&
+           job->gcm.bit_length <= ARMV8_JOB_GCM_LANE_MAX_BYTES * 8 &&
+           (job->gcm.bit_length & 7) == 0 && (job->gcm.aad_bit_length & 7) == 0 &&
+           (job->gcm.cc->mode == AES_GCM_128 || job->gcm.cc->mode == AES_GCM_192 || job->gcm.cc->mode == AES_GCM_256);
+}
+#endif
+
+// Run the queued jobs up to end, then make their results visible to the consumer together
+// In builds with lanes, short AES-GCM jobs are gathered from anywhere in the batch into groups of up to
+// ARMV8_JOB_GCM_LANES of the same key size and run interleaved, the rest run back to back. The order jobs run in within a batch doesn't show, as their
+// results only become visible once the whole batch has run
+static uint32_t run_batch(armv8_job_mgr_t * mgr, uint64_t end)
+{
+    uint64_t first = mgr->completed;
+#ifdef ARMV8_JOB_GCM_LANES_ENABLED
+    uint64_t laned = 0;         // bit i - first is set once job i has run in lanes
+#endif
+    for( uint64_t i=first; i<end; ++i )
+    {
+        armv8_job_t * job = &mgr->jobs[i & JOB_RING_MASK];
+#ifdef ARMV8_JOB_GCM_LANES_ENABLED
+        if(laned & (1ull << (i - first))) {
+            continue;
+        }
+        if(gcm_lane_job(job)) {
+            armv8_job_t * lanes[ARMV8_JOB_GCM_LANES] = { job };
+            uint32_t count = 1;
+            for( uint64_t j=i+1; j<end && count<ARMV8_JOB_GCM_LANES; ++j )
+            {
+                armv8_job_t * other = &mgr->jobs[j & JOB_RING_MASK];
+                if(!(laned & (1ull << (j - first))) && gcm_lane_job(other) && other->gcm.cc->mode == job->gcm.cc->mode) {
+                    lanes[count++] = other;
+                    laned |= 1ull << (j - first);
+                }
+            }
+            if(count > 1) {
+                armv8_job_run_gcm_lanes(lanes, count);
+                continue;
+            }
+        }
+#endif
+        if(i + 1 < end) {
+            prefetch_job(&mgr->jobs[(i + 1) & JOB_RING_MASK]);
+        }
+        armv8_job_run(job);
+    }
+    __atomic_store_n(&mgr->completed, end, __ATOMIC_RELEASE);
+    return (uint32_t) (end - first);
+}
+
+armv8_operation_result_t armv8_job_mgr_init(
+    armv8_job_mgr_t * mgr,
+    uint32_t batch_size)
+{
+    if(batch_size == 0 || batch_size > ARMV8_JOB_MAX_BATCH) {
+        return INVALID_PARAMETER;
+    }
+    memset(mgr, 0, sizeof(*mgr));
+    mgr->batch_size = batch_size;
+    return SUCCESSFUL_OPERATION;
+}
+
+armv8_job_t * armv8_job_get_next(armv8_job_mgr_t * mgr)
+{
+    // the consumer's copy out of a slot is complete before it moves retired past it
+    if(mgr->submitted - __atomic_load_n(&mgr->retired, __ATOMIC_ACQUIRE) >= ARMV8_JOB_RING_SIZE) {
+        return NULL;
+    }
+    return &mgr->jobs[mgr->submitted & JOB_RING_MASK];
+}
+
+uint32_t armv8_job_submit(armv8_job_mgr_t * mgr)
+{
+    mgr->submitted++;
+    if(mgr->submitted - mgr->completed < mgr->batch_size) {
+        return 0;
+    }
+    return run_batch(mgr, mgr->submitted);
+}
+
+uint32_t armv8_job_flush(armv8_job_mgr_t * mgr)
+{
+    uint32_t count = 0;
+    while(mgr->completed < mgr->submitted) {
+        uint64_t end = mgr->completed + mgr->batch_size;
+        count += run_batch(mgr, end < mgr->submitted ? end : mgr->submitted);
+    }
+    return count;
+}
+
+uint32_t armv8_job_get_completed(
+    armv8_job_mgr_t * mgr,
+    armv8_job_t * jobs,
+    uint32_t max_jobs)
+{
+    uint64_t retired = mgr->retired;
+    uint64_t available = __atomic_load_n(&mgr->completed, __ATOMIC_ACQUIRE) - retired;
+    uint32_t count = available < max_jobs ? (uint32_t) available : max_jobs;
+    for( uint32_t i=0; i<count; ++i )
+    {
+        jobs[i] = mgr->jobs[(retired + i) & JOB_RING_MASK];
+    }
+    __atomic_store_n(&mgr->retired, retired + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+#undef JOB_RING_MASK
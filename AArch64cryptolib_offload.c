@@ -0,0 +1,321 @@
+//Copyright (c) 2018-2019, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+#define _GNU_SOURCE
+#include "AArch64cryptolib_private.h"
+
+#include <stdbool.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define OFFLOAD_QUEUE_MASK      (ARMV8_OFFLOAD_QUEUE_SIZE - 1)
+#define OFFLOAD_SPIN_POLLS      4096
+
+// Bounded multi producer queue after Vyukov - a slot is free for the producer claiming position pos when its sequence
+// is pos, and holds a request for the worker at position pos when its sequence is pos + 1
+typedef struct offload_slot {
+    uint64_t sequence;
+    armv8_offload_request_t * request;
+    uint32_t part;
+} offload_slot_t;
+
+typedef struct __attribute__((aligned(64))) offload_worker {
+    uint64_t tail;                                  // next position for producers to claim
+    uint64_t head __attribute__((aligned(64)));     // next position for the worker, only it touches head
+    uint32_t sleeping __attribute__((aligned(64))); // futex word, 1 while the worker is (about to be) asleep
+    uint32_t stop;
+    pthread_t thread;
+    offload_slot_t slots[ARMV8_OFFLOAD_QUEUE_SIZE];
+} offload_worker_t;
+
+struct offload_pool {
+    uint32_t worker_count;
+    uint32_t next_worker;
+    offload_worker_t * workers;
+};
+
+static void futex_wait(uint32_t * word, uint32_t value)
+{
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+static void futex_wake(uint32_t * word)
+{
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+static void offload_wake(offload_worker_t * worker)
+{
+    // pairs with the fence in the worker before it sleeps - either it sees the new request, or we see it sleeping
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&worker->sleeping, __ATOMIC_RELAXED) &&
+       __atomic_exchange_n(&worker->sleeping, 0, __ATOMIC_RELAXED)) {
+        futex_wake(&worker->sleeping);
+    }
+}
+
+static bool offload_enqueue(offload_worker_t * worker, armv8_offload_request_t * request, uint32_t part)
+{
+    uint64_t pos = __atomic_load_n(&worker->tail, __ATOMIC_RELAXED);
+    offload_slot_t * slot;
+    for(;;) {
+        slot = &worker->slots[pos & OFFLOAD_QUEUE_MASK];
+        int64_t diff = (int64_t) (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - pos);
+        if(diff == 0) {
+            if(__atomic_compare_exchange_n(&worker->tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if(diff < 0) {
+            return false;   // the worker hasn't taken the request a lap ago yet - full
+        } else {
+            pos = __atomic_load_n(&worker->tail, __ATOMIC_RELAXED);
+        }
+    }
+    slot->request = request;
+    slot->part = part;
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+    offload_wake(worker);
+    return true;
+}
+
+// Try the workers in turn from first
+static bool offload_enqueue_any(armv8_offload_pool_t * pool, uint32_t first, armv8_offload_request_t * request,
+                                uint32_t part)
+{
+    for( uint32_t i=0; i<pool->worker_count; ++i )
+    {
+        if(offload_enqueue(&pool->workers[(first + i) % pool->worker_count], request, part)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void offload_complete(armv8_offload_request_t * request)
+{
+    armv8_offload_callback_t callback = request->callback;
+    int eventfd = request->eventfd;
+    __atomic_store_n(&request->done, 1, __ATOMIC_RELEASE);
+    if(callback) {
+        callback(request);
+    }
+    if(eventfd >= 0) {
+        uint64_t count = 1;
+        while(write(eventfd, &count, sizeof(count)) < 0 && errno == EINTR);
+    }
+}
+
+// One counter range of a split AES-GCM job - the ciphertext is hashed before an in place decryption overwrites it
+static void offload_run_part(armv8_offload_request_t * request, uint32_t part)
+{
+    armv8_job_t * job = &request->job;
+    uint64_t offset = part * request->part_byte_length;
+    uint64_t byte_length = (job->gcm.bit_length >> 3) - offset;
+    if(byte_length > request->part_byte_length) byte_length = request->part_byte_length;
+
+    armv8_operation_result_t result;
+    if(job->type == ARMV8_JOB_AES_GCM_ENC) {
+        result = armv8_enc_aes_gcm_range(&request->cs, offset*8, job->gcm.input + offset, byte_length*8,
+                                         job->gcm.output + offset);
+        result |= armv8_aes_gcm_ghash_segment(job->gcm.cc, job->gcm.output + offset, byte_length*8,
+                                              &request->segments[part]);
+    } else {
+        result = armv8_aes_gcm_ghash_segment(job->gcm.cc, job->gcm.input + offset, byte_length*8,
+                                             &request->segments[part]);
+        result |= armv8_dec_aes_gcm_range(&request->cs, offset*8, job->gcm.input + offset, byte_length*8,
+                                          job->gcm.output + offset);
+    }
+    if(result != SUCCESSFUL_OPERATION) {
+        __atomic_or_fetch(&request->parts_result, result, __ATOMIC_RELAXED);
+    }
+    // the last part to finish sees every other part's segment
+    if(__atomic_sub_fetch(&request->parts_pending, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    result = __atomic_load_n(&request->parts_result, __ATOMIC_RELAXED);
+    if(result == SUCCESSFUL_OPERATION) {
+        result = job->type == ARMV8_JOB_AES_GCM_ENC ?
+            armv8_aes_gcm_tag_segments(&request->cs, job->gcm.aad, job->gcm.aad_bit_length,
+                                       request->segments, request->parts, job->gcm.tag) :
+            armv8_aes_gcm_verify_segments(&request->cs, job->gcm.aad, job->gcm.aad_bit_length,
+                                          request->segments, request->parts, job->gcm.tag);
+    }
+    job->result = result;
+    offload_complete(request);
+}
+
+static void offload_run(armv8_offload_request_t * request, uint32_t part)
+{
+    if(request->parts > 1) {
+        offload_run_part(request, part);
+        return;
+    }
+    armv8_job_run(&request->job);
+    offload_complete(request);
+}
+
+static bool offload_take(offload_worker_t * worker, armv8_offload_request_t ** request, uint32_t * part)
+{
+    offload_slot_t * slot = &worker->slots[worker->head & OFFLOAD_QUEUE_MASK];
+    if(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != worker->head + 1) {
+        return false;
+    }
+    *request = slot->request;
+    *part = slot->part;
+    __atomic_store_n(&slot->sequence, worker->head + ARMV8_OFFLOAD_QUEUE_SIZE, __ATOMIC_RELEASE);
+    worker->head++;
+    return true;
+}
+
+static void * offload_worker_main(void * arg)
+{
+    offload_worker_t * worker = arg;
+    armv8_offload_request_t * request;
+    uint32_t part, idle = 0;
+    for(;;) {
+        if(offload_take(worker, &request, &part)) {
+            offload_run(request, part);
+            idle = 0;
+            continue;
+        }
+        if(__atomic_load_n(&worker->stop, __ATOMIC_ACQUIRE)) {
+            return NULL;
+        }
+        if(++idle < OFFLOAD_SPIN_POLLS) {
+            __asm__ __volatile__("yield" : : : "memory");
+            continue;
+        }
+        __atomic_store_n(&worker->sleeping, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        offload_slot_t * slot = &worker->slots[worker->head & OFFLOAD_QUEUE_MASK];
+        if(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) == worker->head + 1 ||
+           __atomic_load_n(&worker->stop, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&worker->sleeping, 0, __ATOMIC_RELAXED);
+            continue;
+        }
+        futex_wait(&worker->sleeping, 1);
+        __atomic_store_n(&worker->sleeping, 0, __ATOMIC_RELAXED);
+        idle = 0;
+    }
+}
+
+static void offload_stop(armv8_offload_pool_t * pool, uint32_t started)
+{
+    for( uint32_t i=0; i<started; ++i )
+    {
+        __atomic_store_n(&pool->workers[i].stop, 1, __ATOMIC_RELEASE);
+        offload_wake(&pool->workers[i]);
+    }
+    for( uint32_t i=0; i<started; ++i )
+    {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    free(pool->workers);
+    free(pool);
+}
+
+armv8_operation_result_t armv8_offload_create(
+    uint32_t worker_count,
+    const int32_t * cpus,
+    armv8_offload_pool_t ** pool)
+{
+    if(worker_count == 0 || worker_count > ARMV8_OFFLOAD_MAX_WORKERS) {
+        return INVALID_PARAMETER;
+    }
+    armv8_offload_pool_t * p = calloc(1, sizeof(*p));
+    void * workers = NULL;
+    if(p == NULL || posix_memalign(&workers, 64, worker_count * sizeof(offload_worker_t)) != 0) {
+        free(p);
+        return INTERNAL_FAILURE;
+    }
+    memset(workers, 0, worker_count * sizeof(offload_worker_t));
+    p->workers = workers;
+    p->worker_count = worker_count;
+
+    for( uint32_t i=0; i<worker_count; ++i )
+    {
+        offload_worker_t * worker = &p->workers[i];
+        for( uint32_t s=0; s<ARMV8_OFFLOAD_QUEUE_SIZE; ++s )
+        {
+            worker->slots[s].sequence = s;
+        }
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if(cpus) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if(cpus[i] < 0 || cpus[i] >= CPU_SETSIZE) {
+                pthread_attr_destroy(&attr);
+                offload_stop(p, i);
+                return INVALID_PARAMETER;
+            }
+            CPU_SET(cpus[i], &set);
+            pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+        }
+        int error = pthread_create(&worker->thread, &attr, offload_worker_main, worker);
+        pthread_attr_destroy(&attr);
+        if(error) {
+            offload_stop(p, i);
+            return error == EINVAL ? INVALID_PARAMETER : INTERNAL_FAILURE;
+        }
+    }
+    *pool = p;
+    return SUCCESSFUL_OPERATION;
+}
+
+void armv8_offload_destroy(armv8_offload_pool_t * pool)
+{
+    offload_stop(pool, pool->worker_count);
+}
+
+armv8_operation_result_t armv8_offload_submit(
+    armv8_offload_pool_t * pool,
+    armv8_offload_request_t * request)
+{
+    armv8_job_t * job = &request->job;
+    if(job->type > ARMV8_JOB_AES_CBC_SHA256_DEC) {
+        return INVALID_PARAMETER;
+    }
+    uint32_t parts = 1;
+    if((job->type == ARMV8_JOB_AES_GCM_ENC || job->type == ARMV8_JOB_AES_GCM_DEC) && pool->worker_count > 1 &&
+       (job->gcm.bit_length & 7) == 0 && (job->gcm.bit_length >> 3) >= 2 * (uint64_t) ARMV8_OFFLOAD_SPLIT_MIN_BYTES) {
+        uint64_t byte_length = job->gcm.bit_length >> 3;
+        uint64_t split = byte_length / ARMV8_OFFLOAD_SPLIT_MIN_BYTES;
+        if(split > pool->worker_count) split = pool->worker_count;
+        if(split > ARMV8_OFFLOAD_MAX_PARTS) split = ARMV8_OFFLOAD_MAX_PARTS;
+        // whole blocks in every part but the last
+        request->part_byte_length = ((byte_length + split - 1) / split + 15) & ~15ull;
+        parts = (uint32_t) ((byte_length + request->part_byte_length - 1) / request->part_byte_length);
+        request->cs = (armv8_cipher_state_t) { .constants = job->gcm.cc };
+        armv8_operation_result_t result = armv8_aes_gcm_set_counter(job->gcm.nonce, job->gcm.nonce_bit_length,
+                                                                    &request->cs);
+        if(result != SUCCESSFUL_OPERATION) {
+            return result;
+        }
+    }
+    request->done = 0;
+    request->parts = parts;
+    request->parts_pending = parts;
+    request->parts_result = SUCCESSFUL_OPERATION;
+
+    // once the last part is queued the request may complete at any time, so it isn't read again here
+    uint32_t first = __atomic_fetch_add(&pool->next_worker, 1, __ATOMIC_RELAXED) % pool->worker_count;
+    if(!offload_enqueue_any(pool, first, request, 0)) {
+        return INTERNAL_FAILURE;
+    }
+    for( uint32_t part=1; part<parts; ++part )
+    {
+        if(!offload_enqueue_any(pool, first + part, request, part)) {
+            offload_run(request, part);
+        }
+    }
+    return SUCCESSFUL_OPERATION;
+}
+
+#undef OFFLOAD_QUEUE_MASK
+#undef OFFLOAD_SPIN_POLLS
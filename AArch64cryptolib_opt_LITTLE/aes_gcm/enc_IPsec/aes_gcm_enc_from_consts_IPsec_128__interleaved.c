@@ -289,10 +289,10 @@ static operation_result_t encrypt_from_constants_IPsec_128(
         "       ldp     "rk10_l", "rk10_h", [%[cc], #160]                   \n" // load rk10
         "       aese    "ctr0b", "rk5"   \n  aesmc   "ctr0b", "ctr0b"       \n" // AES final+1 block - round 5
 
-        "       ldr     "h1q", [%[cc], #240]                                \n" // load h1l | h1h
-        "       ldr     "h2q", [%[cc], #256]                                \n" // load h2l | h2h
-        "       ldr     "h3q", [%[cc], #272]                                \n" // load h3l | h3h
-        "       ldr     "h4q", [%[cc], #288]                                \n" // load h4l | h4h
+        "       ldr     "h1q", [%[cc], #" IPSEC_HASH_KEYS "]                \n" // load h1l | h1h
+        "       ldr     "h2q", [%[cc], #(" IPSEC_HASH_KEYS "+16)]           \n" // load h2l | h2h
+        "       ldr     "h3q", [%[cc], #(" IPSEC_HASH_KEYS "+32)]           \n" // load h3l | h3h
+        "       ldr     "h4q", [%[cc], #(" IPSEC_HASH_KEYS "+48)]           \n" // load h4l | h4h
         "       mov     "h1kd", "h1".d[1]                                   \n" // mov   -  | h1l
         "       mov     "h2kd", "h2".d[1]                                   \n" // mov   -  | h2l
         "       mov     "h3kd", "h3".d[1]                                   \n" // mov   -  | h3l
@@ -293,7 +293,7 @@ v28-v31 various temps
 // Given a set up cipher_constants_t and the IPsec salt and ESPIV, perform decryption in place and checksum on the produced plaintext
 static operation_result_t decrypt_from_constants_IPsec_128(
     //Inputs
-    const armv8_cipher_constants_t * cc,
+    const cipher_constants_t * cc,
     uint32_t salt,
     uint64_t ESPIV,
     const uint8_t * restrict aad, uint64_t aad_byte_length,
@@ -400,7 +400,7 @@ static operation_result_t decrypt_from_constants_IPsec_128(
 
 // cycle 12
 "       aese    "res0b", "rk1"   \n  aesmc   "res0b", "res0b"       \n" // AES block final+1 - round 1
-"       ldr     "h1q", [%[cc], #240]                                \n" // load h1l | h1h
+"       ldr     "h1q", [%[cc], #" IPSEC_HASH_KEYS "]                \n" // load h1l | h1h
 
 // cycle 13
 "       ldr     "rk2q", [%[cc], #32]                                \n" // load rk2
@@ -412,7 +412,7 @@ static operation_result_t decrypt_from_constants_IPsec_128(
 
 // cycle 15
 "       aese    "ctr1b", "rk0"   \n  aesmc   "ctr1b", "ctr1b"       \n" // AES block 1 - round 0
-"       ldr     "h2q", [%[cc], #256]                                \n" // load h2l | h2h
+"       ldr     "h2q", [%[cc], #(" IPSEC_HASH_KEYS "+16)]           \n" // load h2l | h2h
 
 // cycle 16
 "       aese    "ctr2b", "rk0"   \n  aesmc   "ctr2b", "ctr2b"       \n" // AES block 2 - round 0
@@ -427,11 +427,11 @@ static operation_result_t decrypt_from_constants_IPsec_128(
 "       ldr     "rk4q", [%[cc], #64]                                \n" // load rk4
 
 // cycle 19
-"       ldr     "h4q", [%[cc], #288]                                \n" // load h4l | h4h
+"       ldr     "h4q", [%[cc], #(" IPSEC_HASH_KEYS "+48)]           \n" // load h4l | h4h
 "       trn1    "t0".2d,    "h1".2d,    "h2".2d                     \n" // h2h | h1h
 
 // cycle 20
-"       ldr     "h3q", [%[cc], #272]                                \n" // load h3l | h3h
+"       ldr     "h3q", [%[cc], #(" IPSEC_HASH_KEYS "+32)]           \n" // load h3l | h3h
 "       trn2    "h12k".2d,  "h1".2d,    "h2".2d                     \n" // h2l | h1l
 
 // cycle 21
@@ -293,7 +293,7 @@ v28-v31 various temps
 // Given a set up cipher_constants_t and the IPsec salt and ESPIV, perform decryption in place and checksum on the produced plaintext
 static operation_result_t decrypt_from_constants_IPsec_128(
     //Inputs
-    const armv8_cipher_constants_t * cc,
+    const cipher_constants_t * cc,
     uint32_t salt,
     uint64_t ESPIV,
     const uint8_t * restrict aad, uint64_t aad_byte_length,
@@ -391,10 +391,10 @@ static operation_result_t decrypt_from_constants_IPsec_128(
         "       ldr     "rk9q", [%[cc], #144]                               \n" // load rk9
         "       ldp     "rk10_l", "rk10_h", [%[cc], #160]                   \n" // load rk10
 
-        "       ldr     "h1q", [%[cc], #240]                                \n" // load h1l | h1h
-        "       ldr     "h2q", [%[cc], #256]                                \n" // load h2l | h2h
-        "       ldr     "h3q", [%[cc], #272]                                \n" // load h3l | h3h
-        "       ldr     "h4q", [%[cc], #288]                                \n" // load h4l | h4h
+        "       ldr     "h1q", [%[cc], #" IPSEC_HASH_KEYS "]                \n" // load h1l | h1h
+        "       ldr     "h2q", [%[cc], #(" IPSEC_HASH_KEYS "+16)]           \n" // load h2l | h2h
+        "       ldr     "h3q", [%[cc], #(" IPSEC_HASH_KEYS "+32)]           \n" // load h3l | h3h
+        "       ldr     "h4q", [%[cc], #(" IPSEC_HASH_KEYS "+48)]           \n" // load h4l | h4h
         "       trn1    "t0".2d,    "h1".2d,    "h2".2d                     \n" // h2h | h1h
         "       trn2    "h12k".2d,  "h1".2d,    "h2".2d                     \n" // h2l | h1l
         "       eor     "h12k".16b, "h12k".16b, "t0".16b                    \n" // h2k | h1k
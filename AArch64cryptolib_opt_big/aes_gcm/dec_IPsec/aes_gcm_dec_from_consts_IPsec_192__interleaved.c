@@ -301,7 +301,7 @@ v30-v31 various temps
 // Given a set up cipher_constants_t and the IPsec salt and ESPIV, perform decryption in place and checksum on the produced plaintext
 static operation_result_t decrypt_from_constants_IPsec_192(
     //Inputs
-    const armv8_cipher_constants_t * cc,
+    const cipher_constants_t * cc,
     uint32_t salt,
     uint64_t ESPIV,
     const uint8_t * restrict aad, uint64_t aad_byte_length,
@@ -427,7 +427,7 @@ static operation_result_t decrypt_from_constants_IPsec_192(
 
 // cycle 17
 "       aese    "ctr3b", "rk0"   \n  aesmc   "ctr3b", "ctr3b"       \n" // AES block 3 - round 0
-"       ldr     "h3q", [%[cc], #272]                                \n" // load h3l | h3h
+"       ldr     "h3q", [%[cc], #(" IPSEC_HASH_KEYS "+32)]           \n" // load h3l | h3h
 
 // cycle 18
 "       aese    "res0b", "rk2"   \n  aesmc   "res0b", "res0b"       \n" // AES block final+1 - round 2
@@ -439,18 +439,18 @@ static operation_result_t decrypt_from_constants_IPsec_192(
 
 // cycle 20
 "       aese    "ctr1b", "rk1"   \n  aesmc   "ctr1b", "ctr1b"       \n" // AES block 1 - round 1
-"       ldr     "h1q", [%[cc], #240]                                \n" // load h1l | h1h
+"       ldr     "h1q", [%[cc], #" IPSEC_HASH_KEYS "]                \n" // load h1l | h1h
 
 // cycle 21
 "       aese    "res0b", "rk3"   \n  aesmc   "res0b", "res0b"       \n" // AES block final+1 - round 3
-"       ldr     "h2q", [%[cc], #256]                                \n" // load h2l | h2h
+"       ldr     "h2q", [%[cc], #(" IPSEC_HASH_KEYS "+16)]           \n" // load h2l | h2h
 
 // cycle 22
 "       aese    "ctr3b", "rk1"   \n  aesmc   "ctr3b", "ctr3b"       \n" // AES block 3 - round 1
 "       rev64   "res1b", "res1b"                                    \n" // GHASH aad block
 
 // cycle 23
-"       ldr     "h4q", [%[cc], #288]                                \n" // load h4l | h4h
+"       ldr     "h4q", [%[cc], #(" IPSEC_HASH_KEYS "+48)]           \n" // load h4l | h4h
 "       sub     "main_end_input_ptr", "main_end_input_ptr", #1      \n" // byte_len - 1
 
 // cycle 24
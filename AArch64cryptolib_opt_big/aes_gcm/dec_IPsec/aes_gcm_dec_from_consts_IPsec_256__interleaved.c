@@ -308,7 +308,7 @@ v18-v31 Constant AES round keys (only need 10 for 128b AES, but reserving 4 more
 // Given a set up cipher_constants_t and the IPsec salt and ESPIV, perform decryption in place and checksum on the produced plaintext
 static operation_result_t decrypt_from_constants_IPsec_256(
     //Inputs
-    const armv8_cipher_constants_t * cc,
+    const cipher_constants_t * cc,
     uint32_t salt,
     uint64_t ESPIV,
     const uint8_t * restrict aad, uint64_t aad_byte_length,
@@ -424,11 +424,11 @@ static operation_result_t decrypt_from_constants_IPsec_256(
 
 // cycle 15
 "       aese    "ctr0b", "rk0"   \n  aesmc   "ctr0b", "ctr0b"       \n" // AES block 0 - round 0
-"       ldr     "h2q", [%[cc], #256]                                \n" // load h2l | h2h
+"       ldr     "h2q", [%[cc], #(" IPSEC_HASH_KEYS "+16)]           \n" // load h2l | h2h
 
 // cycle 16
 "       aese    "res0b", "rk2"   \n  aesmc   "res0b", "res0b"       \n" // AES block final+1 - round 2
-"       ldr     "h1q", [%[cc], #240]                                \n" // load h1l | h1h
+"       ldr     "h1q", [%[cc], #" IPSEC_HASH_KEYS "]                \n" // load h1l | h1h
 
 // cycle 17
 "       aese    "ctr3b", "rk0"   \n  aesmc   "ctr3b", "ctr3b"       \n" // AES block 3 - round 0
@@ -451,7 +451,7 @@ static operation_result_t decrypt_from_constants_IPsec_256(
 
 // cycle 22
 "       aese    "ctr0b", "rk2"   \n  aesmc   "ctr0b", "ctr0b"       \n" // AES block 0 - round 2
-"       ldr     "h3q", [%[cc], #272]                                \n" // load h3l | h3h
+"       ldr     "h3q", [%[cc], #(" IPSEC_HASH_KEYS "+32)]           \n" // load h3l | h3h
 
 // cycle 23
 "       aese    "ctr1b", "rk2"   \n  aesmc   "ctr1b", "ctr1b"       \n" // AES block 1 - round 2
@@ -459,7 +459,7 @@ static operation_result_t decrypt_from_constants_IPsec_256(
 
 // cycle 24
 "       aese    "ctr2b", "rk1"   \n  aesmc   "ctr2b", "ctr2b"       \n" // AES block 2 - round 1
-"       ldr     "h4q", [%[cc], #288]                                \n" // load h4l | h4h
+"       ldr     "h4q", [%[cc], #(" IPSEC_HASH_KEYS "+48)]           \n" // load h4l | h4h
 
 // cycle 25
 "       aese    "ctr0b", "rk3"   \n  aesmc   "ctr0b", "ctr0b"       \n" // AES block 0 - round 3
@@ -308,7 +308,7 @@ v18-v31 Constant AES round keys (only need 10 for 128b AES, but reserving 4 more
 // Given a set up cipher_constants_t and the IPsec salt and ESPIV, perform decryption in place and checksum on the produced plaintext
 static operation_result_t decrypt_from_constants_IPsec_256(
     //Inputs
-    const armv8_cipher_constants_t * cc,
+    const cipher_constants_t * cc,
     uint32_t salt,
     uint64_t ESPIV,
     const uint8_t * restrict aad, uint64_t aad_byte_length,
@@ -410,10 +410,10 @@ static operation_result_t decrypt_from_constants_IPsec_256(
         "       ldr     "rk13q", [%[cc], #208]                              \n" // load rk13
         "       ldp     "rk14_l", "rk14_h", [%[cc], #224]                   \n" // load rk14
 
-        "       ldr     "h1q", [%[cc], #240]                                \n" // load h1l | h1h
-        "       ldr     "h2q", [%[cc], #256]                                \n" // load h2l | h2h
-        "       ldr     "h3q", [%[cc], #272]                                \n" // load h3l | h3h
-        "       ldr     "h4q", [%[cc], #288]                                \n" // load h4l | h4h
+        "       ldr     "h1q", [%[cc], #" IPSEC_HASH_KEYS "]                \n" // load h1l | h1h
+        "       ldr     "h2q", [%[cc], #(" IPSEC_HASH_KEYS "+16)]           \n" // load h2l | h2h
+        "       ldr     "h3q", [%[cc], #(" IPSEC_HASH_KEYS "+32)]           \n" // load h3l | h3h
+        "       ldr     "h4q", [%[cc], #(" IPSEC_HASH_KEYS "+48)]           \n" // load h4l | h4h
         "       trn1    "t0".2d,    "h1".2d,    "h2".2d                     \n" // h2h | h1h
         "       trn2    "h12k".2d,  "h1".2d,    "h2".2d                     \n" // h2l | h1l
         "       eor     "h12k".16b, "h12k".16b, "t0".16b                    \n" // h2k | h1k
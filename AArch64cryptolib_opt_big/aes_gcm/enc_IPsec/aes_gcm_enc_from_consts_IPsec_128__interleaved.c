@@ -377,11 +377,11 @@ static operation_result_t encrypt_from_constants_IPsec_128(
 
 // cycle 13
 "       aese    "ctr1b", "rk0"   \n  aesmc   "ctr1b", "ctr1b"       \n" // AES block 1 - round 0
-"       ldr     "h1q", [%[cc], #240]                                \n" // load h1l | h1h
+"       ldr     "h1q", [%[cc], #" IPSEC_HASH_KEYS "]                \n" // load h1l | h1h
 
 // cycle 14
 "       aese    "ctr0b", "rk0"   \n  aesmc   "ctr0b", "ctr0b"       \n" // AES block 0 - round 0
-"       ldr     "h2q", [%[cc], #256]                                \n" // load h2l | h2h
+"       ldr     "h2q", [%[cc], #(" IPSEC_HASH_KEYS "+16)]           \n" // load h2l | h2h
 
 // cycle 15
 "       aese    "res0b", "rk1"   \n  aesmc   "res0b", "res0b"       \n" // AES block final+1 - round 1
@@ -389,11 +389,11 @@ static operation_result_t encrypt_from_constants_IPsec_128(
 
 // cycle 16
 "       aese    "ctr2b", "rk0"   \n  aesmc   "ctr2b", "ctr2b"       \n" // AES block 2 - round 0
-"       ldr     "h4q", [%[cc], #288]                                \n" // load h4l | h4h
+"       ldr     "h4q", [%[cc], #(" IPSEC_HASH_KEYS "+48)]           \n" // load h4l | h4h
 
 // cycle 17
 "       aese    "ctr3b", "rk0"   \n  aesmc   "ctr3b", "ctr3b"       \n" // AES block 3 - round 0
-"       ldr     "h3q", [%[cc], #272]                                \n" // load h3l | h3h
+"       ldr     "h3q", [%[cc], #(" IPSEC_HASH_KEYS "+32)]           \n" // load h3l | h3h
 
 // cycle 18
 "       ldr     "rk3q", [%[cc], #48]                                \n" // load rk3
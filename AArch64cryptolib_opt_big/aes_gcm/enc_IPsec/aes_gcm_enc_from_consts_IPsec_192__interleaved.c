@@ -396,11 +396,11 @@ static operation_result_t encrypt_from_constants_IPsec_192(
 
 // cycle 16
 "       aese    "res0b", "rk2"   \n  aesmc   "res0b", "res0b"       \n" // AES block final+1 - round 2
-"       ldr     "h2q", [%[cc], #256]                                \n" // load h2l | h2h
+"       ldr     "h2q", [%[cc], #(" IPSEC_HASH_KEYS "+16)]           \n" // load h2l | h2h
 
 // cycle 17
 "       aese    "ctr0b", "rk2"   \n  aesmc   "ctr0b", "ctr0b"       \n" // AES block 0 - round 2
-"       ldr     "h1q", [%[cc], #240]                                \n" // load h1l | h1h
+"       ldr     "h1q", [%[cc], #" IPSEC_HASH_KEYS "]                \n" // load h1l | h1h
 
 // cycle 18
 "       aese    "ctr3b", "rk0"   \n  aesmc   "ctr3b", "ctr3b"       \n" // AES block 3 - round 0
@@ -412,7 +412,7 @@ static operation_result_t encrypt_from_constants_IPsec_192(
 
 // cycle 20
 "       aese    "res0b", "rk3"   \n  aesmc   "res0b", "res0b"       \n" // AES block final+1 - round 3
-"       ldr     "h4q", [%[cc], #288]                                \n" // load h4l | h4h
+"       ldr     "h4q", [%[cc], #(" IPSEC_HASH_KEYS "+48)]           \n" // load h4l | h4h
 
 // cycle 21
 "       aese    "ctr3b", "rk1"   \n  aesmc   "ctr3b", "ctr3b"       \n" // AES block 3 - round 1
@@ -420,7 +420,7 @@ static operation_result_t encrypt_from_constants_IPsec_192(
 
 // cycle 22
 "       aese    "ctr2b", "rk2"   \n  aesmc   "ctr2b", "ctr2b"       \n" // AES block 2 - round 2
-"       ldr     "h3q", [%[cc], #272]                                \n" // load h3l | h3h
+"       ldr     "h3q", [%[cc], #(" IPSEC_HASH_KEYS "+32)]           \n" // load h3l | h3h
 
 // cycle 23
 "       aese    "res0b", "rk4"   \n  aesmc   "res0b", "res0b"       \n" // AES block final+1 - round 4
@@ -417,7 +417,7 @@ static operation_result_t encrypt_from_constants_IPsec_256(
 
 // cycle 19
 "       aese    "ctr2b", "rk1"   \n  aesmc   "ctr2b", "ctr2b"       \n" // AES block 2 - round 1
-"       ldr     "h3q", [%[cc], #272]                                \n" // load h3l | h3h
+"       ldr     "h3q", [%[cc], #(" IPSEC_HASH_KEYS "+32)]           \n" // load h3l | h3h
 
 // cycle 20
 "       aese    "res0b", "rk3"   \n  aesmc   "res0b", "res0b"       \n" // AES block final+1 - round 3
@@ -429,7 +429,7 @@ static operation_result_t encrypt_from_constants_IPsec_256(
 
 // cycle 22
 "       aese    "ctr2b", "rk2"   \n  aesmc   "ctr2b", "ctr2b"       \n" // AES block 2 - round 2
-"       ldr     "h4q", [%[cc], #288]                                \n" // load h4l | h4h
+"       ldr     "h4q", [%[cc], #(" IPSEC_HASH_KEYS "+48)]           \n" // load h4l | h4h
 
 // cycle 23
 "       aese    "res0b", "rk4"   \n  aesmc   "res0b", "res0b"       \n" // AES block final+1 - round 4
@@ -437,14 +437,14 @@ static operation_result_t encrypt_from_constants_IPsec_256(
 
 // cycle 24
 "       aese    "ctr3b", "rk2"   \n  aesmc   "ctr3b", "ctr3b"       \n" // AES block 3 - round 2
-"       ldr     "h1q", [%[cc], #240]                                \n" // load h1l | h1h
+"       ldr     "h1q", [%[cc], #" IPSEC_HASH_KEYS "]                \n" // load h1l | h1h
 
 // cycle 25
 "       aese    "ctr1b", "rk2"   \n  aesmc   "ctr1b", "ctr1b"       \n" // AES block 1 - round 2
 "       ldr     "rk8q", [%[cc], #128]                               \n" // load rk8
 
 // cycle 26
-"       ldr     "h2q", [%[cc], #256]                                \n" // load h2l | h2h
+"       ldr     "h2q", [%[cc], #(" IPSEC_HASH_KEYS "+16)]           \n" // load h2l | h2h
 "       rev64   "res1b", "res1b"                                    \n" // GHASH aad block
 "       trn1    "acc_h".2d, "h3".2d,    "h4".2d                     \n" // h4h | h3h
 
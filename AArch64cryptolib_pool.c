@@ -0,0 +1,313 @@
+//Copyright (c) 2018-2019, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+#define _GNU_SOURCE
+#include "AArch64cryptolib_private.h"
+
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#define HUGEPAGE_SIZE       (2u << 20)
+#define CONTEXT_ALIGN       64u
+#define MAX_NUMA_NODES      1024
+#define MPOL_BIND           2
+#define CACHE_BATCH         ((ARMV8_CTX_POOL_CACHE_HANDLES + 1) / 2)
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB        (21 << 26)
+#endif
+
+// Index of the calling thread's free list in every pool, assigned on first use (0 means not yet assigned)
+// Indices are returned to ctx_pool_free_indices when their thread exits, so thread churn doesn't use them up. A
+// recycled index comes with whatever contexts the exited thread left in its free lists. Once its index is released, an
+// exiting thread uses the shared free list, as its other TLS destructors may still call into the pools
+static pthread_once_t ctx_pool_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ctx_pool_key;
+static pthread_mutex_t ctx_pool_index_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t ctx_pool_threads = 0;
+static uint32_t ctx_pool_free_indices[ARMV8_CTX_POOL_MAX_THREADS];
+static uint32_t ctx_pool_free_count = 0;
+static __thread uint32_t ctx_pool_thread_index = 0;
+
+static void release_thread_index(void * value)
+{
+    pthread_mutex_lock(&ctx_pool_index_lock);
+    ctx_pool_free_indices[ctx_pool_free_count++] = (uint32_t) (uintptr_t) value;
+    pthread_mutex_unlock(&ctx_pool_index_lock);
+    ctx_pool_thread_index = ARMV8_CTX_POOL_MAX_THREADS + 1;
+}
+
+static void create_thread_key(void)
+{
+    pthread_key_create(&ctx_pool_key, release_thread_index);
+}
+
+// Threads that find every index in use get ARMV8_CTX_POOL_MAX_THREADS + 1, and use the shared free list directly
+static uint32_t assign_thread_index(void)
+{
+    uint32_t index = ARMV8_CTX_POOL_MAX_THREADS + 1;
+
+    pthread_once(&ctx_pool_key_once, create_thread_key);
+    pthread_mutex_lock(&ctx_pool_index_lock);
+    if(ctx_pool_free_count > 0) {
+        index = ctx_pool_free_indices[--ctx_pool_free_count];
+    } else if(ctx_pool_threads < ARMV8_CTX_POOL_MAX_THREADS) {
+        index = ++ctx_pool_threads;
+    }
+    pthread_mutex_unlock(&ctx_pool_index_lock);
+    if(index <= ARMV8_CTX_POOL_MAX_THREADS) {
+        pthread_setspecific(ctx_pool_key, (void *) (uintptr_t) index);
+    }
+    ctx_pool_thread_index = index;
+    return index;
+}
+
+static inline armv8_ctx_pool_cache_t * thread_cache(armv8_ctx_pool_t * pool)
+{
+    uint32_t index = ctx_pool_thread_index;
+    if(__builtin_expect(index == 0, 0)) {
+        index = assign_thread_index();
+    }
+    return index <= ARMV8_CTX_POOL_MAX_THREADS ? &pool->caches[index - 1] : NULL;
+}
+
+// While a context is free, its first 4 bytes hold the handle of the next free context
+static inline uint32_t * free_link(armv8_ctx_pool_t * pool, armv8_ctx_handle_t handle)
+{
+    return (uint32_t *) armv8_ctx_pool_ptr(pool, handle);
+}
+
+// Shared free list - a Treiber stack, with a tag in the top half of the head bumped on every update to avoid ABA
+static void shared_push(armv8_ctx_pool_t * pool, armv8_ctx_handle_t first, armv8_ctx_handle_t last)
+{
+    uint64_t head = __atomic_load_n(&pool->free_head, __ATOMIC_RELAXED);
+    uint64_t new_head;
+    do {
+        __atomic_store_n(free_link(pool, last), (uint32_t) head, __ATOMIC_RELAXED);
+        new_head = (((head >> 32) + 1) << 32) | first;
+    } while(!__atomic_compare_exchange_n(&pool->free_head, &head, new_head, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static armv8_ctx_handle_t shared_pop(armv8_ctx_pool_t * pool)
+{
+    uint64_t head = __atomic_load_n(&pool->free_head, __ATOMIC_ACQUIRE);
+    uint64_t new_head;
+    do {
+        armv8_ctx_handle_t first = (uint32_t) head;
+        if(first == ARMV8_CTX_HANDLE_INVALID) {
+            return ARMV8_CTX_HANDLE_INVALID;
+        }
+        // the link may be overwritten if first is popped by another thread meanwhile, but then the tag has moved on
+        // and the exchange fails
+        uint32_t next = __atomic_load_n(free_link(pool, first), __ATOMIC_RELAXED);
+        new_head = (((head >> 32) + 1) << 32) | next;
+    } while(!__atomic_compare_exchange_n(&pool->free_head, &head, new_head, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+    return (uint32_t) head;
+}
+
+// Pushes handles[0..count) to the shared free list in one exchange
+static void shared_push_array(armv8_ctx_pool_t * pool, const armv8_ctx_handle_t * handles, uint32_t count)
+{
+    if(count == 0) {
+        return;
+    }
+    for( uint32_t i=0; i+1<count; ++i )
+    {
+        __atomic_store_n(free_link(pool, handles[i]), handles[i+1], __ATOMIC_RELAXED);
+    }
+    shared_push(pool, handles[0], handles[count-1]);
+}
+
+static void * map_pool(size_t byte_length, uint32_t * hugepages, void ** mapping, size_t * mapping_byte_length)
+{
+    void * p = mmap(NULL, byte_length, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+    if(p != MAP_FAILED) {
+        *hugepages = 1;
+        *mapping = p;
+        *mapping_byte_length = byte_length;
+        return p;
+    }
+
+    // No reserved hugepages - over-map to get 2MB alignment so that transparent hugepages can back all of it
+    size_t over_byte_length = byte_length + HUGEPAGE_SIZE;
+    uint8_t * over = mmap(NULL, over_byte_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(over == MAP_FAILED) {
+        return NULL;
+    }
+    uint8_t * aligned = (uint8_t *) (((uintptr_t) over + HUGEPAGE_SIZE - 1) & ~((uintptr_t) HUGEPAGE_SIZE - 1));
+    if(aligned != over) {
+        munmap(over, aligned - over);
+    }
+    if(aligned + byte_length != over + over_byte_length) {
+        munmap(aligned + byte_length, (over + over_byte_length) - (aligned + byte_length));
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, byte_length, MADV_HUGEPAGE);
+#endif
+    *hugepages = 0;
+    *mapping = aligned;
+    *mapping_byte_length = byte_length;
+    return aligned;
+}
+
+static int bind_pool(void * p, size_t byte_length, int32_t numa_node)
+{
+    unsigned long nodemask[MAX_NUMA_NODES / (8 * sizeof(unsigned long))] = { 0 };
+    nodemask[numa_node / (8 * sizeof(unsigned long))] = 1ul << (numa_node % (8 * sizeof(unsigned long)));
+    if(syscall(SYS_mbind, p, byte_length, MPOL_BIND, nodemask, (unsigned long) MAX_NUMA_NODES + 1, 0) == 0) {
+        return 0;
+    }
+    // A kernel without NUMA support only has node 0
+    return (errno == ENOSYS && numa_node == 0) ? 0 : -1;
+}
+
+armv8_operation_result_t armv8_ctx_pool_create(
+    uint32_t context_byte_length,
+    uint32_t capacity,
+    int32_t numa_node,
+    armv8_ctx_pool_t ** pool)
+{
+    *pool = NULL;
+    if(context_byte_length < sizeof(uint32_t) || context_byte_length > (1u << 30) ||
+       capacity == 0 || capacity >= ARMV8_CTX_HANDLE_INVALID ||
+       numa_node < -1 || numa_node >= MAX_NUMA_NODES) {
+        return INVALID_PARAMETER;
+    }
+
+    uint32_t stride = (context_byte_length + CONTEXT_ALIGN - 1) & ~(CONTEXT_ALIGN - 1);
+    size_t byte_length = ((size_t) stride * capacity + HUGEPAGE_SIZE - 1) & ~((size_t) HUGEPAGE_SIZE - 1);
+
+    armv8_ctx_pool_t * p;
+    if(posix_memalign((void **) &p, CONTEXT_ALIGN, sizeof(*p)) != 0) {
+        return INTERNAL_FAILURE;
+    }
+    memset(p, 0, sizeof(*p));
+    p->stride = stride;
+    p->capacity = capacity;
+    p->numa_node = numa_node;
+
+    p->base = map_pool(byte_length, &p->hugepages, &p->mapping, &p->mapping_byte_length);
+    if(p->base == NULL) {
+        free(p);
+        return INTERNAL_FAILURE;
+    }
+    if(numa_node >= 0 && bind_pool(p->mapping, p->mapping_byte_length, numa_node) != 0) {
+        munmap(p->mapping, p->mapping_byte_length);
+        free(p);
+        return INVALID_PARAMETER;
+    }
+
+    // Fault everything in now, on the bound node, and chain all contexts into the shared free list in order
+    memset(p->base, 0, byte_length);
+    for( uint32_t i=0; i<capacity; ++i )
+    {
+        *free_link(p, i) = (i + 1 < capacity) ? i + 1 : ARMV8_CTX_HANDLE_INVALID;
+    }
+    p->free_head = 0;
+
+    *pool = p;
+    return SUCCESSFUL_OPERATION;
+}
+
+void armv8_ctx_pool_destroy(armv8_ctx_pool_t * pool)
+{
+    if(pool == NULL) {
+        return;
+    }
+    munmap(pool->mapping, pool->mapping_byte_length);
+    free(pool);
+}
+
+armv8_operation_result_t armv8_ctx_pool_alloc(
+    armv8_ctx_pool_t * pool,
+    armv8_ctx_handle_t * handle)
+{
+    armv8_ctx_pool_cache_t * cache = thread_cache(pool);
+    if(cache == NULL) {
+        *handle = shared_pop(pool);
+        return *handle == ARMV8_CTX_HANDLE_INVALID ? INTERNAL_FAILURE : SUCCESSFUL_OPERATION;
+    }
+
+    if(cache->count == 0) {
+        // Refill half of the thread's free list, so that alternating alloc and free stays local
+        while(cache->count < CACHE_BATCH) {
+            armv8_ctx_handle_t h = shared_pop(pool);
+            if(h == ARMV8_CTX_HANDLE_INVALID) {
+                break;
+            }
+            cache->handles[cache->count++] = h;
+        }
+        if(cache->count == 0) {
+            *handle = ARMV8_CTX_HANDLE_INVALID;
+            return INTERNAL_FAILURE;
+        }
+    }
+    *handle = cache->handles[--cache->count];
+    return SUCCESSFUL_OPERATION;
+}
+
+void armv8_ctx_pool_free(
+    armv8_ctx_pool_t * pool,
+    armv8_ctx_handle_t handle)
+{
+    armv8_ctx_pool_cache_t * cache = thread_cache(pool);
+    if(cache == NULL) {
+        shared_push(pool, handle, handle);
+        return;
+    }
+
+    if(cache->count == ARMV8_CTX_POOL_CACHE_HANDLES) {
+        // Spill the oldest half, keeping the most recently freed (and most likely cached) contexts local
+        shared_push_array(pool, cache->handles, CACHE_BATCH);
+        memmove(cache->handles, cache->handles + CACHE_BATCH,
+                (ARMV8_CTX_POOL_CACHE_HANDLES - CACHE_BATCH) * sizeof(armv8_ctx_handle_t));
+        cache->count -= CACHE_BATCH;
+    }
+    cache->handles[cache->count++] = handle;
+}
+
+void armv8_ctx_pool_flush(armv8_ctx_pool_t * pool)
+{
+    armv8_ctx_pool_cache_t * cache = thread_cache(pool);
+    if(cache == NULL) {
+        return;
+    }
+    shared_push_array(pool, cache->handles, cache->count);
+    cache->count = 0;
+}
+
+armv8_operation_result_t armv8_ctx_pool_alloc_constants(
+    armv8_ctx_pool_t * pool,
+    armv8_cipher_mode_t mode,
+    uint8_t tag_byte_length,
+    uint8_t * restrict key,
+    armv8_ctx_handle_t * handle)
+{
+    if(pool->stride < sizeof(armv8_cipher_constants_t)) {
+        *handle = ARMV8_CTX_HANDLE_INVALID;
+        return INVALID_PARAMETER;
+    }
+    armv8_operation_result_t result = armv8_ctx_pool_alloc(pool, handle);
+    if(result != SUCCESSFUL_OPERATION) {
+        return result;
+    }
+    result = armv8_aes_gcm_set_constants(mode, tag_byte_length, key, armv8_ctx_pool_ptr(pool, *handle));
+    if(result != SUCCESSFUL_OPERATION) {
+        armv8_ctx_pool_free(pool, *handle);
+        *handle = ARMV8_CTX_HANDLE_INVALID;
+    }
+    return result;
+}
+
+#undef HUGEPAGE_SIZE
+#undef CONTEXT_ALIGN
+#undef MAX_NUMA_NODES
+#undef MPOL_BIND
+#undef CACHE_BATCH
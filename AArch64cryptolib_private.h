@@ -24,5 +24,113 @@ int asm_sha1_hmac_aes128cbc_dec(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
 int asm_sha256_hmac_aes128cbc_dec(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
 			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
 			armv8_cipher_digest_t *arg);
+int asm_aes192cbc_sha1_hmac(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+int asm_aes192cbc_sha256_hmac(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+int asm_sha1_hmac_aes192cbc_dec(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+int asm_sha256_hmac_aes192cbc_dec(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+int asm_aes256cbc_sha1_hmac(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+int asm_aes256cbc_sha256_hmac(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+int asm_sha1_hmac_aes256cbc_dec(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+int asm_sha256_hmac_aes256cbc_dec(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+			uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+			armv8_cipher_digest_t *arg);
+
+/*
+ * Job queue - run one job on the calling thread, setting job->result. Shared by the job manager and
+ * the worker thread offload pool.
+ */
+void armv8_job_run(armv8_job_t *job);
+
+#ifdef ARMV8_JOB_GCM_LANES_ENABLED
+/*
+ * Run 2 to ARMV8_JOB_GCM_LANES AES-GCM jobs with constants of the same key size interleaved, setting each
+ * job->result as armv8_job_run would. Every job is ARMV8_JOB_AES_GCM_ENC or _DEC with a 96 bit nonce, at most
+ * ARMV8_JOB_GCM_LANE_MAX_BYTES of data and whole bytes of AAD and data.
+ */
+void armv8_job_run_gcm_lanes(armv8_job_t * const * jobs, uint32_t count);
+#endif
+
+/*
+ * Runtime statistics - each thread counts into its own block, registered with the library on
+ * first use, so the entry points only do plain loads and stores. The stores are relaxed atomics
+ * so that armv8_crypto_stats_snapshot can read them from another thread without tearing.
+ * With ARMV8_CRYPTO_STATS undefined, STATS_RECORD is just the result and nothing is counted.
+ */
+#ifdef ARMV8_CRYPTO_STATS
+typedef struct crypto_thread_stats {
+	armv8_crypto_stats_t counters;
+	struct crypto_thread_stats *next;
+	struct crypto_thread_stats *prev;
+	int registered;
+} crypto_thread_stats_t;
+
+extern __thread crypto_thread_stats_t armv8_thread_stats;
+void armv8_crypto_stats_register(crypto_thread_stats_t *stats);
+
+#define STATS_ADD(counter, value) \
+	__atomic_store_n(&(counter), (counter) + (value), __ATOMIC_RELAXED)
+
+static inline int armv8_crypto_stats_record(armv8_crypto_stats_op_t op,
+			uint64_t bytes, int generic, int result)
+{
+	crypto_thread_stats_t *stats = &armv8_thread_stats;
+
+	if (__builtin_expect(!stats->registered, 0))
+		armv8_crypto_stats_register(stats);
+	STATS_ADD(stats->counters.calls[op], 1);
+	STATS_ADD(stats->counters.bytes[op], bytes);
+	if (bytes & 15)
+		STATS_ADD(stats->counters.tail_calls[op], 1);
+	if (generic)
+		STATS_ADD(stats->counters.generic_calls[op], 1);
+	if (result == AUTHENTICATION_FAILURE)
+		STATS_ADD(stats->counters.auth_failures[op], 1);
+	else if (result != SUCCESSFUL_OPERATION)
+		STATS_ADD(stats->counters.errors[op], 1);
+	return result;
+}
+
+#define STATS_RECORD(op, bytes, generic, result) \
+	armv8_crypto_stats_record((op), (bytes), (generic), (result))
+#else
+#define STATS_RECORD(op, bytes, generic, result) (result)
+#endif
+
+/*
+ * USDT probes - with ARMV8_CRYPTO_USDT defined, each public C function has a <name>_entry probe
+ * in provider aarch64cryptolib carrying its mode and lengths, and a <name>_exit probe carrying the
+ * result. An unused probe is a single nop, and its arguments are only read when a tracer is attached.
+ */
+#ifdef ARMV8_CRYPTO_USDT
+#include <sys/sdt.h>
+
+#define TRACE_ENTRY(name, ...) \
+	STAP_PROBEV(aarch64cryptolib, name##_entry, __VA_ARGS__)
+#define TRACE_EXIT(name, result) \
+	({ int trace_result = (result); \
+	   STAP_PROBE1(aarch64cryptolib, name##_exit, trace_result); \
+	   trace_result; })
+#else
+#define TRACE_ENTRY(name, ...) do { } while(0)
+#define TRACE_EXIT(name, result) (result)
+#endif
+
+/* Return from a public function, counting it in the statistics and firing its exit probe */
+#define API_RETURN(name, op, bytes, generic, result) \
+	TRACE_EXIT(name, STATS_RECORD(op, bytes, generic, result))
 
 #endif
\ No newline at end of file
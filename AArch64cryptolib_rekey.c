@@ -0,0 +1,111 @@
+//Copyright (c) 2018-2019, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+#include "AArch64cryptolib_private.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+// Zero a slot in a way the compiler can't drop as a dead store
+static void scrub_constants(armv8_cipher_constants_t * cc)
+{
+    memset(cc, 0, sizeof(*cc));
+    __asm__ __volatile__("" : : "r" (cc) : "memory");
+}
+
+armv8_operation_result_t armv8_rekey_init(
+    armv8_rekey_handle_t * handle,
+    armv8_cipher_mode_t mode,
+    uint8_t tag_byte_length,
+    uint8_t * restrict key)
+{
+    memset(handle, 0, sizeof(*handle));
+    for( uint32_t i=0; i<ARMV8_REKEY_MAX_READERS; ++i )
+    {
+        handle->readers[i].epoch = ARMV8_REKEY_OFFLINE;
+    }
+    handle->epoch = 1;
+    return armv8_aes_gcm_set_constants(mode, tag_byte_length, key, &handle->slots[0]);
+}
+
+armv8_operation_result_t armv8_rekey_set(
+    armv8_rekey_handle_t * handle,
+    armv8_cipher_mode_t mode,
+    uint8_t tag_byte_length,
+    uint8_t * restrict key)
+{
+    if(armv8_rekey_reclaim(handle) != SUCCESSFUL_OPERATION) {
+        return INTERNAL_FAILURE;
+    }
+
+    uint32_t inactive = handle->active ^ 1;
+    armv8_operation_result_t result = armv8_aes_gcm_set_constants(mode, tag_byte_length, key, &handle->slots[inactive]);
+    if(result != SUCCESSFUL_OPERATION) {
+        scrub_constants(&handle->slots[inactive]);
+        return result;
+    }
+
+    // Readers that see the new epoch in a quiescent state see the new slot after it
+    uint64_t epoch = handle->epoch + 1;
+    __atomic_store_n(&handle->active, inactive, __ATOMIC_RELEASE);
+    __atomic_store_n(&handle->epoch, epoch, __ATOMIC_RELEASE);
+    handle->retired_epoch = epoch;
+    return SUCCESSFUL_OPERATION;
+}
+
+armv8_operation_result_t armv8_rekey_reclaim(armv8_rekey_handle_t * handle)
+{
+    if(handle->retired_epoch == 0) {
+        return SUCCESSFUL_OPERATION;
+    }
+
+    // Pairs with the fence in armv8_rekey_online - either the reader is seen online here, or it sees the new slot
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for( uint32_t i=0; i<ARMV8_REKEY_MAX_READERS; ++i )
+    {
+        if(!__atomic_load_n(&handle->readers[i].registered, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        uint64_t epoch = __atomic_load_n(&handle->readers[i].epoch, __ATOMIC_ACQUIRE);
+        if(epoch != ARMV8_REKEY_OFFLINE && epoch < handle->retired_epoch) {
+            return INTERNAL_FAILURE;
+        }
+    }
+
+    scrub_constants(&handle->slots[handle->active ^ 1]);
+    handle->retired_epoch = 0;
+    return SUCCESSFUL_OPERATION;
+}
+
+void armv8_rekey_synchronize(armv8_rekey_handle_t * handle)
+{
+    while(armv8_rekey_reclaim(handle) != SUCCESSFUL_OPERATION) {
+        __asm__ __volatile__("yield" : : : "memory");
+    }
+}
+
+armv8_operation_result_t armv8_rekey_reader_register(
+    armv8_rekey_handle_t * handle,
+    uint32_t * reader)
+{
+    for( uint32_t i=0; i<ARMV8_REKEY_MAX_READERS; ++i )
+    {
+        uint32_t expected = 0;
+        if(__atomic_compare_exchange_n(&handle->readers[i].registered, &expected, 1, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            armv8_rekey_online(handle, i);
+            *reader = i;
+            return SUCCESSFUL_OPERATION;
+        }
+    }
+    return INTERNAL_FAILURE;
+}
+
+void armv8_rekey_reader_unregister(
+    armv8_rekey_handle_t * handle,
+    uint32_t reader)
+{
+    armv8_rekey_offline(handle, reader);
+    __atomic_store_n(&handle->readers[reader].registered, 0, __ATOMIC_RELEASE);
+}
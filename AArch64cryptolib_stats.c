@@ -0,0 +1,121 @@
+//Copyright (c) 2018-2019, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+#include "AArch64cryptolib_private.h"
+
+#include <string.h>
+
+static const char * const stats_op_names[ARMV8_STATS_OP_COUNT] = {
+    [ARMV8_STATS_GCM_ENC]           = "gcm_enc",
+    [ARMV8_STATS_GCM_DEC]           = "gcm_dec",
+    [ARMV8_STATS_IPSEC_ENC]         = "ipsec_enc",
+    [ARMV8_STATS_IPSEC_DEC]         = "ipsec_dec",
+    [ARMV8_STATS_GMAC]              = "gmac",
+    [ARMV8_STATS_GMAC_VERIFY]       = "gmac_verify",
+    [ARMV8_STATS_MACSEC_PROTECT]    = "macsec_protect",
+    [ARMV8_STATS_MACSEC_VALIDATE]   = "macsec_validate",
+    [ARMV8_STATS_TLS13_SEAL]        = "tls13_seal",
+    [ARMV8_STATS_TLS13_OPEN]        = "tls13_open",
+    [ARMV8_STATS_QUIC_PROTECT]      = "quic_protect",
+    [ARMV8_STATS_QUIC_UNPROTECT]    = "quic_unprotect",
+    [ARMV8_STATS_CBC_SHA1_ENC]      = "cbc_sha1_enc",
+    [ARMV8_STATS_CBC_SHA1_DEC]      = "cbc_sha1_dec",
+    [ARMV8_STATS_CBC_SHA256_ENC]    = "cbc_sha256_enc",
+    [ARMV8_STATS_CBC_SHA256_DEC]    = "cbc_sha256_dec",
+};
+
+const char * armv8_crypto_stats_op_name(armv8_crypto_stats_op_t op)
+{
+    if((unsigned) op >= ARMV8_STATS_OP_COUNT) {
+        return NULL;
+    }
+    return stats_op_names[op];
+}
+
+#ifdef ARMV8_CRYPTO_STATS
+#include <pthread.h>
+
+#define STATS_COUNTERS (sizeof(armv8_crypto_stats_t) / sizeof(uint64_t))
+
+__thread crypto_thread_stats_t armv8_thread_stats;
+
+// Threads that have counted anything, and the totals of those that have since exited
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;
+static crypto_thread_stats_t * stats_threads = NULL;
+static armv8_crypto_stats_t stats_retired;
+
+// Runs at thread exit (the key value is the thread's own block), folding its counters into the retired totals
+static void stats_thread_exit(void * arg)
+{
+    crypto_thread_stats_t * stats = arg;
+    const uint64_t * counters = (const uint64_t *) &stats->counters;
+    uint64_t * retired = (uint64_t *) &stats_retired;
+
+    pthread_mutex_lock(&stats_lock);
+    for( size_t i=0; i<STATS_COUNTERS; ++i )
+    {
+        retired[i] += counters[i];
+    }
+    if(stats->prev) {
+        stats->prev->next = stats->next;
+    } else {
+        stats_threads = stats->next;
+    }
+    if(stats->next) {
+        stats->next->prev = stats->prev;
+    }
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_unlock(&stats_lock);
+}
+
+static void stats_key_create(void)
+{
+    pthread_key_create(&stats_key, stats_thread_exit);
+}
+
+void armv8_crypto_stats_register(crypto_thread_stats_t * stats)
+{
+    pthread_once(&stats_once, stats_key_create);
+
+    pthread_mutex_lock(&stats_lock);
+    stats->prev = NULL;
+    stats->next = stats_threads;
+    if(stats_threads) {
+        stats_threads->prev = stats;
+    }
+    stats_threads = stats;
+    stats->registered = 1;
+    pthread_mutex_unlock(&stats_lock);
+
+    pthread_setspecific(stats_key, stats);
+}
+
+armv8_operation_result_t armv8_crypto_stats_snapshot(armv8_crypto_stats_t * stats)
+{
+    uint64_t * total = (uint64_t *) stats;
+
+    pthread_mutex_lock(&stats_lock);
+    *stats = stats_retired;
+    for( crypto_thread_stats_t * thread = stats_threads; thread != NULL; thread = thread->next )
+    {
+        uint64_t * counters = (uint64_t *) &thread->counters;
+        for( size_t i=0; i<STATS_COUNTERS; ++i )
+        {
+            total[i] += __atomic_load_n(&counters[i], __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&stats_lock);
+    return SUCCESSFUL_OPERATION;
+}
+
+#undef STATS_COUNTERS
+#else
+armv8_operation_result_t armv8_crypto_stats_snapshot(armv8_crypto_stats_t * stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    return INTERNAL_FAILURE;
+}
+#endif
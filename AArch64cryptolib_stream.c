@@ -0,0 +1,119 @@
+//Copyright (c) 2018-2019, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+#include "AArch64cryptolib_private.h"
+
+#include <string.h>
+
+#define STREAM_VERSION          1
+#define STREAM_MAX_CHUNK_BYTES  (1u << 30)
+
+static const uint8_t stream_magic[4] = { 'A', '6', '4', 'S' };
+
+// nonce_prefix | chunk_index (big endian) | last flag
+static void stream_nonce(const armv8_stream_context_t * ctx, uint64_t chunk_index, int last, uint8_t * nonce)
+{
+    memcpy(nonce, ctx->header + 12, ARMV8_STREAM_NONCE_PREFIX_BYTES);
+    nonce[7]  = (uint8_t) (chunk_index >> 24);
+    nonce[8]  = (uint8_t) (chunk_index >> 16);
+    nonce[9]  = (uint8_t) (chunk_index >> 8);
+    nonce[10] = (uint8_t) chunk_index;
+    nonce[11] = last ? 1 : 0;
+}
+
+// A chunk other than the last is exactly chunk_byte_length, the last is at most that
+static int stream_chunk_valid(const armv8_stream_context_t * ctx, uint64_t chunk_index, int last, uint64_t bit_length)
+{
+    return chunk_index < ARMV8_STREAM_MAX_CHUNKS && (bit_length & 7) == 0 &&
+           (last ? (bit_length >> 3) <= ctx->chunk_byte_length : (bit_length >> 3) == ctx->chunk_byte_length);
+}
+
+armv8_operation_result_t armv8_stream_init_seal(
+    armv8_stream_context_t * ctx,
+    armv8_cipher_mode_t mode,
+    uint8_t * restrict key,
+    const uint8_t * nonce_prefix,
+    uint32_t chunk_byte_length)
+{
+    TRACE_ENTRY(stream_init_seal, mode, chunk_byte_length);
+    if(chunk_byte_length == 0 || (chunk_byte_length & 15) || chunk_byte_length > STREAM_MAX_CHUNK_BYTES) {
+        return TRACE_EXIT(stream_init_seal, INVALID_PARAMETER);
+    }
+    memset(ctx->header, 0, sizeof(ctx->header));
+    memcpy(ctx->header, stream_magic, sizeof(stream_magic));
+    ctx->header[4] = STREAM_VERSION;
+    ctx->header[5] = (uint8_t) mode;
+    ctx->header[8]  = (uint8_t) chunk_byte_length;
+    ctx->header[9]  = (uint8_t) (chunk_byte_length >> 8);
+    ctx->header[10] = (uint8_t) (chunk_byte_length >> 16);
+    ctx->header[11] = (uint8_t) (chunk_byte_length >> 24);
+    memcpy(ctx->header + 12, nonce_prefix, ARMV8_STREAM_NONCE_PREFIX_BYTES);
+    ctx->chunk_byte_length = chunk_byte_length;
+    return TRACE_EXIT(stream_init_seal, armv8_aes_gcm_set_constants(mode, ARMV8_STREAM_TAG_BYTES, key, &ctx->constants));
+}
+
+armv8_operation_result_t armv8_stream_init_open(
+    armv8_stream_context_t * ctx,
+    uint8_t * restrict key,
+    const uint8_t * header)
+{
+    uint32_t chunk_byte_length = (uint32_t) header[8] | ((uint32_t) header[9] << 8) |
+                                 ((uint32_t) header[10] << 16) | ((uint32_t) header[11] << 24);
+    TRACE_ENTRY(stream_init_open, header[5], chunk_byte_length);
+    if(memcmp(header, stream_magic, sizeof(stream_magic)) != 0 || header[4] != STREAM_VERSION ||
+       header[5] > AES_GCM_256) {
+        return TRACE_EXIT(stream_init_open, INVALID_PARAMETER);
+    }
+    armv8_operation_result_t result = armv8_stream_init_seal(ctx, (armv8_cipher_mode_t) header[5], key,
+                                                             header + 12, chunk_byte_length);
+    // anything else that differs (e.g. the reserved bytes) makes every chunk fail to open
+    memcpy(ctx->header, header, sizeof(ctx->header));
+    return TRACE_EXIT(stream_init_open, result);
+}
+
+armv8_operation_result_t armv8_stream_seal_chunk(
+    armv8_stream_context_t * ctx,
+    uint64_t chunk_index, int last,
+    uint8_t * plaintext,    uint64_t plaintext_bit_length,
+    uint8_t * ciphertext,
+    uint8_t * tag)
+{
+    TRACE_ENTRY(stream_seal_chunk, ctx->constants.mode, chunk_index, plaintext_bit_length, last);
+    if(!stream_chunk_valid(ctx, chunk_index, last, plaintext_bit_length)) {
+        return TRACE_EXIT(stream_seal_chunk, INVALID_PARAMETER);
+    }
+    uint8_t nonce[12];
+    armv8_cipher_state_t cs = { .constants = &ctx->constants };
+    stream_nonce(ctx, chunk_index, last, nonce);
+    armv8_operation_result_t result = armv8_aes_gcm_set_counter(nonce, 96, &cs);
+    result |= armv8_enc_aes_gcm_from_state_exact(&cs, ctx->header, ARMV8_STREAM_HEADER_BYTES*8,
+                                                 plaintext, plaintext_bit_length, ciphertext, tag);
+    return TRACE_EXIT(stream_seal_chunk, result);
+}
+
+armv8_operation_result_t armv8_stream_open_chunk(
+    armv8_stream_context_t * ctx,
+    uint64_t chunk_index, int last,
+    uint8_t * ciphertext,   uint64_t ciphertext_bit_length,
+    uint8_t * tag,
+    uint8_t * plaintext)
+{
+    TRACE_ENTRY(stream_open_chunk, ctx->constants.mode, chunk_index, ciphertext_bit_length, last);
+    if(!stream_chunk_valid(ctx, chunk_index, last, ciphertext_bit_length)) {
+        return TRACE_EXIT(stream_open_chunk, INVALID_PARAMETER);
+    }
+    uint8_t nonce[12];
+    armv8_cipher_state_t cs = { .constants = &ctx->constants };
+    stream_nonce(ctx, chunk_index, last, nonce);
+    armv8_operation_result_t result = armv8_aes_gcm_set_counter(nonce, 96, &cs);
+    if(result != SUCCESSFUL_OPERATION) {
+        return TRACE_EXIT(stream_open_chunk, result);
+    }
+    result = armv8_dec_aes_gcm_from_state_exact(&cs, ctx->header, ARMV8_STREAM_HEADER_BYTES*8,
+                                                ciphertext, ciphertext_bit_length, tag, plaintext);
+    return TRACE_EXIT(stream_open_chunk, result);
+}
+
+#undef STREAM_VERSION
+#undef STREAM_MAX_CHUNK_BYTES
@@ -0,0 +1,304 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// C++ interface (AArch64cryptolib.hpp)
+//// For each key size and several tag lengths, messages of random lengths are sealed and opened through AesGcm and
+//// must match armv8_{enc,dec}_aes_gcm_full_exact. Bursts must match single messages, with per message results, and
+//// chunked streams sealed through AesGcmStream must open with the C interface and the other way round
+//// Finally the time to seal small messages through AesGcm and through armv8_enc_aes_gcm_from_state is compared
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "AArch64cryptolib.hpp"
+
+#define CPP_MESSAGES        200
+#define CPP_MAX_BYTES       300
+#define CPP_BURST           16
+#define CPP_STREAM_CHUNK    64
+#define CPP_SMALL_BYTES     64
+#define CPP_TIMED_MESSAGES  100000
+
+using armv8::AesGcm;
+using armv8::AesGcmStream;
+using armv8::result_t;
+
+// The key size and tag length are checked at compile time
+static_assert(AesGcm<192, 12>::key_bytes == 24 && AesGcm<192, 12>::tag_bytes == 12);
+static_assert(AesGcm<256>::mode == AES_GCM_256 && AesGcm<256>::tag_bytes == 16);
+static_assert(armv8::valid_tag_length(4) && armv8::valid_tag_length(8) && armv8::valid_tag_length(13));
+static_assert(!armv8::valid_tag_length(0) && !armv8::valid_tag_length(10) && !armv8::valid_tag_length(17));
+
+static uint64_t rng_next(uint64_t * rng)
+{
+    *rng ^= *rng << 13; *rng ^= *rng >> 7; *rng ^= *rng << 17;
+    return *rng;
+}
+
+static void fill_random(uint64_t * rng, uint8_t * buffer, size_t bytes)
+{
+    for( size_t i=0; i<bytes; ++i ) buffer[i] = (uint8_t) rng_next(rng);
+}
+
+template <unsigned KeyBits, size_t TagBytes>
+static bool test_seal_open(uint64_t * rng)
+{
+    std::array<uint8_t, KeyBits / 8> key;
+    fill_random(rng, key.data(), key.size());
+    const AesGcm<KeyBits, TagBytes> gcm(key);
+
+    for( uint32_t i=0; i<CPP_MESSAGES; ++i )
+    {
+        // a 12B nonce most of the time, and some that go through GHASH
+        std::vector<uint8_t> nonce(i % 4 == 3 ? 1 + rng_next(rng) % 64 : 12);
+        std::vector<uint8_t> aad(rng_next(rng) % 40);
+        std::vector<uint8_t> plaintext(rng_next(rng) % CPP_MAX_BYTES);
+        fill_random(rng, nonce.data(), nonce.size());
+        fill_random(rng, aad.data(), aad.size());
+        fill_random(rng, plaintext.data(), plaintext.size());
+
+        std::vector<uint8_t> ciphertext(plaintext.size()), expected(plaintext.size()), decrypted(plaintext.size());
+        std::array<uint8_t, TagBytes> tag, expected_tag;
+        result_t result = gcm.seal(nonce, aad, plaintext, ciphertext, tag);
+        result_t expected_result = armv8_enc_aes_gcm_full_exact(AesGcm<KeyBits, TagBytes>::mode, key.data(),
+            nonce.data(), nonce.size() * 8, aad.data(), aad.size() * 8, plaintext.data(), plaintext.size() * 8,
+            TagBytes, expected.data(), expected_tag.data());
+        if(result != SUCCESSFUL_OPERATION || expected_result != SUCCESSFUL_OPERATION || ciphertext != expected ||
+           tag != expected_tag)
+        {
+            printf("AES-GCM-%u %zuB tag: seal mismatch for %zuB\n", KeyBits, TagBytes, plaintext.size());
+            return false;
+        }
+
+        if(gcm.open(nonce, aad, ciphertext, tag, decrypted) != SUCCESSFUL_OPERATION || decrypted != plaintext) {
+            printf("AES-GCM-%u %zuB tag: open mismatch for %zuB\n", KeyBits, TagBytes, plaintext.size());
+            return false;
+        }
+        tag[i % TagBytes] ^= 1;
+        if(gcm.open(nonce, aad, ciphertext, tag, decrypted) != AUTHENTICATION_FAILURE) {
+            printf("AES-GCM-%u %zuB tag: corrupted tag accepted\n", KeyBits, TagBytes);
+            return false;
+        }
+    }
+
+    // Outputs that are too short and empty nonces are rejected
+    std::array<uint8_t, 16> data = {}, nonce = {};
+    std::array<uint8_t, TagBytes> tag = {};
+    if(gcm.seal(nonce, {}, data, std::span(data).first(15), tag) != INVALID_PARAMETER ||
+       gcm.open(nonce, {}, data, tag, std::span(data).first(15)) != INVALID_PARAMETER ||
+       gcm.seal({}, {}, data, data, tag) != INVALID_PARAMETER)
+    {
+        printf("AES-GCM-%u %zuB tag: invalid buffers were not rejected\n", KeyBits, TagBytes);
+        return false;
+    }
+    return true;
+}
+
+template <unsigned KeyBits>
+static bool test_burst(uint64_t * rng)
+{
+    using gcm_t = AesGcm<KeyBits, 12>;
+    std::array<uint8_t, KeyBits / 8> key;
+    fill_random(rng, key.data(), key.size());
+    const gcm_t gcm(key);
+
+    std::array<std::array<uint8_t, 12>, CPP_BURST> nonces;
+    std::array<std::array<uint8_t, CPP_MAX_BYTES>, CPP_BURST> plaintexts, ciphertexts, decrypted;
+    std::array<std::array<uint8_t, 12>, CPP_BURST> tags;
+    std::array<uint8_t, 20> aad;
+    std::vector<typename gcm_t::message> seal, open;
+    fill_random(rng, aad.data(), aad.size());
+    for( uint32_t i=0; i<CPP_BURST; ++i )
+    {
+        size_t bytes = rng_next(rng) % CPP_MAX_BYTES;
+        fill_random(rng, nonces[i].data(), nonces[i].size());
+        fill_random(rng, plaintexts[i].data(), bytes);
+        seal.push_back({ nonces[i], aad, std::span(plaintexts[i]).first(bytes), ciphertexts[i], tags[i] });
+        open.push_back({ nonces[i], aad, std::span(ciphertexts[i]).first(bytes), decrypted[i], tags[i] });
+    }
+
+    if(gcm.seal_burst(seal) != SUCCESSFUL_OPERATION) {
+        printf("AES-GCM-%u burst seal failed\n", KeyBits);
+        return false;
+    }
+    for( uint32_t i=0; i<CPP_BURST; ++i )
+    {
+        std::array<uint8_t, CPP_MAX_BYTES> expected;
+        std::array<uint8_t, 12> expected_tag;
+        size_t bytes = seal[i].input.size();
+        gcm.seal(nonces[i], aad, seal[i].input, expected, expected_tag);
+        if(memcmp(ciphertexts[i].data(), expected.data(), bytes) != 0 || tags[i] != expected_tag) {
+            printf("AES-GCM-%u burst seal mismatch for message %u\n", KeyBits, i);
+            return false;
+        }
+    }
+
+    // every third message is corrupted, and must be the only ones to fail
+    std::array<result_t, CPP_BURST> results;
+    for( uint32_t i=0; i<CPP_BURST; i+=3 ) tags[i][0] ^= 1;
+    if(gcm.open_burst(open, results) != AUTHENTICATION_FAILURE) {
+        printf("AES-GCM-%u burst open did not report the corrupted messages\n", KeyBits);
+        return false;
+    }
+    for( uint32_t i=0; i<CPP_BURST; ++i )
+    {
+        size_t bytes = open[i].input.size();
+        bool valid = i % 3 != 0;
+        if(results[i] != (valid ? SUCCESSFUL_OPERATION : AUTHENTICATION_FAILURE) ||
+           (valid && memcmp(decrypted[i].data(), plaintexts[i].data(), bytes) != 0))
+        {
+            printf("AES-GCM-%u burst open mismatch for message %u\n", KeyBits, i);
+            return false;
+        }
+    }
+    if(gcm.open_burst(open, std::span(results).first(CPP_BURST - 1)) != INVALID_PARAMETER) {
+        printf("AES-GCM-%u burst open with too few results was not rejected\n", KeyBits);
+        return false;
+    }
+    return true;
+}
+
+template <unsigned KeyBits>
+static bool test_stream(uint64_t * rng)
+{
+    std::array<uint8_t, KeyBits / 8> key;
+    std::array<uint8_t, ARMV8_STREAM_NONCE_PREFIX_BYTES> nonce_prefix;
+    fill_random(rng, key.data(), key.size());
+    fill_random(rng, nonce_prefix.data(), nonce_prefix.size());
+
+    // 3 whole chunks and a partial last chunk
+    const uint32_t chunks = 4;
+    const size_t last_bytes = 29;
+    std::array<uint8_t, CPP_STREAM_CHUNK * chunks> plaintext, ciphertext, decrypted;
+    std::array<std::array<uint8_t, ARMV8_STREAM_TAG_BYTES>, chunks> tags;
+    fill_random(rng, plaintext.data(), plaintext.size());
+    auto chunk = [&](auto & buffer, uint32_t i) {
+        return std::span(buffer).subspan(i * CPP_STREAM_CHUNK, i + 1 == chunks ? last_bytes : CPP_STREAM_CHUNK);
+    };
+
+    // sealed through the C++ interface in reverse order, opened through the C interface
+    AesGcmStream<KeyBits> sealer;
+    if(sealer.init_seal(key, nonce_prefix, CPP_STREAM_CHUNK) != SUCCESSFUL_OPERATION) {
+        printf("AES-GCM-%u stream set up failed\n", KeyBits);
+        return false;
+    }
+    for( uint32_t i=chunks; i-->0; )
+    {
+        if(sealer.seal_chunk(i, i + 1 == chunks, chunk(plaintext, i), chunk(ciphertext, i), tags[i]) != SUCCESSFUL_OPERATION) {
+            printf("AES-GCM-%u stream seal failed for chunk %u\n", KeyBits, i);
+            return false;
+        }
+    }
+    armv8_stream_context_t ctx;
+    if(armv8_stream_init_open(&ctx, key.data(), sealer.header().data()) != SUCCESSFUL_OPERATION) {
+        printf("AES-GCM-%u stream header rejected\n", KeyBits);
+        return false;
+    }
+    for( uint32_t i=0; i<chunks; ++i )
+    {
+        auto c = chunk(ciphertext, i);
+        if(armv8_stream_open_chunk(&ctx, i, i + 1 == chunks, c.data(), c.size() * 8, tags[i].data(),
+                                   chunk(decrypted, i).data()) != SUCCESSFUL_OPERATION)
+        {
+            printf("AES-GCM-%u stream chunk %u sealed in C++ did not open in C\n", KeyBits, i);
+            return false;
+        }
+    }
+    if(memcmp(decrypted.data(), plaintext.data(), CPP_STREAM_CHUNK * (chunks - 1) + last_bytes) != 0) {
+        printf("AES-GCM-%u stream mismatch\n", KeyBits);
+        return false;
+    }
+
+    // sealed through the C interface, opened through the C++ interface
+    uint8_t header[ARMV8_STREAM_HEADER_BYTES];
+    if(armv8_stream_init_seal(&ctx, AesGcm<KeyBits>::mode, key.data(), nonce_prefix.data(), CPP_STREAM_CHUNK) != SUCCESSFUL_OPERATION) {
+        return false;
+    }
+    memcpy(header, ctx.header, sizeof(header));
+    for( uint32_t i=0; i<chunks; ++i )
+    {
+        auto p = chunk(plaintext, i);
+        armv8_stream_seal_chunk(&ctx, i, i + 1 == chunks, p.data(), p.size() * 8, chunk(ciphertext, i).data(), tags[i].data());
+    }
+    AesGcmStream<KeyBits> opener;
+    if(opener.init_open(key, header) != SUCCESSFUL_OPERATION || opener.chunk_byte_length() != CPP_STREAM_CHUNK) {
+        printf("AES-GCM-%u stream header rejected in C++\n", KeyBits);
+        return false;
+    }
+    decrypted.fill(0);
+    for( uint32_t i=0; i<chunks; ++i )
+    {
+        if(opener.open_chunk(i, i + 1 == chunks, chunk(ciphertext, i), tags[i], chunk(decrypted, i)) != SUCCESSFUL_OPERATION) {
+            printf("AES-GCM-%u stream chunk %u sealed in C did not open in C++\n", KeyBits, i);
+            return false;
+        }
+    }
+    // a truncated stream fails, as in the C interface
+    if(memcmp(decrypted.data(), plaintext.data(), CPP_STREAM_CHUNK * (chunks - 1) + last_bytes) != 0 ||
+       opener.open_chunk(1, true, chunk(ciphertext, 1), tags[1], chunk(decrypted, 1)) != AUTHENTICATION_FAILURE)
+    {
+        printf("AES-GCM-%u stream opened in C++ mismatch\n", KeyBits);
+        return false;
+    }
+
+    // a stream of another key size is rejected
+    constexpr unsigned other_bits = KeyBits == 128 ? 256 : 128;
+    std::array<uint8_t, other_bits / 8> other_key = {};
+    AesGcmStream<other_bits> other;
+    if(other.init_open(other_key, header) != INVALID_PARAMETER) {
+        printf("AES-GCM-%u stream header accepted for AES-GCM-%u\n", KeyBits, other_bits);
+        return false;
+    }
+    return true;
+}
+
+static void time_seal(void)
+{
+    std::array<uint8_t, 16> key = {};
+    std::array<uint8_t, 12> nonce = {};
+    std::array<uint8_t, CPP_SMALL_BYTES> data = {};
+    std::array<uint8_t, 16> tag;
+    const AesGcm<128> gcm(key);
+
+    armv8_cipher_constants_t cc;
+    armv8_aes_gcm_set_constants(AES_GCM_128, 16, key.data(), &cc);
+    auto start = std::chrono::steady_clock::now();
+    for( uint32_t i=0; i<CPP_TIMED_MESSAGES; ++i )
+    {
+        armv8_cipher_state_t cs = {};
+        cs.constants = &cc;
+        armv8_aes_gcm_set_counter(nonce.data(), 96, &cs);
+        armv8_enc_aes_gcm_from_state(&cs, NULL, 0, data.data(), CPP_SMALL_BYTES * 8, data.data(), tag.data());
+    }
+    std::chrono::duration<double, std::nano> c_time = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for( uint32_t i=0; i<CPP_TIMED_MESSAGES; ++i )
+    {
+        gcm.seal(nonce, {}, data, data, tag);
+    }
+    std::chrono::duration<double, std::nano> cpp_time = std::chrono::steady_clock::now() - start;
+    printf("%u AES-GCM-128 %uB messages: C %.1f ns/message, C++ %.1f ns/message\n", CPP_TIMED_MESSAGES,
+           CPP_SMALL_BYTES, c_time.count() / CPP_TIMED_MESSAGES, cpp_time.count() / CPP_TIMED_MESSAGES);
+}
+
+int main(void)
+{
+    uint64_t rng = 0x243f6a8885a308d3ull;
+    bool ok = test_seal_open<128, 16>(&rng) && test_seal_open<128, 4>(&rng) &&
+              test_seal_open<192, 16>(&rng) && test_seal_open<192, 12>(&rng) &&
+              test_seal_open<256, 16>(&rng) && test_seal_open<256, 8>(&rng) &&
+              test_burst<128>(&rng) && test_burst<192>(&rng) && test_burst<256>(&rng) &&
+              test_stream<128>(&rng) && test_stream<192>(&rng) && test_stream<256>(&rng);
+    if(!ok) {
+        printf("Failed\n");
+        return 1;
+    }
+    time_seal();
+    printf("Success\n");
+    return 0;
+}
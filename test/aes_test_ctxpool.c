@@ -0,0 +1,328 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Context pool
+//// A number of threads allocate and free contexts concurrently, each marking the contexts it holds and checking
+//// nobody else was handed them, then every context must be allocatable exactly once, and AES-GCM constants set up
+//// in the pool must give the same result as constants set up anywhere else
+//// Threads started one after another, many more than ARMV8_CTX_POOL_MAX_THREADS in total, must each still get a
+//// free list of their own
+//// A thread's TLS destructors that run after its free list has been released must use the shared free list
+//// Usage: aes_test_ctxpool [numa node, default 0 - falls back to unbound if the node can't be used]
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "AArch64cryptolib.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define cipher_constants_t  armv8_cipher_constants_t
+#define cipher_state_t      armv8_cipher_state_t
+#define ctx_pool_t          armv8_ctx_pool_t
+#define ctx_handle_t        armv8_ctx_handle_t
+
+#define POOL_THREADS        8
+#define POOL_CAPACITY       100000
+#define POOL_ITERATIONS     200000
+#define POOL_HELD           1024        // most contexts a thread holds at once
+#define CHURN_THREADS       (2 * ARMV8_CTX_POOL_MAX_THREADS + 8)
+#define CHURN_ITERATIONS    100
+
+typedef struct pool_thread {
+    pthread_t thread;
+    uint32_t id;
+    ctx_pool_t * pool;
+    bool failed;
+} pool_thread_t;
+
+typedef struct pool_marker {
+    uint32_t link;              // overwritten by the pool while the context is free
+    uint32_t thread;
+    uint64_t sequence;
+} pool_marker_t;
+
+static uint8_t key[32] = { 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 };
+static uint8_t nonce[16] = { 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88 };
+
+static void * pool_thread_main(void * arg)
+{
+    pool_thread_t * t = arg;
+    ctx_handle_t held[POOL_HELD];
+    uint64_t sequence[POOL_HELD];
+    uint32_t count = 0;
+    uint64_t rng = 0x9e3779b97f4a7c15ull * (t->id + 1);
+
+    for( uint64_t i=0; i<POOL_ITERATIONS && !t->failed; ++i )
+    {
+        rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+        if(count < POOL_HELD && (count == 0 || (rng & 3) != 0)) {
+            ctx_handle_t h;
+            if(armv8_ctx_pool_alloc(t->pool, &h) != SUCCESSFUL_OPERATION) {
+                continue; // the other threads may hold everything for a moment
+            }
+            if(h >= t->pool->capacity) {
+                printf("Thread %u: handle %u out of range\n", t->id, h);
+                t->failed = true;
+                break;
+            }
+            pool_marker_t * m = armv8_ctx_pool_ptr(t->pool, h);
+            m->thread = t->id;
+            m->sequence = i;
+            held[count] = h;
+            sequence[count++] = i;
+        } else {
+            uint32_t j = (uint32_t) (rng >> 32) % count;
+            pool_marker_t * m = armv8_ctx_pool_ptr(t->pool, held[j]);
+            if(m->thread != t->id || m->sequence != sequence[j]) {
+                printf("Thread %u: context %u was handed out twice\n", t->id, held[j]);
+                t->failed = true;
+            }
+            armv8_ctx_pool_free(t->pool, held[j]);
+            held[j] = held[--count];
+            sequence[j] = sequence[count];
+        }
+    }
+    while(count > 0) {
+        armv8_ctx_pool_free(t->pool, held[--count]);
+    }
+    armv8_ctx_pool_flush(t->pool);
+    return NULL;
+}
+
+// Each allocation or free that goes to the shared free list bumps the tag in the top half of its head, while a
+// thread with its own free list only goes there to refill it, half a free list at a time
+static void * churn_thread_main(void * arg)
+{
+    pool_thread_t * t = arg;
+    uint64_t head = __atomic_load_n(&t->pool->free_head, __ATOMIC_RELAXED);
+
+    for( uint32_t i=0; i<CHURN_ITERATIONS; ++i )
+    {
+        ctx_handle_t h;
+        if(armv8_ctx_pool_alloc(t->pool, &h) != SUCCESSFUL_OPERATION) {
+            t->failed = true;
+            return NULL;
+        }
+        armv8_ctx_pool_free(t->pool, h);
+    }
+    uint64_t updates = (__atomic_load_n(&t->pool->free_head, __ATOMIC_RELAXED) >> 32) - (head >> 32);
+    if(updates > (ARMV8_CTX_POOL_CACHE_HANDLES + 1) / 2) {
+        printf("Thread %u: %lu updates to the shared free list, it has no free list of its own\n", t->id, updates);
+        t->failed = true;
+    }
+    // leave the last thread's free list empty for check_all_free, the others are passed on when they exit
+    if(t->id == CHURN_THREADS - 1) {
+        armv8_ctx_pool_flush(t->pool);
+    }
+    return NULL;
+}
+
+static bool check_churn(ctx_pool_t * pool)
+{
+    bool passed = true;
+
+    for( uint32_t i=0; i<CHURN_THREADS && passed; ++i )
+    {
+        pool_thread_t t = { .id = i, .pool = pool };
+        pthread_create(&t.thread, NULL, churn_thread_main, &t);
+        pthread_join(t.thread, NULL);
+        passed &= !t.failed;
+    }
+    return passed;
+}
+
+// Runs in the second round of TLS destructors of the thread, so after the pool's destructor has given its thread index
+// back - its free list may already belong to another thread, so both calls must go to the shared free list
+static pthread_key_t late_key;
+
+static void late_destructor(void * arg)
+{
+    pool_thread_t * t = arg;
+    if(t->id == 0) {
+        t->id = 1;
+        pthread_setspecific(late_key, t);
+        return;
+    }
+    uint64_t head = __atomic_load_n(&t->pool->free_head, __ATOMIC_RELAXED);
+    ctx_handle_t h;
+    if(armv8_ctx_pool_alloc(t->pool, &h) != SUCCESSFUL_OPERATION) {
+        t->failed = true;
+        return;
+    }
+    armv8_ctx_pool_free(t->pool, h);
+    uint64_t updates = (__atomic_load_n(&t->pool->free_head, __ATOMIC_RELAXED) >> 32) - (head >> 32);
+    if(updates != 2) {
+        printf("Pool used from a TLS destructor after the thread's index was released: %lu updates to the shared free "
+               "list rather than 2, it used a free list it no longer owns\n", updates);
+        t->failed = true;
+    }
+}
+
+static void * late_thread_main(void * arg)
+{
+    pool_thread_t * t = arg;
+    ctx_handle_t h;
+    // leave contexts in this thread's free list, which a wrongly used free list would then take from
+    if(armv8_ctx_pool_alloc(t->pool, &h) != SUCCESSFUL_OPERATION) {
+        t->failed = true;
+        return NULL;
+    }
+    armv8_ctx_pool_free(t->pool, h);
+    pthread_setspecific(late_key, t);
+    return NULL;
+}
+
+static void * flush_thread_main(void * arg)
+{
+    pool_thread_t * t = arg;
+    armv8_ctx_pool_flush(t->pool);
+    return NULL;
+}
+
+static bool check_late_destructor(ctx_pool_t * pool)
+{
+    pool_thread_t t = { .id = 0, .pool = pool };
+    pthread_key_create(&late_key, late_destructor);
+    pthread_create(&t.thread, NULL, late_thread_main, &t);
+    pthread_join(t.thread, NULL);
+    pthread_key_delete(late_key);
+
+    // the next thread takes over the released index, and passes the contexts left in its free list on for
+    // check_all_free
+    pool_thread_t flush = { .pool = pool };
+    pthread_create(&flush.thread, NULL, flush_thread_main, &flush);
+    pthread_join(flush.thread, NULL);
+    return !t.failed;
+}
+
+// After every thread has flushed, each context can be allocated exactly once
+static bool check_all_free(ctx_pool_t * pool)
+{
+    uint8_t * seen = calloc(pool->capacity, 1);
+    bool passed = true;
+    ctx_handle_t h;
+
+    for( uint32_t i=0; i<pool->capacity; ++i )
+    {
+        if(armv8_ctx_pool_alloc(pool, &h) != SUCCESSFUL_OPERATION) {
+            printf("Only %u of %u contexts could be allocated\n", i, pool->capacity);
+            passed = false;
+            break;
+        }
+        if(h >= pool->capacity || seen[h]) {
+            printf("Context %u allocated twice or out of range\n", h);
+            passed = false;
+            break;
+        }
+        seen[h] = 1;
+        if(((uintptr_t) armv8_ctx_pool_ptr(pool, h) & 63) != 0) {
+            printf("Context %u is not 64B aligned\n", h);
+            passed = false;
+        }
+    }
+    if(passed && (armv8_ctx_pool_alloc(pool, &h) != INTERNAL_FAILURE || h != ARMV8_CTX_HANDLE_INVALID)) {
+        printf("Allocation from an empty pool did not fail\n");
+        passed = false;
+    }
+    for( uint32_t i=0; i<pool->capacity; ++i )
+    {
+        if(seen[i]) armv8_ctx_pool_free(pool, i);
+    }
+    armv8_ctx_pool_flush(pool);
+    free(seen);
+    return passed;
+}
+
+// Key setup straight into the pool matches key setup into a separately allocated context
+static bool check_constants(ctx_pool_t * pool)
+{
+    uint8_t plaintext[256] = { 0 };
+    uint8_t aad[16] = { 0 };
+    uint8_t ciphertext[2][256];
+    uint8_t tag[2][16];
+    cipher_constants_t cc;
+    bool passed = true;
+
+    for( armv8_cipher_mode_t mode = AES_GCM_128; mode <= AES_GCM_256; ++mode )
+    {
+        ctx_handle_t h;
+        operation_result_t result = armv8_ctx_pool_alloc_constants(pool, mode, 16, key, &h);
+        result |= armv8_aes_gcm_set_constants(mode, 16, key, &cc);
+
+        cipher_state_t cs_pool = { .constants = armv8_ctx_pool_ptr(pool, h) };
+        cipher_state_t cs = { .constants = &cc };
+        result |= armv8_aes_gcm_set_counter(nonce, 96, &cs_pool);
+        result |= armv8_aes_gcm_set_counter(nonce, 96, &cs);
+        result |= armv8_enc_aes_gcm_from_state(&cs_pool, aad, 128, plaintext, sizeof(plaintext)*8, ciphertext[0], tag[0]);
+        result |= armv8_enc_aes_gcm_from_state(&cs, aad, 128, plaintext, sizeof(plaintext)*8, ciphertext[1], tag[1]);
+        if(result != SUCCESSFUL_OPERATION || memcmp(ciphertext[0], ciphertext[1], sizeof(ciphertext[0])) != 0 ||
+           memcmp(tag[0], tag[1], sizeof(tag[0])) != 0) {
+            printf("AES-GCM with pooled constants (mode %d) does not match\n", mode);
+            passed = false;
+        }
+        armv8_ctx_pool_free(pool, h);
+    }
+    armv8_ctx_pool_flush(pool);
+    return passed;
+}
+
+int main(int argc, char* argv[]) {
+    int32_t numa_node = argc > 1 ? atoi(argv[1]) : 0;
+    pool_thread_t threads[POOL_THREADS];
+    ctx_pool_t * pool;
+    bool passed = true;
+
+    operation_result_t result = armv8_ctx_pool_create(sizeof(cipher_constants_t), POOL_CAPACITY, numa_node, &pool);
+    if(result == INVALID_PARAMETER && numa_node >= 0) {
+        printf("Can't bind to NUMA node %d, using an unbound pool\n", numa_node);
+        result = armv8_ctx_pool_create(sizeof(cipher_constants_t), POOL_CAPACITY, -1, &pool);
+    }
+    if(result != SUCCESSFUL_OPERATION) {
+        printf("Failed to create pool (%d)\n", result);
+        return 1;
+    }
+    printf("%u contexts of %u bytes (stride %u) on node %d, %s hugepages\n", pool->capacity,
+           (uint32_t) sizeof(cipher_constants_t), pool->stride, pool->numa_node,
+           pool->hugepages ? "reserved" : "transparent");
+
+    for( uint32_t i=0; i<POOL_THREADS; ++i )
+    {
+        threads[i] = (pool_thread_t) { .id = i, .pool = pool };
+        pthread_create(&threads[i].thread, NULL, pool_thread_main, &threads[i]);
+    }
+    for( uint32_t i=0; i<POOL_THREADS; ++i )
+    {
+        pthread_join(threads[i].thread, NULL);
+        passed &= !threads[i].failed;
+    }
+
+    passed &= check_churn(pool);
+    passed &= check_late_destructor(pool);
+    passed &= check_all_free(pool);
+    passed &= check_constants(pool);
+    armv8_ctx_pool_destroy(pool);
+
+    // Compact constants pack four to a 1KB span
+    if(armv8_ctx_pool_create(sizeof(armv8_compact_constants_128_t), 1024, -1, &pool) != SUCCESSFUL_OPERATION ||
+       pool->stride != sizeof(armv8_compact_constants_128_t)) {
+        printf("Compact constants pool has the wrong stride\n");
+        passed = false;
+    }
+    armv8_ctx_pool_destroy(pool);
+
+    if(armv8_ctx_pool_create(sizeof(cipher_constants_t), 0, -1, &pool) != INVALID_PARAMETER || pool != NULL) {
+        printf("Empty pool was not rejected\n");
+        passed = false;
+    }
+
+    if(!passed) {
+        printf("Failed\n");
+        return 1;
+    }
+    printf("Success\n");
+    return 0;
+}
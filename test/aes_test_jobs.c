@@ -0,0 +1,499 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Asynchronous job queue
+//// A mix of AES-GCM, IPsec and AES-CBC/SHA jobs of random lengths is run once by calling the API directly and once
+//// through a job manager, for several batch sizes and with completions taken on the submitting thread or on a
+//// second thread. Completions must come back in submission order, with the same outputs and results - in builds
+//// without the IPsec variants, IPsec jobs must complete with INVALID_PARAMETER
+//// AES-GCM jobs use constants of all three key sizes, in runs of the same size, so that in builds with lanes short
+//// ones run in lanes with others of their size; this is checked again with batches made only of such jobs
+//// Finally the throughput of AES-GCM jobs called directly and through the queue is compared, which is what decides
+//// whether lanes are worth turning on for a core
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "AArch64cryptolib.h"
+#include "test_timing.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define cipher_constants_t  armv8_cipher_constants_t
+#define cipher_state_t      armv8_cipher_state_t
+#define job_t               armv8_job_t
+#define job_mgr_t           armv8_job_mgr_t
+
+#define JOB_ITEMS           1000
+#define JOB_MAX_BYTES       1024
+#define JOB_TYPES           (ARMV8_JOB_AES_CBC_SHA256_DEC + 1)
+#define JOB_MODE_RUN        (JOB_TYPES * 4)         // consecutive items whose AES-GCM jobs use the same key size
+#define JOB_TIMED_ITEMS     20000
+
+// Everything one job reads and writes, so that the direct and queued runs can be compared with one memcmp
+typedef struct item {
+    uint8_t nonce[12];
+    uint8_t data[JOB_MAX_BYTES + 32];       // input, or data processed in place with the tag after it (IPsec)
+    uint8_t output[JOB_MAX_BYTES + 16];
+    uint8_t tag[16];
+    uint8_t digest[64];
+    uint32_t byte_length;
+    uint64_t checksum;
+    operation_result_t result;
+} item_t;
+
+static uint8_t key[32] = { 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+                           0x4b, 0xa9, 0x0c, 0x31, 0xd5, 0x72, 0x18, 0x6e, 0x93, 0x07, 0xc2, 0x5d, 0xe1, 0x48, 0xb6, 0x2a };
+static uint8_t aad[48] = { 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef };
+static uint8_t cbc_iv[16], cbc_hmac_pad[64];
+static uint8_t cbc_enc_keys[256], cbc_dec_keys[256];
+static cipher_constants_t cc[3];               // AES-GCM-128, 192 and 256
+static armv8_cipher_digest_t cbc_enc_arg, cbc_dec_arg;
+static job_mgr_t mgr;
+
+static uint64_t rng_next(uint64_t * rng)
+{
+    *rng ^= *rng << 13; *rng ^= *rng >> 7; *rng ^= *rng << 17;
+    return *rng;
+}
+
+static armv8_job_type_t item_type(uint32_t i)
+{
+    return (armv8_job_type_t) (i % JOB_TYPES);
+}
+
+static cipher_constants_t * item_constants(uint32_t i)
+{
+    return &cc[(i / JOB_MODE_RUN) % 3];
+}
+
+// A job for item i, pointing at the item's buffers
+static void fill_job(job_t * job, item_t * item, uint32_t i)
+{
+    memset(job, 0, sizeof(*job));
+    job->type = item_type(i);
+    job->user_data = item;
+    switch(job->type) {
+    case ARMV8_JOB_AES_GCM_ENC:
+    case ARMV8_JOB_AES_GCM_DEC:
+        job->gcm.cc = item_constants(i);
+        job->gcm.nonce = item->nonce;
+        job->gcm.nonce_bit_length = 96;
+        job->gcm.aad = aad;
+        job->gcm.aad_bit_length = (i % 41) * 8;
+        job->gcm.input = item->data;
+        job->gcm.bit_length = item->byte_length * 8;
+        job->gcm.output = item->output;
+        job->gcm.tag = item->tag;
+        break;
+    case ARMV8_JOB_AES_GCM_ENC_IPSEC:
+    case ARMV8_JOB_AES_GCM_DEC_IPSEC:
+        job->ipsec.cc = &cc[0];
+        job->ipsec.salt = 0xcafebabe;
+        job->ipsec.ESPIV = i;
+        job->ipsec.aad = aad;
+        job->ipsec.aad_byte_length = 8;
+        job->ipsec.data = item->data;
+        job->ipsec.byte_length = item->byte_length;
+        job->ipsec.tag = item->data + item->byte_length;
+        break;
+    default:
+        job->cbc_sha.csrc = item->data;
+        job->cbc_sha.cdst = item->output;
+        job->cbc_sha.clen = item->byte_length;
+        job->cbc_sha.dsrc = job->type <= ARMV8_JOB_AES_CBC_SHA256_ENC ? item->data : item->output;
+        job->cbc_sha.ddst = item->digest;
+        job->cbc_sha.dlen = item->byte_length;
+        job->cbc_sha.arg = job->type <= ARMV8_JOB_AES_CBC_SHA256_ENC ? &cbc_enc_arg : &cbc_dec_arg;
+        break;
+    }
+}
+
+// What the job manager should do for the job, by calling the API directly
+static void run_direct(job_t * job)
+{
+    item_t * item = job->user_data;
+    cipher_state_t cs = { .constants = job->gcm.cc };
+    int cbc_result = 0;
+    switch(job->type) {
+    case ARMV8_JOB_AES_GCM_ENC:
+        armv8_aes_gcm_set_counter(job->gcm.nonce, job->gcm.nonce_bit_length, &cs);
+        item->result = armv8_enc_aes_gcm_from_state(&cs, job->gcm.aad, job->gcm.aad_bit_length, job->gcm.input,
+                                                     job->gcm.bit_length, job->gcm.output, job->gcm.tag);
+        return;
+    case ARMV8_JOB_AES_GCM_DEC:
+        armv8_aes_gcm_set_counter(job->gcm.nonce, job->gcm.nonce_bit_length, &cs);
+        item->result = armv8_dec_aes_gcm_from_state(&cs, job->gcm.aad, job->gcm.aad_bit_length, job->gcm.input,
+                                                     job->gcm.bit_length, job->gcm.tag, job->gcm.output);
+        return;
+#ifdef IPSEC_ENABLED
+    case ARMV8_JOB_AES_GCM_ENC_IPSEC:
+        item->result = armv8_enc_aes_gcm_from_constants_IPsec(job->ipsec.cc, job->ipsec.salt, job->ipsec.ESPIV,
+                                                              job->ipsec.aad, job->ipsec.aad_byte_length,
+                                                              job->ipsec.data, job->ipsec.byte_length, job->ipsec.tag);
+        return;
+    case ARMV8_JOB_AES_GCM_DEC_IPSEC:
+        item->result = armv8_dec_aes_gcm_from_constants_IPsec(job->ipsec.cc, job->ipsec.salt, job->ipsec.ESPIV,
+                                                              job->ipsec.aad, job->ipsec.aad_byte_length,
+                                                              job->ipsec.data, job->ipsec.byte_length, job->ipsec.tag,
+                                                              &item->checksum);
+        return;
+#else
+    case ARMV8_JOB_AES_GCM_ENC_IPSEC:
+    case ARMV8_JOB_AES_GCM_DEC_IPSEC:
+        item->result = INVALID_PARAMETER;
+        return;
+#endif
+    case ARMV8_JOB_AES_CBC_SHA1_ENC:
+        cbc_result = armv8_enc_aes_cbc_sha1_128(job->cbc_sha.csrc, job->cbc_sha.cdst, job->cbc_sha.clen,
+                                                job->cbc_sha.dsrc, job->cbc_sha.ddst, job->cbc_sha.dlen, job->cbc_sha.arg);
+        break;
+    case ARMV8_JOB_AES_CBC_SHA256_ENC:
+        cbc_result = armv8_enc_aes_cbc_sha256_128(job->cbc_sha.csrc, job->cbc_sha.cdst, job->cbc_sha.clen,
+                                                  job->cbc_sha.dsrc, job->cbc_sha.ddst, job->cbc_sha.dlen, job->cbc_sha.arg);
+        break;
+    case ARMV8_JOB_AES_CBC_SHA1_DEC:
+        cbc_result = armv8_dec_aes_cbc_sha1_128(job->cbc_sha.csrc, job->cbc_sha.cdst, job->cbc_sha.clen,
+                                                job->cbc_sha.dsrc, job->cbc_sha.ddst, job->cbc_sha.dlen, job->cbc_sha.arg);
+        break;
+    case ARMV8_JOB_AES_CBC_SHA256_DEC:
+        cbc_result = armv8_dec_aes_cbc_sha256_128(job->cbc_sha.csrc, job->cbc_sha.cdst, job->cbc_sha.clen,
+                                                  job->cbc_sha.dsrc, job->cbc_sha.ddst, job->cbc_sha.dlen, job->cbc_sha.arg);
+        break;
+    }
+    item->result = cbc_result == 0 ? SUCCESSFUL_OPERATION : INTERNAL_FAILURE;
+}
+
+// Random inputs - decryption jobs get real ciphertext and tags, with every third tag corrupted
+static void prepare_items(item_t * items, uint64_t * rng)
+{
+    memset(items, 0, JOB_ITEMS * sizeof(item_t));
+    for( uint32_t i=0; i<JOB_ITEMS; ++i )
+    {
+        item_t * item = &items[i];
+        armv8_job_type_t type = item_type(i);
+        for( uint32_t b=0; b<12; ++b ) item->nonce[b] = (uint8_t) rng_next(rng);
+        item->byte_length = rng_next(rng) % (JOB_MAX_BYTES + 1);
+        if(type >= ARMV8_JOB_AES_CBC_SHA1_ENC) {
+            item->byte_length = (item->byte_length & ~15u) ? item->byte_length & ~15u : 16;
+        }
+        for( uint32_t b=0; b<item->byte_length; ++b ) item->data[b] = (uint8_t) rng_next(rng);
+
+        job_t job;
+        if(type == ARMV8_JOB_AES_GCM_DEC) {
+            cipher_state_t cs = { .constants = item_constants(i) };
+            fill_job(&job, item, i);
+            armv8_aes_gcm_set_counter(item->nonce, 96, &cs);
+            armv8_enc_aes_gcm_from_state(&cs, job.gcm.aad, job.gcm.aad_bit_length, item->data, item->byte_length*8,
+                                         item->data, item->tag);
+            memset(item->data + item->byte_length, 0, sizeof(item->data) - item->byte_length);
+            item->tag[0] ^= (i / JOB_TYPES) % 3 == 0;
+        }
+#ifdef IPSEC_ENABLED
+        if(type == ARMV8_JOB_AES_GCM_DEC_IPSEC) {
+            fill_job(&job, item, i);
+            armv8_enc_aes_gcm_from_constants_IPsec(&cc[0], job.ipsec.salt, job.ipsec.ESPIV, aad, 8, item->data,
+                                                   item->byte_length, item->data + item->byte_length);
+            item->data[item->byte_length] ^= (i / JOB_TYPES) % 3 == 0;
+        }
+#endif
+    }
+}
+
+// Completions must come back in order - collects their results into the items
+static bool take_completed(item_t * items, uint32_t * next, bool * in_order)
+{
+    job_t done[32];
+    uint32_t count = armv8_job_get_completed(&mgr, done, 32);
+    for( uint32_t c=0; c<count; ++c )
+    {
+        item_t * item = done[c].user_data;
+        if(item != &items[*next]) {
+            *in_order = false;
+        }
+        item->result = done[c].result;
+        if(done[c].type == ARMV8_JOB_AES_GCM_DEC_IPSEC) {
+            item->checksum = done[c].ipsec.checksum;
+        }
+        (*next)++;
+    }
+    return count != 0;
+}
+
+typedef struct consumer {
+    item_t * items;
+    bool in_order;
+} consumer_t;
+
+static void * consumer_main(void * arg)
+{
+    consumer_t * consumer = arg;
+    uint32_t next = 0;
+    while(next < JOB_ITEMS) {
+        take_completed(consumer->items, &next, &consumer->in_order);
+    }
+    return NULL;
+}
+
+// Submits every item, taking completions on this thread, or on a second thread if threaded
+static bool run_queued(item_t * items, uint32_t batch_size, bool threaded)
+{
+    pthread_t thread;
+    consumer_t consumer = { .items = items, .in_order = true };
+    uint32_t next = 0;
+    bool in_order = true;
+
+    armv8_job_mgr_init(&mgr, batch_size);
+    if(threaded) {
+        pthread_create(&thread, NULL, consumer_main, &consumer);
+    }
+    for( uint32_t i=0; i<JOB_ITEMS; ++i )
+    {
+        job_t * job;
+        while((job = armv8_job_get_next(&mgr)) == NULL) {
+            if(!threaded) take_completed(items, &next, &in_order);
+        }
+        fill_job(job, &items[i], i);
+        armv8_job_submit(&mgr);
+        if(!threaded && i % 5 == 0) take_completed(items, &next, &in_order);
+    }
+    armv8_job_flush(&mgr);
+    if(threaded) {
+        pthread_join(thread, NULL);
+        in_order = consumer.in_order;
+    } else {
+        while(take_completed(items, &next, &in_order));
+        in_order &= next == JOB_ITEMS;
+    }
+    return in_order;
+}
+
+// A partial batch only runs on flush, and a full ring refuses more jobs until completions are taken
+static bool test_queue_limits(item_t * items)
+{
+    job_t done[ARMV8_JOB_RING_SIZE];
+    bool passed = true;
+
+    if(armv8_job_mgr_init(&mgr, 0) != INVALID_PARAMETER ||
+       armv8_job_mgr_init(&mgr, ARMV8_JOB_MAX_BATCH + 1) != INVALID_PARAMETER) {
+        printf("Invalid batch size was not rejected\n");
+        passed = false;
+    }
+
+    armv8_job_mgr_init(&mgr, 4);
+    for( uint32_t i=0; i<3; ++i )
+    {
+        fill_job(armv8_job_get_next(&mgr), &items[i], i);
+        passed &= armv8_job_submit(&mgr) == 0;
+    }
+    passed &= armv8_job_get_completed(&mgr, done, ARMV8_JOB_RING_SIZE) == 0;
+    passed &= armv8_job_flush(&mgr) == 3 && armv8_job_get_completed(&mgr, done, ARMV8_JOB_RING_SIZE) == 3;
+    if(!passed) {
+        printf("Partial batch did not wait for flush\n");
+    }
+
+    armv8_job_mgr_init(&mgr, 1);
+    for( uint32_t i=0; i<ARMV8_JOB_RING_SIZE; ++i )
+    {
+        job_t * job = armv8_job_get_next(&mgr);
+        if(job == NULL) {
+            printf("Ring full after %u jobs\n", i);
+            return false;
+        }
+        fill_job(job, &items[i % 8], i % 8);
+        armv8_job_submit(&mgr);
+    }
+    if(armv8_job_get_next(&mgr) != NULL) {
+        printf("Full ring accepted another job\n");
+        passed = false;
+    }
+    if(armv8_job_get_completed(&mgr, done, 10) != 10 || armv8_job_get_next(&mgr) == NULL) {
+        printf("Taking completions did not free ring slots\n");
+        passed = false;
+    }
+    return passed;
+}
+
+static bool lane_item(const item_t * items, uint32_t i)
+{
+    return (item_type(i) == ARMV8_JOB_AES_GCM_ENC || item_type(i) == ARMV8_JOB_AES_GCM_DEC) &&
+           items[i].byte_length <= ARMV8_JOB_GCM_LANE_MAX_BYTES;
+}
+
+// Queues the items whose AES-GCM jobs can run in lanes, and only those, in full batches
+static bool test_gcm_lanes(item_t * items, const item_t * expected)
+{
+    job_t done[ARMV8_JOB_RING_SIZE];
+    uint32_t submitted = 0, completed = 0;
+    bool passed = true;
+
+    armv8_job_mgr_init(&mgr, ARMV8_JOB_MAX_BATCH);
+    for( uint32_t i=0; i<JOB_ITEMS; ++i )
+    {
+        if(!lane_item(items, i)) continue;
+        job_t * job;
+        while((job = armv8_job_get_next(&mgr)) == NULL) {
+            uint32_t count = armv8_job_get_completed(&mgr, done, ARMV8_JOB_RING_SIZE);
+            for( uint32_t c=0; c<count; ++c ) ((item_t *) done[c].user_data)->result = done[c].result;
+            completed += count;
+        }
+        fill_job(job, &items[i], i);
+        armv8_job_submit(&mgr);
+        submitted++;
+    }
+    armv8_job_flush(&mgr);
+    uint32_t count = armv8_job_get_completed(&mgr, done, ARMV8_JOB_RING_SIZE);
+    for( uint32_t c=0; c<count; ++c ) ((item_t *) done[c].user_data)->result = done[c].result;
+    completed += count;
+    if(completed != submitted) {
+        printf("Only %u of %u short AES-GCM jobs completed\n", completed, submitted);
+        passed = false;
+    }
+
+    for( uint32_t i=0; i<JOB_ITEMS; ++i )
+    {
+        if(lane_item(items, i) && memcmp(&items[i], &expected[i], sizeof(item_t)) != 0) {
+            printf("Job %u (type %d) mismatch: short AES-GCM jobs only\n", i, item_type(i));
+            passed = false;
+            break;
+        }
+    }
+    return passed;
+}
+
+// Runs the jobs through a manager, returning the time taken
+static uint64_t time_queued(const job_t * jobs, uint32_t n, uint32_t batch_size)
+{
+    job_t done[ARMV8_JOB_RING_SIZE];
+    armv8_job_mgr_init(&mgr, batch_size);
+    uint64_t start = timing_now_ns();
+    for( uint32_t i=0; i<JOB_TIMED_ITEMS; ++i )
+    {
+        job_t * job = armv8_job_get_next(&mgr);
+        if(job == NULL) {
+            armv8_job_get_completed(&mgr, done, ARMV8_JOB_RING_SIZE);
+            job = armv8_job_get_next(&mgr);
+        }
+        *job = jobs[i % n];
+        armv8_job_submit(&mgr);
+    }
+    armv8_job_flush(&mgr);
+    armv8_job_get_completed(&mgr, done, ARMV8_JOB_RING_SIZE);
+    return timing_now_ns() - start;
+}
+
+// AES-GCM encryption jobs called directly against through the queue, one at a time and in batches whose short jobs
+// run in lanes if they are built
+static void time_gcm_jobs(item_t * items)
+{
+    static const uint32_t sizes[] = { 64, 256, ARMV8_JOB_GCM_LANE_MAX_BYTES, JOB_MAX_BYTES };
+    static const uint32_t batch_sizes[] = { 1, 16 };
+    static const uint32_t key_bits[] = { 128, 192, 256 };
+    job_t jobs[JOB_TYPES * 4];
+
+#ifdef ARMV8_JOB_GCM_LANES_ENABLED
+    printf("AES-GCM job lanes: on, %u lanes for jobs of up to %uB\n", ARMV8_JOB_GCM_LANES, ARMV8_JOB_GCM_LANE_MAX_BYTES);
+#else
+    printf("AES-GCM job lanes: off\n");
+#endif
+    for( uint32_t m=0; m<3; ++m )
+    {
+        for( uint32_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s )
+        {
+            uint32_t n = 0;
+            for( uint32_t i=0; n<sizeof(jobs)/sizeof(jobs[0]); ++i )
+            {
+                if(item_type(i) != ARMV8_JOB_AES_GCM_ENC) continue;
+                items[i].byte_length = sizes[s];
+                fill_job(&jobs[n], &items[i], i);
+                jobs[n++].gcm.cc = &cc[m];
+            }
+
+            uint64_t start = timing_now_ns();
+            for( uint32_t i=0; i<JOB_TIMED_ITEMS; ++i ) run_direct(&jobs[i % n]);
+            uint64_t direct_ns = timing_now_ns() - start;
+            printf("AES-GCM-%u %4uB jobs: direct %7.1f ns/job %7.1f MB/s", key_bits[m], sizes[s],
+                   (double) direct_ns / JOB_TIMED_ITEMS, (double) sizes[s] * JOB_TIMED_ITEMS * 1000 / direct_ns);
+            for( uint32_t b=0; b<sizeof(batch_sizes)/sizeof(batch_sizes[0]); ++b )
+            {
+                uint64_t queued_ns = time_queued(jobs, n, batch_sizes[b]);
+                printf(", batches of %2u %7.1f ns/job %7.1f MB/s", batch_sizes[b], (double) queued_ns / JOB_TIMED_ITEMS,
+                       (double) sizes[s] * JOB_TIMED_ITEMS * 1000 / queued_ns);
+            }
+            printf("\n");
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    static const uint32_t batch_sizes[] = { 1, 7, 16, ARMV8_JOB_MAX_BATCH };
+    item_t * inputs = malloc(JOB_ITEMS * sizeof(item_t));
+    item_t * expected = malloc(JOB_ITEMS * sizeof(item_t));
+    item_t * queued = malloc(JOB_ITEMS * sizeof(item_t));
+    uint64_t rng = 0x9e3779b97f4a7c15ull;
+    bool passed = true;
+
+    armv8_aes_gcm_set_constants(AES_GCM_128, 16, key, &cc[0]);
+    armv8_aes_gcm_set_constants(AES_GCM_192, 16, key, &cc[1]);
+    armv8_aes_gcm_set_constants(AES_GCM_256, 16, key, &cc[2]);
+    armv8_expandkeys_enc_aes_cbc_128(cbc_enc_keys, key);
+    armv8_expandkeys_dec_aes_cbc_128(cbc_dec_keys, key);
+    cbc_enc_arg = (armv8_cipher_digest_t) { .cipher = { .key = cbc_enc_keys, .iv = cbc_iv },
+                                            .digest.hmac = { key, cbc_hmac_pad, cbc_hmac_pad } };
+    cbc_dec_arg = cbc_enc_arg;
+    cbc_dec_arg.cipher.key = cbc_dec_keys;
+
+    prepare_items(inputs, &rng);
+    memcpy(expected, inputs, JOB_ITEMS * sizeof(item_t));
+    for( uint32_t i=0; i<JOB_ITEMS; ++i )
+    {
+        job_t job;
+        fill_job(&job, &expected[i], i);
+        run_direct(&job);
+    }
+
+    for( uint32_t b=0; b<sizeof(batch_sizes)/sizeof(batch_sizes[0]); ++b )
+    {
+        for( int threaded=0; threaded<2; ++threaded )
+        {
+            memcpy(queued, inputs, JOB_ITEMS * sizeof(item_t));
+            if(!run_queued(queued, batch_sizes[b], threaded)) {
+                printf("Completions out of order: batches of %u%s\n", batch_sizes[b], threaded ? ", threaded" : "");
+                passed = false;
+            }
+            for( uint32_t i=0; i<JOB_ITEMS; ++i )
+            {
+                if(memcmp(&queued[i], &expected[i], sizeof(item_t)) != 0) {
+                    printf("Job %u (type %d) mismatch: batches of %u%s\n", i, item_type(i), batch_sizes[b],
+                           threaded ? ", threaded" : "");
+                    passed = false;
+                    break;
+                }
+            }
+        }
+    }
+    uint32_t failures = 0;
+    for( uint32_t i=0; i<JOB_ITEMS; ++i ) failures += expected[i].result == AUTHENTICATION_FAILURE;
+    if(failures == 0) {
+        printf("No corrupted tag failed authentication\n");
+        passed = false;
+    }
+
+    memcpy(queued, inputs, JOB_ITEMS * sizeof(item_t));
+    passed &= test_gcm_lanes(queued, expected);
+    passed &= test_queue_limits(queued);
+    time_gcm_jobs(queued);
+
+    free(inputs);
+    free(expected);
+    free(queued);
+    if(!passed) {
+        printf("Failed\n");
+        return 1;
+    }
+    printf("Success\n");
+    return 0;
+}
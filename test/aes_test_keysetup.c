@@ -0,0 +1,501 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Key setup and SA churn
+//// Times the per key and per nonce setup calls - key expansion for AES-GCM and AES-CBC,
+//// set_counter with 96b and other IV lengths, and the HMAC ipad/opad precompute - in
+//// setups per second and cycles per setup, on one or more pinned threads.
+//// The rekey scenario forwards traffic over a table of SAs and compares the throughput
+//// with and without SAs being re-keyed in between packets
+
+#define _GNU_SOURCE
+#define NDEBUG
+#include <assert.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "AArch64cryptolib.h"
+#include "test_timing.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define cipher_constants_t  armv8_cipher_constants_t
+#define cipher_state_t      armv8_cipher_state_t
+#define cipher_mode_t       armv8_cipher_mode_t
+
+#define KEYSETUP_MAX_THREADS    1024
+#define KEYSETUP_KEY_POOL       64      // keys cycled through, so every setup sees a different key
+#define KEYSETUP_HMAC_BLOCK     64
+#define KEYSETUP_AAD_BYTES      8
+#define KEYSETUP_TAG_BYTES      16
+
+typedef enum keysetup_benchmark {
+    KEYSETUP_GCM_128,
+    KEYSETUP_GCM_192,
+    KEYSETUP_GCM_256,
+    KEYSETUP_GCM_COUNTER_96,
+    KEYSETUP_GCM_COUNTER_64,
+    KEYSETUP_GCM_COUNTER_128,
+    KEYSETUP_GCM_COUNTER_1024,
+    KEYSETUP_CBC_ENC,
+    KEYSETUP_CBC_DEC,
+    KEYSETUP_HMAC_SHA1,
+    KEYSETUP_HMAC_SHA256,
+    KEYSETUP_REKEY,
+    KEYSETUP_BENCHMARK_COUNT
+} keysetup_benchmark_t;
+
+static const char * keysetup_names[KEYSETUP_BENCHMARK_COUNT] = {
+    "gcm_set_constants_128",
+    "gcm_set_constants_192",
+    "gcm_set_constants_256",
+    "gcm_set_counter_96",
+    "gcm_set_counter_64",
+    "gcm_set_counter_128",
+    "gcm_set_counter_1024",
+    "cbc_expandkeys_enc_128",
+    "cbc_expandkeys_dec_128",
+    "hmac_sha1_pads",
+    "hmac_sha256_pads",
+    "rekey",
+};
+
+typedef struct keysetup_options {
+    bool benchmarks[KEYSETUP_BENCHMARK_COUNT];
+    uint64_t count;             // setups, or packets for the rekey scenario, per trial per thread
+    uint32_t cpus[KEYSETUP_MAX_THREADS];
+    uint32_t threads;
+    //// rekey scenario
+    cipher_mode_t gcm_mode;
+    uint32_t key_bits;
+    uint32_t sas;
+    uint32_t bytes;
+    uint32_t rekey_interval;    // packets forwarded between each rekey
+    timing_options_t timing;
+} keysetup_options_t;
+
+//// Per thread results - for the rekey scenario timing is forwarding only, and rekey_timing
+//// is forwarding with rekeys
+typedef struct keysetup_worker {
+    pthread_t thread;
+    uint32_t cpu;
+    keysetup_benchmark_t benchmark;
+    const keysetup_options_t * options;
+    pthread_barrier_t * start;
+    bool pinned;
+    operation_result_t result;
+    timing_result_t timing;
+    timing_result_t rekey_timing;
+    uint64_t rekeys;            // rekeys per trial
+} keysetup_worker_t;
+
+//// HMAC ipad/opad precompute - hash of one block of the padded key XOR 0x36 and 0x5c
+static inline void hmac_pads(bool sha256, const uint8_t * key, uint32_t key_bytes, uint8_t * i_key_pad, uint8_t * o_key_pad)
+{
+    uint8_t ipad[KEYSETUP_HMAC_BLOCK], opad[KEYSETUP_HMAC_BLOCK];
+    for(uint32_t i=0; i<KEYSETUP_HMAC_BLOCK; ++i) {
+        uint8_t k = (i < key_bytes) ? key[i] : 0;
+        ipad[i] = k ^ 0x36;
+        opad[i] = k ^ 0x5c;
+    }
+    if(sha256) {
+        armv8_sha256_block_partial(NULL, ipad, i_key_pad, KEYSETUP_HMAC_BLOCK);
+        armv8_sha256_block_partial(NULL, opad, o_key_pad, KEYSETUP_HMAC_BLOCK);
+    } else {
+        armv8_sha1_block_partial(NULL, ipad, i_key_pad, KEYSETUP_HMAC_BLOCK);
+        armv8_sha1_block_partial(NULL, opad, o_key_pad, KEYSETUP_HMAC_BLOCK);
+    }
+}
+
+static inline operation_result_t run_setups(keysetup_benchmark_t benchmark, uint64_t count, uint8_t (*keys)[128],
+                                            cipher_constants_t * cc, uint8_t * output)
+{
+    operation_result_t result = SUCCESSFUL_OPERATION;
+    cipher_state_t cs = { .constants = cc };
+    for(uint64_t i=0; i<count; ++i) {
+        uint8_t * key = keys[i % KEYSETUP_KEY_POOL];
+        switch(benchmark)
+        {
+            case KEYSETUP_GCM_128:
+                result |= armv8_aes_gcm_set_constants(AES_GCM_128, KEYSETUP_TAG_BYTES, key, cc);
+                break;
+            case KEYSETUP_GCM_192:
+                result |= armv8_aes_gcm_set_constants(AES_GCM_192, KEYSETUP_TAG_BYTES, key, cc);
+                break;
+            case KEYSETUP_GCM_256:
+                result |= armv8_aes_gcm_set_constants(AES_GCM_256, KEYSETUP_TAG_BYTES, key, cc);
+                break;
+            //// IVs other than 96b are hashed with the key, so they are a per packet cost too
+            case KEYSETUP_GCM_COUNTER_96:
+                result |= armv8_aes_gcm_set_counter(key, 96, &cs);
+                break;
+            case KEYSETUP_GCM_COUNTER_64:
+                result |= armv8_aes_gcm_set_counter(key, 64, &cs);
+                break;
+            case KEYSETUP_GCM_COUNTER_128:
+                result |= armv8_aes_gcm_set_counter(key, 128, &cs);
+                break;
+            case KEYSETUP_GCM_COUNTER_1024:
+                result |= armv8_aes_gcm_set_counter(key, 1024, &cs);
+                break;
+            case KEYSETUP_CBC_ENC:
+                armv8_expandkeys_enc_aes_cbc_128(output, key);
+                break;
+            case KEYSETUP_CBC_DEC:
+                armv8_expandkeys_dec_aes_cbc_128(output, key);
+                break;
+            case KEYSETUP_HMAC_SHA1:
+                hmac_pads(false, key, 20, output, output + 64);
+                break;
+            case KEYSETUP_HMAC_SHA256:
+                hmac_pads(true, key, 32, output, output + 64);
+                break;
+            default:
+                result |= INVALID_PARAMETER;
+                break;
+        }
+    }
+    return result;
+}
+
+//// Forward count packets round robin over the SA table, re-keying the next SA every
+//// rekey_interval packets (never if 0), returning the number of rekeys done
+static inline uint64_t forward(const keysetup_options_t * options, uint64_t count, uint32_t rekey_interval,
+                               cipher_constants_t * sas, uint8_t (*keys)[128], uint8_t * nonce, uint8_t * aad,
+                               uint8_t * packet, uint64_t * rekey_cursor, operation_result_t * result)
+{
+    uint64_t rekeys = 0;
+    uint32_t sa = 0;
+    uint32_t next_rekey = rekey_interval;
+    for(uint64_t i=0; i<count; ++i) {
+        cipher_state_t cs = { .constants = &sas[sa] };
+        *result |= armv8_aes_gcm_set_counter(nonce, 96, &cs);
+        *result |= armv8_enc_aes_gcm_from_state(&cs, aad, KEYSETUP_AAD_BYTES*8, packet, (uint64_t) options->bytes*8,
+                                                packet, packet + options->bytes);
+        if(++sa == options->sas) sa = 0;
+        if(rekey_interval && --next_rekey == 0) {
+            uint32_t target = (uint32_t) (*rekey_cursor % options->sas);
+            *result |= armv8_aes_gcm_set_constants(options->gcm_mode, KEYSETUP_TAG_BYTES,
+                                                   keys[*rekey_cursor % KEYSETUP_KEY_POOL], &sas[target]);
+            (*rekey_cursor)++;
+            rekeys++;
+            next_rekey = rekey_interval;
+        }
+    }
+    return rekeys;
+}
+
+void * worker_main(void * arg)
+{
+    keysetup_worker_t * w = (keysetup_worker_t *) arg;
+    const keysetup_options_t * options = w->options;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(w->cpu, &set);
+    w->pinned = (sched_setaffinity(0, sizeof(set), &set) == 0);
+
+    uint64_t seed = 0x9e3779b97f4a7c15ull * (w->cpu + 1);
+    uint8_t (*keys)[128] = aligned_alloc(64, KEYSETUP_KEY_POOL * 128);
+    uint8_t * output = aligned_alloc(64, 512);
+    cipher_constants_t * sas = NULL;
+    uint8_t * packet = NULL;
+    uint8_t nonce[16] = {0}, aad[16] = {0};
+    cipher_constants_t cc;
+    for(uint32_t k=0; k<KEYSETUP_KEY_POOL; ++k) {
+        for(uint32_t i=0; i<128; ++i) {
+            seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+            keys[k][i] = (uint8_t) seed;
+        }
+    }
+    armv8_aes_gcm_set_constants(AES_GCM_128, KEYSETUP_TAG_BYTES, keys[0], &cc);
+
+    timing_counters_t counters;
+    timing_sample_t samples[TIMING_MAX_TRIALS];
+    timing_sample_t rekey_samples[TIMING_MAX_TRIALS];
+    uint64_t warmup_count = timing_warmup_count(&options->timing, options->count/10);
+    operation_result_t result = SUCCESSFUL_OPERATION;
+    uint64_t rekey_cursor = 0;
+
+    if(w->benchmark == KEYSETUP_REKEY) {
+        sas = aligned_alloc(64, options->sas * sizeof(cipher_constants_t));
+        packet = aligned_alloc(64, options->bytes + 64);
+        memset(packet, 0x5a, options->bytes + 64);
+        for(uint32_t s=0; s<options->sas; ++s) {
+            result |= armv8_aes_gcm_set_constants(options->gcm_mode, KEYSETUP_TAG_BYTES, keys[s % KEYSETUP_KEY_POOL], &sas[s]);
+        }
+        forward(options, warmup_count, 0, sas, keys, nonce, aad, packet, &rekey_cursor, &result);
+    } else {
+        run_setups(w->benchmark, warmup_count, keys, &cc, output);
+    }
+
+    timing_counters_open(&counters, options->timing.use_pmu);
+    pthread_barrier_wait(w->start);
+    for(uint32_t trial=0; trial<options->timing.trials; ++trial) {
+        if(w->benchmark == KEYSETUP_REKEY) {
+            //// alternate the trials with and without rekeys, so both see the same conditions
+            timing_start(&counters, &samples[trial]);
+            forward(options, options->count, 0, sas, keys, nonce, aad, packet, &rekey_cursor, &result);
+            timing_stop(&counters, &samples[trial]);
+            timing_start(&counters, &rekey_samples[trial]);
+            w->rekeys = forward(options, options->count, options->rekey_interval, sas, keys, nonce, aad, packet,
+                                &rekey_cursor, &result);
+            timing_stop(&counters, &rekey_samples[trial]);
+        } else {
+            timing_start(&counters, &samples[trial]);
+            result |= run_setups(w->benchmark, options->count, keys, &cc, output);
+            timing_stop(&counters, &samples[trial]);
+        }
+    }
+    timing_counters_close(&counters);
+
+    w->result = result;
+    w->timing.success = (result == SUCCESSFUL_OPERATION);
+    timing_summarize(samples, options->timing.trials, options->count, &w->timing);
+    if(w->benchmark == KEYSETUP_REKEY) {
+        w->rekey_timing.success = w->timing.success;
+        timing_summarize(rekey_samples, options->timing.trials, options->count, &w->rekey_timing);
+    }
+
+    free(keys);
+    free(output);
+    free(sas);
+    free(packet);
+    return NULL;
+}
+
+void report_begin(timing_format_t format)
+{
+    if(format == TIMING_FORMAT_CSV) {
+        printf("benchmark,threads,count,trials,ns_per_op,ns_per_op_stddev,ops_per_second,cycles_per_op,"
+               "gbps,rekeys_per_second,ns_per_rekey,cycles_per_rekey,result\n");
+    } else if(format == TIMING_FORMAT_JSON) {
+        printf("[");
+    }
+}
+
+void report_end(timing_format_t format)
+{
+    if(format == TIMING_FORMAT_JSON) {
+        printf("\n]\n");
+    }
+}
+
+//// One row per benchmark - times are the mean over the threads of each thread's median, and
+//// rates are summed over the threads
+void report(const keysetup_options_t * options, const char * name, const keysetup_worker_t * workers,
+            bool rekey, uint64_t index)
+{
+    double ns = 0.0, stddev = 0.0, cycles = 0.0, ops_per_second = 0.0;
+    double rekeys_per_second = 0.0, ns_per_rekey = 0.0, cycles_per_rekey = 0.0;
+    bool success = true;
+    for(uint32_t t=0; t<options->threads; ++t) {
+        const timing_result_t * timing = rekey ? &workers[t].rekey_timing : &workers[t].timing;
+        ns += timing->ns_per_run / options->threads;
+        stddev += timing->ns_per_run_stddev / options->threads;
+        cycles += timing->cycles_per_run / options->threads;
+        if(timing->ns_per_run > 0.0) ops_per_second += 1e9 / timing->ns_per_run;
+        success &= timing->success;
+        if(rekey && workers[t].rekeys) {
+            //// the extra time per trial over forwarding alone, shared over the rekeys
+            double extra_ns = (workers[t].rekey_timing.ns_per_run - workers[t].timing.ns_per_run) * options->count;
+            double extra_cycles = (workers[t].rekey_timing.cycles_per_run - workers[t].timing.cycles_per_run) * options->count;
+            rekeys_per_second += workers[t].rekeys * 1e9 / (workers[t].rekey_timing.ns_per_run * options->count);
+            ns_per_rekey += extra_ns / workers[t].rekeys / options->threads;
+            cycles_per_rekey += extra_cycles / workers[t].rekeys / options->threads;
+        }
+    }
+    bool forwarding = (strncmp(name, "forward", 7) == 0);
+    double gbps = forwarding ? ops_per_second * options->bytes * 8.0 / 1e9 : 0.0;
+
+    switch(options->timing.format)
+    {
+        case TIMING_FORMAT_CSV:
+            printf("%s,%u,%lu,%u,%.2f,%.2f,%.0f,%.2f,%.3f,%.0f,%.2f,%.2f,%s\n", name, options->threads, options->count,
+                   options->timing.trials, ns, stddev, ops_per_second, cycles, gbps, rekeys_per_second,
+                   ns_per_rekey, cycles_per_rekey, success ? "Success" : "Failure");
+            break;
+        case TIMING_FORMAT_JSON:
+            printf("%s\n  {\"benchmark\": \"%s\", \"threads\": %u, \"count\": %lu, \"trials\": %u, \"ns_per_op\": %.2f, "
+                   "\"ns_per_op_stddev\": %.2f, \"ops_per_second\": %.0f, \"cycles_per_op\": %.2f, \"gbps\": %.3f, "
+                   "\"rekeys_per_second\": %.0f, \"ns_per_rekey\": %.2f, \"cycles_per_rekey\": %.2f, \"success\": %s}",
+                   index ? "," : "", name, options->threads, options->count, options->timing.trials, ns, stddev,
+                   ops_per_second, cycles, gbps, rekeys_per_second, ns_per_rekey, cycles_per_rekey,
+                   success ? "true" : "false");
+            break;
+        default:
+            if(forwarding) {
+                printf("%-24s %10.0f packets/s %8.3f Gb/s  %8.2f ns/packet", name, ops_per_second, gbps, ns);
+            } else {
+                printf("%-24s %10.0f setups/s  %8.2f ns/setup (stddev %.2f)", name, ops_per_second, ns, stddev);
+            }
+            if(cycles > 0.0) printf("  %8.2f cycles", cycles);
+            printf("  %s\n", success ? "Success" : "Failure");
+            if(rekey) {
+                printf("%-24s %10.0f rekeys/s   %8.2f ns/rekey", "", rekeys_per_second, ns_per_rekey);
+                if(cycles_per_rekey > 0.0) printf("  %8.2f cycles/rekey", cycles_per_rekey);
+                printf(" (over forwarding alone)\n");
+            }
+            break;
+    }
+}
+
+void run_benchmark(const keysetup_options_t * options, keysetup_benchmark_t benchmark, uint64_t * report_index)
+{
+    keysetup_worker_t * workers = calloc(options->threads, sizeof(keysetup_worker_t));
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, options->threads);
+    for(uint32_t t=0; t<options->threads; ++t) {
+        workers[t].cpu = options->cpus[t];
+        workers[t].benchmark = benchmark;
+        workers[t].options = options;
+        workers[t].start = &start;
+        pthread_create(&workers[t].thread, NULL, worker_main, &workers[t]);
+    }
+    for(uint32_t t=0; t<options->threads; ++t) {
+        pthread_join(workers[t].thread, NULL);
+        if(!workers[t].pinned && options->timing.format == TIMING_FORMAT_TEXT) {
+            printf("thread %u could not be pinned to cpu %u\n", t, workers[t].cpu);
+        }
+    }
+    if(benchmark == KEYSETUP_REKEY) {
+        report(options, "forward", workers, false, (*report_index)++);
+        report(options, "forward_rekey", workers, true, (*report_index)++);
+    } else {
+        report(options, keysetup_names[benchmark], workers, false, (*report_index)++);
+    }
+    pthread_barrier_destroy(&start);
+    free(workers);
+}
+
+//// Parse a CPU list such as 0-3,8,10-11
+uint32_t parse_cpus(const char * list, uint32_t * cpus)
+{
+    uint32_t count = 0;
+    const char * p = list;
+    while(*p && count < KEYSETUP_MAX_THREADS) {
+        char * end;
+        uint32_t first = (uint32_t) strtoul(p, &end, 10);
+        uint32_t last = first;
+        if(end == p) break;
+        if(*end == '-') {
+            p = end + 1;
+            last = (uint32_t) strtoul(p, &end, 10);
+        }
+        for(uint32_t cpu=first; cpu<=last && count < KEYSETUP_MAX_THREADS; ++cpu) {
+            cpus[count++] = cpu;
+        }
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    keysetup_options_t options = {
+        .count = 100000,
+        .threads = 0,
+        .gcm_mode = AES_GCM_128,
+        .key_bits = 128,
+        .sas = 10000,
+        .bytes = 1500,
+        .rekey_interval = 16,
+        .timing = TIMING_DEFAULT_OPTIONS };
+    uint32_t cpu_count = 0;
+    uint32_t threads = 1;
+    bool selected = false;
+
+    for(int i=1; i<argc; ) {
+        int consumed = timing_parse_option(argc, argv, i, &options.timing);
+        if(consumed) {
+            i += consumed;
+            continue;
+        }
+        if(i+1 >= argc) {
+            printf("Unknown or incomplete option %s\n", argv[i]);
+            return 1;
+        }
+        if(strcmp(argv[i], "--count") == 0) {
+            options.count = strtoul(argv[i+1], NULL, 10);
+            if(options.count == 0) options.count = 1;
+        } else if(strcmp(argv[i], "--threads") == 0) {
+            threads = (uint32_t) strtoul(argv[i+1], NULL, 10);
+        } else if(strcmp(argv[i], "--cpus") == 0) {
+            cpu_count = parse_cpus(argv[i+1], options.cpus);
+        } else if(strcmp(argv[i], "--sas") == 0) {
+            options.sas = (uint32_t) strtoul(argv[i+1], NULL, 10);
+            if(options.sas == 0) options.sas = 1;
+        } else if(strcmp(argv[i], "--size") == 0) {
+            options.bytes = (uint32_t) strtoul(argv[i+1], NULL, 10);
+            if(options.bytes == 0) options.bytes = 1;
+        } else if(strcmp(argv[i], "--rekey-interval") == 0) {
+            options.rekey_interval = (uint32_t) strtoul(argv[i+1], NULL, 10);
+            if(options.rekey_interval == 0) options.rekey_interval = 1;
+        } else if(strcmp(argv[i], "--key-length") == 0) {
+            options.key_bits = (uint32_t) strtoul(argv[i+1], NULL, 10);
+            switch(options.key_bits)
+            {
+                case 128: options.gcm_mode = AES_GCM_128; break;
+                case 192: options.gcm_mode = AES_GCM_192; break;
+                case 256: options.gcm_mode = AES_GCM_256; break;
+                default:
+                    printf("Key length must be 128, 192 or 256\n");
+                    return 1;
+            }
+        } else if(strcmp(argv[i], "--benchmark") == 0) {
+            keysetup_benchmark_t benchmark;
+            for(benchmark=0; benchmark<KEYSETUP_BENCHMARK_COUNT; ++benchmark) {
+                if(strcmp(argv[i+1], keysetup_names[benchmark]) == 0) break;
+            }
+            if(benchmark == KEYSETUP_BENCHMARK_COUNT) {
+                printf("Unknown benchmark %s\n", argv[i+1]);
+                return 1;
+            }
+            options.benchmarks[benchmark] = true;
+            selected = true;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        i += 2;
+    }
+    if(!selected) {
+        for(keysetup_benchmark_t benchmark=0; benchmark<KEYSETUP_BENCHMARK_COUNT; ++benchmark) {
+            options.benchmarks[benchmark] = true;
+        }
+    }
+
+    //// default to the CPUs this process may run on, in order
+    if(cpu_count == 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if(sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for(uint32_t cpu=0; cpu<CPU_SETSIZE && cpu_count < KEYSETUP_MAX_THREADS; ++cpu) {
+                if(CPU_ISSET(cpu, &set)) options.cpus[cpu_count++] = cpu;
+            }
+        }
+        if(cpu_count == 0) options.cpus[cpu_count++] = 0;
+    }
+    options.threads = (threads == 0 || threads > cpu_count) ? cpu_count : threads;
+
+    if(options.timing.format == TIMING_FORMAT_TEXT) {
+        printf("%u thread%s, %lu setups per trial, %u trials\n", options.threads, options.threads > 1 ? "s" : "",
+               options.count, options.timing.trials);
+    }
+    uint64_t report_index = 0;
+    report_begin(options.timing.format);
+    for(keysetup_benchmark_t benchmark=0; benchmark<KEYSETUP_BENCHMARK_COUNT; ++benchmark) {
+        if(!options.benchmarks[benchmark]) continue;
+        if(benchmark == KEYSETUP_REKEY && options.timing.format == TIMING_FORMAT_TEXT) {
+            printf("Forwarding %u byte packets over %u SAs (%u-bit keys), re-keying an SA every %u packets\n",
+                   options.bytes, options.sas, options.key_bits, options.rekey_interval);
+        }
+        run_benchmark(&options, benchmark, &report_index);
+    }
+    report_end(options.timing.format);
+
+    return 0;
+}
@@ -0,0 +1,532 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Per call latency of the AES-GCM and AES-CBC-SHA interfaces
+//// Every call is timestamped with the generic timer, and the distribution of the
+//// calls is reported as percentiles rather than as the average over a long run -
+//// for small buffers the per call setup and finalize costs dominate
+
+#define NDEBUG
+#include <assert.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "AArch64cryptolib.h"
+#include "test_timing.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define cipher_constants_t  armv8_cipher_constants_t
+#define cipher_state_t      armv8_cipher_state_t
+#define cipher_mode_t       armv8_cipher_mode_t
+#define cipher_digest_t     armv8_cipher_digest_t
+
+#define LATENCY_MAX_SIZES   16
+#define LATENCY_MAX_BYTES   16384
+#define LATENCY_AAD_BYTES   8
+#define LATENCY_TAG_BYTES   16
+#define LATENCY_SALT        0x01020304
+#define LATENCY_CALIBRATION_READS 10000
+
+typedef enum latency_api {
+    LATENCY_GCM_ENC_FULL,
+    LATENCY_GCM_DEC_FULL,
+    LATENCY_GCM_ENC_FROM_STATE,
+    LATENCY_GCM_DEC_FROM_STATE,
+    LATENCY_GCM_ENC_IPSEC,
+    LATENCY_GCM_DEC_IPSEC,
+    LATENCY_CBC_SHA1_ENC,
+    LATENCY_CBC_SHA1_DEC,
+    LATENCY_CBC_SHA256_ENC,
+    LATENCY_CBC_SHA256_DEC,
+    LATENCY_API_COUNT
+} latency_api_t;
+
+static const char * latency_api_names[LATENCY_API_COUNT] = {
+    "gcm_enc_full",
+    "gcm_dec_full",
+    "gcm_enc_from_state",
+    "gcm_dec_from_state",
+    "gcm_enc_ipsec",
+    "gcm_dec_ipsec",
+    "cbc_sha1_enc",
+    "cbc_sha1_dec",
+    "cbc_sha256_enc",
+    "cbc_sha256_dec",
+};
+
+//// One entry of the key pool - a key with everything derived from it, and a reference
+//// ciphertext and tag for the current size so that decryption takes the successful path
+typedef struct latency_key {
+    uint8_t key[32];
+    cipher_constants_t cc;
+    uint8_t cbc_enc_keys[256];
+    uint8_t cbc_dec_keys[256];
+    uint8_t hmac_pads[128];
+    uint8_t * gcm_ct;       // ciphertext and tag from enc_full/enc_from_state
+    uint8_t * ipsec_ct;     // ciphertext with the tag appended from enc_from_constants_IPsec
+    uint8_t * cbc_sha1_ct;
+    uint8_t * cbc_sha256_ct;
+} latency_key_t;
+
+typedef struct latency_options {
+    cipher_mode_t mode;
+    uint32_t key_bits;
+    uint32_t sizes[LATENCY_MAX_SIZES];
+    uint32_t size_count;
+    uint64_t samples;
+    uint32_t pool_size;     // 1 for a single hot key, otherwise a random key from the pool for every call
+    double cycles_per_tick; // 0 if it can't be measured and wasn't given
+    bool apis[LATENCY_API_COUNT];
+    timing_options_t timing;
+} latency_options_t;
+
+typedef struct latency_buffers {
+    uint8_t * aad;
+    uint8_t * nonce;
+    uint8_t * plaintext;
+    uint8_t * work;
+    uint8_t * output;
+    uint8_t * tag;
+    uint8_t * digest;
+} latency_buffers_t;
+
+//// xorshift - only needs to be cheap and spread the key choice over the pool
+static inline uint64_t latency_random(uint64_t * x)
+{
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+static int compare_uint64(const void * a, const void * b)
+{
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+//// Median cost of two back to back timer reads, subtracted from every sample
+uint64_t calibrate_timer_overhead(void)
+{
+    uint64_t * reads = malloc(LATENCY_CALIBRATION_READS * sizeof(uint64_t));
+    for(uint32_t i=0; i<LATENCY_CALIBRATION_READS; ++i) {
+        uint64_t start = timing_now_ticks();
+        uint64_t end = timing_now_ticks();
+        reads[i] = end - start;
+    }
+    qsort(reads, LATENCY_CALIBRATION_READS, sizeof(uint64_t), compare_uint64);
+    uint64_t overhead = reads[LATENCY_CALIBRATION_READS/2];
+    free(reads);
+    return overhead;
+}
+
+//// Ratio of CPU cycles to generic timer ticks, measured over a short busy loop with the PMU
+double calibrate_cycles_per_tick(bool use_pmu)
+{
+    timing_counters_t counters;
+    timing_sample_t sample;
+    timing_counters_open(&counters, use_pmu);
+    if(counters.cycles_fd < 0) {
+        return 0.0;
+    }
+    volatile uint64_t spin = 0;
+    timing_start(&counters, &sample);
+    for(uint64_t i=0; i<20000000; ++i) {
+        spin += i;
+    }
+    timing_stop(&counters, &sample);
+    timing_counters_close(&counters);
+    return (sample.ticks && sample.cycles) ? (double) sample.cycles / sample.ticks : 0.0;
+}
+
+//// Nearest rank percentile of sorted samples
+static inline uint64_t percentile(const uint64_t * sorted, uint64_t count, double p)
+{
+    uint64_t rank = (uint64_t) (p * count);
+    return sorted[rank < count ? rank : count - 1];
+}
+
+void init_key(latency_key_t * k, const latency_options_t * options, uint64_t * seed)
+{
+    for(uint32_t i=0; i<sizeof(k->key); ++i) {
+        k->key[i] = (uint8_t) latency_random(seed);
+    }
+    for(uint32_t i=0; i<sizeof(k->hmac_pads); ++i) {
+        k->hmac_pads[i] = (uint8_t) latency_random(seed);
+    }
+    armv8_aes_gcm_set_constants(options->mode, LATENCY_TAG_BYTES, k->key, &k->cc);
+    armv8_expandkeys_enc_aes_cbc_128(k->cbc_enc_keys, k->key);
+    armv8_expandkeys_dec_aes_cbc_128(k->cbc_dec_keys, k->key);
+    k->gcm_ct = aligned_alloc(64, LATENCY_MAX_BYTES + 2*LATENCY_TAG_BYTES);
+    k->ipsec_ct = aligned_alloc(64, LATENCY_MAX_BYTES + 2*LATENCY_TAG_BYTES);
+    k->cbc_sha1_ct = aligned_alloc(64, LATENCY_MAX_BYTES + 2*LATENCY_TAG_BYTES + 64);
+    k->cbc_sha256_ct = aligned_alloc(64, LATENCY_MAX_BYTES + 2*LATENCY_TAG_BYTES + 64);
+}
+
+void free_key(latency_key_t * k)
+{
+    free(k->gcm_ct);
+    free(k->ipsec_ct);
+    free(k->cbc_sha1_ct);
+    free(k->cbc_sha256_ct);
+}
+
+static inline void set_cbc_arg(cipher_digest_t * arg, latency_key_t * k, bool encrypt, uint8_t * iv)
+{
+    arg->cipher.key = encrypt ? k->cbc_enc_keys : k->cbc_dec_keys;
+    arg->cipher.iv = iv;
+    arg->digest.hmac.key = k->key;
+    arg->digest.hmac.i_key_pad = k->hmac_pads;
+    arg->digest.hmac.o_key_pad = k->hmac_pads + 64;
+}
+
+//// Produce the reference outputs for a key at this size, for the decrypt interfaces to consume
+void prepare_key(latency_key_t * k, uint32_t bytes, latency_buffers_t * b)
+{
+    cipher_digest_t arg;
+    armv8_enc_aes_gcm_full(k->cc.mode, k->key, b->nonce, 96, b->aad, LATENCY_AAD_BYTES*8,
+                           b->plaintext, (uint64_t) bytes*8, k->gcm_ct, k->gcm_ct + bytes);
+#ifdef IPSEC_ENABLED
+    memcpy(k->ipsec_ct, b->plaintext, bytes);
+    armv8_enc_aes_gcm_from_constants_IPsec(&k->cc, LATENCY_SALT, 0, b->aad, LATENCY_AAD_BYTES,
+                                           k->ipsec_ct, bytes, k->ipsec_ct + bytes);
+#endif
+    set_cbc_arg(&arg, k, true, b->nonce);
+    armv8_enc_aes_cbc_sha1_128(b->plaintext, k->cbc_sha1_ct, bytes, b->plaintext, k->cbc_sha1_ct + bytes, bytes, &arg);
+    set_cbc_arg(&arg, k, true, b->nonce);
+    armv8_enc_aes_cbc_sha256_128(b->plaintext, k->cbc_sha256_ct, bytes, b->plaintext, k->cbc_sha256_ct + bytes, bytes, &arg);
+}
+
+//// Time a single call of the given interface, with any per call input set up outside the timed region
+static inline uint64_t time_call(latency_api_t api, latency_key_t * k, uint32_t bytes,
+                                 latency_buffers_t * b, operation_result_t * result)
+{
+    cipher_state_t cs = { .constants = &k->cc };
+    cipher_digest_t arg;
+    uint64_t checksum;
+    uint64_t start, end;
+    int cbc_result;
+
+    switch(api)
+    {
+        case LATENCY_GCM_ENC_FULL:
+            start = timing_now_ticks();
+            *result |= armv8_enc_aes_gcm_full(k->cc.mode, k->key, b->nonce, 96, b->aad, LATENCY_AAD_BYTES*8,
+                                              b->plaintext, (uint64_t) bytes*8, b->output, b->tag);
+            end = timing_now_ticks();
+            break;
+        case LATENCY_GCM_DEC_FULL:
+            start = timing_now_ticks();
+            *result |= armv8_dec_aes_gcm_full(k->cc.mode, k->key, b->nonce, 96, b->aad, LATENCY_AAD_BYTES*8,
+                                              k->gcm_ct, (uint64_t) bytes*8, k->gcm_ct + bytes, LATENCY_TAG_BYTES,
+                                              b->output);
+            end = timing_now_ticks();
+            break;
+        //// from_state is timed with the per packet set_counter, as it would be used
+        case LATENCY_GCM_ENC_FROM_STATE:
+            start = timing_now_ticks();
+            *result |= armv8_aes_gcm_set_counter(b->nonce, 96, &cs);
+            *result |= armv8_enc_aes_gcm_from_state(&cs, b->aad, LATENCY_AAD_BYTES*8,
+                                                    b->plaintext, (uint64_t) bytes*8, b->output, b->tag);
+            end = timing_now_ticks();
+            break;
+        case LATENCY_GCM_DEC_FROM_STATE:
+            start = timing_now_ticks();
+            *result |= armv8_aes_gcm_set_counter(b->nonce, 96, &cs);
+            *result |= armv8_dec_aes_gcm_from_state(&cs, b->aad, LATENCY_AAD_BYTES*8,
+                                                    k->gcm_ct, (uint64_t) bytes*8, k->gcm_ct + bytes, b->output);
+            end = timing_now_ticks();
+            break;
+#ifdef IPSEC_ENABLED
+        //// the IPsec interfaces work in place, so the input is refreshed before each call
+        case LATENCY_GCM_ENC_IPSEC:
+            memcpy(b->work, b->plaintext, bytes);
+            start = timing_now_ticks();
+            *result |= armv8_enc_aes_gcm_from_constants_IPsec(&k->cc, LATENCY_SALT, 0, b->aad, LATENCY_AAD_BYTES,
+                                                              b->work, bytes, b->work + bytes);
+            end = timing_now_ticks();
+            break;
+        case LATENCY_GCM_DEC_IPSEC:
+            memcpy(b->work, k->ipsec_ct, bytes + LATENCY_TAG_BYTES);
+            start = timing_now_ticks();
+            *result |= armv8_dec_aes_gcm_from_constants_IPsec(&k->cc, LATENCY_SALT, 0, b->aad, LATENCY_AAD_BYTES,
+                                                              b->work, bytes, b->work + bytes, &checksum);
+            end = timing_now_ticks();
+            break;
+#endif
+        case LATENCY_CBC_SHA1_ENC:
+            set_cbc_arg(&arg, k, true, b->nonce);
+            start = timing_now_ticks();
+            cbc_result = armv8_enc_aes_cbc_sha1_128(b->plaintext, b->output, bytes, b->plaintext, b->digest, bytes, &arg);
+            end = timing_now_ticks();
+            *result |= cbc_result ? INTERNAL_FAILURE : SUCCESSFUL_OPERATION;
+            break;
+        case LATENCY_CBC_SHA1_DEC:
+            set_cbc_arg(&arg, k, false, b->nonce);
+            start = timing_now_ticks();
+            cbc_result = armv8_dec_aes_cbc_sha1_128(k->cbc_sha1_ct, b->output, bytes, k->cbc_sha1_ct, b->digest, bytes, &arg);
+            end = timing_now_ticks();
+            *result |= cbc_result ? INTERNAL_FAILURE : SUCCESSFUL_OPERATION;
+            break;
+        case LATENCY_CBC_SHA256_ENC:
+            set_cbc_arg(&arg, k, true, b->nonce);
+            start = timing_now_ticks();
+            cbc_result = armv8_enc_aes_cbc_sha256_128(b->plaintext, b->output, bytes, b->plaintext, b->digest, bytes, &arg);
+            end = timing_now_ticks();
+            *result |= cbc_result ? INTERNAL_FAILURE : SUCCESSFUL_OPERATION;
+            break;
+        case LATENCY_CBC_SHA256_DEC:
+            set_cbc_arg(&arg, k, false, b->nonce);
+            start = timing_now_ticks();
+            cbc_result = armv8_dec_aes_cbc_sha256_128(k->cbc_sha256_ct, b->output, bytes, k->cbc_sha256_ct, b->digest, bytes, &arg);
+            end = timing_now_ticks();
+            *result |= cbc_result ? INTERNAL_FAILURE : SUCCESSFUL_OPERATION;
+            break;
+        default:
+            *result |= INVALID_PARAMETER;
+            return 0;
+    }
+    (void) checksum;
+    return end - start;
+}
+
+void report_begin(timing_format_t format)
+{
+    if(format == TIMING_FORMAT_CSV) {
+        printf("api,key_bits,bytes,pool,samples,overhead_ticks,cycles_per_tick,"
+               "min_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,"
+               "min_cycles,p50_cycles,p90_cycles,p99_cycles,p999_cycles,max_cycles,result\n");
+    } else if(format == TIMING_FORMAT_JSON) {
+        printf("[");
+    }
+}
+
+//// sorted holds the calibrated tick count of each call
+void report(const latency_options_t * options, latency_api_t api, uint32_t bytes, const uint64_t * sorted,
+            uint64_t overhead, bool success, uint64_t index)
+{
+    const double quantiles[6] = { 0.0, 0.5, 0.9, 0.99, 0.999, 1.0 };
+    const char * labels[6] = { "min", "p50", "p90", "p99", "p99.9", "max" };
+    double ns_per_tick = 1e9 / timing_tick_frequency();
+    double ns[6], cycles[6];
+    uint32_t key_bits = (api >= LATENCY_CBC_SHA1_ENC) ? 128 : options->key_bits;
+    for(uint32_t q=0; q<6; ++q) {
+        uint64_t ticks = percentile(sorted, options->samples, quantiles[q]);
+        ns[q] = ticks * ns_per_tick;
+        cycles[q] = ticks * options->cycles_per_tick;
+    }
+    switch(options->timing.format)
+    {
+        case TIMING_FORMAT_CSV:
+            printf("%s,%u,%u,%u,%lu,%lu,%.3f", latency_api_names[api], key_bits, bytes, options->pool_size,
+                   options->samples, overhead, options->cycles_per_tick);
+            for(uint32_t q=0; q<6; ++q) printf(",%.1f", ns[q]);
+            for(uint32_t q=0; q<6; ++q) printf(",%.0f", cycles[q]);
+            printf(",%s\n", success ? "Success" : "Failure");
+            break;
+        case TIMING_FORMAT_JSON:
+            printf("%s\n  {\"api\": \"%s\", \"key_bits\": %u, \"bytes\": %u, \"pool\": %u, \"samples\": %lu, "
+                   "\"overhead_ticks\": %lu, \"cycles_per_tick\": %.3f",
+                   index ? "," : "", latency_api_names[api], key_bits, bytes, options->pool_size,
+                   options->samples, overhead, options->cycles_per_tick);
+            for(uint32_t q=0; q<6; ++q) printf(", \"%s_ns\": %.1f", labels[q], ns[q]);
+            for(uint32_t q=0; q<6; ++q) printf(", \"%s_cycles\": %.0f", labels[q], cycles[q]);
+            printf(", \"success\": %s}", success ? "true" : "false");
+            break;
+        default:
+            printf("%-20s %3u-bit %6u bytes  ", latency_api_names[api], key_bits, bytes);
+            if(options->cycles_per_tick > 0.0) {
+                printf("cycles p50 %7.0f p90 %7.0f p99 %7.0f p99.9 %7.0f max %8.0f  ",
+                       cycles[1], cycles[2], cycles[3], cycles[4], cycles[5]);
+            }
+            printf("ns p50 %8.1f p99 %8.1f p99.9 %8.1f  %s\n", ns[1], ns[3], ns[4], success ? "Success" : "Failure");
+            break;
+    }
+}
+
+void report_end(timing_format_t format)
+{
+    if(format == TIMING_FORMAT_JSON) {
+        printf("\n]\n");
+    }
+}
+
+int run_latency(latency_options_t * options)
+{
+    uint64_t seed = 0x2545f4914f6cdd1dull;
+    latency_buffers_t b;
+    b.aad = aligned_alloc(64, 64);
+    b.nonce = aligned_alloc(64, 64);
+    b.plaintext = aligned_alloc(64, LATENCY_MAX_BYTES + 2*LATENCY_TAG_BYTES);
+    b.work = aligned_alloc(64, LATENCY_MAX_BYTES + 2*LATENCY_TAG_BYTES);
+    b.output = aligned_alloc(64, LATENCY_MAX_BYTES + 2*LATENCY_TAG_BYTES);
+    b.tag = aligned_alloc(64, 64);
+    b.digest = aligned_alloc(64, 64);
+    memset(b.aad, 0, 64);
+    memset(b.nonce, 0, 64);
+    for(uint32_t i=0; i<LATENCY_AAD_BYTES; ++i) b.aad[i] = (uint8_t) latency_random(&seed);
+    for(uint32_t i=0; i<16; ++i) b.nonce[i] = (uint8_t) latency_random(&seed);
+    for(uint32_t i=0; i<LATENCY_MAX_BYTES; ++i) b.plaintext[i] = (uint8_t) latency_random(&seed);
+
+    latency_key_t * pool = malloc(options->pool_size * sizeof(latency_key_t));
+    for(uint32_t i=0; i<options->pool_size; ++i) {
+        init_key(&pool[i], options, &seed);
+    }
+    uint32_t * choices = malloc(options->samples * sizeof(uint32_t));
+    uint64_t * samples = malloc(options->samples * sizeof(uint64_t));
+    uint64_t overhead = calibrate_timer_overhead();
+    uint64_t report_index = 0;
+
+    if(options->timing.format == TIMING_FORMAT_TEXT) {
+        printf("Generic timer at %lu Hz (%.2f ns/tick), timer read overhead %lu ticks\n",
+               timing_tick_frequency(), 1e9 / timing_tick_frequency(), overhead);
+        if(options->cycles_per_tick > 0.0) {
+            printf("%.3f cycles/tick\n", options->cycles_per_tick);
+        } else {
+            printf("Cycles not available (perf_event_open not permitted or not supported) - use --cycles-per-tick\n");
+        }
+        printf("%lu calls per interface, %s\n", options->samples,
+               options->pool_size > 1 ? "random key from the pool for every call" : "single key");
+    }
+    report_begin(options->timing.format);
+
+    for(uint32_t s=0; s<options->size_count; ++s) {
+        uint32_t bytes = options->sizes[s];
+        for(uint32_t i=0; i<options->pool_size; ++i) {
+            prepare_key(&pool[i], bytes, &b);
+        }
+        for(latency_api_t api=0; api<LATENCY_API_COUNT; ++api) {
+            if(!options->apis[api]) continue;
+            operation_result_t result = SUCCESSFUL_OPERATION;
+            //// the key choice is drawn up front so it doesn't add to the timed calls
+            for(uint64_t i=0; i<options->samples; ++i) {
+                choices[i] = (options->pool_size > 1) ? (uint32_t) (latency_random(&seed) % options->pool_size) : 0;
+            }
+            uint64_t warmup_count = timing_warmup_count(&options->timing, options->samples/10);
+            for(uint64_t i=0; i<warmup_count; ++i) {
+                time_call(api, &pool[choices[i % options->samples]], bytes, &b, &result);
+            }
+            for(uint64_t i=0; i<options->samples; ++i) {
+                uint64_t ticks = time_call(api, &pool[choices[i]], bytes, &b, &result);
+                samples[i] = (ticks > overhead) ? ticks - overhead : 0;
+            }
+            qsort(samples, options->samples, sizeof(uint64_t), compare_uint64);
+            report(options, api, bytes, samples, overhead, result == SUCCESSFUL_OPERATION, report_index++);
+        }
+    }
+    report_end(options->timing.format);
+
+    for(uint32_t i=0; i<options->pool_size; ++i) {
+        free_key(&pool[i]);
+    }
+    free(pool);
+    free(choices);
+    free(samples);
+    free(b.aad);
+    free(b.nonce);
+    free(b.plaintext);
+    free(b.work);
+    free(b.output);
+    free(b.tag);
+    free(b.digest);
+    return 0;
+}
+
+//// Parse a comma separated list of sizes, returning the number parsed
+uint32_t parse_sizes(const char * list, uint32_t * sizes)
+{
+    uint32_t count = 0;
+    const char * p = list;
+    while(*p && count < LATENCY_MAX_SIZES) {
+        char * end;
+        uint64_t size = strtoul(p, &end, 10);
+        if(end == p) break;
+        if(size == 0 || size > LATENCY_MAX_BYTES || (size & 15)) {
+            printf("Ignoring size %lu - sizes must be multiples of 16 up to %u bytes\n", size, LATENCY_MAX_BYTES);
+        } else {
+            sizes[count++] = (uint32_t) size;
+        }
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    latency_options_t options = {
+        .mode = AES_GCM_128,
+        .key_bits = 128,
+        .sizes = { 64, 128, 256, 512 },
+        .size_count = 4,
+        .samples = 100000,
+        .pool_size = 1,
+        .cycles_per_tick = 0.0,
+        .timing = TIMING_DEFAULT_OPTIONS };
+    bool api_selected = false;
+    double cycles_per_tick = 0.0;
+
+    for(int i=1; i<argc; ) {
+        int consumed = timing_parse_option(argc, argv, i, &options.timing);
+        if(consumed) {
+            i += consumed;
+            continue;
+        }
+        if(i+1 >= argc) {
+            printf("Unknown or incomplete option %s\n", argv[i]);
+            return 1;
+        }
+        if(strcmp(argv[i], "--sizes") == 0) {
+            options.size_count = parse_sizes(argv[i+1], options.sizes);
+        } else if(strcmp(argv[i], "--samples") == 0) {
+            options.samples = strtoul(argv[i+1], NULL, 10);
+            if(options.samples == 0) options.samples = 1;
+        } else if(strcmp(argv[i], "--pool") == 0) {
+            options.pool_size = (uint32_t) strtoul(argv[i+1], NULL, 10);
+            if(options.pool_size == 0) options.pool_size = 1;
+        } else if(strcmp(argv[i], "--key-length") == 0) {
+            options.key_bits = (uint32_t) strtoul(argv[i+1], NULL, 10);
+            switch(options.key_bits)
+            {
+                case 128: options.mode = AES_GCM_128; break;
+                case 192: options.mode = AES_GCM_192; break;
+                case 256: options.mode = AES_GCM_256; break;
+                default:
+                    printf("Key length must be 128, 192 or 256\n");
+                    return 1;
+            }
+        } else if(strcmp(argv[i], "--cycles-per-tick") == 0) {
+            cycles_per_tick = strtod(argv[i+1], NULL);
+        } else if(strcmp(argv[i], "--api") == 0) {
+            latency_api_t api;
+            for(api=0; api<LATENCY_API_COUNT; ++api) {
+                if(strcmp(argv[i+1], latency_api_names[api]) == 0) break;
+            }
+            if(api == LATENCY_API_COUNT) {
+                printf("Unknown interface %s\n", argv[i+1]);
+                return 1;
+            }
+            options.apis[api] = true;
+            api_selected = true;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        i += 2;
+    }
+    if(!api_selected) {
+        for(latency_api_t api=0; api<LATENCY_API_COUNT; ++api) {
+            options.apis[api] = true;
+        }
+    }
+#ifndef IPSEC_ENABLED
+    options.apis[LATENCY_GCM_ENC_IPSEC] = false;
+    options.apis[LATENCY_GCM_DEC_IPSEC] = false;
+#endif
+    options.cycles_per_tick = (cycles_per_tick > 0.0) ? cycles_per_tick : calibrate_cycles_per_tick(options.timing.use_pmu);
+
+    return run_latency(&options);
+}
@@ -0,0 +1,503 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Throughput scaling across cores
+//// N worker threads are each pinned to a CPU with their own key and buffers, and run the
+//// selected mode back-to-back for a fixed duration. Per thread and aggregate GB/s are
+//// reported for 1, 2, 4, ... N threads, with the scaling efficiency against one thread
+//// and a breakdown per core type for heterogeneous (big.LITTLE) systems
+
+#define _GNU_SOURCE
+#define NDEBUG
+#include <assert.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "AArch64cryptolib.h"
+#include "test_timing.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define cipher_constants_t  armv8_cipher_constants_t
+#define cipher_state_t      armv8_cipher_state_t
+#define cipher_mode_t       armv8_cipher_mode_t
+#define cipher_digest_t     armv8_cipher_digest_t
+
+#define MULTICORE_MAX_THREADS   1024
+#define MULTICORE_MAX_CLUSTERS  16
+#define MULTICORE_AAD_BYTES     8
+#define MULTICORE_TAG_BYTES     16
+#define MULTICORE_SALT          0x01020304
+
+typedef enum multicore_mode {
+    MULTICORE_GCM_ENC,
+    MULTICORE_GCM_DEC,
+    MULTICORE_IPSEC_ENC,
+    MULTICORE_IPSEC_DEC,
+    MULTICORE_CBC_SHA1_ENC,
+    MULTICORE_CBC_SHA1_DEC,
+    MULTICORE_CBC_SHA256_ENC,
+    MULTICORE_CBC_SHA256_DEC,
+    MULTICORE_MODE_COUNT
+} multicore_mode_t;
+
+static const char * multicore_mode_names[MULTICORE_MODE_COUNT] = {
+    "gcm_enc",
+    "gcm_dec",
+    "ipsec_enc",
+    "ipsec_dec",
+    "cbc_sha1_enc",
+    "cbc_sha1_dec",
+    "cbc_sha256_enc",
+    "cbc_sha256_dec",
+};
+
+typedef struct multicore_options {
+    multicore_mode_t mode;
+    cipher_mode_t gcm_mode;
+    uint32_t key_bits;
+    uint32_t bytes;
+    double duration;            // seconds per thread count
+    uint32_t cpus[MULTICORE_MAX_THREADS];
+    uint32_t cpu_count;
+    bool scaling;               // run 1, 2, 4, ... cpu_count threads rather than just cpu_count
+    timing_options_t timing;
+} multicore_options_t;
+
+//// Threads are grouped by core type - MIDR_EL1 implementer and part number where the
+//// kernel exposes it, otherwise the cluster id from the topology
+typedef struct multicore_cluster {
+    uint64_t id;
+    char name[32];
+} multicore_cluster_t;
+
+typedef struct worker {
+    pthread_t thread;
+    uint32_t cpu;
+    uint32_t cluster;           // index into the cluster table
+    const multicore_options_t * options;
+    pthread_barrier_t * start;
+    atomic_bool * stop;
+    bool pinned;
+    operation_result_t result; // result of the first call, which is checked against the reference
+    uint64_t calls;
+    uint64_t ns;
+} worker_t;
+
+static multicore_cluster_t clusters[MULTICORE_MAX_CLUSTERS];
+static uint32_t cluster_count = 0;
+
+static bool read_sysfs_u64(const char * path, int base, uint64_t * value)
+{
+    char line[64];
+    FILE * f = fopen(path, "r");
+    if(f == NULL) return false;
+    bool ok = fgets(line, sizeof(line), f) != NULL;
+    fclose(f);
+    if(ok) *value = strtoull(line, NULL, base);
+    return ok;
+}
+
+uint32_t cpu_cluster(uint32_t cpu)
+{
+    char path[128];
+    uint64_t value;
+    uint64_t id = 0;
+    bool midr = false;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/regs/identification/midr_el1", cpu);
+    if(read_sysfs_u64(path, 16, &value)) {
+        //// implementer and part number, ignoring variant and revision
+        id = value & 0xff00fff0;
+        midr = true;
+    } else {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/cluster_id", cpu);
+        if(read_sysfs_u64(path, 10, &value)) id = value;
+    }
+    for(uint32_t i=0; i<cluster_count; ++i) {
+        if(clusters[i].id == id) return i;
+    }
+    if(cluster_count == MULTICORE_MAX_CLUSTERS) return cluster_count - 1;
+    clusters[cluster_count].id = id;
+    if(midr) {
+        snprintf(clusters[cluster_count].name, sizeof(clusters[cluster_count].name), "midr_0x%08lx", id);
+    } else {
+        snprintf(clusters[cluster_count].name, sizeof(clusters[cluster_count].name), "cluster_%lu", id);
+    }
+    return cluster_count++;
+}
+
+static inline operation_result_t run_once(multicore_mode_t mode, const cipher_constants_t * cc, uint8_t * key,
+                                          uint8_t * nonce, uint8_t * aad, uint8_t * input, uint8_t * output,
+                                          uint8_t * tag, uint32_t bytes, cipher_digest_t * arg)
+{
+    uint64_t checksum;
+    switch(mode)
+    {
+        case MULTICORE_GCM_ENC:
+            return armv8_enc_aes_gcm_full(cc->mode, key, nonce, 96, aad, MULTICORE_AAD_BYTES*8,
+                                          input, (uint64_t) bytes*8, output, tag);
+        case MULTICORE_GCM_DEC:
+            return armv8_dec_aes_gcm_full(cc->mode, key, nonce, 96, aad, MULTICORE_AAD_BYTES*8,
+                                          input, (uint64_t) bytes*8, tag, MULTICORE_TAG_BYTES, output);
+#ifdef IPSEC_ENABLED
+        case MULTICORE_IPSEC_ENC:
+            return armv8_enc_aes_gcm_from_constants_IPsec(cc, MULTICORE_SALT, 0, aad, MULTICORE_AAD_BYTES,
+                                                          input, bytes, input + bytes);
+        case MULTICORE_IPSEC_DEC:
+            return armv8_dec_aes_gcm_from_constants_IPsec(cc, MULTICORE_SALT, 0, aad, MULTICORE_AAD_BYTES,
+                                                          input, bytes, input + bytes, &checksum);
+#endif
+        case MULTICORE_CBC_SHA1_ENC:
+            return armv8_enc_aes_cbc_sha1_128(input, output, bytes, input, tag, bytes, arg) ? INTERNAL_FAILURE : SUCCESSFUL_OPERATION;
+        case MULTICORE_CBC_SHA1_DEC:
+            return armv8_dec_aes_cbc_sha1_128(input, output, bytes, input, tag, bytes, arg) ? INTERNAL_FAILURE : SUCCESSFUL_OPERATION;
+        case MULTICORE_CBC_SHA256_ENC:
+            return armv8_enc_aes_cbc_sha256_128(input, output, bytes, input, tag, bytes, arg) ? INTERNAL_FAILURE : SUCCESSFUL_OPERATION;
+        case MULTICORE_CBC_SHA256_DEC:
+            return armv8_dec_aes_cbc_sha256_128(input, output, bytes, input, tag, bytes, arg) ? INTERNAL_FAILURE : SUCCESSFUL_OPERATION;
+        default:
+            (void) checksum;
+            return INVALID_PARAMETER;
+    }
+}
+
+//// Each worker pins itself before allocating, so its buffers are first touched on its own node
+void * worker_main(void * arg)
+{
+    worker_t * w = (worker_t *) arg;
+    const multicore_options_t * options = w->options;
+    uint32_t bytes = options->bytes;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(w->cpu, &set);
+    w->pinned = (sched_setaffinity(0, sizeof(set), &set) == 0);
+
+    uint64_t seed = 0x9e3779b97f4a7c15ull * (w->cpu + 1);
+    uint8_t key[32], nonce[16] = {0}, aad[16] = {0}, pads[128];
+    uint8_t cbc_keys[256];
+    uint8_t * input = aligned_alloc(64, bytes + 64);
+    uint8_t * output = aligned_alloc(64, bytes + 64);
+    uint8_t * tag = aligned_alloc(64, 64);
+    cipher_constants_t cc;
+    cipher_digest_t digest_arg;
+    for(uint32_t i=0; i<sizeof(key); ++i) key[i] = (uint8_t) (seed >> (i & 7)*8) ^ i;
+    for(uint32_t i=0; i<12; ++i) nonce[i] = (uint8_t) (seed >> (i & 7)*8);
+    for(uint32_t i=0; i<MULTICORE_AAD_BYTES; ++i) aad[i] = (uint8_t) i;
+    for(uint32_t i=0; i<sizeof(pads); ++i) pads[i] = (uint8_t) (i * 7);
+    for(uint32_t i=0; i<bytes; ++i) input[i] = (uint8_t) (i ^ w->cpu);
+    armv8_aes_gcm_set_constants(options->gcm_mode, MULTICORE_TAG_BYTES, key, &cc);
+
+    //// decryption starts from a valid reference so the first call can be checked
+    bool encrypt = true;
+    switch(options->mode)
+    {
+        case MULTICORE_GCM_DEC:
+            armv8_enc_aes_gcm_full(cc.mode, key, nonce, 96, aad, MULTICORE_AAD_BYTES*8,
+                                   input, (uint64_t) bytes*8, input, tag);
+            encrypt = false;
+            break;
+#ifdef IPSEC_ENABLED
+        case MULTICORE_IPSEC_DEC:
+            armv8_enc_aes_gcm_from_constants_IPsec(&cc, MULTICORE_SALT, 0, aad, MULTICORE_AAD_BYTES,
+                                                   input, bytes, input + bytes);
+            encrypt = false;
+            break;
+#endif
+        case MULTICORE_CBC_SHA1_DEC:
+        case MULTICORE_CBC_SHA256_DEC:
+            encrypt = false;
+            break;
+        default:
+            break;
+    }
+    if(encrypt) {
+        armv8_expandkeys_enc_aes_cbc_128(cbc_keys, key);
+    } else {
+        armv8_expandkeys_dec_aes_cbc_128(cbc_keys, key);
+    }
+    digest_arg.cipher.key = cbc_keys;
+    digest_arg.cipher.iv = nonce;
+    digest_arg.digest.hmac.key = key;
+    digest_arg.digest.hmac.i_key_pad = pads;
+    digest_arg.digest.hmac.o_key_pad = pads + 64;
+
+    w->result = run_once(options->mode, &cc, key, nonce, aad, input, output, tag, bytes, &digest_arg);
+    //// the IPsec decrypt is in place, so later calls fail authentication but do the same work
+    uint64_t warmup_count = timing_warmup_count(&options->timing, 1000);
+    for(uint64_t i=0; i<warmup_count; ++i) {
+        run_once(options->mode, &cc, key, nonce, aad, input, output, tag, bytes, &digest_arg);
+    }
+
+    pthread_barrier_wait(w->start);
+    uint64_t calls = 0;
+    uint64_t start = timing_now_ns();
+    while(!atomic_load_explicit(w->stop, memory_order_relaxed)) {
+        run_once(options->mode, &cc, key, nonce, aad, input, output, tag, bytes, &digest_arg);
+        calls++;
+    }
+    w->ns = timing_now_ns() - start;
+    w->calls = calls;
+
+    free(input);
+    free(output);
+    free(tag);
+    return NULL;
+}
+
+static inline double gbytes_per_second(uint64_t bytes, uint64_t ns)
+{
+    return ns ? (double) bytes / ns : 0.0;
+}
+
+void report_begin(timing_format_t format)
+{
+    if(format == TIMING_FORMAT_CSV) {
+        printf("mode,bytes,threads,kind,id,cpu,cluster,calls,seconds,gbytes_per_second,efficiency,result\n");
+    } else if(format == TIMING_FORMAT_JSON) {
+        printf("[");
+    }
+}
+
+//// efficiency is the GB/s of the row against that of the same number of threads scaling perfectly from
+//// the single thread run, or 0 if there was no single thread run
+void report_row(const multicore_options_t * options, uint32_t threads, const char * kind, const char * id,
+                int cpu, const char * cluster, uint32_t row_threads, uint64_t calls, double seconds, double gbps,
+                double efficiency, bool success, uint64_t index)
+{
+    switch(options->timing.format)
+    {
+        case TIMING_FORMAT_CSV:
+            printf("%s,%u,%u,%s,%s,%d,%s,%lu,%.3f,%.3f,%.3f,%s\n", multicore_mode_names[options->mode], options->bytes,
+                   threads, kind, id, cpu, cluster, calls, seconds, gbps, efficiency, success ? "Success" : "Failure");
+            break;
+        case TIMING_FORMAT_JSON:
+            printf("%s\n  {\"mode\": \"%s\", \"bytes\": %u, \"threads\": %u, \"kind\": \"%s\", \"id\": \"%s\", "
+                   "\"cpu\": %d, \"cluster\": \"%s\", \"calls\": %lu, \"seconds\": %.3f, \"gbytes_per_second\": %.3f, "
+                   "\"efficiency\": %.3f, \"success\": %s}",
+                   index ? "," : "", multicore_mode_names[options->mode], options->bytes, threads, kind, id,
+                   cpu, cluster, calls, seconds, gbps, efficiency, success ? "true" : "false");
+            break;
+        default:
+            if(strcmp(kind, "thread") == 0) {
+                printf("  thread %-4s cpu %-4d %-20s %12lu calls %8.3f GB/s  %s\n",
+                       id, cpu, cluster, calls, gbps, success ? "Success" : "Failure");
+            } else if(strcmp(kind, "cluster") == 0) {
+                printf("  %-36s %12lu calls %8.3f GB/s  %.3f GB/s per thread\n", cluster, calls, gbps, gbps / row_threads);
+            } else {
+                printf("%u threads: %.3f GB/s aggregate, %.3f GB/s per thread", threads, gbps, gbps / row_threads);
+                if(efficiency > 0.0) printf(", scaling efficiency %.1f%%", 100.0 * efficiency);
+                printf("  %s\n", success ? "Success" : "Failure");
+            }
+            break;
+    }
+}
+
+void report_end(timing_format_t format)
+{
+    if(format == TIMING_FORMAT_JSON) {
+        printf("\n]\n");
+    }
+}
+
+//// Run threads workers on the first threads CPUs, returning the aggregate GB/s
+double run_threads(const multicore_options_t * options, uint32_t threads, double single_thread_gbps, uint64_t * report_index)
+{
+    worker_t * workers = calloc(threads, sizeof(worker_t));
+    pthread_barrier_t start;
+    atomic_bool stop = false;
+    pthread_barrier_init(&start, NULL, threads + 1);
+
+    for(uint32_t t=0; t<threads; ++t) {
+        workers[t].cpu = options->cpus[t];
+        workers[t].cluster = cpu_cluster(options->cpus[t]);
+        workers[t].options = options;
+        workers[t].start = &start;
+        workers[t].stop = &stop;
+        pthread_create(&workers[t].thread, NULL, worker_main, &workers[t]);
+    }
+    pthread_barrier_wait(&start);
+    struct timespec duration = {
+        .tv_sec = (time_t) options->duration,
+        .tv_nsec = (long) ((options->duration - (time_t) options->duration) * 1e9) };
+    nanosleep(&duration, NULL);
+    atomic_store(&stop, true);
+
+    uint64_t total_bytes = 0, max_ns = 0, total_calls = 0;
+    uint64_t cluster_calls[MULTICORE_MAX_CLUSTERS] = {0};
+    uint32_t cluster_threads[MULTICORE_MAX_CLUSTERS] = {0};
+    double cluster_gbps[MULTICORE_MAX_CLUSTERS] = {0};
+    bool success = true;
+    for(uint32_t t=0; t<threads; ++t) {
+        pthread_join(workers[t].thread, NULL);
+    }
+    for(uint32_t t=0; t<threads; ++t) {
+        worker_t * w = &workers[t];
+        uint64_t bytes = w->calls * options->bytes;
+        double gbps = gbytes_per_second(bytes, w->ns);
+        char id[16];
+        snprintf(id, sizeof(id), "%u", t);
+        total_bytes += bytes;
+        total_calls += w->calls;
+        if(w->ns > max_ns) max_ns = w->ns;
+        cluster_calls[w->cluster] += w->calls;
+        cluster_threads[w->cluster]++;
+        cluster_gbps[w->cluster] += gbps;
+        success &= (w->result == SUCCESSFUL_OPERATION);
+        if(!w->pinned && options->timing.format == TIMING_FORMAT_TEXT) {
+            printf("  thread %u could not be pinned to cpu %u\n", t, w->cpu);
+        }
+        report_row(options, threads, "thread", id, (int) w->cpu, clusters[w->cluster].name, 1, w->calls,
+                   w->ns / 1e9, gbps, single_thread_gbps > 0.0 ? gbps / single_thread_gbps : (threads == 1 ? 1.0 : 0.0), w->result == SUCCESSFUL_OPERATION, (*report_index)++);
+    }
+    //// per cluster rows are only interesting when there is more than one core type
+    if(cluster_count > 1) {
+        for(uint32_t c=0; c<cluster_count; ++c) {
+            if(cluster_threads[c] == 0) continue;
+            report_row(options, threads, "cluster", clusters[c].name, -1, clusters[c].name, cluster_threads[c],
+                       cluster_calls[c], max_ns / 1e9, cluster_gbps[c],
+                       single_thread_gbps > 0.0 ? cluster_gbps[c] / (cluster_threads[c] * single_thread_gbps) : 0.0,
+                       success, (*report_index)++);
+        }
+    }
+    double aggregate = gbytes_per_second(total_bytes, max_ns);
+    if(single_thread_gbps == 0.0 && threads == 1) single_thread_gbps = aggregate;
+    report_row(options, threads, "total", "all", -1, "all", threads, total_calls, max_ns / 1e9, aggregate,
+               single_thread_gbps > 0.0 ? aggregate / (threads * single_thread_gbps) : 0.0, success, (*report_index)++);
+
+    pthread_barrier_destroy(&start);
+    free(workers);
+    return aggregate;
+}
+
+//// Parse a CPU list such as 0-3,8,10-11
+uint32_t parse_cpus(const char * list, uint32_t * cpus)
+{
+    uint32_t count = 0;
+    const char * p = list;
+    while(*p && count < MULTICORE_MAX_THREADS) {
+        char * end;
+        uint32_t first = (uint32_t) strtoul(p, &end, 10);
+        uint32_t last = first;
+        if(end == p) break;
+        if(*end == '-') {
+            p = end + 1;
+            last = (uint32_t) strtoul(p, &end, 10);
+        }
+        for(uint32_t cpu=first; cpu<=last && count < MULTICORE_MAX_THREADS; ++cpu) {
+            cpus[count++] = cpu;
+        }
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    multicore_options_t options = {
+        .mode = MULTICORE_GCM_ENC,
+        .gcm_mode = AES_GCM_128,
+        .key_bits = 128,
+        .bytes = 16384,
+        .duration = 2.0,
+        .cpu_count = 0,
+        .scaling = true,
+        .timing = TIMING_DEFAULT_OPTIONS };
+    uint32_t threads = 0;
+
+    for(int i=1; i<argc; ) {
+        int consumed = timing_parse_option(argc, argv, i, &options.timing);
+        if(consumed) {
+            i += consumed;
+            continue;
+        }
+        if(strcmp(argv[i], "--no-scaling") == 0) {
+            options.scaling = false;
+            i++;
+            continue;
+        }
+        if(i+1 >= argc) {
+            printf("Unknown or incomplete option %s\n", argv[i]);
+            return 1;
+        }
+        if(strcmp(argv[i], "--threads") == 0) {
+            threads = (uint32_t) strtoul(argv[i+1], NULL, 10);
+        } else if(strcmp(argv[i], "--cpus") == 0) {
+            options.cpu_count = parse_cpus(argv[i+1], options.cpus);
+        } else if(strcmp(argv[i], "--size") == 0) {
+            options.bytes = (uint32_t) strtoul(argv[i+1], NULL, 10);
+            if(options.bytes == 0 || (options.bytes & 15)) {
+                printf("Size must be a non-zero multiple of 16 bytes\n");
+                return 1;
+            }
+        } else if(strcmp(argv[i], "--duration") == 0) {
+            options.duration = strtod(argv[i+1], NULL);
+        } else if(strcmp(argv[i], "--key-length") == 0) {
+            options.key_bits = (uint32_t) strtoul(argv[i+1], NULL, 10);
+            switch(options.key_bits)
+            {
+                case 128: options.gcm_mode = AES_GCM_128; break;
+                case 192: options.gcm_mode = AES_GCM_192; break;
+                case 256: options.gcm_mode = AES_GCM_256; break;
+                default:
+                    printf("Key length must be 128, 192 or 256\n");
+                    return 1;
+            }
+        } else if(strcmp(argv[i], "--mode") == 0) {
+            multicore_mode_t mode;
+            for(mode=0; mode<MULTICORE_MODE_COUNT; ++mode) {
+                if(strcmp(argv[i+1], multicore_mode_names[mode]) == 0) break;
+            }
+            if(mode == MULTICORE_MODE_COUNT) {
+                printf("Unknown mode %s\n", argv[i+1]);
+                return 1;
+            }
+            options.mode = mode;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        i += 2;
+    }
+#ifndef IPSEC_ENABLED
+    if(options.mode == MULTICORE_IPSEC_ENC || options.mode == MULTICORE_IPSEC_DEC) {
+        printf("IPsec interfaces are not enabled for this target\n");
+        return 1;
+    }
+#endif
+
+    //// default to every CPU this process may run on
+    if(options.cpu_count == 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if(sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for(uint32_t cpu=0; cpu<CPU_SETSIZE && options.cpu_count < MULTICORE_MAX_THREADS; ++cpu) {
+                if(CPU_ISSET(cpu, &set)) options.cpus[options.cpu_count++] = cpu;
+            }
+        }
+        if(options.cpu_count == 0) options.cpus[options.cpu_count++] = 0;
+    }
+    if(threads == 0 || threads > options.cpu_count) threads = options.cpu_count;
+
+    if(options.timing.format == TIMING_FORMAT_TEXT) {
+        printf("%s, %u-bit key, %u bytes, %.1f s per run, up to %u threads\n", multicore_mode_names[options.mode],
+               (options.mode >= MULTICORE_CBC_SHA1_ENC) ? 128 : options.key_bits, options.bytes, options.duration, threads);
+    }
+    uint64_t report_index = 0;
+    report_begin(options.timing.format);
+    double single_thread_gbps = 0.0;
+    if(options.scaling) {
+        for(uint32_t n=1; n<threads; n*=2) {
+            double gbps = run_threads(&options, n, single_thread_gbps, &report_index);
+            if(n == 1) single_thread_gbps = gbps;
+        }
+    }
+    run_threads(&options, threads, single_thread_gbps, &report_index);
+    report_end(options.timing.format);
+
+    return 0;
+}
@@ -0,0 +1,277 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Worker thread offload
+//// Several submitting threads hand small AES-GCM and AES-CBC/SHA requests to a pool of workers, learning of their
+//// completion by callback, by eventfd and by polling, and every output must match calling the API directly
+//// Large AES-GCM requests are split between the workers by counter range, and must give the same ciphertext and tag
+//// as one armv8_enc_aes_gcm_from_state call, decrypt (in place too), and fail authentication when tampered with
+//// Finally the time a submitting thread spends on a large encryption is compared with doing it itself
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "AArch64cryptolib.h"
+#include "test_timing.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define cipher_constants_t  armv8_cipher_constants_t
+#define cipher_state_t      armv8_cipher_state_t
+#define job_t               armv8_job_t
+#define offload_request_t   armv8_offload_request_t
+
+#define OFFLOAD_WORKERS     4
+#define OFFLOAD_SUBMITTERS  3
+#define OFFLOAD_REQUESTS    300     // per submitter
+#define OFFLOAD_MAX_BYTES   2048
+#define OFFLOAD_LARGE_BYTES ((4u << 20) + 37)
+
+typedef enum notify { NOTIFY_CALLBACK, NOTIFY_EVENTFD, NOTIFY_POLL } notify_t;
+
+typedef struct small {
+    offload_request_t request;
+    uint8_t nonce[12];
+    uint8_t input[OFFLOAD_MAX_BYTES + 16];
+    uint8_t output[OFFLOAD_MAX_BYTES + 16];
+    uint8_t expected[OFFLOAD_MAX_BYTES + 16];
+    uint8_t tag[16], expected_tag[16];
+    uint8_t digest[32], expected_digest[32];
+} small_t;
+
+typedef struct submitter {
+    pthread_t thread;
+    uint32_t index;
+    notify_t notify;
+    int eventfd;
+    uint32_t callbacks;
+    bool passed;
+    small_t * smalls;
+} submitter_t;
+
+static uint8_t key[16] = { 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 };
+static uint8_t aad[32] = { 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef };
+static uint8_t cbc_iv[16], cbc_hmac_pad[64], cbc_keys[256];
+static armv8_cipher_digest_t cbc_arg;
+static cipher_constants_t cc, cc_tag12;
+static armv8_offload_pool_t * pool;
+
+static uint64_t rng_next(uint64_t * rng)
+{
+    *rng ^= *rng << 13; *rng ^= *rng >> 7; *rng ^= *rng << 17;
+    return *rng;
+}
+
+static void gcm_job(job_t * job, armv8_job_type_t type, cipher_constants_t * constants, uint8_t * nonce,
+                    uint8_t * input, uint64_t byte_length, uint8_t * output, uint8_t * tag)
+{
+    *job = (job_t) { .type = type, .gcm = { .cc = constants, .nonce = nonce, .nonce_bit_length = 96, .aad = aad,
+                     .aad_bit_length = 13*8, .input = input, .bit_length = byte_length*8, .output = output, .tag = tag } };
+}
+
+static void count_callback(offload_request_t * request)
+{
+    submitter_t * submitter = request->job.user_data;
+    __atomic_add_fetch(&submitter->callbacks, 1, __ATOMIC_RELEASE);
+}
+
+// Every third request is AES-CBC/SHA1, the rest AES-GCM encryption, checked against direct calls
+static void * submitter_main(void * arg)
+{
+    submitter_t * submitter = arg;
+    uint64_t rng = 0x9e3779b97f4a7c15ull * (submitter->index + 1);
+    submitter->passed = true;
+
+    for( uint32_t i=0; i<OFFLOAD_REQUESTS; ++i )
+    {
+        small_t * s = &submitter->smalls[i];
+        uint64_t byte_length = rng_next(&rng) % (OFFLOAD_MAX_BYTES + 1);
+        for( uint32_t b=0; b<sizeof(s->nonce); ++b ) s->nonce[b] = (uint8_t) rng_next(&rng);
+        for( uint32_t b=0; b<byte_length; ++b ) s->input[b] = (uint8_t) rng_next(&rng);
+        job_t * job = &s->request.job;
+        if(i % 3 == 2) {
+            byte_length = (byte_length & ~15ull) ? byte_length & ~15ull : 16;
+            armv8_enc_aes_cbc_sha1_128(s->input, s->expected, byte_length, s->input, s->expected_digest, byte_length,
+                                       &cbc_arg);
+            *job = (job_t) { .type = ARMV8_JOB_AES_CBC_SHA1_ENC, .cbc_sha = { s->input, s->output, byte_length,
+                             s->input, s->digest, byte_length, &cbc_arg } };
+        } else {
+            cipher_state_t cs = { .constants = &cc };
+            armv8_aes_gcm_set_counter(s->nonce, 96, &cs);
+            armv8_enc_aes_gcm_from_state(&cs, aad, 13*8, s->input, byte_length*8, s->expected, s->expected_tag);
+            gcm_job(job, ARMV8_JOB_AES_GCM_ENC, &cc, s->nonce, s->input, byte_length, s->output, s->tag);
+        }
+        job->user_data = submitter;
+        s->request.callback = submitter->notify == NOTIFY_CALLBACK ? count_callback : NULL;
+        s->request.eventfd = submitter->notify == NOTIFY_EVENTFD ? submitter->eventfd : -1;
+        while(armv8_offload_submit(pool, &s->request) == INTERNAL_FAILURE);
+    }
+
+    // wait for every completion the way this submitter asked to be told
+    if(submitter->notify == NOTIFY_CALLBACK) {
+        while(__atomic_load_n(&submitter->callbacks, __ATOMIC_ACQUIRE) < OFFLOAD_REQUESTS);
+    } else if(submitter->notify == NOTIFY_EVENTFD) {
+        uint64_t completed = 0, count;
+        while(completed < OFFLOAD_REQUESTS) {
+            if(read(submitter->eventfd, &count, sizeof(count)) == sizeof(count)) completed += count;
+        }
+    }
+    for( uint32_t i=0; i<OFFLOAD_REQUESTS; ++i )
+    {
+        small_t * s = &submitter->smalls[i];
+        while(!armv8_offload_done(&s->request));
+        bool cbc = s->request.job.type == ARMV8_JOB_AES_CBC_SHA1_ENC;
+        uint64_t byte_length = cbc ? s->request.job.cbc_sha.clen : s->request.job.gcm.bit_length >> 3;
+        if(s->request.job.result != SUCCESSFUL_OPERATION || memcmp(s->output, s->expected, byte_length) != 0 ||
+           (cbc ? memcmp(s->digest, s->expected_digest, 20) : memcmp(s->tag, s->expected_tag, 16)) != 0) {
+            printf("Submitter %u request %u mismatch\n", submitter->index, i);
+            submitter->passed = false;
+        }
+    }
+    return NULL;
+}
+
+static bool test_small_requests(void)
+{
+    submitter_t submitters[OFFLOAD_SUBMITTERS];
+    bool passed = true;
+    for( uint32_t t=0; t<OFFLOAD_SUBMITTERS; ++t )
+    {
+        submitters[t] = (submitter_t) { .index = t, .notify = (notify_t) t, .eventfd = eventfd(0, 0),
+                                        .smalls = calloc(OFFLOAD_REQUESTS, sizeof(small_t)) };
+        pthread_create(&submitters[t].thread, NULL, submitter_main, &submitters[t]);
+    }
+    for( uint32_t t=0; t<OFFLOAD_SUBMITTERS; ++t )
+    {
+        pthread_join(submitters[t].thread, NULL);
+        passed &= submitters[t].passed;
+        close(submitters[t].eventfd);
+        free(submitters[t].smalls);
+    }
+    return passed;
+}
+
+static operation_result_t offload_and_wait(offload_request_t * request)
+{
+    request->callback = NULL;
+    request->eventfd = -1;
+    operation_result_t result = armv8_offload_submit(pool, request);
+    if(result != SUCCESSFUL_OPERATION) {
+        return result;
+    }
+    while(!armv8_offload_done(request));
+    return request->job.result;
+}
+
+// A large request split between the workers against one direct call
+static bool test_split(cipher_constants_t * constants, uint8_t * plaintext, uint8_t * ciphertext, uint8_t * decrypted)
+{
+    uint8_t nonce[12] = { 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88 };
+    uint8_t expected_tag[16], tag[16];
+    cipher_state_t cs = { .constants = constants };
+    offload_request_t request;
+    bool passed = true;
+
+    armv8_aes_gcm_set_counter(nonce, 96, &cs);
+    armv8_enc_aes_gcm_from_state(&cs, aad, 13*8, plaintext, OFFLOAD_LARGE_BYTES*8LL, decrypted, expected_tag);
+
+    memset(tag, 0xa5, sizeof(tag));
+    gcm_job(&request.job, ARMV8_JOB_AES_GCM_ENC, constants, nonce, plaintext, OFFLOAD_LARGE_BYTES, ciphertext, tag);
+    if(offload_and_wait(&request) != SUCCESSFUL_OPERATION || request.parts < 2 ||
+       memcmp(ciphertext, decrypted, OFFLOAD_LARGE_BYTES) != 0 ||
+       memcmp(tag, expected_tag, constants->tag_byte_length) != 0 ||
+       (constants->tag_byte_length < 16 && tag[constants->tag_byte_length] != 0xa5)) {
+        printf("Split encryption mismatch: %u parts, %u byte tag\n", request.parts, constants->tag_byte_length);
+        passed = false;
+    }
+
+    gcm_job(&request.job, ARMV8_JOB_AES_GCM_DEC, constants, nonce, ciphertext, OFFLOAD_LARGE_BYTES, decrypted, tag);
+    if(offload_and_wait(&request) != SUCCESSFUL_OPERATION || memcmp(decrypted, plaintext, OFFLOAD_LARGE_BYTES) != 0) {
+        printf("Split decryption mismatch\n");
+        passed = false;
+    }
+    ciphertext[OFFLOAD_LARGE_BYTES - 1] ^= 1;
+    if(offload_and_wait(&request) != AUTHENTICATION_FAILURE) {
+        printf("Split decryption of a tampered message was not caught\n");
+        passed = false;
+    }
+    ciphertext[OFFLOAD_LARGE_BYTES - 1] ^= 1;
+    gcm_job(&request.job, ARMV8_JOB_AES_GCM_DEC, constants, nonce, ciphertext, OFFLOAD_LARGE_BYTES, ciphertext, tag);
+    if(offload_and_wait(&request) != SUCCESSFUL_OPERATION || memcmp(ciphertext, plaintext, OFFLOAD_LARGE_BYTES) != 0) {
+        printf("Split in place decryption mismatch\n");
+        passed = false;
+    }
+    return passed;
+}
+
+// Time on the submitting thread - encrypting itself, against submitting and later collecting the result
+static void time_offload(uint8_t * plaintext, uint8_t * ciphertext)
+{
+    uint8_t nonce[12] = { 0 }, tag[16];
+    cipher_state_t cs = { .constants = &cc };
+    offload_request_t request;
+
+    uint64_t start = timing_now_ns();
+    armv8_aes_gcm_set_counter(nonce, 96, &cs);
+    armv8_enc_aes_gcm_from_state(&cs, aad, 13*8, plaintext, OFFLOAD_LARGE_BYTES*8LL, ciphertext, tag);
+    uint64_t direct_ns = timing_now_ns() - start;
+
+    gcm_job(&request.job, ARMV8_JOB_AES_GCM_ENC, &cc, nonce, plaintext, OFFLOAD_LARGE_BYTES, ciphertext, tag);
+    request.callback = NULL;
+    request.eventfd = -1;
+    start = timing_now_ns();
+    armv8_offload_submit(pool, &request);
+    uint64_t submit_ns = timing_now_ns() - start;
+    while(!armv8_offload_done(&request));
+    uint64_t offload_ns = timing_now_ns() - start;
+    printf("AES-GCM-128 %u KB: direct %.1f us, submit %.1f us and complete %.1f us over %u parts\n",
+           OFFLOAD_LARGE_BYTES >> 10, direct_ns / 1000.0, submit_ns / 1000.0, offload_ns / 1000.0, request.parts);
+}
+
+int main(int argc, char* argv[]) {
+    uint8_t * plaintext = malloc(OFFLOAD_LARGE_BYTES + 16);
+    uint8_t * ciphertext = malloc(OFFLOAD_LARGE_BYTES + 16);
+    uint8_t * decrypted = malloc(OFFLOAD_LARGE_BYTES + 16);
+    uint64_t rng = 0x2545f4914f6cdd1dull;
+    bool passed = true;
+
+    for( uint32_t i=0; i<OFFLOAD_LARGE_BYTES; ++i ) plaintext[i] = (uint8_t) rng_next(&rng);
+    armv8_aes_gcm_set_constants(AES_GCM_128, 16, key, &cc);
+    armv8_aes_gcm_set_constants(AES_GCM_128, 12, key, &cc_tag12);
+    armv8_expandkeys_enc_aes_cbc_128(cbc_keys, key);
+    cbc_arg = (armv8_cipher_digest_t) { .cipher = { .key = cbc_keys, .iv = cbc_iv },
+                                        .digest.hmac = { key, cbc_hmac_pad, cbc_hmac_pad } };
+
+    int32_t bad_cpu = -1;
+    if(armv8_offload_create(0, NULL, &pool) != INVALID_PARAMETER ||
+       armv8_offload_create(ARMV8_OFFLOAD_MAX_WORKERS + 1, NULL, &pool) != INVALID_PARAMETER ||
+       armv8_offload_create(1, &bad_cpu, &pool) != INVALID_PARAMETER) {
+        printf("Invalid pool parameters were not rejected\n");
+        passed = false;
+    }
+    if(armv8_offload_create(OFFLOAD_WORKERS, NULL, &pool) != SUCCESSFUL_OPERATION) {
+        printf("Failed to create the pool\n");
+        return 1;
+    }
+
+    passed &= test_small_requests();
+    passed &= test_split(&cc, plaintext, ciphertext, decrypted);
+    passed &= test_split(&cc_tag12, plaintext, ciphertext, decrypted);
+    time_offload(plaintext, ciphertext);
+    armv8_offload_destroy(pool);
+
+    free(plaintext);
+    free(ciphertext);
+    free(decrypted);
+    if(!passed) {
+        printf("Failed\n");
+        return 1;
+    }
+    printf("Success\n");
+    return 0;
+}
@@ -0,0 +1,516 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Comparison against OpenSSL libcrypto
+//// Runs the same size sweep through this library and through the EVP interface of the
+//// system libcrypto, and reports the throughput of each side by side with the speedup.
+//// Every run is also a differential test - before timing, the ciphertext, plaintext,
+//// tags and digests from both are checked to be identical.
+//// Only built when pkg-config finds libcrypto
+
+#define NDEBUG
+#include <assert.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#else
+#include <openssl/hmac.h>
+#endif
+
+#include "AArch64cryptolib.h"
+#include "test_timing.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define cipher_constants_t  armv8_cipher_constants_t
+#define cipher_state_t      armv8_cipher_state_t
+#define cipher_mode_t       armv8_cipher_mode_t
+
+#define OPENSSL_MAX_SIZES       16
+#define OPENSSL_MAX_BYTES       (1 << 20)
+#define OPENSSL_AAD_BYTES       16
+#define OPENSSL_TAG_BYTES       16
+#define OPENSSL_HMAC_BLOCK      64
+#define OPENSSL_HMAC_KEY_BYTES  32
+#define OPENSSL_MAX_DIGEST      32
+
+typedef enum compare_algorithm { COMPARE_GCM, COMPARE_CBC_SHA1, COMPARE_CBC_SHA256, COMPARE_ALGORITHM_COUNT } compare_algorithm_t;
+
+static const char * compare_algorithm_names[COMPARE_ALGORITHM_COUNT] = { "gcm", "cbc_sha1", "cbc_sha256" };
+
+typedef struct compare_options {
+    bool algorithms[COMPARE_ALGORITHM_COUNT];
+    bool key_sizes[3];          // AES-GCM 128, 192 and 256 - AES-CBC is 128 only
+    uint32_t sizes[OPENSSL_MAX_SIZES];
+    uint32_t size_count;
+    uint64_t bytes_per_trial;
+    timing_options_t timing;
+} compare_options_t;
+
+//// Keys and buffers for both libraries - the OpenSSL contexts are set up once with the key,
+//// and the key schedules here are expanded once, so each run only pays for the IV and data
+typedef struct compare_context {
+    compare_algorithm_t algorithm;
+    uint32_t key_bits;
+    uint8_t key[32];
+    uint8_t hmac_key[OPENSSL_HMAC_KEY_BYTES];
+    uint8_t nonce[16];
+    uint8_t iv[16];
+    uint8_t aad[OPENSSL_AAD_BYTES + 16];
+    //// AArch64cryptolib
+    cipher_constants_t cc;
+    uint8_t cbc_enc_key[256];
+    uint8_t cbc_dec_key[256];
+    uint8_t i_key_pad[64];
+    uint8_t o_key_pad[64];
+    armv8_cipher_digest_t arg;
+    //// libcrypto
+    EVP_CIPHER_CTX * evp_enc;
+    EVP_CIPHER_CTX * evp_dec;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_MAC * mac;
+    EVP_MAC_CTX * hmac;
+#else
+    HMAC_CTX * hmac;
+#endif
+    const EVP_MD * md;
+    uint32_t digest_bytes;
+} compare_context_t;
+
+typedef struct compare_buffers {
+    uint8_t * plaintext;
+    uint8_t * ciphertext;       // reference ciphertext from this library, input to decrypt
+    uint8_t * output;
+    uint8_t tag[OPENSSL_MAX_DIGEST + 16];      // reference tag or digest for decrypt
+    uint8_t output_tag[OPENSSL_MAX_DIGEST + 16];
+} compare_buffers_t;
+
+//// HMAC ipad/opad precompute - hash of one block of the padded key XOR 0x36 and 0x5c
+static void hmac_pads(bool sha256, const uint8_t * key, uint32_t key_bytes, uint8_t * i_key_pad, uint8_t * o_key_pad)
+{
+    uint8_t ipad[OPENSSL_HMAC_BLOCK], opad[OPENSSL_HMAC_BLOCK];
+    for(uint32_t i=0; i<OPENSSL_HMAC_BLOCK; ++i) {
+        uint8_t k = (i < key_bytes) ? key[i] : 0;
+        ipad[i] = k ^ 0x36;
+        opad[i] = k ^ 0x5c;
+    }
+    if(sha256) {
+        armv8_sha256_block_partial(NULL, ipad, i_key_pad, OPENSSL_HMAC_BLOCK);
+        armv8_sha256_block_partial(NULL, opad, o_key_pad, OPENSSL_HMAC_BLOCK);
+    } else {
+        armv8_sha1_block_partial(NULL, ipad, i_key_pad, OPENSSL_HMAC_BLOCK);
+        armv8_sha1_block_partial(NULL, opad, o_key_pad, OPENSSL_HMAC_BLOCK);
+    }
+}
+
+static const EVP_CIPHER * gcm_cipher(uint32_t key_bits)
+{
+    switch(key_bits)
+    {
+        case 128: return EVP_aes_128_gcm();
+        case 192: return EVP_aes_192_gcm();
+        default:  return EVP_aes_256_gcm();
+    }
+}
+
+bool context_init(compare_context_t * ctx, compare_algorithm_t algorithm, uint32_t key_bits)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->algorithm = algorithm;
+    ctx->key_bits = key_bits;
+    for(uint32_t i=0; i<sizeof(ctx->key); ++i) ctx->key[i] = (uint8_t) (i * 37 + 11);
+    for(uint32_t i=0; i<sizeof(ctx->hmac_key); ++i) ctx->hmac_key[i] = (uint8_t) (i * 53 + 3);
+    for(uint32_t i=0; i<12; ++i) ctx->nonce[i] = (uint8_t) (i * 17 + 1);
+    for(uint32_t i=0; i<sizeof(ctx->iv); ++i) ctx->iv[i] = (uint8_t) (i * 23 + 9);
+    for(uint32_t i=0; i<OPENSSL_AAD_BYTES; ++i) ctx->aad[i] = (uint8_t) (i * 7 + 2);
+
+    ctx->evp_enc = EVP_CIPHER_CTX_new();
+    ctx->evp_dec = EVP_CIPHER_CTX_new();
+    if(ctx->evp_enc == NULL || ctx->evp_dec == NULL) return false;
+
+    if(algorithm == COMPARE_GCM) {
+        cipher_mode_t mode = (key_bits == 128) ? AES_GCM_128 : (key_bits == 192) ? AES_GCM_192 : AES_GCM_256;
+        if(armv8_aes_gcm_set_constants(mode, OPENSSL_TAG_BYTES, ctx->key, &ctx->cc) != SUCCESSFUL_OPERATION) return false;
+        ctx->digest_bytes = OPENSSL_TAG_BYTES;
+        return EVP_EncryptInit_ex(ctx->evp_enc, gcm_cipher(key_bits), NULL, ctx->key, NULL) == 1 &&
+               EVP_DecryptInit_ex(ctx->evp_dec, gcm_cipher(key_bits), NULL, ctx->key, NULL) == 1;
+    }
+
+    bool sha256 = (algorithm == COMPARE_CBC_SHA256);
+    armv8_expandkeys_enc_aes_cbc_128(ctx->cbc_enc_key, ctx->key);
+    armv8_expandkeys_dec_aes_cbc_128(ctx->cbc_dec_key, ctx->key);
+    hmac_pads(sha256, ctx->hmac_key, OPENSSL_HMAC_KEY_BYTES, ctx->i_key_pad, ctx->o_key_pad);
+    ctx->arg.cipher.iv = ctx->iv;
+    ctx->arg.digest.hmac.key = ctx->hmac_key;
+    ctx->arg.digest.hmac.i_key_pad = ctx->i_key_pad;
+    ctx->arg.digest.hmac.o_key_pad = ctx->o_key_pad;
+    ctx->md = sha256 ? EVP_sha256() : EVP_sha1();
+    ctx->digest_bytes = sha256 ? 32 : 20;
+    if(EVP_EncryptInit_ex(ctx->evp_enc, EVP_aes_128_cbc(), NULL, ctx->key, NULL) != 1 ||
+       EVP_DecryptInit_ex(ctx->evp_dec, EVP_aes_128_cbc(), NULL, ctx->key, NULL) != 1) return false;
+    EVP_CIPHER_CTX_set_padding(ctx->evp_enc, 0);
+    EVP_CIPHER_CTX_set_padding(ctx->evp_dec, 0);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    OSSL_PARAM params[2] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, sha256 ? "SHA256" : "SHA1", 0),
+        OSSL_PARAM_construct_end() };
+    ctx->mac = EVP_MAC_fetch(NULL, "HMAC", NULL);
+    ctx->hmac = (ctx->mac != NULL) ? EVP_MAC_CTX_new(ctx->mac) : NULL;
+    return ctx->hmac != NULL && EVP_MAC_init(ctx->hmac, ctx->hmac_key, OPENSSL_HMAC_KEY_BYTES, params) == 1;
+#else
+    ctx->hmac = HMAC_CTX_new();
+    return ctx->hmac != NULL && HMAC_Init_ex(ctx->hmac, ctx->hmac_key, OPENSSL_HMAC_KEY_BYTES, ctx->md, NULL) == 1;
+#endif
+}
+
+void context_free(compare_context_t * ctx)
+{
+    EVP_CIPHER_CTX_free(ctx->evp_enc);
+    EVP_CIPHER_CTX_free(ctx->evp_dec);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_MAC_CTX_free(ctx->hmac);
+    EVP_MAC_free(ctx->mac);
+#else
+    HMAC_CTX_free(ctx->hmac);
+#endif
+}
+
+//// HMAC of data with the key already set, as it would be for an SA
+static bool openssl_hmac(compare_context_t * ctx, const uint8_t * data, uint32_t bytes, uint8_t * digest)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    size_t length;
+    return EVP_MAC_init(ctx->hmac, NULL, 0, NULL) == 1 &&
+           EVP_MAC_update(ctx->hmac, data, bytes) == 1 &&
+           EVP_MAC_final(ctx->hmac, digest, &length, OPENSSL_MAX_DIGEST) == 1;
+#else
+    unsigned int length;
+    return HMAC_Init_ex(ctx->hmac, NULL, 0, NULL, NULL) == 1 &&
+           HMAC_Update(ctx->hmac, data, bytes) == 1 &&
+           HMAC_Final(ctx->hmac, digest, &length) == 1;
+#endif
+}
+
+//// One message through this library - for decrypt, tag is the tag or digest to check against
+static inline bool armv8_run(compare_context_t * ctx, bool encrypt, uint8_t * input, uint32_t bytes,
+                             uint8_t * output, uint8_t * tag, uint8_t * output_tag)
+{
+    switch(ctx->algorithm)
+    {
+        case COMPARE_GCM: {
+            //// a fresh state per message, as set_counter with a 96b nonce doesn't clear the tag
+            cipher_state_t cs = { .constants = &ctx->cc };
+            armv8_aes_gcm_set_counter(ctx->nonce, 96, &cs);
+            if(encrypt) {
+                return armv8_enc_aes_gcm_from_state(&cs, ctx->aad, OPENSSL_AAD_BYTES*8,
+                                                    input, (uint64_t) bytes*8, output, output_tag) == SUCCESSFUL_OPERATION;
+            }
+            return armv8_dec_aes_gcm_from_state(&cs, ctx->aad, OPENSSL_AAD_BYTES*8,
+                                                input, (uint64_t) bytes*8, tag, output) == SUCCESSFUL_OPERATION;
+        }
+        case COMPARE_CBC_SHA1:
+            if(encrypt) {
+                ctx->arg.cipher.key = ctx->cbc_enc_key;
+                return armv8_enc_aes_cbc_sha1_128(input, output, bytes, output, output_tag, bytes, &ctx->arg) == 0;
+            }
+            ctx->arg.cipher.key = ctx->cbc_dec_key;
+            return armv8_dec_aes_cbc_sha1_128(input, output, bytes, input, output_tag, bytes, &ctx->arg) == 0 &&
+                   memcmp(output_tag, tag, ctx->digest_bytes) == 0;
+        default:
+            if(encrypt) {
+                ctx->arg.cipher.key = ctx->cbc_enc_key;
+                return armv8_enc_aes_cbc_sha256_128(input, output, bytes, output, output_tag, bytes, &ctx->arg) == 0;
+            }
+            ctx->arg.cipher.key = ctx->cbc_dec_key;
+            return armv8_dec_aes_cbc_sha256_128(input, output, bytes, input, output_tag, bytes, &ctx->arg) == 0 &&
+                   memcmp(output_tag, tag, ctx->digest_bytes) == 0;
+    }
+}
+
+//// The same message through libcrypto - AES-CBC with HMAC is encrypt-then-MAC over the ciphertext,
+//// as in IPsec ESP, since the stitched EVP_aes_128_cbc_hmac_sha* ciphers are x86 only and MAC-then-encrypt
+static inline bool openssl_run(compare_context_t * ctx, bool encrypt, uint8_t * input, uint32_t bytes,
+                               uint8_t * output, uint8_t * tag, uint8_t * output_tag)
+{
+    int length, final_length;
+    if(ctx->algorithm == COMPARE_GCM) {
+        if(encrypt) {
+            return EVP_EncryptInit_ex(ctx->evp_enc, NULL, NULL, NULL, ctx->nonce) == 1 &&
+                   EVP_EncryptUpdate(ctx->evp_enc, NULL, &length, ctx->aad, OPENSSL_AAD_BYTES) == 1 &&
+                   EVP_EncryptUpdate(ctx->evp_enc, output, &length, input, bytes) == 1 &&
+                   EVP_EncryptFinal_ex(ctx->evp_enc, output + length, &final_length) == 1 &&
+                   EVP_CIPHER_CTX_ctrl(ctx->evp_enc, EVP_CTRL_GCM_GET_TAG, OPENSSL_TAG_BYTES, output_tag) == 1;
+        }
+        return EVP_DecryptInit_ex(ctx->evp_dec, NULL, NULL, NULL, ctx->nonce) == 1 &&
+               EVP_DecryptUpdate(ctx->evp_dec, NULL, &length, ctx->aad, OPENSSL_AAD_BYTES) == 1 &&
+               EVP_DecryptUpdate(ctx->evp_dec, output, &length, input, bytes) == 1 &&
+               EVP_CIPHER_CTX_ctrl(ctx->evp_dec, EVP_CTRL_GCM_SET_TAG, OPENSSL_TAG_BYTES, tag) == 1 &&
+               EVP_DecryptFinal_ex(ctx->evp_dec, output + length, &final_length) > 0;
+    }
+    if(encrypt) {
+        return EVP_EncryptInit_ex(ctx->evp_enc, NULL, NULL, NULL, ctx->iv) == 1 &&
+               EVP_EncryptUpdate(ctx->evp_enc, output, &length, input, bytes) == 1 &&
+               EVP_EncryptFinal_ex(ctx->evp_enc, output + length, &final_length) == 1 &&
+               openssl_hmac(ctx, output, bytes, output_tag);
+    }
+    return openssl_hmac(ctx, input, bytes, output_tag) &&
+           memcmp(output_tag, tag, ctx->digest_bytes) == 0 &&
+           EVP_DecryptInit_ex(ctx->evp_dec, NULL, NULL, NULL, ctx->iv) == 1 &&
+           EVP_DecryptUpdate(ctx->evp_dec, output, &length, input, bytes) == 1 &&
+           EVP_DecryptFinal_ex(ctx->evp_dec, output + length, &final_length) == 1;
+}
+
+//// Encrypt with both libraries and decrypt with both, checking every output matches -
+//// leaves this library's ciphertext and tag in the buffers as the input for timing decrypt
+bool cross_check(compare_context_t * ctx, uint32_t bytes, compare_buffers_t * b, bool verbose)
+{
+    bool success = true;
+    uint8_t openssl_tag[OPENSSL_MAX_DIGEST + 16];
+
+    bool armv8_ok = armv8_run(ctx, true, b->plaintext, bytes, b->ciphertext, NULL, b->tag);
+    bool openssl_ok = openssl_run(ctx, true, b->plaintext, bytes, b->output, NULL, openssl_tag);
+    if(!armv8_ok || !openssl_ok || memcmp(b->ciphertext, b->output, bytes) != 0 ||
+       memcmp(b->tag, openssl_tag, ctx->digest_bytes) != 0) {
+        if(verbose) printf("Encrypt mismatch at %u bytes (AArch64cryptolib %s, OpenSSL %s)\n", bytes,
+                           armv8_ok ? "ok" : "failed", openssl_ok ? "ok" : "failed");
+        success = false;
+    }
+
+    memset(b->output, 0, bytes);
+    armv8_ok = armv8_run(ctx, false, b->ciphertext, bytes, b->output, b->tag, b->output_tag);
+    if(!armv8_ok || memcmp(b->output, b->plaintext, bytes) != 0) {
+        if(verbose) printf("AArch64cryptolib decrypt of OpenSSL output failed at %u bytes\n", bytes);
+        success = false;
+    }
+    memset(b->output, 0, bytes);
+    openssl_ok = openssl_run(ctx, false, b->ciphertext, bytes, b->output, b->tag, b->output_tag);
+    if(!openssl_ok || memcmp(b->output, b->plaintext, bytes) != 0) {
+        if(verbose) printf("OpenSSL decrypt of AArch64cryptolib output failed at %u bytes\n", bytes);
+        success = false;
+    }
+
+    //// and a corrupted tag must be rejected by both
+    b->tag[0] ^= 1;
+    if(armv8_run(ctx, false, b->ciphertext, bytes, b->output, b->tag, b->output_tag) ||
+       openssl_run(ctx, false, b->ciphertext, bytes, b->output, b->tag, b->output_tag)) {
+        if(verbose) printf("Corrupted tag accepted at %u bytes\n", bytes);
+        success = false;
+    }
+    b->tag[0] ^= 1;
+    return success;
+}
+
+void time_runs(const compare_options_t * options, compare_context_t * ctx, bool openssl, bool encrypt,
+               uint32_t bytes, compare_buffers_t * b, timing_result_t * timing)
+{
+    timing_counters_t counters;
+    timing_sample_t samples[TIMING_MAX_TRIALS];
+    uint8_t * input = encrypt ? b->plaintext : b->ciphertext;
+    uint64_t runs = options->bytes_per_trial / bytes;
+    if(runs == 0) runs = 1;
+    uint64_t warmup_count = timing_warmup_count(&options->timing, (runs+9)/10);
+    bool success = true;
+
+    for(uint64_t i=0; i<warmup_count; ++i) {
+        success &= openssl ? openssl_run(ctx, encrypt, input, bytes, b->output, b->tag, b->output_tag)
+                           : armv8_run(ctx, encrypt, input, bytes, b->output, b->tag, b->output_tag);
+    }
+    timing_counters_open(&counters, options->timing.use_pmu);
+    for(uint32_t trial=0; trial<options->timing.trials; ++trial) {
+        timing_start(&counters, &samples[trial]);
+        if(openssl) {
+            for(uint64_t i=0; i<runs; ++i) success &= openssl_run(ctx, encrypt, input, bytes, b->output, b->tag, b->output_tag);
+        } else {
+            for(uint64_t i=0; i<runs; ++i) success &= armv8_run(ctx, encrypt, input, bytes, b->output, b->tag, b->output_tag);
+        }
+        timing_stop(&counters, &samples[trial]);
+    }
+    timing_counters_close(&counters);
+    timing->bytes = bytes;
+    timing->success = success;
+    timing_summarize(samples, options->timing.trials, runs, timing);
+}
+
+void report_begin(timing_format_t format)
+{
+    if(format == TIMING_FORMAT_CSV) {
+        printf("mode,operation,bytes,runs,trials,armv8_ns_per_run,armv8_gbps,armv8_cycles_per_byte,"
+               "openssl_ns_per_run,openssl_gbps,openssl_cycles_per_byte,speedup,match\n");
+    } else if(format == TIMING_FORMAT_JSON) {
+        printf("[");
+    }
+}
+
+void report_end(timing_format_t format)
+{
+    if(format == TIMING_FORMAT_JSON) {
+        printf("\n]\n");
+    }
+}
+
+void report(timing_format_t format, const char * mode, const char * operation,
+            const timing_result_t * armv8, const timing_result_t * openssl, bool match, uint64_t index)
+{
+    double speedup = (armv8->ns_per_run > 0.0) ? openssl->ns_per_run / armv8->ns_per_run : 0.0;
+    double armv8_cpb = armv8->cycles_per_run / armv8->bytes;
+    double openssl_cpb = openssl->cycles_per_run / openssl->bytes;
+    bool success = match && armv8->success && openssl->success;
+    switch(format)
+    {
+        case TIMING_FORMAT_CSV:
+            printf("%s,%s,%lu,%lu,%u,%.2f,%.3f,%.4f,%.2f,%.3f,%.4f,%.3f,%s\n",
+                   mode, operation, armv8->bytes, armv8->runs, armv8->trials,
+                   armv8->ns_per_run, timing_gbps(armv8), armv8_cpb,
+                   openssl->ns_per_run, timing_gbps(openssl), openssl_cpb, speedup, success ? "Success" : "Failure");
+            break;
+        case TIMING_FORMAT_JSON:
+            printf("%s\n  {\"mode\": \"%s\", \"operation\": \"%s\", \"bytes\": %lu, \"runs\": %lu, \"trials\": %u, "
+                   "\"armv8_ns_per_run\": %.2f, \"armv8_gbps\": %.3f, \"armv8_cycles_per_byte\": %.4f, "
+                   "\"openssl_ns_per_run\": %.2f, \"openssl_gbps\": %.3f, \"openssl_cycles_per_byte\": %.4f, "
+                   "\"speedup\": %.3f, \"match\": %s}",
+                   index ? "," : "", mode, operation, armv8->bytes, armv8->runs, armv8->trials,
+                   armv8->ns_per_run, timing_gbps(armv8), armv8_cpb,
+                   openssl->ns_per_run, timing_gbps(openssl), openssl_cpb, speedup, success ? "true" : "false");
+            break;
+        default:
+            printf("%-18s %-8s %8lu %12.3f %12.3f %8.2fx  %s\n", mode, operation, armv8->bytes,
+                   timing_gbps(armv8), timing_gbps(openssl), speedup, success ? "Success" : "Failure");
+            break;
+    }
+}
+
+int run_comparison(const compare_options_t * options)
+{
+    static const uint32_t gcm_key_bits[3] = { 128, 192, 256 };
+    static const char * gcm_names[3] = { "AES-GCM-128", "AES-GCM-192", "AES-GCM-256" };
+    compare_buffers_t b;
+    uint32_t largest = 0;
+    for(uint32_t s=0; s<options->size_count; ++s) {
+        if(options->sizes[s] > largest) largest = options->sizes[s];
+    }
+    //// this library reads and writes up to 15B past the end of its buffers
+    b.plaintext = aligned_alloc(64, largest + 64);
+    b.ciphertext = aligned_alloc(64, largest + 64);
+    b.output = aligned_alloc(64, largest + 64);
+    for(uint32_t i=0; i<largest + 64; ++i) b.plaintext[i] = (uint8_t) (i * 13 + 5);
+
+    uint64_t index = 0;
+    int failures = 0;
+    if(options->timing.format == TIMING_FORMAT_TEXT) {
+        printf("AArch64cryptolib vs %s\n", OpenSSL_version(OPENSSL_VERSION));
+        printf("%-18s %-8s %8s %12s %12s %9s\n", "mode", "op", "bytes", "armv8 Gb/s", "OpenSSL Gb/s", "speedup");
+    }
+    report_begin(options->timing.format);
+    for(compare_algorithm_t algorithm=0; algorithm<COMPARE_ALGORITHM_COUNT; ++algorithm) {
+        if(!options->algorithms[algorithm]) continue;
+        for(uint32_t k=0; k<3; ++k) {
+            if(algorithm == COMPARE_GCM ? !options->key_sizes[k] : k > 0) continue;
+            const char * mode = (algorithm == COMPARE_GCM) ? gcm_names[k] :
+                                (algorithm == COMPARE_CBC_SHA1) ? "AES-CBC-128-SHA1" : "AES-CBC-128-SHA256";
+            compare_context_t ctx;
+            if(!context_init(&ctx, algorithm, (algorithm == COMPARE_GCM) ? gcm_key_bits[k] : 128)) {
+                printf("Failed to set up %s\n", mode);
+                context_free(&ctx);
+                ++failures;
+                continue;
+            }
+            for(uint32_t s=0; s<options->size_count; ++s) {
+                uint32_t bytes = options->sizes[s];
+                //// AES-CBC has no padding here, so only whole blocks
+                if(algorithm != COMPARE_GCM && (bytes % 16) != 0) continue;
+                bool match = cross_check(&ctx, bytes, &b, options->timing.format == TIMING_FORMAT_TEXT);
+                if(!match) ++failures;
+                for(int encrypt=1; encrypt>=0; --encrypt) {
+                    timing_result_t armv8 = {0}, openssl = {0};
+                    time_runs(options, &ctx, false, encrypt, bytes, &b, &armv8);
+                    time_runs(options, &ctx, true, encrypt, bytes, &b, &openssl);
+                    report(options->timing.format, mode, encrypt ? "encrypt" : "decrypt", &armv8, &openssl, match, index++);
+                }
+            }
+            context_free(&ctx);
+        }
+    }
+    report_end(options->timing.format);
+
+    free(b.plaintext);
+    free(b.ciphertext);
+    free(b.output);
+    return failures ? 1 : 0;
+}
+
+//// Parse a comma separated list of sizes, returning the number parsed
+uint32_t parse_sizes(const char * list, uint32_t * sizes)
+{
+    uint32_t count = 0;
+    const char * p = list;
+    while(*p && count < OPENSSL_MAX_SIZES) {
+        char * end;
+        uint64_t size = strtoul(p, &end, 10);
+        if(end == p) break;
+        if(size == 0 || size > OPENSSL_MAX_BYTES) {
+            printf("Ignoring size %lu - sizes must be up to %u bytes\n", size, OPENSSL_MAX_BYTES);
+        } else {
+            sizes[count++] = (uint32_t) size;
+        }
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    compare_options_t options = {
+        .algorithms = { true, true, true },
+        .key_sizes = { true, true, true },
+        .sizes = { 64, 256, 1024, 1536, 4096, 16384 },
+        .size_count = 6,
+        .bytes_per_trial = 16ul << 20,
+        .timing = TIMING_DEFAULT_OPTIONS };
+
+    for(int i=1; i<argc; ) {
+        int consumed = timing_parse_option(argc, argv, i, &options.timing);
+        if(consumed) {
+            i += consumed;
+            continue;
+        }
+        if(i+1 >= argc) {
+            printf("Unknown or incomplete option %s\n", argv[i]);
+            return 1;
+        }
+        if(strcmp(argv[i], "--mode") == 0) {
+            bool all = (strcmp(argv[i+1], "all") == 0);
+            bool found = all;
+            for(uint32_t a=0; a<COMPARE_ALGORITHM_COUNT; ++a) {
+                options.algorithms[a] = all || (strcmp(argv[i+1], compare_algorithm_names[a]) == 0);
+                found |= options.algorithms[a];
+            }
+            if(!found) {
+                printf("Unknown mode %s - expected gcm, cbc_sha1, cbc_sha256 or all\n", argv[i+1]);
+                return 1;
+            }
+        } else if(strcmp(argv[i], "--sizes") == 0) {
+            options.size_count = parse_sizes(argv[i+1], options.sizes);
+        } else if(strcmp(argv[i], "--bytes-per-trial") == 0) {
+            options.bytes_per_trial = strtoull(argv[i+1], NULL, 10);
+            if(options.bytes_per_trial == 0) options.bytes_per_trial = 1;
+        } else if(strcmp(argv[i], "--key-length") == 0) {
+            uint32_t bits = (uint32_t) strtoul(argv[i+1], NULL, 10);
+            options.key_sizes[0] = (bits == 128);
+            options.key_sizes[1] = (bits == 192);
+            options.key_sizes[2] = (bits == 256);
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        i += 2;
+    }
+
+    return run_comparison(&options);
+}
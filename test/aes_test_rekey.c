@@ -0,0 +1,163 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Re-keying
+//// Reader threads encrypt with whatever constants are active and pass a quiescent state after each message, while
+//// the main thread cycles through a set of keys, reclaiming the old slot before each re-key
+//// Every tag must be the tag of one of the keys - a slot scrubbed or rewritten while a reader was using it would
+//// give some other tag - and readers must see every key
+//// Also checks that a re-key is refused while a reader still holds the old slot, and that offline readers don't
+//// hold up reclaim
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "AArch64cryptolib.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define cipher_constants_t  armv8_cipher_constants_t
+#define cipher_state_t      armv8_cipher_state_t
+#define rekey_handle_t      armv8_rekey_handle_t
+
+#define REKEY_READERS       4
+#define REKEY_KEYS          4
+#define REKEY_ROTATIONS     200
+#define REKEY_BYTES         64
+
+typedef struct rekey_thread {
+    pthread_t thread;
+    rekey_handle_t * handle;
+    uint32_t seen[REKEY_KEYS];
+    uint64_t messages;
+    bool failed;
+} rekey_thread_t;
+
+static uint8_t keys[REKEY_KEYS][32];
+static uint8_t expected_tags[REKEY_KEYS][16];
+static uint8_t nonce[16] = { 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88 };
+static uint8_t aad[16] = { 0 };
+static uint8_t plaintext[REKEY_BYTES] = { 0 };
+static bool rekey_done = false;
+
+static operation_result_t encrypt_tag(cipher_constants_t * cc, uint8_t * tag)
+{
+    uint8_t ciphertext[REKEY_BYTES];
+    cipher_state_t cs = { .constants = cc };
+    operation_result_t result = armv8_aes_gcm_set_counter(nonce, 96, &cs);
+    result |= armv8_enc_aes_gcm_from_state(&cs, aad, 128, plaintext, REKEY_BYTES*8, ciphertext, tag);
+    return result;
+}
+
+static void * reader_main(void * arg)
+{
+    rekey_thread_t * t = arg;
+    uint32_t reader;
+
+    if(armv8_rekey_reader_register(t->handle, &reader) != SUCCESSFUL_OPERATION) {
+        printf("Reader slot not available\n");
+        t->failed = true;
+        return NULL;
+    }
+    while(!__atomic_load_n(&rekey_done, __ATOMIC_RELAXED) && !t->failed) {
+        uint8_t tag[16];
+        uint32_t k = REKEY_KEYS;
+        if(encrypt_tag(armv8_rekey_constants(t->handle), tag) == SUCCESSFUL_OPERATION) {
+            for( k=0; k<REKEY_KEYS && memcmp(tag, expected_tags[k], 16) != 0; ++k );
+        }
+        if(k == REKEY_KEYS) {
+            printf("Reader %u: tag from a slot that changed while in use\n", reader);
+            t->failed = true;
+            break;
+        }
+        t->seen[k]++;
+        t->messages++;
+        armv8_rekey_quiescent(t->handle, reader);
+    }
+    armv8_rekey_reader_unregister(t->handle, reader);
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    rekey_thread_t threads[REKEY_READERS];
+    rekey_handle_t * handle = aligned_alloc(64, sizeof(rekey_handle_t));
+    cipher_constants_t cc;
+    bool passed = true;
+
+    for( uint32_t k=0; k<REKEY_KEYS; ++k )
+    {
+        memset(keys[k], 0x11 * (k + 1), sizeof(keys[k]));
+        armv8_aes_gcm_set_constants(AES_GCM_256, 16, keys[k], &cc);
+        encrypt_tag(&cc, expected_tags[k]);
+    }
+
+    // A registered reader that hasn't passed a quiescent state holds up the second re-key, until it goes offline
+    uint32_t reader;
+    armv8_rekey_init(handle, AES_GCM_256, 16, keys[0]);
+    armv8_rekey_reader_register(handle, &reader);
+    cipher_constants_t * held = armv8_rekey_constants(handle);
+    if(armv8_rekey_set(handle, AES_GCM_256, 16, keys[1]) != SUCCESSFUL_OPERATION ||
+       armv8_rekey_set(handle, AES_GCM_256, 16, keys[2]) != INTERNAL_FAILURE ||
+       armv8_rekey_reclaim(handle) != INTERNAL_FAILURE) {
+        printf("Re-key was not held up by a reader\n");
+        passed = false;
+    }
+    uint8_t tag[16];
+    if(encrypt_tag(held, tag) != SUCCESSFUL_OPERATION || memcmp(tag, expected_tags[0], 16) != 0 ||
+       encrypt_tag(armv8_rekey_constants(handle), tag) != SUCCESSFUL_OPERATION || memcmp(tag, expected_tags[1], 16) != 0) {
+        printf("Old and new slots don't hold the old and new keys\n");
+        passed = false;
+    }
+    armv8_rekey_offline(handle, reader);
+    if(armv8_rekey_reclaim(handle) != SUCCESSFUL_OPERATION || held->mode != 0 || held->expanded_aes_keys[0].d[0] != 0) {
+        printf("Old slot was not scrubbed once the reader went offline\n");
+        passed = false;
+    }
+    armv8_rekey_online(handle, reader);
+    armv8_rekey_quiescent(handle, reader);
+    armv8_rekey_reader_unregister(handle, reader);
+
+    // Concurrent readers
+    armv8_rekey_init(handle, AES_GCM_256, 16, keys[0]);
+    for( uint32_t i=0; i<REKEY_READERS; ++i )
+    {
+        threads[i] = (rekey_thread_t) { .handle = handle };
+        pthread_create(&threads[i].thread, NULL, reader_main, &threads[i]);
+    }
+    for( uint32_t r=1; r<=REKEY_ROTATIONS; ++r )
+    {
+        armv8_rekey_synchronize(handle);
+        if(armv8_rekey_set(handle, AES_GCM_256, 16, keys[r % REKEY_KEYS]) != SUCCESSFUL_OPERATION) {
+            printf("Re-key %u failed after synchronize\n", r);
+            passed = false;
+        }
+    }
+    __atomic_store_n(&rekey_done, true, __ATOMIC_RELAXED);
+    uint64_t messages = 0;
+    uint32_t seen[REKEY_KEYS] = { 0 };
+    for( uint32_t i=0; i<REKEY_READERS; ++i )
+    {
+        pthread_join(threads[i].thread, NULL);
+        passed &= !threads[i].failed;
+        messages += threads[i].messages;
+        for( uint32_t k=0; k<REKEY_KEYS; ++k ) seen[k] += threads[i].seen[k];
+    }
+    printf("%u re-keys, %llu messages, per key:", REKEY_ROTATIONS, (unsigned long long) messages);
+    for( uint32_t k=0; k<REKEY_KEYS; ++k )
+    {
+        printf(" %u", seen[k]);
+        if(seen[k] == 0) passed = false;
+    }
+    printf("\n");
+    free(handle);
+
+    if(!passed) {
+        printf("Failed\n");
+        return 1;
+    }
+    printf("Success\n");
+    return 0;
+}
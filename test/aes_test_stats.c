@@ -0,0 +1,209 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Runtime statistics counters
+//// A number of threads each run a known mix of AES-GCM and AES-CBC/SHA calls (including tails,
+//// a corrupted tag and an invalid parameter), some exiting before the snapshot and some still
+//// running, and the snapshot is checked against the expected totals
+//// If the library was built without STATS=1, this is reported and the test passes
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "AArch64cryptolib.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define cipher_constants_t  armv8_cipher_constants_t
+#define cipher_state_t      armv8_cipher_state_t
+#define cipher_digest_t     armv8_cipher_digest_t
+#define crypto_stats_t      armv8_crypto_stats_t
+
+#define STATS_THREADS       4
+#define STATS_ITERATIONS    100
+#define STATS_FULL_BYTES    256
+#define STATS_TAIL_BYTES    100
+#define STATS_CBC_BYTES     128
+
+typedef struct stats_thread {
+    pthread_t thread;
+    uint32_t id;
+    bool exit_early;
+    pthread_barrier_t * done;       // threads that stay alive wait here until the snapshot is taken
+    bool failed;
+} stats_thread_t;
+
+static uint8_t key[32] = { 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 };
+static uint8_t nonce[16] = { 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88 };
+static uint8_t aad[16] = { 0xab, 0xad, 0xda, 0xd2 };
+
+// Per thread - iterations of (enc full, enc tail, dec full, dec tail), then one corrupted tag and one invalid tag length
+static void run_gcm(stats_thread_t * t)
+{
+    uint8_t plaintext[STATS_FULL_BYTES] = { 0 };
+    uint8_t ciphertext[STATS_FULL_BYTES];
+    uint8_t decrypted[STATS_FULL_BYTES];
+    uint8_t tag_full[16], tag_tail[16];
+    cipher_constants_t cc = { .mode = AES_GCM_128, .tag_byte_length = 16 };
+    operation_result_t result = SUCCESSFUL_OPERATION;
+
+    plaintext[0] = (uint8_t) t->id;
+    result |= armv8_aes_gcm_set_constants(AES_GCM_128, 16, key, &cc);
+    for( uint32_t i=0; i<STATS_ITERATIONS; ++i )
+    {
+        cipher_state_t cs_enc_full = { .constants = &cc };
+        cipher_state_t cs_enc_tail = { .constants = &cc };
+        cipher_state_t cs_dec_full = { .constants = &cc };
+        cipher_state_t cs_dec_tail = { .constants = &cc };
+
+        result |= armv8_aes_gcm_set_counter(nonce, 96, &cs_enc_full);
+        result |= armv8_enc_aes_gcm_from_state(&cs_enc_full, aad, 128, plaintext, STATS_FULL_BYTES*8, ciphertext, tag_full);
+        result |= armv8_aes_gcm_set_counter(nonce, 96, &cs_dec_full);
+        result |= armv8_dec_aes_gcm_from_state(&cs_dec_full, aad, 128, ciphertext, STATS_FULL_BYTES*8, tag_full, decrypted);
+
+        result |= armv8_aes_gcm_set_counter(nonce, 96, &cs_enc_tail);
+        result |= armv8_enc_aes_gcm_from_state(&cs_enc_tail, aad, 128, plaintext, STATS_TAIL_BYTES*8, ciphertext, tag_tail);
+        result |= armv8_aes_gcm_set_counter(nonce, 96, &cs_dec_tail);
+        result |= armv8_dec_aes_gcm_from_state(&cs_dec_tail, aad, 128, ciphertext, STATS_TAIL_BYTES*8, tag_tail, decrypted);
+    }
+    if(result != SUCCESSFUL_OPERATION || memcmp(plaintext, decrypted, STATS_TAIL_BYTES) != 0) {
+        printf("Thread %u: AES-GCM round trip failed\n", t->id);
+        t->failed = true;
+    }
+
+    // Counted once, as a GCM decryption, through armv8_dec_aes_gcm_full
+    armv8_enc_aes_gcm_full(AES_GCM_128, key, nonce, 96, aad, 128, plaintext, STATS_FULL_BYTES*8, ciphertext, tag_full);
+    tag_full[0] ^= 1;
+    if(armv8_dec_aes_gcm_full(AES_GCM_128, key, nonce, 96, aad, 128, ciphertext, STATS_FULL_BYTES*8,
+                              tag_full, 16, decrypted) != AUTHENTICATION_FAILURE) {
+        printf("Thread %u: corrupted tag not rejected\n", t->id);
+        t->failed = true;
+    }
+    if(armv8_dec_aes_gcm_full(AES_GCM_128, key, nonce, 96, aad, 128, ciphertext, STATS_FULL_BYTES*8,
+                              tag_full, 3, decrypted) != INVALID_PARAMETER) {
+        printf("Thread %u: invalid tag length not rejected\n", t->id);
+        t->failed = true;
+    }
+}
+
+// Per thread - iterations of one CBC-SHA256 encryption
+static void run_cbc(stats_thread_t * t)
+{
+    uint8_t src[STATS_CBC_BYTES] = { 0 };
+    uint8_t dst[STATS_CBC_BYTES];
+    uint8_t digest[64];
+    uint8_t i_key_pad[64] = { 0 };
+    uint8_t o_key_pad[64] = { 0 };
+    uint8_t iv[16] = { 0 };
+    uint8_t expanded_key[16*11];
+    cipher_digest_t arg = { 0 };
+
+    armv8_expandkeys_enc_aes_cbc_128(expanded_key, key);
+    arg.cipher.key = expanded_key;
+    arg.cipher.iv = iv;
+    arg.digest.hmac.i_key_pad = i_key_pad;
+    arg.digest.hmac.o_key_pad = o_key_pad;
+    for( uint32_t i=0; i<STATS_ITERATIONS; ++i )
+    {
+        if(armv8_enc_aes_cbc_sha256_128(src, dst, STATS_CBC_BYTES, dst, digest, STATS_CBC_BYTES, &arg) != 0) {
+            printf("Thread %u: AES-CBC/SHA-256 failed\n", t->id);
+            t->failed = true;
+            return;
+        }
+    }
+}
+
+static void * stats_thread_main(void * arg)
+{
+    stats_thread_t * t = arg;
+    run_gcm(t);
+    run_cbc(t);
+    if(!t->exit_early) {
+        pthread_barrier_wait(t->done);
+        pthread_barrier_wait(t->done);
+    }
+    return NULL;
+}
+
+static bool check(const char * what, armv8_crypto_stats_op_t op, uint64_t value, uint64_t expected)
+{
+    if(value == expected) {
+        return true;
+    }
+    printf("%s %s: got %llu, expected %llu\n", armv8_crypto_stats_op_name(op), what,
+           (unsigned long long) value, (unsigned long long) expected);
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+    stats_thread_t threads[STATS_THREADS];
+    pthread_barrier_t done;
+    crypto_stats_t stats;
+    bool passed = true;
+
+    if(armv8_crypto_stats_snapshot(&stats) != SUCCESSFUL_OPERATION) {
+        printf("Library built without statistics (STATS=1), nothing to test\n");
+        return 0;
+    }
+
+    // Half the threads exit before the snapshot, so both retired and live counters are covered
+    uint32_t live = 0;
+    for( uint32_t i=0; i<STATS_THREADS; ++i ) live += (i & 1);
+    pthread_barrier_init(&done, NULL, live + 1);
+    for( uint32_t i=0; i<STATS_THREADS; ++i )
+    {
+        threads[i] = (stats_thread_t) { .id = i, .exit_early = !(i & 1), .done = &done };
+        pthread_create(&threads[i].thread, NULL, stats_thread_main, &threads[i]);
+    }
+    for( uint32_t i=0; i<STATS_THREADS; ++i )
+    {
+        if(threads[i].exit_early) pthread_join(threads[i].thread, NULL);
+    }
+    pthread_barrier_wait(&done);
+
+    armv8_crypto_stats_snapshot(&stats);
+
+    pthread_barrier_wait(&done);
+    for( uint32_t i=0; i<STATS_THREADS; ++i )
+    {
+        if(!threads[i].exit_early) pthread_join(threads[i].thread, NULL);
+        passed &= !threads[i].failed;
+    }
+    pthread_barrier_destroy(&done);
+
+    uint64_t n = (uint64_t) STATS_THREADS * STATS_ITERATIONS;
+    passed &= check("calls", ARMV8_STATS_GCM_ENC, stats.calls[ARMV8_STATS_GCM_ENC], 2*n + STATS_THREADS);
+    passed &= check("bytes", ARMV8_STATS_GCM_ENC, stats.bytes[ARMV8_STATS_GCM_ENC],
+                    n*(STATS_FULL_BYTES + STATS_TAIL_BYTES) + STATS_THREADS*STATS_FULL_BYTES);
+    passed &= check("tail_calls", ARMV8_STATS_GCM_ENC, stats.tail_calls[ARMV8_STATS_GCM_ENC], n);
+    passed &= check("calls", ARMV8_STATS_GCM_DEC, stats.calls[ARMV8_STATS_GCM_DEC], 2*n + 2*STATS_THREADS);
+    passed &= check("tail_calls", ARMV8_STATS_GCM_DEC, stats.tail_calls[ARMV8_STATS_GCM_DEC], n);
+    passed &= check("auth_failures", ARMV8_STATS_GCM_DEC, stats.auth_failures[ARMV8_STATS_GCM_DEC], STATS_THREADS);
+    passed &= check("errors", ARMV8_STATS_GCM_DEC, stats.errors[ARMV8_STATS_GCM_DEC], STATS_THREADS);
+    passed &= check("generic_calls", ARMV8_STATS_GCM_DEC, stats.generic_calls[ARMV8_STATS_GCM_DEC],
+                    stats.generic_calls[ARMV8_STATS_GCM_DEC] ? stats.calls[ARMV8_STATS_GCM_DEC] : 0);
+    passed &= check("calls", ARMV8_STATS_CBC_SHA256_ENC, stats.calls[ARMV8_STATS_CBC_SHA256_ENC], n);
+    passed &= check("bytes", ARMV8_STATS_CBC_SHA256_ENC, stats.bytes[ARMV8_STATS_CBC_SHA256_ENC], n*STATS_CBC_BYTES);
+    passed &= check("errors", ARMV8_STATS_CBC_SHA256_ENC, stats.errors[ARMV8_STATS_CBC_SHA256_ENC], 0);
+    passed &= check("calls", ARMV8_STATS_CBC_SHA1_ENC, stats.calls[ARMV8_STATS_CBC_SHA1_ENC], 0);
+
+    printf("%-16s %10s %12s %10s %10s %10s %10s\n", "op", "calls", "bytes", "tail", "generic", "auth_fail", "errors");
+    for( uint32_t op=0; op<ARMV8_STATS_OP_COUNT; ++op )
+    {
+        if(stats.calls[op] == 0) continue;
+        printf("%-16s %10llu %12llu %10llu %10llu %10llu %10llu\n", armv8_crypto_stats_op_name(op),
+               (unsigned long long) stats.calls[op], (unsigned long long) stats.bytes[op],
+               (unsigned long long) stats.tail_calls[op], (unsigned long long) stats.generic_calls[op],
+               (unsigned long long) stats.auth_failures[op], (unsigned long long) stats.errors[op]);
+    }
+
+    if(!passed) {
+        printf("Failed\n");
+        return 1;
+    }
+    printf("Success\n");
+    return 0;
+}
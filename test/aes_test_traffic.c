@@ -0,0 +1,547 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Traffic replay throughput
+//// Unlike the speed test, which reuses one hot buffer and one key, packets here have sizes
+//// drawn from a distribution, are spread over a working set much larger than the last level
+//// cache and visited in a random order, start at varying alignments, can be in place or out
+//// of place, and each uses one of thousands of keys
+
+#define NDEBUG
+#include <assert.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "AArch64cryptolib.h"
+#include "test_timing.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define cipher_constants_t  armv8_cipher_constants_t
+#define cipher_state_t      armv8_cipher_state_t
+#define cipher_mode_t       armv8_cipher_mode_t
+#define cipher_digest_t     armv8_cipher_digest_t
+
+#define TRAFFIC_MAX_SIZES       256
+#define TRAFFIC_MAX_BYTES       65536
+#define TRAFFIC_AAD_BYTES       8
+#define TRAFFIC_TAG_BYTES       16
+#define TRAFFIC_SLACK_BYTES     32      // room for the tag and the 16B over-read/over-write
+#define TRAFFIC_SALT            0x01020304
+
+typedef enum traffic_mode {
+    TRAFFIC_GCM_ENC,
+    TRAFFIC_GCM_DEC,
+    TRAFFIC_IPSEC_ENC,
+    TRAFFIC_IPSEC_DEC,
+    TRAFFIC_CBC_SHA1_ENC,
+    TRAFFIC_CBC_SHA1_DEC,
+    TRAFFIC_CBC_SHA256_ENC,
+    TRAFFIC_CBC_SHA256_DEC,
+    TRAFFIC_MODE_COUNT
+} traffic_mode_t;
+
+static const char * traffic_mode_names[TRAFFIC_MODE_COUNT] = {
+    "gcm_enc",
+    "gcm_dec",
+    "ipsec_enc",
+    "ipsec_dec",
+    "cbc_sha1_enc",
+    "cbc_sha1_dec",
+    "cbc_sha256_enc",
+    "cbc_sha256_dec",
+};
+
+typedef enum traffic_placement { TRAFFIC_OUT_OF_PLACE, TRAFFIC_IN_PLACE, TRAFFIC_MIXED } traffic_placement_t;
+
+static const char * traffic_placement_names[3] = { "out_of_place", "in_place", "mixed" };
+
+//// Packet size distribution as (size, weight) pairs
+typedef struct traffic_distribution {
+    const char * name;
+    uint32_t count;
+    uint32_t sizes[TRAFFIC_MAX_SIZES];
+    uint32_t weights[TRAFFIC_MAX_SIZES];
+} traffic_distribution_t;
+
+//// Simple IMIX - 7:4:1 of 64B, 576B and 1500B
+static const traffic_distribution_t traffic_imix = {
+    "imix", 3, { 64, 576, 1500 }, { 7, 4, 1 } };
+
+//// Mix of TLS records - mostly full 16KB records from bulk transfers, with smaller
+//// records from interactive traffic and records sized to fit one TCP segment
+static const traffic_distribution_t traffic_tls = {
+    "tls", 6, { 64, 512, 1400, 4096, 8192, 16384 }, { 10, 10, 20, 10, 10, 40 } };
+
+typedef struct traffic_packet {
+    uint64_t input;         // offset of the packet in the working set
+    uint64_t output;        // offset of the output, in the output working set unless in place
+    uint32_t bytes;
+    uint32_t context;
+    bool in_place;
+} traffic_packet_t;
+
+typedef struct traffic_context {
+    cipher_constants_t cc;
+    uint8_t cbc_keys[256];
+    uint8_t hmac_pads[128];
+    uint8_t key[32];
+} traffic_context_t;
+
+typedef struct traffic_options {
+    traffic_mode_t mode;
+    cipher_mode_t gcm_mode;
+    uint32_t key_bits;
+    traffic_distribution_t distribution;
+    uint64_t working_set_bytes;     // 0 to size from the last level cache
+    uint32_t contexts;
+    int32_t alignment;              // fixed offset from 64B alignment, or -1 for a random offset per packet
+    traffic_placement_t placement;
+    bool shuffle;
+    timing_options_t timing;
+} traffic_options_t;
+
+//// xorshift - only needs to be cheap and reproducible
+static inline uint64_t traffic_random(uint64_t * x)
+{
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+//// Largest cache size reported for cpu0, or 0 if it can't be read
+uint64_t last_level_cache_bytes(void)
+{
+    uint64_t largest = 0;
+    for(uint32_t index=0; index<8; ++index) {
+        char path[128], line[32];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/size", index);
+        FILE * f = fopen(path, "r");
+        if(f == NULL) continue;
+        if(fgets(line, sizeof(line), f) != NULL) {
+            char * end;
+            uint64_t size = strtoull(line, &end, 10);
+            if(*end == 'K') size <<= 10;
+            else if(*end == 'M') size <<= 20;
+            if(size > largest) largest = size;
+        }
+        fclose(f);
+    }
+    return largest;
+}
+
+//// Read a histogram of "<bytes> <weight>" lines, ignoring lines starting with #
+bool read_distribution(const char * filename, traffic_distribution_t * d)
+{
+    char line[128];
+    FILE * f = fopen(filename, "r");
+    if(f == NULL) {
+        printf("Could not open size histogram %s\n", filename);
+        return false;
+    }
+    d->name = filename;
+    d->count = 0;
+    while(fgets(line, sizeof(line), f) != NULL && d->count < TRAFFIC_MAX_SIZES) {
+        unsigned long size, weight;
+        if(line[0] == '#') continue;
+        if(sscanf(line, "%lu %lu", &size, &weight) != 2) continue;
+        if(size == 0 || size > TRAFFIC_MAX_BYTES || weight == 0) {
+            printf("Ignoring histogram line %s", line);
+            continue;
+        }
+        d->sizes[d->count] = (uint32_t) size;
+        d->weights[d->count] = (uint32_t) weight;
+        d->count++;
+    }
+    fclose(f);
+    if(d->count == 0) {
+        printf("No sizes in histogram %s\n", filename);
+        return false;
+    }
+    return true;
+}
+
+static inline uint32_t draw_size(const traffic_distribution_t * d, uint64_t total_weight, uint64_t * seed)
+{
+    uint64_t r = traffic_random(seed) % total_weight;
+    for(uint32_t i=0; i<d->count; ++i) {
+        if(r < d->weights[i]) return d->sizes[i];
+        r -= d->weights[i];
+    }
+    return d->sizes[d->count - 1];
+}
+
+static inline bool is_cbc(traffic_mode_t mode)
+{
+    return mode >= TRAFFIC_CBC_SHA1_ENC;
+}
+
+static inline bool is_decrypt(traffic_mode_t mode)
+{
+    return mode == TRAFFIC_GCM_DEC || mode == TRAFFIC_IPSEC_DEC || mode == TRAFFIC_CBC_SHA1_DEC || mode == TRAFFIC_CBC_SHA256_DEC;
+}
+
+//// Lay the packets out back to back through the working set, then optionally shuffle the
+//// order they are visited in so the hardware prefetchers can't follow from one to the next
+traffic_packet_t * build_schedule(const traffic_options_t * options, uint64_t working_set_bytes,
+                                  uint64_t * packet_count, uint64_t * seed)
+{
+    const traffic_distribution_t * d = &options->distribution;
+    uint64_t total_weight = 0;
+    uint32_t smallest = TRAFFIC_MAX_BYTES;
+    for(uint32_t i=0; i<d->count; ++i) {
+        total_weight += d->weights[i];
+        if(d->sizes[i] < smallest) smallest = d->sizes[i];
+    }
+    uint64_t capacity = working_set_bytes / (smallest + TRAFFIC_SLACK_BYTES + 64) + 1;
+    traffic_packet_t * packets = malloc(capacity * sizeof(traffic_packet_t));
+    uint64_t cursor = 0;
+    uint64_t count = 0;
+    while(count < capacity) {
+        uint32_t bytes = draw_size(d, total_weight, seed);
+        //// AES-CBC works on whole blocks
+        if(is_cbc(options->mode)) bytes = (bytes + 15) & ~15;
+        uint32_t offset = (options->alignment >= 0) ? (uint32_t) options->alignment : (uint32_t) (traffic_random(seed) & 63);
+        uint64_t footprint = ((uint64_t) offset + bytes + TRAFFIC_SLACK_BYTES + 63) & ~63ull;
+        if(cursor + footprint > working_set_bytes) break;
+        traffic_packet_t * p = &packets[count++];
+        p->input = cursor + offset;
+        p->bytes = bytes;
+        p->context = (uint32_t) (traffic_random(seed) % options->contexts);
+        switch(options->placement)
+        {
+            case TRAFFIC_IN_PLACE:      p->in_place = true; break;
+            case TRAFFIC_OUT_OF_PLACE:  p->in_place = false; break;
+            default:                    p->in_place = traffic_random(seed) & 1; break;
+        }
+        //// the IPsec interfaces only work in place
+        if(options->mode == TRAFFIC_IPSEC_ENC || options->mode == TRAFFIC_IPSEC_DEC) p->in_place = true;
+        p->output = p->input;
+        cursor += footprint;
+    }
+    if(options->shuffle) {
+        for(uint64_t i=count; i>1; --i) {
+            uint64_t j = traffic_random(seed) % i;
+            traffic_packet_t t = packets[i-1];
+            packets[i-1] = packets[j];
+            packets[j] = t;
+        }
+    }
+    *packet_count = count;
+    return packets;
+}
+
+static inline void set_cbc_arg(cipher_digest_t * arg, traffic_context_t * c, uint8_t * iv)
+{
+    arg->cipher.key = c->cbc_keys;
+    arg->cipher.iv = iv;
+    arg->digest.hmac.key = c->key;
+    arg->digest.hmac.i_key_pad = c->hmac_pads;
+    arg->digest.hmac.o_key_pad = c->hmac_pads + 64;
+}
+
+//// Process one packet, with the tag (or digest) written directly after the output
+static inline operation_result_t process_packet(traffic_mode_t mode, const traffic_packet_t * p,
+                                                traffic_context_t * contexts, uint8_t * input_set,
+                                                uint8_t * output_set, uint8_t * nonce, uint8_t * aad)
+{
+    traffic_context_t * c = &contexts[p->context];
+    uint8_t * input = input_set + p->input;
+    uint8_t * output = (p->in_place ? input_set : output_set) + p->output;
+    cipher_state_t cs = { .constants = &c->cc };
+    cipher_digest_t arg;
+    uint64_t checksum;
+    operation_result_t result = SUCCESSFUL_OPERATION;
+
+    switch(mode)
+    {
+        //// with keys set up ahead of time the per packet work is set_counter and from_state
+        case TRAFFIC_GCM_ENC:
+            result |= armv8_aes_gcm_set_counter(nonce, 96, &cs);
+            result |= armv8_enc_aes_gcm_from_state(&cs, aad, TRAFFIC_AAD_BYTES*8, input, (uint64_t) p->bytes*8,
+                                                   output, output + p->bytes);
+            break;
+        case TRAFFIC_GCM_DEC:
+            result |= armv8_aes_gcm_set_counter(nonce, 96, &cs);
+            result |= armv8_dec_aes_gcm_from_state(&cs, aad, TRAFFIC_AAD_BYTES*8, input, (uint64_t) p->bytes*8,
+                                                   input + p->bytes, output);
+            break;
+#ifdef IPSEC_ENABLED
+        case TRAFFIC_IPSEC_ENC:
+            result |= armv8_enc_aes_gcm_from_constants_IPsec(&c->cc, TRAFFIC_SALT, 0, aad, TRAFFIC_AAD_BYTES,
+                                                             input, p->bytes, input + p->bytes);
+            break;
+        case TRAFFIC_IPSEC_DEC:
+            result |= armv8_dec_aes_gcm_from_constants_IPsec(&c->cc, TRAFFIC_SALT, 0, aad, TRAFFIC_AAD_BYTES,
+                                                             input, p->bytes, input + p->bytes, &checksum);
+            break;
+#endif
+        case TRAFFIC_CBC_SHA1_ENC:
+            set_cbc_arg(&arg, c, nonce);
+            result |= armv8_enc_aes_cbc_sha1_128(input, output, p->bytes, input, output + p->bytes, p->bytes, &arg) ?
+                      INTERNAL_FAILURE : SUCCESSFUL_OPERATION;
+            break;
+        case TRAFFIC_CBC_SHA1_DEC:
+            set_cbc_arg(&arg, c, nonce);
+            result |= armv8_dec_aes_cbc_sha1_128(input, output, p->bytes, input, output + p->bytes, p->bytes, &arg) ?
+                      INTERNAL_FAILURE : SUCCESSFUL_OPERATION;
+            break;
+        case TRAFFIC_CBC_SHA256_ENC:
+            set_cbc_arg(&arg, c, nonce);
+            result |= armv8_enc_aes_cbc_sha256_128(input, output, p->bytes, input, output + p->bytes, p->bytes, &arg) ?
+                      INTERNAL_FAILURE : SUCCESSFUL_OPERATION;
+            break;
+        case TRAFFIC_CBC_SHA256_DEC:
+            set_cbc_arg(&arg, c, nonce);
+            result |= armv8_dec_aes_cbc_sha256_128(input, output, p->bytes, input, output + p->bytes, p->bytes, &arg) ?
+                      INTERNAL_FAILURE : SUCCESSFUL_OPERATION;
+            break;
+        default:
+            result |= INVALID_PARAMETER;
+            break;
+    }
+    (void) checksum;
+    return result;
+}
+
+void report_begin(timing_format_t format)
+{
+    if(format == TIMING_FORMAT_CSV) {
+        printf("mode,key_bits,distribution,working_set_bytes,contexts,alignment,placement,shuffle,packets,"
+               "average_bytes,trials,ns_per_packet,ns_per_packet_stddev,mpps,gbps,cycles_per_byte,result\n");
+    } else if(format == TIMING_FORMAT_JSON) {
+        printf("[");
+    }
+}
+
+void report_end(timing_format_t format)
+{
+    if(format == TIMING_FORMAT_JSON) {
+        printf("\n]\n");
+    }
+}
+
+void report(const traffic_options_t * options, uint64_t working_set_bytes, uint64_t packets, uint64_t total_bytes,
+            const timing_result_t * timing)
+{
+    char alignment[16];
+    double average_bytes = (double) total_bytes / packets;
+    double mpps = (timing->ns_per_run > 0.0) ? 1e3 / timing->ns_per_run : 0.0;
+    double gbps = (timing->ns_per_run > 0.0) ? 8.0 * average_bytes / timing->ns_per_run : 0.0;
+    double cycles_per_byte = timing->cycles_per_run / average_bytes;
+    uint32_t key_bits = is_cbc(options->mode) ? 128 : options->key_bits;
+    if(options->alignment >= 0) snprintf(alignment, sizeof(alignment), "%d", options->alignment);
+    else snprintf(alignment, sizeof(alignment), "random");
+
+    switch(options->timing.format)
+    {
+        case TIMING_FORMAT_CSV:
+            printf("%s,%u,%s,%lu,%u,%s,%s,%s,%lu,%.1f,%u,%.2f,%.2f,%.3f,%.3f,%.4f,%s\n",
+                   traffic_mode_names[options->mode], key_bits, options->distribution.name, working_set_bytes,
+                   options->contexts, alignment, traffic_placement_names[options->placement],
+                   options->shuffle ? "yes" : "no", packets, average_bytes, timing->trials,
+                   timing->ns_per_run, timing->ns_per_run_stddev, mpps, gbps, cycles_per_byte,
+                   timing->success ? "Success" : "Failure");
+            break;
+        case TIMING_FORMAT_JSON:
+            printf("\n  {\"mode\": \"%s\", \"key_bits\": %u, \"distribution\": \"%s\", \"working_set_bytes\": %lu, "
+                   "\"contexts\": %u, \"alignment\": \"%s\", \"placement\": \"%s\", \"shuffle\": %s, \"packets\": %lu, "
+                   "\"average_bytes\": %.1f, \"trials\": %u, \"ns_per_packet\": %.2f, \"ns_per_packet_stddev\": %.2f, "
+                   "\"mpps\": %.3f, \"gbps\": %.3f, \"cycles_per_byte\": %.4f, \"success\": %s}",
+                   traffic_mode_names[options->mode], key_bits, options->distribution.name, working_set_bytes,
+                   options->contexts, alignment, traffic_placement_names[options->placement],
+                   options->shuffle ? "true" : "false", packets, average_bytes, timing->trials,
+                   timing->ns_per_run, timing->ns_per_run_stddev, mpps, gbps, cycles_per_byte,
+                   timing->success ? "true" : "false");
+            break;
+        default:
+            printf("%s, %u-bit keys, %s sizes (average %.1f bytes)\n", traffic_mode_names[options->mode], key_bits,
+                   options->distribution.name, average_bytes);
+            printf("%lu packets over a %.1f MB working set, %u contexts, alignment %s, %s%s\n", packets,
+                   working_set_bytes / 1048576.0, options->contexts, alignment,
+                   traffic_placement_names[options->placement], options->shuffle ? ", shuffled" : "");
+            printf("%u trials - median %.2f ns/packet (stddev %.2f ns), %.3f Mpps, %.3f Gb/s\n", timing->trials,
+                   timing->ns_per_run, timing->ns_per_run_stddev, mpps, gbps);
+            if(timing->cycles_per_run > 0.0) {
+                printf("%.2f cycles/packet, %.4f cycles/B\n", timing->cycles_per_run, cycles_per_byte);
+            } else {
+                printf("Cycles not available (perf_event_open not permitted or not supported)\n");
+            }
+            printf("Result is %s\n", timing->success ? "Success" : "Failure");
+            break;
+    }
+}
+
+int run_traffic(const traffic_options_t * options)
+{
+    uint64_t seed = 0x2545f4914f6cdd1dull;
+    uint64_t working_set_bytes = options->working_set_bytes;
+    if(working_set_bytes == 0) {
+        //// default to 4x the last level cache, so nothing is left in cache from one pass to the next
+        uint64_t llc = last_level_cache_bytes();
+        working_set_bytes = llc ? 4*llc : (256ull << 20);
+        if(working_set_bytes < (64ull << 20)) working_set_bytes = 64ull << 20;
+    }
+
+    uint8_t * input_set = aligned_alloc(64, working_set_bytes + 64);
+    uint8_t * output_set = aligned_alloc(64, working_set_bytes + 64);
+    uint8_t nonce[16] = {0}, aad[16] = {0};
+    if(input_set == NULL || output_set == NULL) {
+        printf("Could not allocate a %lu byte working set\n", working_set_bytes);
+        return 1;
+    }
+    for(uint64_t i=0; i<working_set_bytes; i+=8) {
+        uint64_t r = traffic_random(&seed);
+        memcpy(input_set + i, &r, 8);
+    }
+    memset(output_set, 0, working_set_bytes);
+    for(uint32_t i=0; i<12; ++i) nonce[i] = (uint8_t) traffic_random(&seed);
+    for(uint32_t i=0; i<TRAFFIC_AAD_BYTES; ++i) aad[i] = (uint8_t) traffic_random(&seed);
+
+    traffic_context_t * contexts = aligned_alloc(64, options->contexts * sizeof(traffic_context_t));
+    for(uint32_t c=0; c<options->contexts; ++c) {
+        for(uint32_t i=0; i<sizeof(contexts[c].key); ++i) contexts[c].key[i] = (uint8_t) traffic_random(&seed);
+        for(uint32_t i=0; i<sizeof(contexts[c].hmac_pads); ++i) contexts[c].hmac_pads[i] = (uint8_t) traffic_random(&seed);
+        armv8_aes_gcm_set_constants(options->gcm_mode, TRAFFIC_TAG_BYTES, contexts[c].key, &contexts[c].cc);
+        if(is_decrypt(options->mode)) {
+            armv8_expandkeys_dec_aes_cbc_128(contexts[c].cbc_keys, contexts[c].key);
+        } else {
+            armv8_expandkeys_enc_aes_cbc_128(contexts[c].cbc_keys, contexts[c].key);
+        }
+    }
+
+    uint64_t packet_count;
+    traffic_packet_t * packets = build_schedule(options, working_set_bytes, &packet_count, &seed);
+    uint64_t total_bytes = 0;
+    for(uint64_t i=0; i<packet_count; ++i) {
+        total_bytes += packets[i].bytes;
+    }
+
+    //// decryption starts from valid packets, so the first pass can be checked - in place
+    //// decryption leaves plaintext behind, so later passes fail authentication but do the same work
+    operation_result_t result = SUCCESSFUL_OPERATION;
+    if(options->mode == TRAFFIC_GCM_DEC || options->mode == TRAFFIC_IPSEC_DEC) {
+        traffic_mode_t encrypt_mode = (options->mode == TRAFFIC_GCM_DEC) ? TRAFFIC_GCM_ENC : TRAFFIC_IPSEC_ENC;
+        for(uint64_t i=0; i<packet_count; ++i) {
+            traffic_packet_t p = packets[i];
+            p.in_place = true;
+            p.output = p.input;
+            process_packet(encrypt_mode, &p, contexts, input_set, output_set, nonce, aad);
+        }
+    }
+    for(uint64_t i=0; i<packet_count; ++i) {
+        result |= process_packet(options->mode, &packets[i], contexts, input_set, output_set, nonce, aad);
+    }
+
+    timing_counters_t counters;
+    timing_sample_t samples[TIMING_MAX_TRIALS];
+    timing_counters_open(&counters, options->timing.use_pmu);
+    for(uint32_t trial=0; trial<options->timing.trials; ++trial) {
+        timing_start(&counters, &samples[trial]);
+        for(uint64_t i=0; i<packet_count; ++i) {
+            process_packet(options->mode, &packets[i], contexts, input_set, output_set, nonce, aad);
+        }
+        timing_stop(&counters, &samples[trial]);
+    }
+    timing_counters_close(&counters);
+
+    timing_result_t timing = { .success = (result == SUCCESSFUL_OPERATION) };
+    timing_summarize(samples, options->timing.trials, packet_count, &timing);
+    report_begin(options->timing.format);
+    report(options, working_set_bytes, packet_count, total_bytes, &timing);
+    report_end(options->timing.format);
+
+    free(packets);
+    free(contexts);
+    free(input_set);
+    free(output_set);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    traffic_options_t options = {
+        .mode = TRAFFIC_GCM_ENC,
+        .gcm_mode = AES_GCM_128,
+        .key_bits = 128,
+        .distribution = traffic_imix,
+        .working_set_bytes = 0,
+        .contexts = 4096,
+        .alignment = -1,
+        .placement = TRAFFIC_OUT_OF_PLACE,
+        .shuffle = true,
+        .timing = TIMING_DEFAULT_OPTIONS };
+
+    for(int i=1; i<argc; ) {
+        int consumed = timing_parse_option(argc, argv, i, &options.timing);
+        if(consumed) {
+            i += consumed;
+            continue;
+        }
+        if(strcmp(argv[i], "--no-shuffle") == 0) {
+            options.shuffle = false;
+            i++;
+            continue;
+        }
+        if(i+1 >= argc) {
+            printf("Unknown or incomplete option %s\n", argv[i]);
+            return 1;
+        }
+        if(strcmp(argv[i], "--sizes") == 0) {
+            if(strcmp(argv[i+1], "imix") == 0) {
+                options.distribution = traffic_imix;
+            } else if(strcmp(argv[i+1], "tls") == 0) {
+                options.distribution = traffic_tls;
+            } else if(!read_distribution(argv[i+1], &options.distribution)) {
+                return 1;
+            }
+        } else if(strcmp(argv[i], "--working-set") == 0) {
+            options.working_set_bytes = strtoull(argv[i+1], NULL, 10) << 20;
+        } else if(strcmp(argv[i], "--contexts") == 0) {
+            options.contexts = (uint32_t) strtoul(argv[i+1], NULL, 10);
+            if(options.contexts == 0) options.contexts = 1;
+        } else if(strcmp(argv[i], "--alignment") == 0) {
+            options.alignment = (strcmp(argv[i+1], "random") == 0) ? -1 : (int32_t) (strtoul(argv[i+1], NULL, 10) & 63);
+        } else if(strcmp(argv[i], "--placement") == 0) {
+            if(strcmp(argv[i+1], "in_place") == 0) options.placement = TRAFFIC_IN_PLACE;
+            else if(strcmp(argv[i+1], "mixed") == 0) options.placement = TRAFFIC_MIXED;
+            else options.placement = TRAFFIC_OUT_OF_PLACE;
+        } else if(strcmp(argv[i], "--key-length") == 0) {
+            options.key_bits = (uint32_t) strtoul(argv[i+1], NULL, 10);
+            switch(options.key_bits)
+            {
+                case 128: options.gcm_mode = AES_GCM_128; break;
+                case 192: options.gcm_mode = AES_GCM_192; break;
+                case 256: options.gcm_mode = AES_GCM_256; break;
+                default:
+                    printf("Key length must be 128, 192 or 256\n");
+                    return 1;
+            }
+        } else if(strcmp(argv[i], "--mode") == 0) {
+            traffic_mode_t mode;
+            for(mode=0; mode<TRAFFIC_MODE_COUNT; ++mode) {
+                if(strcmp(argv[i+1], traffic_mode_names[mode]) == 0) break;
+            }
+            if(mode == TRAFFIC_MODE_COUNT) {
+                printf("Unknown mode %s\n", argv[i+1]);
+                return 1;
+            }
+            options.mode = mode;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        i += 2;
+    }
+#ifndef IPSEC_ENABLED
+    if(options.mode == TRAFFIC_IPSEC_ENC || options.mode == TRAFFIC_IPSEC_DEC) {
+        printf("IPsec interfaces are not enabled for this target\n");
+        return 1;
+    }
+#endif
+
+    return run_traffic(&options);
+}
@@ -15,6 +15,14 @@
 
 #define operation_result_t  armv8_operation_result_t
 
+#define MAX_KEY_BYTE_LENGTH 32
+#define MAX_DIGEST_BYTE_LENGTH 32
+
+typedef void (*expandkeys_fn_t)(uint8_t *expanded_key, const uint8_t *user_key);
+typedef int (*cbc_sha_fn_t)(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+                    uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+                    armv8_cipher_digest_t *arg);
+
 #ifndef TEST_DEBUG
 #define TEST_DEBUG_PRINTF 0
 #else
@@ -34,13 +42,15 @@ inline uint8_t hextobyte(uint8_t top, uint8_t bot) {
     return (t<<4) + b;
 }
 
-//// Called once a reference state is set up, runs encrypt/decrypt
-//// and checks the outputs match the expected outputs
+//// Called once a reference state is set up, runs encrypt/decrypt with the SHA1 or SHA256 variant
+//// and checks the outputs match the expected outputs - the digest isn't checked here, see aescbc_test_hmac
 bool __attribute__ ((noinline)) test_reference(uint64_t block_byte_length,
+                    uint64_t key_byte_length,
                     uint8_t * key, uint8_t * iv,
                     uint8_t * reference_plaintext,
                     uint8_t * reference_ciphertext,
                     bool is_encrypt,
+                    bool sha256,
                     bool verbose)
 {
     bool success = true;
@@ -48,11 +58,34 @@ bool __attribute__ ((noinline)) test_reference(uint64_t block_byte_length,
     uint8_t key_expanded[256] = {0};
     uint8_t * output;
     uint8_t * auth;
+    expandkeys_fn_t expandkeys_enc, expandkeys_dec;
+    cbc_sha_fn_t enc, dec;
+
+    switch (key_byte_length) {
+    case 24:
+        expandkeys_enc = armv8_expandkeys_enc_aes_cbc_192;
+        expandkeys_dec = armv8_expandkeys_dec_aes_cbc_192;
+        enc = sha256 ? armv8_enc_aes_cbc_sha256_192 : armv8_enc_aes_cbc_sha1_192;
+        dec = sha256 ? armv8_dec_aes_cbc_sha256_192 : armv8_dec_aes_cbc_sha1_192;
+        break;
+    case 32:
+        expandkeys_enc = armv8_expandkeys_enc_aes_cbc_256;
+        expandkeys_dec = armv8_expandkeys_dec_aes_cbc_256;
+        enc = sha256 ? armv8_enc_aes_cbc_sha256_256 : armv8_enc_aes_cbc_sha1_256;
+        dec = sha256 ? armv8_dec_aes_cbc_sha256_256 : armv8_dec_aes_cbc_sha1_256;
+        break;
+    default:
+        expandkeys_enc = armv8_expandkeys_enc_aes_cbc_128;
+        expandkeys_dec = armv8_expandkeys_dec_aes_cbc_128;
+        enc = sha256 ? armv8_enc_aes_cbc_sha256_128 : armv8_enc_aes_cbc_sha1_128;
+        dec = sha256 ? armv8_dec_aes_cbc_sha256_128 : armv8_dec_aes_cbc_sha1_128;
+        break;
+    }
 
     output = (uint8_t *)malloc(block_byte_length);
 
     //// Dummy auth data to feed cipher function.
-    auth = (uint8_t *)malloc(block_byte_length);
+    auth = (uint8_t *)malloc(MAX_DIGEST_BYTE_LENGTH);
     //// Dummy auth key
     arg.digest.hmac.key = key;
     arg.digest.hmac.i_key_pad = key;
@@ -61,12 +94,12 @@ bool __attribute__ ((noinline)) test_reference(uint64_t block_byte_length,
     if (is_encrypt) {
         //// ENCRYPTION TEST
         //// Encrypt reference plaintext and check output with reference ciphertext and tag
-        if(verbose) printf("\n\nENCRYPTION TEST\n");
+        if(verbose) printf("\n\nENCRYPTION TEST (%s)\n", sha256 ? "SHA256" : "SHA1");
 
-        armv8_expandkeys_enc_aes_cbc_128(key_expanded, key);
+        expandkeys_enc(key_expanded, key);
         arg.cipher.key = key_expanded;
         arg.cipher.iv = iv;
-        operation_result_t encrypt_result = armv8_enc_aes_cbc_sha1_128(
+        operation_result_t encrypt_result = enc(
                 reference_plaintext, output, block_byte_length,
                 reference_plaintext, auth, block_byte_length,
                 &arg);
@@ -83,7 +116,7 @@ bool __attribute__ ((noinline)) test_reference(uint64_t block_byte_length,
                 printf("\n");
 
                 printf("Computed digest: 0x");
-                for(uint64_t i=0; i<block_byte_length; ++i) {
+                for(uint64_t i=0; i<(sha256 ? 32 : 20); ++i) {
                     printf("%02x", auth[i]);
                 }
                 printf("\n");
@@ -106,12 +139,12 @@ bool __attribute__ ((noinline)) test_reference(uint64_t block_byte_length,
     } else {
         //// DECRYPTION TEST
         //// Decrypt reference ciphertext and check output with reference plaintext and tag
-        if(verbose) printf("\n\nDECRYPTION TEST\n");
+        if(verbose) printf("\n\nDECRYPTION TEST (%s)\n", sha256 ? "SHA256" : "SHA1");
 
-        armv8_expandkeys_dec_aes_cbc_128(key_expanded, key);
+        expandkeys_dec(key_expanded, key);
         arg.cipher.key = key_expanded;
         arg.cipher.iv = iv;
-        operation_result_t decrypt_result = armv8_dec_aes_cbc_sha1_128(
+        operation_result_t decrypt_result = dec(
                 reference_ciphertext, output, block_byte_length,
                 output, auth, block_byte_length,
                 &arg);
@@ -127,7 +160,7 @@ bool __attribute__ ((noinline)) test_reference(uint64_t block_byte_length,
                 printf("\n");
 
                 printf("Computed digest: 0x");
-                for(uint64_t i=0; i<block_byte_length; ++i) {
+                for(uint64_t i=0; i<(sha256 ? 32 : 20); ++i) {
                     printf("%02x", auth[i]);
                 }
                 printf("\n");
@@ -161,6 +194,7 @@ void process_test_file(FILE * fin)
 {
     //// Initialise/Default values
     uint64_t block_byte_length = 16;
+    uint64_t key_byte_length = 16;
 
     char * input_buff = (char *)malloc(MAX_LINE_LEN);
     fpos_t last_line;
@@ -175,7 +209,7 @@ void process_test_file(FILE * fin)
     uint64_t passes = 0;
     uint64_t skips = 0;
 
-    key = malloc(block_byte_length);
+    key = malloc(MAX_KEY_BYTE_LENGTH);
     iv = malloc(block_byte_length);
     pt = malloc(block_byte_length);
     ct = malloc(block_byte_length);
@@ -191,15 +225,18 @@ void process_test_file(FILE * fin)
                         {
                             bool pass;
                             pass = test_reference(block_byte_length,
-                                        key, iv, pt, ct, dir_encrypt,
-                                        false);
+                                        key_byte_length, key, iv, pt, ct, dir_encrypt,
+                                        false, false) &&
+                                   test_reference(block_byte_length,
+                                        key_byte_length, key, iv, pt, ct, dir_encrypt,
+                                        true, false);
 
                             if (!pass)
                             {
                                 printf("Keylen = %lu\n",
-                                        block_byte_length<<3);
+                                        key_byte_length<<3);
                                 printf("Key 0x");
-                                for(uint64_t i=0; i<block_byte_length; ++i) {
+                                for(uint64_t i=0; i<key_byte_length; ++i) {
                                     printf("%02x", key[i]);
                                 }
                                 printf("\n");
@@ -220,8 +257,11 @@ void process_test_file(FILE * fin)
                                 printf("\n");
 
                                 pass = test_reference(block_byte_length,
-                                            key, iv, pt, ct, dir_encrypt,
-                                            true);
+                                            key_byte_length, key, iv, pt, ct, dir_encrypt,
+                                            false, true);
+                                pass = test_reference(block_byte_length,
+                                            key_byte_length, key, iv, pt, ct, dir_encrypt,
+                                            true, true);
                                 exit(1);
                             }
                             passes++;
@@ -250,7 +290,7 @@ void process_test_file(FILE * fin)
                     //set the AES key
                     fsetpos(fin, &last_line);
                     fseek(fin, 6, SEEK_CUR);
-                    for(uint64_t i=0; i<block_byte_length; ++i) {
+                    for(uint64_t i=0; i<key_byte_length; ++i) {
                         uint8_t top = fgetc(fin);
                         uint8_t bot = fgetc(fin);
                         key[i] = hextobyte(top, bot);
@@ -317,10 +357,16 @@ void process_test_file(FILE * fin)
             }
             else if(strncmp(input_buff, "# Key Length :", 14) == 0) {
                     //Check key length
-                    if(strncmp (input_buff+15, "128", 3) != 0) {
-                    printf("ERROR: Currently only key length 128 is supported.\n");
-                    exit(1);
-                }
+                    if(strncmp (input_buff+15, "128", 3) == 0) {
+                        key_byte_length = 16;
+                    } else if(strncmp (input_buff+15, "192", 3) == 0) {
+                        key_byte_length = 24;
+                    } else if(strncmp (input_buff+15, "256", 3) == 0) {
+                        key_byte_length = 32;
+                    } else {
+                        printf("ERROR: Only key lengths 128, 192 and 256 are supported.\n");
+                        exit(1);
+                    }
             }
         }
     }
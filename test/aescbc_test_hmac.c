@@ -0,0 +1,270 @@
+//Copyright (c) 2018-2019, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// AES-CBC with HMAC-SHA1/SHA256 known answer tests
+//// Each reference gives a key, IV, HMAC key, a header (the bytes authenticated ahead of the ciphertext, as the ESP
+//// header is) and the plaintext, ciphertext and digest. Every reference is encrypted and decrypted, both in place
+//// and out of place, and the ciphertext or plaintext and the digest must all match
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AArch64cryptolib.h"
+
+#define MAX_LINE_LEN        4096
+#define MAX_BLOCKS          67
+#define MAX_HEADER_LEN      64
+#define MAX_DATA_LEN        (MAX_BLOCKS * 16)
+#define MAX_DIGEST_LEN      32
+#define HMAC_BLOCK_LEN      64
+#define SLACK_LEN           64          // the kernels may touch up to a block of SHA input past the end
+
+typedef void (*expandkeys_fn_t)(uint8_t *expanded_key, const uint8_t *user_key);
+typedef int (*cbc_sha_fn_t)(uint8_t *csrc, uint8_t *cdst, uint64_t clen,
+                    uint8_t *dsrc, uint8_t *ddst, uint64_t dlen,
+                    armv8_cipher_digest_t *arg);
+typedef int (*sha_block_fn_t)(uint8_t *init, const uint8_t *src, uint8_t *dst, uint64_t len);
+
+typedef struct reference {
+    uint64_t count;
+    uint8_t key[32];
+    uint8_t iv[16];
+    uint8_t hmac_key[HMAC_BLOCK_LEN];   uint64_t hmac_key_length;
+    uint8_t header[MAX_HEADER_LEN];     uint64_t header_length;
+    uint8_t plaintext[MAX_DATA_LEN];    uint64_t plaintext_length;
+    uint8_t ciphertext[MAX_DATA_LEN];   uint64_t ciphertext_length;
+    uint8_t digest[MAX_DIGEST_LEN];     uint64_t digest_length;
+} reference_t;
+
+typedef struct algorithm {
+    uint64_t key_byte_length;
+    bool sha256;
+    expandkeys_fn_t expandkeys_enc, expandkeys_dec;
+    cbc_sha_fn_t enc, dec;
+} algorithm_t;
+
+static const algorithm_t algorithms[] = {
+    { 16, false, armv8_expandkeys_enc_aes_cbc_128, armv8_expandkeys_dec_aes_cbc_128, armv8_enc_aes_cbc_sha1_128,   armv8_dec_aes_cbc_sha1_128 },
+    { 16, true,  armv8_expandkeys_enc_aes_cbc_128, armv8_expandkeys_dec_aes_cbc_128, armv8_enc_aes_cbc_sha256_128, armv8_dec_aes_cbc_sha256_128 },
+    { 24, false, armv8_expandkeys_enc_aes_cbc_192, armv8_expandkeys_dec_aes_cbc_192, armv8_enc_aes_cbc_sha1_192,   armv8_dec_aes_cbc_sha1_192 },
+    { 24, true,  armv8_expandkeys_enc_aes_cbc_192, armv8_expandkeys_dec_aes_cbc_192, armv8_enc_aes_cbc_sha256_192, armv8_dec_aes_cbc_sha256_192 },
+    { 32, false, armv8_expandkeys_enc_aes_cbc_256, armv8_expandkeys_dec_aes_cbc_256, armv8_enc_aes_cbc_sha1_256,   armv8_dec_aes_cbc_sha1_256 },
+    { 32, true,  armv8_expandkeys_enc_aes_cbc_256, armv8_expandkeys_dec_aes_cbc_256, armv8_enc_aes_cbc_sha256_256, armv8_dec_aes_cbc_sha256_256 },
+};
+
+static inline uint8_t hextobyte(uint8_t top, uint8_t bot) {
+    uint8_t t = top & 0xf;
+    uint8_t b = bot & 0xf;
+    t += top & 0x40 ? 9 : 0;
+    b += bot & 0x40 ? 9 : 0;
+    return (t<<4) + b;
+}
+
+//// Hex string after "NAME = " into out, returning the number of bytes, or max+1 if there are too many
+static uint64_t read_hex(const char * value, uint8_t * out, uint64_t max)
+{
+    uint64_t length = 0;
+    while(value[0] != '\0' && value[0] != '\r' && value[0] != '\n' && value[1] != '\0') {
+        if(length == max) return max + 1;
+        out[length++] = hextobyte(value[0], value[1]);
+        value += 2;
+    }
+    return length;
+}
+
+//// HMAC ipad/opad precompute - hash of one block of the padded key XOR 0x36 and 0x5c
+static void hmac_pads(const algorithm_t * algorithm, const reference_t * ref, uint8_t * i_key_pad, uint8_t * o_key_pad)
+{
+    sha_block_fn_t sha_block = algorithm->sha256 ? armv8_sha256_block_partial : armv8_sha1_block_partial;
+    uint8_t ipad[HMAC_BLOCK_LEN], opad[HMAC_BLOCK_LEN];
+    for(uint32_t i=0; i<HMAC_BLOCK_LEN; ++i) {
+        uint8_t k = (i < ref->hmac_key_length) ? ref->hmac_key[i] : 0;
+        ipad[i] = k ^ 0x36;
+        opad[i] = k ^ 0x5c;
+    }
+    sha_block(NULL, ipad, i_key_pad, HMAC_BLOCK_LEN);
+    sha_block(NULL, opad, o_key_pad, HMAC_BLOCK_LEN);
+}
+
+static void print_hex(const char * name, const uint8_t * data, uint64_t length)
+{
+    printf("%s 0x", name);
+    for(uint64_t i=0; i<length; ++i) printf("%02x", data[i]);
+    printf("\n");
+}
+
+//// One direction and buffer placement of a reference - the digest source is the header followed by the
+//// ciphertext, with the cipher destination (encrypt) or source (decrypt) inside it, as for ESP
+static bool test_reference(const algorithm_t * algorithm, const reference_t * ref, bool is_encrypt, bool in_place)
+{
+    static uint8_t digest_buffer[MAX_HEADER_LEN + MAX_DATA_LEN + SLACK_LEN];
+    static uint8_t separate_buffer[MAX_DATA_LEN + SLACK_LEN];
+    uint8_t expanded_key[256] = {0};
+    uint8_t iv[16];
+    uint8_t i_key_pad[HMAC_BLOCK_LEN], o_key_pad[HMAC_BLOCK_LEN];
+    uint8_t digest[MAX_DIGEST_LEN + SLACK_LEN];
+    armv8_cipher_digest_t arg;
+    uint64_t clen = ref->plaintext_length;
+    uint64_t dlen = ref->header_length + clen;
+    const uint8_t * input = is_encrypt ? ref->plaintext : ref->ciphertext;
+    const uint8_t * expected = is_encrypt ? ref->ciphertext : ref->plaintext;
+    uint8_t * csrc, * cdst;
+
+    memset(digest_buffer, 0, sizeof(digest_buffer));
+    memset(separate_buffer, 0, sizeof(separate_buffer));
+    memset(digest, 0, sizeof(digest));
+    memcpy(digest_buffer, ref->header, ref->header_length);
+    if(in_place) {
+        csrc = cdst = digest_buffer + ref->header_length;
+        memcpy(csrc, input, clen);
+    } else if(is_encrypt) {
+        csrc = separate_buffer;
+        cdst = digest_buffer + ref->header_length;
+        memcpy(csrc, input, clen);
+    } else {
+        csrc = digest_buffer + ref->header_length;
+        cdst = separate_buffer;
+        memcpy(csrc, input, clen);
+    }
+
+    memcpy(iv, ref->iv, sizeof(iv));
+    (is_encrypt ? algorithm->expandkeys_enc : algorithm->expandkeys_dec)(expanded_key, ref->key);
+    hmac_pads(algorithm, ref, i_key_pad, o_key_pad);
+    arg.cipher.key = expanded_key;
+    arg.cipher.iv = iv;
+    arg.digest.hmac.key = (uint8_t *) ref->hmac_key;
+    arg.digest.hmac.i_key_pad = i_key_pad;
+    arg.digest.hmac.o_key_pad = o_key_pad;
+
+    int result = (is_encrypt ? algorithm->enc : algorithm->dec)(csrc, cdst, clen, digest_buffer, digest, dlen, &arg);
+
+    bool output_match = memcmp(cdst, expected, clen) == 0;
+    bool digest_match = memcmp(digest, ref->digest, ref->digest_length) == 0;
+    if(result == 0 && output_match && digest_match) {
+        return true;
+    }
+
+    printf("COUNT = %lu: %s, %s, %lu blocks, %lu byte header (%lu bytes of the last SHA block used) - %s%s%s\n",
+           ref->count, is_encrypt ? "encrypt" : "decrypt", in_place ? "in place" : "out of place",
+           clen / 16, ref->header_length, dlen ? (dlen - 1) % HMAC_BLOCK_LEN + 1 : 0,
+           result != 0 ? "compute failure " : "",
+           output_match ? "" : (is_encrypt ? "ciphertext mismatch " : "plaintext mismatch "),
+           digest_match ? "" : "digest mismatch");
+    if(!digest_match) {
+        print_hex("Computed digest ", digest, ref->digest_length);
+        print_hex("Reference digest", ref->digest, ref->digest_length);
+    }
+    return false;
+}
+
+//// Run every direction and buffer placement of a complete reference
+static bool test_all(const algorithm_t * algorithm, const reference_t * ref)
+{
+    bool success = true;
+    if(ref->ciphertext_length != ref->plaintext_length || ref->digest_length != (algorithm->sha256 ? 32 : 20)) {
+        printf("COUNT = %lu: inconsistent reference\n", ref->count);
+        return false;
+    }
+    for(int is_encrypt=1; is_encrypt>=0; --is_encrypt) {
+        for(int in_place=1; in_place>=0; --in_place) {
+            success &= test_reference(algorithm, ref, is_encrypt, in_place);
+        }
+    }
+    return success;
+}
+
+//// Read a reference file, running each reference once its DIGEST line is read
+static bool process_test_file(FILE * fin)
+{
+    static char input_buff[MAX_LINE_LEN];
+    static reference_t ref;
+    uint64_t key_bits = 0;
+    bool sha256 = false;
+    const algorithm_t * algorithm = NULL;
+    uint64_t passes = 0;
+    uint64_t fails = 0;
+
+    while(fgets(input_buff, MAX_LINE_LEN, fin)) {
+        char * value = strstr(input_buff, " = ");
+        if(strncmp(input_buff, "# Key Length :", 14) == 0) {
+            key_bits = strtoul(input_buff + 14, NULL, 10);
+        } else if(strncmp(input_buff, "# Digest :", 10) == 0) {
+            sha256 = strstr(input_buff, "SHA256") != NULL;
+        }
+        if(input_buff[0] == '#' || value == NULL) {
+            continue;
+        }
+        if(algorithm == NULL) {
+            for(uint32_t a=0; a<sizeof(algorithms)/sizeof(algorithms[0]); ++a) {
+                if(algorithms[a].key_byte_length * 8 == key_bits && algorithms[a].sha256 == sha256) {
+                    algorithm = &algorithms[a];
+                }
+            }
+            if(algorithm == NULL) {
+                printf("ERROR: No AES-%lu-CBC with HMAC-%s functions\n", key_bits, sha256 ? "SHA256" : "SHA1");
+                return false;
+            }
+        }
+        value += 3;
+        if(strncmp(input_buff, "COUNT", 5) == 0) {
+            memset(&ref, 0, sizeof(ref));
+            ref.count = strtoul(value, NULL, 10);
+        } else if(strncmp(input_buff, "KEY", 3) == 0) {
+            if(read_hex(value, ref.key, sizeof(ref.key)) != algorithm->key_byte_length) {
+                printf("COUNT = %lu: wrong key length\n", ref.count);
+                return false;
+            }
+        } else if(strncmp(input_buff, "IV", 2) == 0) {
+            read_hex(value, ref.iv, sizeof(ref.iv));
+        } else if(strncmp(input_buff, "HMACKEY", 7) == 0) {
+            ref.hmac_key_length = read_hex(value, ref.hmac_key, sizeof(ref.hmac_key));
+        } else if(strncmp(input_buff, "HEADER", 6) == 0) {
+            ref.header_length = read_hex(value, ref.header, sizeof(ref.header));
+        } else if(strncmp(input_buff, "PLAINTEXT", 9) == 0) {
+            ref.plaintext_length = read_hex(value, ref.plaintext, sizeof(ref.plaintext));
+        } else if(strncmp(input_buff, "CIPHERTEXT", 10) == 0) {
+            ref.ciphertext_length = read_hex(value, ref.ciphertext, sizeof(ref.ciphertext));
+        } else if(strncmp(input_buff, "DIGEST", 6) == 0) {
+            ref.digest_length = read_hex(value, ref.digest, sizeof(ref.digest));
+            if(ref.hmac_key_length > sizeof(ref.hmac_key) || ref.header_length > sizeof(ref.header) ||
+               ref.plaintext_length > sizeof(ref.plaintext) || ref.plaintext_length % 16 != 0 ||
+               ref.header_length % 8 != 0) {
+                printf("COUNT = %lu: lengths not supported\n", ref.count);
+                return false;
+            }
+            if(test_all(algorithm, &ref)) {
+                passes++;
+            } else {
+                fails++;
+            }
+        }
+    }
+
+    printf("Successfully processed %lu inputs:\nPASS:\t%lu\nFAIL:\t%lu\n\n", passes+fails, passes, fails);
+    return passes > 0 && fails == 0;
+}
+
+int main(int argc, char* argv[]) {
+    //// Get reference input file name
+    char reference_filename[100];
+    if(argc==2) {
+        strncpy(reference_filename, argv[1], sizeof(reference_filename) - 1);
+        reference_filename[sizeof(reference_filename) - 1] = '\0';
+    } else {
+        strcpy(reference_filename, "ref_default");
+    }
+    printf("Using reference file %s\n", reference_filename);
+    FILE * fin = fopen(reference_filename,"rb");
+    if(fin == NULL) {
+        printf("Could not open reference file\n");
+        exit(1);
+    }
+
+    bool success = process_test_file(fin);
+    fclose(fin);
+
+    return success ? 0 : 1;
+}
@@ -9,8 +9,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <dirent.h>
 
 #include "AArch64cryptolib.h"
+#include "test_timing.h"
 
 #define MAX_LINE_LEN 128
 
@@ -35,10 +37,64 @@ inline uint8_t hextobyte(uint8_t top, uint8_t bot) {
     return (t<<4) + b;
 }
 
+//// Run the selected operation count times on the current reference
+operation_result_t run_operation(uint64_t count, bool encrypt, armv8_cipher_digest_t * arg,
+                                 uint8_t * pt, uint8_t * ct, uint8_t * output, uint8_t * auth,
+                                 uint64_t plaintext_byte_length)
+{
+    operation_result_t result = SUCCESSFUL_OPERATION;
+    if(encrypt)
+    {
+        for(uint64_t i=0; i<count; ++i) {
+            result |= armv8_enc_aes_cbc_sha1_128(
+                        pt, output, plaintext_byte_length,
+                        pt, auth, plaintext_byte_length,
+                        arg);
+#ifdef TEST_DEBUG
+            printf("encrypt output:\n");
+            for(int i=0; i<plaintext_byte_length; ++i) {
+                printf("%02x", output[i]);
+            }
+            for(int i=0; i<plaintext_byte_length; ++i) {
+                if( output[i] != ct[i] ) {
+                    printf("encrypt failed. result: %d\n", result);
+                    break;
+                }
+            }
+            printf("\n");
+#endif
+        }
+    } else {
+        for(uint64_t i=0; i<count; ++i) {
+            result |= armv8_dec_aes_cbc_sha1_128(
+                        ct, output, plaintext_byte_length,
+                        output, auth, plaintext_byte_length,
+                        arg);
+#ifdef TEST_DEBUG
+            printf("decrypt output:\n");
+            for(int i=0; i<plaintext_byte_length; ++i) {
+                printf("%02x", output[i]);
+            }
+            for(int i=0; i<plaintext_byte_length; ++i) {
+                if( output[i] != pt[i] ) {
+                    printf("decrypt failed. result: %d\n", result);
+                    break;
+                }
+            }
+            printf("\n");
+#endif
+        }
+    }
+    return result;
+}
+
 //// Read a reference file and check that encrypt/decrypt operations are
 //// producing the correct outputs without errors
-void process_test_file(FILE * fin, uint64_t test_count, bool encrypt,
-                       bool overwrite_buffer_length, uint64_t overwritten_buffer_length)
+//// Each reference is run for warm-up, then timed over a number of trials of test_count runs
+//// If bytes_per_trial is set it overrides test_count, otherwise a test_count of 0 is taken from the reference file
+void process_test_file(FILE * fin, const char * name, uint64_t test_count, bool encrypt,
+                       bool overwrite_buffer_length, uint64_t overwritten_buffer_length,
+                       uint64_t bytes_per_trial, const timing_options_t * options, uint64_t * report_index)
 {
     //// Initialise/Default values
     uint64_t block_byte_length = 16;
@@ -85,54 +141,48 @@ void process_test_file(FILE * fin, uint64_t test_count, bool encrypt,
                         if(encrypt)
                         {
                             armv8_expandkeys_enc_aes_cbc_128(key_expanded, key);
-                            arg.cipher.key = key_expanded;
-                            arg.cipher.iv = iv;
-                            for(uint64_t i=0; i<test_count; ++i) {
-                                result |= armv8_enc_aes_cbc_sha1_128(
-                                            pt, output, plaintext_byte_length,
-                                            pt, auth, plaintext_byte_length,
-                                            &arg);
-#ifdef TEST_DEBUG
-                                printf("encrypt output:\n");
-                                for(int i=0; i<plaintext_byte_length; ++i) {
-                                    printf("%02x", output[i]);
-                                }
-                                for(int i=0; i<plaintext_byte_length; ++i) {
-                                    if( output[i] != ct[i] ) {
-                                        printf("encrypt failed. result: %d\n", result);
-                                        break;
-                                    }
-                                }
-                                printf("\n");
-#endif
-                            }
                         } else {
                             armv8_expandkeys_dec_aes_cbc_128(key_expanded, key);
-                            arg.cipher.key = key_expanded;
-                            arg.cipher.iv = iv;
-                            for(uint64_t i=0; i<test_count; ++i) {
-                                result |= armv8_dec_aes_cbc_sha1_128(
-                                            ct, output, plaintext_byte_length,
-                                            output, auth, plaintext_byte_length,
-                                            &arg);
-#ifdef TEST_DEBUG
-                                printf("decrypt output:\n");
-                                for(int i=0; i<plaintext_byte_length; ++i) {
-                                    printf("%02x", output[i]);
-                                }
-                                for(int i=0; i<plaintext_byte_length; ++i) {
-                                    if( output[i] != pt[i] ) {
-                                        printf("decrypt failed. result: %d\n", result);
-                                        break;
-                                    }
-                                }
-                                printf("\n");
-#endif
-                            }
                         }
-                        printf("%s\n%lu runs\n%lu bytes\nResult is %s\n",
-                        encrypt ? "Encrypt" : "Decrypt",
-                        test_count, plaintext_byte_length, (result == SUCCESSFUL_OPERATION) ? "Success" : "Failure");
+                        arg.cipher.key = key_expanded;
+                        arg.cipher.iv = iv;
+
+                        //// The plaintext follows COUNT in these files, so the size budget is applied here
+                        uint64_t runs = test_count;
+                        if( bytes_per_trial != 0) {
+                            runs = bytes_per_trial / (plaintext_byte_length ? plaintext_byte_length : 1);
+                            if( runs == 0) runs = 1;
+                        }
+
+                        timing_counters_t counters;
+                        timing_sample_t samples[TIMING_MAX_TRIALS];
+                        uint64_t warmup_count = timing_warmup_count(options, (runs+9)/10);
+                        timing_counters_open(&counters, options->use_pmu);
+                        if(options->profile) timing_profile_open(&counters);
+                        result |= run_operation(warmup_count, encrypt, &arg, pt, ct, output, auth, plaintext_byte_length);
+                        for(uint32_t trial=0; trial<options->trials; ++trial) {
+                            timing_start(&counters, &samples[trial]);
+                            result |= run_operation(runs, encrypt, &arg, pt, ct, output, auth, plaintext_byte_length);
+                            timing_stop(&counters, &samples[trial]);
+                        }
+                        timing_counters_close(&counters);
+
+                        timing_result_t timing = {
+                            .name = name,
+                            .mode = "AES-CBC-128",
+                            .operation = encrypt ? "encrypt" : "decrypt",
+                            .variant = "HMAC-SHA1",
+                            .bytes = plaintext_byte_length,
+                            .profiled = options->profile,
+                            .success = (result == SUCCESSFUL_OPERATION) };
+                        timing_summarize(samples, options->trials, runs, &timing);
+
+                        if(options->format == TIMING_FORMAT_TEXT) {
+                            printf("%s\n%lu runs\n%lu bytes\nResult is %s\n",
+                            encrypt ? "Encrypt" : "Decrypt",
+                            runs, plaintext_byte_length, (result == SUCCESSFUL_OPERATION) ? "Success" : "Failure");
+                        }
+                        timing_report(options->format, &timing, (*report_index)++);
 
                         free(output);
                         free(auth);
@@ -250,6 +300,60 @@ void process_test_file(FILE * fin, uint64_t test_count, bool encrypt,
     free(input_buff);
 }
 
+//// Order speedtest<keylen>_<bytes>.rsp by key length then size
+int compare_speedtest_names(const void * a, const void * b)
+{
+    unsigned int key_a = 0, key_b = 0, size_a = 0, size_b = 0;
+    sscanf(*(const char * const *) a, "speedtest%u_%u.rsp", &key_a, &size_a);
+    sscanf(*(const char * const *) b, "speedtest%u_%u.rsp", &key_b, &size_b);
+    if(key_a != key_b) return (key_a > key_b) - (key_a < key_b);
+    return (size_a > size_b) - (size_a < size_b);
+}
+
+//// Run every speedtest*_N.rsp in a directory, encrypt then decrypt
+int sweep_directory(const char * directory, uint64_t test_count, const timing_options_t * options)
+{
+    char * names[256];
+    uint32_t name_count = 0;
+    DIR * dir = opendir(directory);
+    if(dir == NULL) {
+        printf("Could not open directory %s\n", directory);
+        return 1;
+    }
+    struct dirent * entry;
+    while((entry = readdir(dir)) != NULL && name_count < 256) {
+        unsigned int key_length, size;
+        if(sscanf(entry->d_name, "speedtest%u_%u.rsp", &key_length, &size) == 2) {
+            names[name_count++] = strdup(entry->d_name);
+        }
+    }
+    closedir(dir);
+    qsort(names, name_count, sizeof(char *), compare_speedtest_names);
+
+    uint64_t report_index = 0;
+    timing_report_begin(options->format, options->profile);
+    for(uint32_t n=0; n<name_count; ++n) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", directory, names[n]);
+        FILE * fin = fopen(path, "rb");
+        if(fin == NULL) {
+            printf("Could not open reference file %s\n", path);
+            continue;
+        }
+        for(int encrypt=1; encrypt>=0; --encrypt) {
+            if(options->format == TIMING_FORMAT_TEXT) printf("\nUsing reference file %s\n", path);
+            rewind(fin);
+            // by default keep each trial to around 64MB, so the sweep completes in reasonable time
+            process_test_file(fin, names[n], test_count, encrypt, false, 0,
+                              test_count ? 0 : (64ul << 20), options, &report_index);
+        }
+        fclose(fin);
+        free(names[n]);
+    }
+    timing_report_end(options->format);
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     //// Get input cipher size
     char reference_filename[100];
@@ -257,31 +361,62 @@ int main(int argc, char* argv[]) {
     bool encrypt = true;
     bool overwrite_buffer_length = false;
     uint64_t overwritten_buffer_length = 0;
+    timing_options_t options = TIMING_DEFAULT_OPTIONS;
+    const char * sweep = NULL;
+    char * positional[4];
+    int positional_count = 0;
+
+    for(int i=1; i<argc; ) {
+        int consumed = timing_parse_option(argc, argv, i, &options);
+        if(consumed) {
+            i += consumed;
+        } else if(strcmp(argv[i], "--profile") == 0) {
+            options.profile = true;
+            i++;
+        } else if(strcmp(argv[i], "--sweep") == 0 && i+1 < argc) {
+            sweep = argv[i+1];
+            i += 2;
+        } else {
+            if(positional_count < 4) positional[positional_count++] = argv[i];
+            i++;
+        }
+    }
+
+    if(sweep != NULL) {
+        if(positional_count>=1) {
+            test_count = strtoul(positional[0], NULL, 10);
+        }
+        return sweep_directory(sweep, test_count, &options);
+    }
 
-    if(argc>=2) {
-        strcpy(reference_filename, argv[1]);
+    if(positional_count>=1) {
+        strcpy(reference_filename, positional[0]);
     } else {
         strcpy(reference_filename, "ref_default");
     }
-    if(argc>=3) {
-        test_count = strtoul(argv[2], NULL, 10);
+    if(positional_count>=2) {
+        test_count = strtoul(positional[1], NULL, 10);
     }
-    if(argc>=4) {
-        encrypt = (bool) strtoul(argv[3], NULL, 10);
+    if(positional_count>=3) {
+        encrypt = (bool) strtoul(positional[2], NULL, 10);
     }
-    if(argc>=5) {
+    if(positional_count>=4) {
         overwrite_buffer_length = true;
-        overwritten_buffer_length = strtoul(argv[4], NULL, 10);
+        overwritten_buffer_length = strtoul(positional[3], NULL, 10);
     }
 
-    printf("Using reference file %s\n", reference_filename);
+    if(options.format == TIMING_FORMAT_TEXT) printf("Using reference file %s\n", reference_filename);
     FILE * fin = fopen(reference_filename,"rb");
     if(fin == NULL) {
         printf("Could not open reference file\n");
         exit(1);
     }
 
-    process_test_file(fin, test_count, encrypt, overwrite_buffer_length, overwritten_buffer_length);
+    uint64_t report_index = 0;
+    timing_report_begin(options.format, options.profile);
+    process_test_file(fin, reference_filename, test_count, encrypt, overwrite_buffer_length, overwritten_buffer_length,
+                      0, &options, &report_index);
+    timing_report_end(options.format);
     fclose(fin);
 
     return 0;
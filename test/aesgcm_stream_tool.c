@@ -0,0 +1,295 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Reference tool for the chunked stream format (armv8_stream_*), and an end to end I/O benchmark
+//// The input is mmapped, chunks are sealed or opened by a pool of worker threads, and the main thread writes them
+//// out in order as they complete - at most a window of 2 chunks per worker is held at once, so memory is bounded
+//// whatever the file size
+//// When opening, a chunk is only written out once it has been authenticated, so on failure the output holds the
+//// stream up to the last good chunk and the tool exits with an error
+//// Usage: aesgcm_stream_tool enc|dec <key hex (32, 48 or 64 digits)> <input> <output> [--threads <n>] [--chunk <KB>]
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "AArch64cryptolib.h"
+#include "test_timing.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define stream_context_t    armv8_stream_context_t
+
+#define TOOL_DEFAULT_CHUNK_KB   64
+#define TOOL_WINDOW_PER_THREAD  2
+
+typedef enum slot_state { SLOT_FREE, SLOT_BUSY, SLOT_DONE } slot_state_t;
+
+typedef struct slot {
+    slot_state_t state;
+    uint64_t chunk_index;
+    uint8_t * buffer;           // chunk, followed by its tag when sealing
+    uint64_t byte_length;       // bytes to write out
+    operation_result_t result;
+} slot_t;
+
+typedef struct job {
+    stream_context_t ctx;
+    bool seal;
+    const uint8_t * input;      // chunks, after the header when opening
+    uint64_t input_byte_length;
+    uint64_t chunk_count;
+    uint64_t next_chunk;        // next chunk for a worker to claim
+    uint64_t written;           // chunks written out, so slots up to written + window may be used
+    slot_t * slots;
+    uint32_t window;
+    bool stop;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+} job_t;
+
+static int parse_key(const char * hex, uint8_t * key, armv8_cipher_mode_t * mode)
+{
+    size_t digits = strlen(hex);
+    if(digits != 32 && digits != 48 && digits != 64) {
+        return -1;
+    }
+    for( size_t i=0; i<digits/2; ++i )
+    {
+        unsigned int byte;
+        if(sscanf(hex + 2*i, "%2x", &byte) != 1) {
+            return -1;
+        }
+        key[i] = (uint8_t) byte;
+    }
+    *mode = digits == 32 ? AES_GCM_128 : digits == 48 ? AES_GCM_192 : AES_GCM_256;
+    return 0;
+}
+
+// Chunk i of the input, and where it goes in the slot buffer
+static void run_chunk(job_t * job, slot_t * slot)
+{
+    uint64_t i = slot->chunk_index;
+    bool last = (i + 1 == job->chunk_count);
+    uint64_t chunk_byte_length = job->ctx.chunk_byte_length;
+
+    if(job->seal) {
+        const uint8_t * in = job->input + i * chunk_byte_length;
+        uint64_t byte_length = last ? job->input_byte_length - i * chunk_byte_length : chunk_byte_length;
+        slot->result = armv8_stream_seal_chunk(&job->ctx, i, last, (uint8_t *) in, byte_length*8,
+                                               slot->buffer, slot->buffer + byte_length);
+        slot->byte_length = byte_length + ARMV8_STREAM_TAG_BYTES;
+    } else {
+        uint64_t stored_byte_length = chunk_byte_length + ARMV8_STREAM_TAG_BYTES;
+        const uint8_t * in = job->input + i * stored_byte_length;
+        uint64_t byte_length = (last ? job->input_byte_length - i * stored_byte_length : stored_byte_length)
+                               - ARMV8_STREAM_TAG_BYTES;
+        slot->result = armv8_stream_open_chunk(&job->ctx, i, last, (uint8_t *) in, byte_length*8,
+                                               (uint8_t *) in + byte_length, slot->buffer);
+        slot->byte_length = byte_length;
+    }
+}
+
+static void * worker_main(void * arg)
+{
+    job_t * job = arg;
+    pthread_mutex_lock(&job->lock);
+    while(!job->stop && job->next_chunk < job->chunk_count) {
+        uint64_t i = job->next_chunk;
+        // wait for the writer to free the slot, bounding how far ahead of the output the workers get
+        if(i >= job->written + job->window) {
+            pthread_cond_wait(&job->changed, &job->lock);
+            continue;
+        }
+        job->next_chunk++;
+        slot_t * slot = &job->slots[i % job->window];
+        slot->state = SLOT_BUSY;
+        slot->chunk_index = i;
+        pthread_mutex_unlock(&job->lock);
+
+        run_chunk(job, slot);
+
+        pthread_mutex_lock(&job->lock);
+        slot->state = SLOT_DONE;
+        pthread_cond_broadcast(&job->changed);
+    }
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+static int write_all(int fd, const uint8_t * p, uint64_t byte_length)
+{
+    while(byte_length) {
+        ssize_t n = write(fd, p, byte_length);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        byte_length -= n;
+    }
+    return 0;
+}
+
+static int fill_random(uint8_t * p, size_t byte_length)
+{
+    int fd = open("/dev/urandom", O_RDONLY);
+    if(fd < 0) {
+        return -1;
+    }
+    ssize_t n = read(fd, p, byte_length);
+    close(fd);
+    return n == (ssize_t) byte_length ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t threads = (uint32_t) sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t chunk_kb = TOOL_DEFAULT_CHUNK_KB;
+    uint8_t key[32];
+    armv8_cipher_mode_t mode;
+
+    if(argc < 5 || (strcmp(argv[1], "enc") != 0 && strcmp(argv[1], "dec") != 0) || parse_key(argv[2], key, &mode) != 0) {
+        printf("Usage: %s enc|dec <key hex (32, 48 or 64 digits)> <input> <output> [--threads <n>] [--chunk <KB>]\n",
+               argv[0]);
+        return 1;
+    }
+    for( int i=5; i+1<argc; i+=2 )
+    {
+        if(strcmp(argv[i], "--threads") == 0) threads = (uint32_t) strtoul(argv[i+1], NULL, 10);
+        else if(strcmp(argv[i], "--chunk") == 0) chunk_kb = (uint32_t) strtoul(argv[i+1], NULL, 10);
+    }
+    if(threads == 0) threads = 1;
+
+    job_t job = { .seal = strcmp(argv[1], "enc") == 0, .window = threads * TOOL_WINDOW_PER_THREAD };
+    int in_fd = open(argv[3], O_RDONLY);
+    struct stat st;
+    if(in_fd < 0 || fstat(in_fd, &st) != 0) {
+        printf("Can't open %s: %s\n", argv[3], strerror(errno));
+        return 1;
+    }
+    uint64_t file_byte_length = (uint64_t) st.st_size;
+    const uint8_t * mapped = NULL;
+    if(file_byte_length) {
+        mapped = mmap(NULL, file_byte_length, PROT_READ, MAP_PRIVATE, in_fd, 0);
+        if(mapped == MAP_FAILED) {
+            printf("Can't map %s: %s\n", argv[3], strerror(errno));
+            return 1;
+        }
+        madvise((void *) mapped, file_byte_length, MADV_SEQUENTIAL);
+    }
+
+    operation_result_t result;
+    if(job.seal) {
+        uint8_t nonce_prefix[ARMV8_STREAM_NONCE_PREFIX_BYTES];
+        if(fill_random(nonce_prefix, sizeof(nonce_prefix)) != 0) {
+            printf("Can't read /dev/urandom\n");
+            return 1;
+        }
+        result = chunk_kb <= (1u << 20) ? armv8_stream_init_seal(&job.ctx, mode, key, nonce_prefix, chunk_kb << 10) :
+                                          INVALID_PARAMETER;
+        job.input = mapped;
+        job.input_byte_length = file_byte_length;
+        if(result == SUCCESSFUL_OPERATION && file_byte_length) {
+            job.chunk_count = (file_byte_length + job.ctx.chunk_byte_length - 1) / job.ctx.chunk_byte_length;
+        } else {
+            job.chunk_count = 1;
+        }
+    } else {
+        if(file_byte_length < ARMV8_STREAM_HEADER_BYTES + ARMV8_STREAM_TAG_BYTES) {
+            printf("%s is too short to be a stream\n", argv[3]);
+            return 1;
+        }
+        result = armv8_stream_init_open(&job.ctx, key, mapped);
+        if(result == SUCCESSFUL_OPERATION && job.ctx.constants.mode != mode) {
+            printf("The stream is AES-%d, the key is not\n", 128 + 64 * (int) job.ctx.constants.mode);
+            return 1;
+        }
+        uint64_t stored_byte_length = (uint64_t) job.ctx.chunk_byte_length + ARMV8_STREAM_TAG_BYTES;
+        job.input = mapped + ARMV8_STREAM_HEADER_BYTES;
+        job.input_byte_length = file_byte_length - ARMV8_STREAM_HEADER_BYTES;
+        job.chunk_count = result == SUCCESSFUL_OPERATION ?
+                          (job.input_byte_length + stored_byte_length - 1) / stored_byte_length : 0;
+        // a last chunk must hold its tag, and a last chunk of just a tag only ends an empty stream
+        uint64_t last_stored_byte_length = job.input_byte_length % stored_byte_length;
+        if(job.chunk_count > 1 && last_stored_byte_length != 0 && last_stored_byte_length <= ARMV8_STREAM_TAG_BYTES) {
+            result = INVALID_PARAMETER;
+        }
+    }
+    if(result != SUCCESSFUL_OPERATION || job.chunk_count > ARMV8_STREAM_MAX_CHUNKS) {
+        printf("Invalid key, chunk size or stream header\n");
+        return 1;
+    }
+
+    int out_fd = open(argv[4], O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if(out_fd < 0) {
+        printf("Can't create %s: %s\n", argv[4], strerror(errno));
+        return 1;
+    }
+    if(job.seal && write_all(out_fd, job.ctx.header, ARMV8_STREAM_HEADER_BYTES) != 0) {
+        printf("Write failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    job.slots = calloc(job.window, sizeof(slot_t));
+    for( uint32_t i=0; i<job.window; ++i )
+    {
+        job.slots[i].buffer = malloc((size_t) job.ctx.chunk_byte_length + ARMV8_STREAM_TAG_BYTES);
+    }
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.changed, NULL);
+    pthread_t * workers = malloc(threads * sizeof(pthread_t));
+    uint64_t start = timing_now_ns();
+    for( uint32_t i=0; i<threads; ++i ) pthread_create(&workers[i], NULL, worker_main, &job);
+
+    // Write chunks out in order as they complete
+    int status = 0;
+    pthread_mutex_lock(&job.lock);
+    while(job.written < job.chunk_count && status == 0) {
+        slot_t * slot = &job.slots[job.written % job.window];
+        if(slot->state != SLOT_DONE || slot->chunk_index != job.written) {
+            pthread_cond_wait(&job.changed, &job.lock);
+            continue;
+        }
+        pthread_mutex_unlock(&job.lock);
+        if(slot->result != SUCCESSFUL_OPERATION) {
+            printf("Chunk %lu: %s\n", job.written,
+                   slot->result == AUTHENTICATION_FAILURE ? "authentication failed" : "invalid chunk");
+            status = 1;
+        } else if(write_all(out_fd, slot->buffer, slot->byte_length) != 0) {
+            printf("Write failed: %s\n", strerror(errno));
+            status = 1;
+        }
+        pthread_mutex_lock(&job.lock);
+        slot->state = SLOT_FREE;
+        job.written++;
+        job.stop = status != 0;
+        pthread_cond_broadcast(&job.changed);
+    }
+    pthread_mutex_unlock(&job.lock);
+    for( uint32_t i=0; i<threads; ++i ) pthread_join(workers[i], NULL);
+    if(close(out_fd) != 0) {
+        printf("Write failed: %s\n", strerror(errno));
+        status = 1;
+    }
+    uint64_t ns = timing_now_ns() - start;
+
+    if(status == 0) {
+        fprintf(stderr, "%s %lu bytes in %lu chunks of %u KB on %u threads: %.3f ms, %.3f Gb/s\n",
+                job.seal ? "Sealed" : "Opened", file_byte_length, job.chunk_count, job.ctx.chunk_byte_length >> 10,
+                threads, ns / 1e6, ns ? 8.0 * file_byte_length / ns : 0.0);
+    }
+    for( uint32_t i=0; i<job.window; ++i ) free(job.slots[i].buffer);
+    free(job.slots);
+    free(workers);
+    if(mapped) munmap((void *) mapped, file_byte_length);
+    close(in_fd);
+    return status;
+}
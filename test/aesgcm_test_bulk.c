@@ -0,0 +1,270 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Bulk AES-GCM
+//// Checks the _bulk variants give the same results as the normal ones, then measures how much each disturbs a
+//// co-running cache sensitive workload - a thread chasing pointers at random through a working set sized to fit in
+//// L2 - while a large buffer is encrypted
+//// Usage: aesgcm_test_bulk [--size <MB>] [--working-set <KB>] [--key-length 128|192|256] [--cpus <enc>,<co-runner>]
+////                         [--trials <n>] [--no-pmu]
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "AArch64cryptolib.h"
+#include "test_timing.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define cipher_constants_t  armv8_cipher_constants_t
+#define cipher_state_t      armv8_cipher_state_t
+
+#define BULK_LINE           64
+
+typedef struct co_runner {
+    pthread_t thread;
+    int cpu;
+    uint8_t * lines;            // working set, each line holding the offset of the next in a random cycle
+    uint64_t line_count;
+    uint64_t accesses;
+    uint64_t ns;
+    bool running;
+    bool stop;
+} co_runner_t;
+
+typedef enum bulk_phase { PHASE_SOLO, PHASE_NORMAL, PHASE_BULK, PHASE_COUNT } bulk_phase_t;
+
+static const char * phase_names[PHASE_COUNT] = { "none (solo)", "normal", "bulk" };
+
+static uint8_t key[32] = { 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+                           0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 };
+static uint8_t nonce[16] = { 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88 };
+static uint8_t aad[20] = { 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef, 0xfe, 0xed, 0xfa, 0xce, 0xde, 0xad, 0xbe, 0xef,
+                           0xab, 0xad, 0xda, 0xd2 };
+
+static void pin_thread(int cpu)
+{
+    if(cpu < 0) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        printf("Could not pin to CPU %d\n", cpu);
+    }
+}
+
+// Each line points at the next in one random cycle through the whole working set, so every access depends on the
+// last and the prefetchers can't hide a miss
+static void co_runner_init(co_runner_t * c, uint64_t working_set_bytes)
+{
+    c->line_count = working_set_bytes / BULK_LINE;
+    c->lines = aligned_alloc(BULK_LINE, c->line_count * BULK_LINE);
+    uint64_t * order = malloc(c->line_count * sizeof(uint64_t));
+    uint64_t rng = 0x9e3779b97f4a7c15ull;
+    for( uint64_t i=0; i<c->line_count; ++i ) order[i] = i;
+    for( uint64_t i=c->line_count-1; i>0; --i )
+    {
+        rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+        uint64_t j = rng % (i + 1);
+        uint64_t t = order[i]; order[i] = order[j]; order[j] = t;
+    }
+    for( uint64_t i=0; i<c->line_count; ++i )
+    {
+        *(uint64_t *) (c->lines + order[i] * BULK_LINE) = order[(i + 1) % c->line_count] * BULK_LINE;
+    }
+    free(order);
+}
+
+static void * co_runner_main(void * arg)
+{
+    co_runner_t * c = arg;
+    uint64_t offset = 0;
+    uint64_t accesses = 0;
+
+    pin_thread(c->cpu);
+    // one pass to bring the working set into the cache before timing
+    for( uint64_t i=0; i<c->line_count; ++i ) offset = *(volatile uint64_t *) (c->lines + offset);
+    __atomic_store_n(&c->running, true, __ATOMIC_RELEASE);
+    uint64_t start = timing_now_ns();
+    while(!__atomic_load_n(&c->stop, __ATOMIC_RELAXED)) {
+        for( uint32_t i=0; i<1024; ++i ) offset = *(volatile uint64_t *) (c->lines + offset);
+        accesses += 1024;
+    }
+    c->ns = timing_now_ns() - start;
+    c->accesses = accesses;
+    return NULL;
+}
+
+static void co_runner_start(co_runner_t * c)
+{
+    c->stop = false;
+    c->running = false;
+    pthread_create(&c->thread, NULL, co_runner_main, c);
+    while(!__atomic_load_n(&c->running, __ATOMIC_ACQUIRE));
+}
+
+static double co_runner_stop(co_runner_t * c)
+{
+    __atomic_store_n(&c->stop, true, __ATOMIC_RELAXED);
+    pthread_join(c->thread, NULL);
+    return c->ns ? (double) c->accesses / c->ns * 1000.0 : 0.0;
+}
+
+static operation_result_t encrypt_once(cipher_constants_t * cc, bool bulk, uint8_t * plaintext, uint64_t byte_length,
+                                       uint8_t * ciphertext, uint8_t * tag)
+{
+    cipher_state_t cs = { .constants = cc };
+    operation_result_t result = armv8_aes_gcm_set_counter(nonce, 96, &cs);
+    if(bulk) {
+        result |= armv8_enc_aes_gcm_from_state_bulk(&cs, aad, sizeof(aad)*8, plaintext, byte_length*8, ciphertext, tag);
+    } else {
+        result |= armv8_enc_aes_gcm_from_state(&cs, aad, sizeof(aad)*8, plaintext, byte_length*8, ciphertext, tag);
+    }
+    return result;
+}
+
+// Bulk and normal results match either side of the bulk threshold and with partial chunks and blocks, and bulk
+// decryption recovers the plaintext and rejects a corrupted tag
+static bool check_bulk(cipher_constants_t * cc, uint8_t * plaintext, uint8_t * ciphertext, uint8_t * expected,
+                       uint64_t max_byte_length)
+{
+    const uint64_t lengths[] = { 4096, ARMV8_AES_GCM_BULK_MIN_BYTES - 1, ARMV8_AES_GCM_BULK_MIN_BYTES,
+                                 ARMV8_AES_GCM_BULK_MIN_BYTES + 16384 + 16, ARMV8_AES_GCM_BULK_MIN_BYTES + 100003,
+                                 max_byte_length };
+    bool passed = true;
+
+    for( uint32_t l=0; l<sizeof(lengths)/sizeof(lengths[0]); ++l )
+    {
+        uint64_t byte_length = lengths[l] < max_byte_length ? lengths[l] : max_byte_length;
+        uint8_t tag[16], expected_tag[16];
+        operation_result_t result = encrypt_once(cc, false, plaintext, byte_length, expected, expected_tag);
+        result |= encrypt_once(cc, true, plaintext, byte_length, ciphertext, tag);
+        if(result != SUCCESSFUL_OPERATION || memcmp(ciphertext, expected, byte_length) != 0 ||
+           memcmp(tag, expected_tag, 16) != 0) {
+            printf("Bulk encrypt of %lu bytes does not match\n", byte_length);
+            passed = false;
+            continue;
+        }
+
+        cipher_state_t cs = { .constants = cc };
+        result = armv8_aes_gcm_set_counter(nonce, 96, &cs);
+        result |= armv8_dec_aes_gcm_from_state_bulk(&cs, aad, sizeof(aad)*8, ciphertext, byte_length*8, tag, expected);
+        if(result != SUCCESSFUL_OPERATION || memcmp(expected, plaintext, byte_length) != 0) {
+            printf("Bulk decrypt of %lu bytes does not match\n", byte_length);
+            passed = false;
+        }
+        tag[0] ^= 1;
+        cs = (cipher_state_t) { .constants = cc };
+        armv8_aes_gcm_set_counter(nonce, 96, &cs);
+        if(armv8_dec_aes_gcm_from_state_bulk(&cs, aad, sizeof(aad)*8, ciphertext, byte_length*8, tag, expected)
+           != AUTHENTICATION_FAILURE) {
+            printf("Bulk decrypt of %lu bytes with a corrupted tag did not fail\n", byte_length);
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+int main(int argc, char* argv[]) {
+    timing_options_t options = TIMING_DEFAULT_OPTIONS;
+    uint64_t byte_length = 64ull << 20;
+    uint64_t working_set_bytes = 1ull << 20;
+    armv8_cipher_mode_t mode = AES_GCM_128;
+    int cpus[2] = { -1, -1 };
+
+    for( int i=1; i<argc; )
+    {
+        int consumed = timing_parse_option(argc, argv, i, &options);
+        if(consumed) {
+            i += consumed;
+        } else if(strcmp(argv[i], "--size") == 0 && i+1 < argc) {
+            byte_length = strtoull(argv[i+1], NULL, 10) << 20;
+            i += 2;
+        } else if(strcmp(argv[i], "--working-set") == 0 && i+1 < argc) {
+            working_set_bytes = strtoull(argv[i+1], NULL, 10) << 10;
+            i += 2;
+        } else if(strcmp(argv[i], "--key-length") == 0 && i+1 < argc) {
+            uint32_t bits = (uint32_t) strtoul(argv[i+1], NULL, 10);
+            mode = bits == 256 ? AES_GCM_256 : bits == 192 ? AES_GCM_192 : AES_GCM_128;
+            i += 2;
+        } else if(strcmp(argv[i], "--cpus") == 0 && i+1 < argc) {
+            sscanf(argv[i+1], "%d,%d", &cpus[0], &cpus[1]);
+            i += 2;
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if(byte_length < ARMV8_AES_GCM_BULK_MIN_BYTES || working_set_bytes < BULK_LINE) {
+        printf("--size must be at least 1MB and --working-set at least 1KB\n");
+        return 1;
+    }
+
+    uint8_t * plaintext = aligned_alloc(BULK_LINE, byte_length);
+    uint8_t * ciphertext = aligned_alloc(BULK_LINE, byte_length);
+    uint8_t * scratch = aligned_alloc(BULK_LINE, byte_length);
+    for( uint64_t i=0; i<byte_length; ++i ) plaintext[i] = (uint8_t) (i * 31 + (i >> 12));
+    cipher_constants_t cc;
+    armv8_aes_gcm_set_constants(mode, 16, key, &cc);
+
+    bool passed = check_bulk(&cc, plaintext, ciphertext, scratch, byte_length);
+
+    // Each phase encrypts the buffer trials times while the co-runner runs - the solo phase just waits as long as
+    // the normal phase took
+    co_runner_t c = { .cpu = cpus[1] };
+    co_runner_init(&c, working_set_bytes);
+    pin_thread(cpus[0]);
+    double accesses_per_us[PHASE_COUNT];
+    double gbps[PHASE_COUNT] = { 0 };
+    uint64_t normal_ns = 0;
+    static const bulk_phase_t order[PHASE_COUNT] = { PHASE_NORMAL, PHASE_BULK, PHASE_SOLO };
+    for( uint32_t p=0; p<PHASE_COUNT; ++p )
+    {
+        bulk_phase_t phase = order[p];
+        uint8_t tag[16];
+        co_runner_start(&c);
+        uint64_t start = timing_now_ns();
+        if(phase == PHASE_SOLO) {
+            while(timing_now_ns() - start < normal_ns);
+        } else {
+            for( uint32_t t=0; t<options.trials; ++t )
+            {
+                passed &= encrypt_once(&cc, phase == PHASE_BULK, plaintext, byte_length, ciphertext, tag)
+                          == SUCCESSFUL_OPERATION;
+            }
+        }
+        uint64_t ns = timing_now_ns() - start;
+        accesses_per_us[phase] = co_runner_stop(&c);
+        if(phase == PHASE_NORMAL) normal_ns = ns;
+        if(phase != PHASE_SOLO) gbps[phase] = (8.0 * byte_length * options.trials) / ns;
+    }
+
+    printf("AES-GCM-%d, %lu MB x %u, co-runner working set %lu KB\n",
+           mode == AES_GCM_128 ? 128 : mode == AES_GCM_192 ? 192 : 256, byte_length >> 20, options.trials,
+           working_set_bytes >> 10);
+    for( bulk_phase_t phase = PHASE_SOLO; phase < PHASE_COUNT; ++phase )
+    {
+        printf("Encryption %-12s co-runner %8.2f accesses/us (%5.1f%% of solo)", phase_names[phase],
+               accesses_per_us[phase], 100.0 * accesses_per_us[phase] / accesses_per_us[PHASE_SOLO]);
+        if(phase != PHASE_SOLO) printf(", encryption %.3f Gb/s", gbps[phase]);
+        printf("\n");
+    }
+
+    free(c.lines);
+    free(plaintext);
+    free(ciphertext);
+    free(scratch);
+    if(!passed) {
+        printf("Failed\n");
+        return 1;
+    }
+    printf("Success\n");
+    return 0;
+}
@@ -0,0 +1,219 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Exact length AES-GCM
+//// Every buffer given to the _exact variants ends right before an inaccessible guard page, so reading or writing
+//// a single byte beyond any of them faults
+//// For each key size, and a range of aad, message and tag lengths, the results must match the padded variants
+//// The per key size variants must match too, and must reject constants set up for another key size
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "AArch64cryptolib.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define cipher_constants_t  armv8_cipher_constants_t
+#define cipher_state_t      armv8_cipher_state_t
+
+#define EXACT_MAX_MESSAGE   100
+#define EXACT_MAX_AAD       40
+
+// One accessible page followed by a guard page, handing out buffers that end at the guard
+typedef struct guarded {
+    uint8_t * page;
+    size_t page_size;
+} guarded_t;
+
+static bool guarded_init(guarded_t * g)
+{
+    g->page_size = sysconf(_SC_PAGESIZE);
+    g->page = mmap(NULL, 2 * g->page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(g->page == MAP_FAILED) {
+        return false;
+    }
+    return mprotect(g->page + g->page_size, g->page_size, PROT_NONE) == 0;
+}
+
+static uint8_t * guarded_at_end(guarded_t * g, const uint8_t * contents, size_t byte_length)
+{
+    uint8_t * p = g->page + g->page_size - byte_length;
+    if(contents) {
+        memcpy(p, contents, byte_length);
+    }
+    return p;
+}
+
+static uint8_t key[32] = { 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+                           0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 };
+
+static bool test_lengths(armv8_cipher_mode_t mode, uint32_t aad_bytes, uint32_t message_bytes, uint32_t tag_bytes,
+                         uint32_t nonce_bytes, guarded_t * g)
+{
+    uint8_t nonce[64+16], aad[EXACT_MAX_AAD+16], plaintext[EXACT_MAX_MESSAGE+16];
+    uint8_t expected_ciphertext[EXACT_MAX_MESSAGE+16], expected_tag[16], decrypted[EXACT_MAX_MESSAGE+16];
+    for( uint32_t i=0; i<sizeof(nonce); ++i ) nonce[i] = (uint8_t) (i * 7 + 1);
+    for( uint32_t i=0; i<sizeof(aad); ++i ) aad[i] = (uint8_t) (i * 13 + 5);
+    for( uint32_t i=0; i<sizeof(plaintext); ++i ) plaintext[i] = (uint8_t) (i * 29 + 3);
+    bool passed = true;
+
+    // Padded reference
+    cipher_constants_t cc;
+    cipher_state_t cs = { .constants = &cc };
+    armv8_aes_gcm_set_constants(mode, tag_bytes, key, &cc);
+    armv8_aes_gcm_set_counter(nonce, nonce_bytes*8, &cs);
+    armv8_enc_aes_gcm_from_state(&cs, aad, aad_bytes*8, plaintext, message_bytes*8, expected_ciphertext, expected_tag);
+
+    // Each exact call sees only its own buffer at the guard - inputs are placed in turn, outputs checked after
+    uint8_t ciphertext[EXACT_MAX_MESSAGE], tag[16];
+    operation_result_t result = SUCCESSFUL_OPERATION;
+    for( uint32_t placed=0; placed<4; ++placed )
+    {
+        uint8_t * n = placed == 0 ? guarded_at_end(g, nonce, nonce_bytes) : nonce;
+        uint8_t * a = placed == 1 ? guarded_at_end(g, aad, aad_bytes) : aad;
+        uint8_t * p = placed == 2 ? guarded_at_end(g, plaintext, message_bytes) : plaintext;
+        uint8_t * c = placed == 3 ? guarded_at_end(g, NULL, message_bytes) : ciphertext;
+        result |= armv8_enc_aes_gcm_full_exact(mode, key, n, nonce_bytes*8, a, aad_bytes*8, p, message_bytes*8,
+                                               tag_bytes, c, tag);
+        if(c != ciphertext) memcpy(ciphertext, c, message_bytes);
+        passed &= memcmp(ciphertext, expected_ciphertext, message_bytes) == 0 && memcmp(tag, expected_tag, tag_bytes) == 0;
+    }
+    uint8_t * t = guarded_at_end(g, NULL, tag_bytes);
+    cipher_state_t cs_exact = { .constants = &cc };
+    armv8_aes_gcm_set_counter(nonce, nonce_bytes*8, &cs_exact);
+    result |= armv8_enc_aes_gcm_from_state_exact(&cs_exact, aad, aad_bytes*8, plaintext, message_bytes*8, ciphertext, t);
+    passed &= memcmp(t, expected_tag, tag_bytes) == 0;
+    if(result != SUCCESSFUL_OPERATION || !passed) {
+        printf("Encrypt mismatch: mode %d, aad %u, message %u, tag %u, nonce %u bytes\n",
+               mode, aad_bytes, message_bytes, tag_bytes, nonce_bytes);
+        return false;
+    }
+
+    // Decrypt with ciphertext, tag and plaintext each at the guard in turn, then with a corrupted tag
+    for( uint32_t placed=0; placed<3; ++placed )
+    {
+        uint8_t * c = placed == 0 ? guarded_at_end(g, expected_ciphertext, message_bytes) : expected_ciphertext;
+        uint8_t * tg = placed == 1 ? guarded_at_end(g, expected_tag, tag_bytes) : expected_tag;
+        uint8_t * p = placed == 2 ? guarded_at_end(g, NULL, message_bytes) : decrypted;
+        result |= armv8_dec_aes_gcm_full_exact(mode, key, nonce, nonce_bytes*8, aad, aad_bytes*8, c, message_bytes*8,
+                                               tg, tag_bytes, p);
+        if(p != decrypted) memcpy(decrypted, p, message_bytes);
+        passed &= memcmp(decrypted, plaintext, message_bytes) == 0;
+    }
+    cs_exact = (cipher_state_t) { .constants = &cc };
+    armv8_aes_gcm_set_counter(nonce, nonce_bytes*8, &cs_exact);
+    uint8_t * a = guarded_at_end(g, aad, aad_bytes);
+    result |= armv8_dec_aes_gcm_from_state_exact(&cs_exact, a, aad_bytes*8, expected_ciphertext, message_bytes*8,
+                                                 expected_tag, decrypted);
+    expected_tag[tag_bytes-1] ^= 1;
+    cs_exact = (cipher_state_t) { .constants = &cc };
+    armv8_aes_gcm_set_counter(nonce, nonce_bytes*8, &cs_exact);
+    passed &= armv8_dec_aes_gcm_from_state_exact(&cs_exact, aad, aad_bytes*8, expected_ciphertext, message_bytes*8,
+                                                 expected_tag, decrypted) == AUTHENTICATION_FAILURE;
+    if(result != SUCCESSFUL_OPERATION || !passed) {
+        printf("Decrypt mismatch: mode %d, aad %u, message %u, tag %u, nonce %u bytes\n",
+               mode, aad_bytes, message_bytes, tag_bytes, nonce_bytes);
+        return false;
+    }
+    return true;
+}
+
+typedef operation_result_t (*exact_fn_t)(cipher_state_t *, uint8_t *, uint64_t, uint8_t *, uint64_t,
+                                         uint8_t *, uint8_t *);
+
+static bool test_key_size_variants(void)
+{
+    static const exact_fn_t encrypt[] = { armv8_enc_aes_gcm_from_state_exact_128,
+                                          armv8_enc_aes_gcm_from_state_exact_192,
+                                          armv8_enc_aes_gcm_from_state_exact_256 };
+    static const exact_fn_t decrypt[] = { armv8_dec_aes_gcm_from_state_exact_128,
+                                          armv8_dec_aes_gcm_from_state_exact_192,
+                                          armv8_dec_aes_gcm_from_state_exact_256 };
+    uint8_t nonce[12] = { 0xca, 0xfe, 0xba, 0xbe }, aad[20] = { 1, 2, 3 }, plaintext[37] = { 4, 5, 6 };
+    uint8_t expected_ciphertext[sizeof(plaintext)], expected_tag[16];
+    uint8_t ciphertext[sizeof(plaintext)], tag[16], decrypted[sizeof(plaintext)];
+    cipher_constants_t cc;
+    bool passed = true;
+
+    for( armv8_cipher_mode_t mode = AES_GCM_128; mode <= AES_GCM_256; ++mode )
+    {
+        cipher_state_t cs = { .constants = &cc };
+        armv8_aes_gcm_set_constants(mode, 16, key, &cc);
+        armv8_aes_gcm_set_counter(nonce, 96, &cs);
+        armv8_enc_aes_gcm_from_state_exact(&cs, aad, sizeof(aad)*8, plaintext, sizeof(plaintext)*8,
+                                           expected_ciphertext, expected_tag);
+
+        for( armv8_cipher_mode_t variant = AES_GCM_128; variant <= AES_GCM_256; ++variant )
+        {
+            operation_result_t expected = variant == mode ? SUCCESSFUL_OPERATION : INVALID_PARAMETER;
+            cs = (cipher_state_t) { .constants = &cc };
+            armv8_aes_gcm_set_counter(nonce, 96, &cs);
+            operation_result_t result = encrypt[variant](&cs, aad, sizeof(aad)*8, plaintext, sizeof(plaintext)*8,
+                                                         ciphertext, tag);
+            if(result != expected || (expected == SUCCESSFUL_OPERATION &&
+               (memcmp(ciphertext, expected_ciphertext, sizeof(ciphertext)) != 0 ||
+                memcmp(tag, expected_tag, sizeof(tag)) != 0))) {
+                printf("Encrypt with the %d variant and mode %d constants returned %d, expected %d\n",
+                       variant, mode, result, expected);
+                passed = false;
+            }
+            cs = (cipher_state_t) { .constants = &cc };
+            armv8_aes_gcm_set_counter(nonce, 96, &cs);
+            result = decrypt[variant](&cs, aad, sizeof(aad)*8, expected_ciphertext, sizeof(plaintext)*8,
+                                      expected_tag, decrypted);
+            if(result != expected || (expected == SUCCESSFUL_OPERATION &&
+               memcmp(decrypted, plaintext, sizeof(plaintext)) != 0)) {
+                printf("Decrypt with the %d variant and mode %d constants returned %d, expected %d\n",
+                       variant, mode, result, expected);
+                passed = false;
+            }
+        }
+    }
+    return passed;
+}
+
+int main(int argc, char* argv[]) {
+    static const uint32_t tag_lengths[] = { 4, 8, 12, 16 };
+    static const uint32_t nonce_lengths[] = { 12, 1, 17, 64 };
+    guarded_t g;
+    bool passed = true;
+    uint32_t count = 0;
+
+    if(!guarded_init(&g)) {
+        printf("Failed to map a guard page\n");
+        return 1;
+    }
+    for( armv8_cipher_mode_t mode = AES_GCM_128; mode <= AES_GCM_256; ++mode )
+    {
+        for( uint32_t message_bytes=0; message_bytes<=EXACT_MAX_MESSAGE; ++message_bytes )
+        {
+            for( uint32_t aad_bytes=0; aad_bytes<=EXACT_MAX_AAD; aad_bytes += 7 )
+            {
+                uint32_t tag_bytes = tag_lengths[(message_bytes + aad_bytes) % 4];
+                uint32_t nonce_bytes = nonce_lengths[message_bytes % 4];
+                passed &= test_lengths(mode, aad_bytes, message_bytes, tag_bytes, nonce_bytes, &g);
+                count++;
+            }
+        }
+    }
+
+    uint8_t nonce[12] = { 0 }, tag[16];
+    if(armv8_enc_aes_gcm_full_exact(AES_GCM_128, key, nonce, 96, NULL, 0, NULL, 0, 3, NULL, tag) != INVALID_PARAMETER) {
+        printf("Invalid tag length was not rejected\n");
+        passed = false;
+    }
+    passed &= test_key_size_variants();
+
+    printf("%u length combinations\n", count);
+    if(!passed) {
+        printf("Failed\n");
+        return 1;
+    }
+    printf("Success\n");
+    return 0;
+}
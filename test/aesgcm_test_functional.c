@@ -34,6 +34,25 @@
 #define decrypt_full                    armv8_dec_aes_gcm_full
 #define decrypt_from_state              armv8_dec_aes_gcm_from_state
 #define decrypt_from_constants_IPsec    armv8_dec_aes_gcm_from_constants_IPsec
+#define gmac_from_constants_IPsec       armv8_gmac_from_constants_IPsec
+#define gmac_verify_from_constants_IPsec armv8_gmac_verify_from_constants_IPsec
+#define macsec_sa_t                     armv8_macsec_sa_t
+#define macsec_sa_init                  armv8_macsec_sa_init
+#define macsec_xpn_sa_init              armv8_macsec_xpn_sa_init
+#define macsec_protect                  armv8_macsec_protect
+#define macsec_validate                 armv8_macsec_validate
+#define macsec_protect_burst            armv8_macsec_protect_burst
+#define macsec_validate_burst           armv8_macsec_validate_burst
+#define tls13_context_t                 armv8_tls13_context_t
+#define tls13_context_init              armv8_tls13_context_init
+#define tls13_seal                      armv8_tls13_seal
+#define tls13_open                      armv8_tls13_open
+#define quic_context_t                  armv8_quic_context_t
+#define quic_context_init               armv8_quic_context_init
+#define quic_protect                    armv8_quic_protect
+#define quic_unprotect                  armv8_quic_unprotect
+#define quic_protect_burst              armv8_quic_protect_burst
+#define quic_unprotect_burst            armv8_quic_unprotect_burst
 
 #define aesgcm_debug_printf(...) \
     do { if (TEST_DEBUG_PRINTF) printf(__VA_ARGS__); } while (0)
@@ -48,6 +67,45 @@ inline uint8_t hextobyte(uint8_t top, uint8_t bot) {
     return (t<<4) + b;
 }
 
+#ifdef IPSEC_ENABLED
+//// Sets up compact constants for the key size of mode, and runs the compact IPsec
+//// encrypt (checksum == NULL) or decrypt on data in place
+static operation_result_t compact_IPsec(cipher_mode_t mode, uint8_t tag_byte_length, uint8_t * key,
+                    uint32_t salt, uint64_t ESPIV,
+                    uint8_t * aad, uint32_t aad_byte_length,
+                    uint8_t * data, uint32_t byte_length,
+                    uint8_t * tag, uint64_t * checksum)
+{
+    armv8_compact_constants_128_t cc_128;
+    armv8_compact_constants_192_t cc_192;
+    armv8_compact_constants_256_t cc_256;
+    operation_result_t result;
+
+    switch(mode) {
+    case AES_GCM_128:
+        result = armv8_aes_gcm_set_compact_constants_128(tag_byte_length, key, &cc_128);
+        if(result != SUCCESSFUL_OPERATION) return result;
+        return checksum == NULL ?
+            armv8_enc_aes_gcm_from_compact_IPsec_128(&cc_128, salt, ESPIV, aad, aad_byte_length, data, byte_length, tag) :
+            armv8_dec_aes_gcm_from_compact_IPsec_128(&cc_128, salt, ESPIV, aad, aad_byte_length, data, byte_length, tag, checksum);
+    case AES_GCM_192:
+        result = armv8_aes_gcm_set_compact_constants_192(tag_byte_length, key, &cc_192);
+        if(result != SUCCESSFUL_OPERATION) return result;
+        return checksum == NULL ?
+            armv8_enc_aes_gcm_from_compact_IPsec_192(&cc_192, salt, ESPIV, aad, aad_byte_length, data, byte_length, tag) :
+            armv8_dec_aes_gcm_from_compact_IPsec_192(&cc_192, salt, ESPIV, aad, aad_byte_length, data, byte_length, tag, checksum);
+    case AES_GCM_256:
+        result = armv8_aes_gcm_set_compact_constants_256(tag_byte_length, key, &cc_256);
+        if(result != SUCCESSFUL_OPERATION) return result;
+        return checksum == NULL ?
+            armv8_enc_aes_gcm_from_compact_IPsec_256(&cc_256, salt, ESPIV, aad, aad_byte_length, data, byte_length, tag) :
+            armv8_dec_aes_gcm_from_compact_IPsec_256(&cc_256, salt, ESPIV, aad, aad_byte_length, data, byte_length, tag, checksum);
+    default:
+        return INVALID_PARAMETER;
+    }
+}
+#endif
+
 //// Called once a reference state is set up, runs encrypt/decrypt
 //// and checks the outputs match the expected outputs
 bool __attribute__ ((noinline)) test_reference(cipher_state_t cs,
@@ -193,8 +251,447 @@ bool __attribute__ ((noinline)) test_reference(cipher_state_t cs,
     {
         if(verbose) printf("\n\nENCRYPTION IPsec TEST skipped\n");
     }
+
+    //// COMPACT IPsec TEST
+    //// Encrypt and decrypt as above, but with compact constants set up from the key
+    if((aad_length > 0) && (aad_length <= 128) && (cs.counter.s[3] == __builtin_bswap32(1u)))
+    {
+        if(verbose) printf("\n\nCOMPACT IPsec TEST\n");
+        uint8_t zero_padded_aad[16] = { 0 };
+        memcpy(zero_padded_aad, aad, aad_length>>3);
+        uint32_t salt = cs.counter.s[0];
+        uint64_t ESPIV = (((uint64_t) cs.counter.s[2])<<32) | cs.counter.s[1];
+
+        memcpy(output, reference_plaintext, plaintext_byte_length);
+        tag = output+plaintext_byte_length;
+        operation_result_t encrypt_result = compact_IPsec(cs.constants->mode, cs.constants->tag_byte_length, key,
+                salt, ESPIV, zero_padded_aad, aad_length>>3, output, plaintext_length>>3, tag, NULL);
+        bool ref_ciphertext_match = (memcmp(output, reference_ciphertext, plaintext_length>>3) == 0);
+        bool reference_tag_match = (memcmp(tag, reference_tag, cs.constants->tag_byte_length) == 0);
+
+        memcpy(output, reference_ciphertext, plaintext_byte_length);
+        memcpy(tag, reference_tag, cs.constants->tag_byte_length);
+        uint64_t checksum = 0;
+        operation_result_t decrypt_result = compact_IPsec(cs.constants->mode, cs.constants->tag_byte_length, key,
+                salt, ESPIV, aad, aad_length>>3, output, plaintext_length>>3, tag, &checksum);
+        bool ref_plaintext_match = (memcmp(output, reference_plaintext, plaintext_length>>3) == 0);
+
+        if(verbose) printf("Reference ciphertext match %s!\nReference tag match %s!\nReference plaintext match %s!\n",
+                ref_ciphertext_match ? "success" : "failure", reference_tag_match ? "success" : "failure",
+                ref_plaintext_match ? "success" : "failure");
+
+        if(!ref_ciphertext_match || !reference_tag_match || (encrypt_result != SUCCESSFUL_OPERATION) ||
+           !ref_plaintext_match || (decrypt_result != SUCCESSFUL_OPERATION) || (check_checksum && (checksum != reference_checksum))) {
+            if(verbose) printf("Compact IPsec failure!\n");
+            success = false;
+        }
+    }
+    else
+    {
+        if(verbose) printf("\n\nCOMPACT IPsec TEST skipped\n");
+    }
     #endif
 
+    //// GMAC IPsec TEST
+    //// Authenticate reference plaintext as a NULL encrypted ESP payload, and check against
+    //// encrypt_from_state with the equivalent aad and an empty plaintext
+    for(uint32_t header_byte_length = 8; header_byte_length <= 12; header_byte_length += 4)
+    {
+        if((aad_length < (header_byte_length<<3)) || (cs.counter.s[3] != __builtin_bswap32(1u))) {
+            if(verbose) printf("\n\nGMAC IPsec TEST skipped\n");
+            continue;
+        }
+        if(verbose) printf("\n\nGMAC IPsec TEST (%u byte header)\n", header_byte_length);
+
+        uint64_t payload_byte_length = plaintext_length>>3;
+        uint64_t gmac_aad_byte_length = header_byte_length + 8 + payload_byte_length;
+        uint8_t * gmac_aad = (uint8_t *)malloc(gmac_aad_byte_length+16);
+        memcpy(gmac_aad, aad, header_byte_length);
+        memcpy(gmac_aad+header_byte_length, cs.counter.b+4, 8);
+        memcpy(gmac_aad+header_byte_length+8, reference_plaintext, payload_byte_length);
+
+        uint8_t expected_tag[16];
+        cs.current_tag.d[0] = 0;
+        cs.current_tag.d[1] = 0;
+        operation_result_t expected_result = encrypt_from_state(
+                &cs,
+                gmac_aad, gmac_aad_byte_length<<3,
+                NULL, 0,
+                NULL,
+                expected_tag);
+        cs.counter = temp_counter;
+
+        uint64_t expected_checksum = 0;
+        for(uint64_t i=0; i<payload_byte_length; i+=8) {
+            uint64_t word = 0;
+            memcpy(&word, reference_plaintext+i, (payload_byte_length-i) < 8 ? (payload_byte_length-i) : 8);
+            expected_checksum += word;
+            if(expected_checksum < word) expected_checksum++;
+        }
+
+        memcpy(output, reference_plaintext, plaintext_byte_length);
+        tag = output+plaintext_byte_length; // tag will go after end of payload
+        uint64_t checksum = 0;
+
+        operation_result_t gmac_result = gmac_from_constants_IPsec(
+                cs.constants,
+                cs.counter.s[0],
+                (((uint64_t) cs.counter.s[2])<<32) | cs.counter.s[1],
+                aad, header_byte_length,
+                output, payload_byte_length,
+                tag,
+                &checksum);
+
+        bool reference_tag_match = true;
+        for(int i=0; i<(cs.constants->tag_byte_length); ++i) {
+            if( tag[i] != expected_tag[i] ) reference_tag_match = false;
+        }
+        bool ref_payload_match = (memcmp(output, reference_plaintext, payload_byte_length) == 0);
+
+        operation_result_t verify_result = gmac_verify_from_constants_IPsec(
+                cs.constants,
+                cs.counter.s[0],
+                (((uint64_t) cs.counter.s[2])<<32) | cs.counter.s[1],
+                aad, header_byte_length,
+                output, payload_byte_length,
+                expected_tag,
+                NULL);
+
+        expected_tag[0] ^= 1;
+        operation_result_t verify_invalid_result = gmac_verify_from_constants_IPsec(
+                cs.constants,
+                cs.counter.s[0],
+                (((uint64_t) cs.counter.s[2])<<32) | cs.counter.s[1],
+                aad, header_byte_length,
+                output, payload_byte_length,
+                expected_tag,
+                NULL);
+
+        if(verbose)
+        {
+            printf("Computed tag: 0x%016lx_%016lx\n",
+                    __builtin_bswap64(((uint64_t*)tag)[0]),
+                    __builtin_bswap64(((uint64_t*)tag)[1]));
+            printf("Computed checksum: 0x%016lx\n", checksum);
+            printf("Reference tag match %s!\nReference checksum match %s!\n",
+                    reference_tag_match ? "success" : "failure", (checksum == expected_checksum) ? "success" : "failure");
+        }
+
+        free(gmac_aad);
+        if(!reference_tag_match || !ref_payload_match || (checksum != expected_checksum) ||
+           (expected_result != SUCCESSFUL_OPERATION) || (gmac_result != SUCCESSFUL_OPERATION) ||
+           (verify_result != SUCCESSFUL_OPERATION) || (verify_invalid_result != AUTHENTICATION_FAILURE)) {
+            if(verbose) printf("GMAC failure!\n");
+            success = false;
+        }
+    }
+
+    //// MACsec TEST
+    //// Protect reference plaintext as the User Data of a frame whose DA | SA | SecTAG comes from the aad,
+    //// with the SA set up so the IV is the reference nonce, and check against encrypt_from_state
+    for(uint32_t variant = 0; variant < 4; ++variant)
+    {
+        bool xpn = variant & 1;
+        uint32_t macsec_aad_byte_length = (variant & 2) ? 28 : 20;
+        if((cs.constants->mode == AES_GCM_192) || (cs.counter.s[3] != __builtin_bswap32(1u))) {
+            if(verbose) printf("\n\nMACsec TEST skipped\n");
+            continue;
+        }
+        if(verbose) printf("\n\nMACsec%s TEST (%u byte AAD)\n", xpn ? " XPN" : "", macsec_aad_byte_length);
+
+        uint64_t user_data_byte_length = plaintext_length>>3;
+        uint32_t frame_byte_length = macsec_aad_byte_length + user_data_byte_length;
+        uint8_t * frame = (uint8_t *)malloc(frame_byte_length+32);
+        uint8_t * expected_frame = (uint8_t *)malloc(frame_byte_length+32);
+        memset(frame, 0, macsec_aad_byte_length);
+        memcpy(frame, aad, (aad_length>>3) < macsec_aad_byte_length ? (aad_length>>3) : macsec_aad_byte_length);
+        frame[14] = (frame[14] & 0xd3) | 0x0c | ((variant & 2) ? 0x20 : 0); // E and C set, SC as required
+        memcpy(frame+macsec_aad_byte_length, reference_plaintext, user_data_byte_length);
+
+        uint8_t expected_icv[16];
+        cs.current_tag.d[0] = 0;
+        cs.current_tag.d[1] = 0;
+        operation_result_t expected_result = encrypt_from_state(
+                &cs,
+                frame, (uint64_t) macsec_aad_byte_length<<3,
+                frame+macsec_aad_byte_length, plaintext_length,
+                expected_frame+macsec_aad_byte_length,
+                expected_icv);
+        cs.counter = temp_counter;
+        memcpy(expected_frame, frame, macsec_aad_byte_length);
+
+        macsec_sa_t sa;
+        uint64_t PN;
+        operation_result_t sa_result;
+        if(xpn) {
+            uint32_t ssci = 0x7a0f3c11;
+            PN = 0x00000001ull << 32 | __builtin_bswap32(cs.counter.s[2]);
+            uint8_t salt[12];
+            memcpy(salt, cs.counter.b, 12);
+            uint32_t ssci_be = __builtin_bswap32(ssci);
+            uint64_t pn_be = __builtin_bswap64(PN);
+            for(int i=0; i<4; ++i) salt[i] ^= ((uint8_t *) &ssci_be)[i];
+            for(int i=0; i<8; ++i) salt[4+i] ^= ((uint8_t *) &pn_be)[i];
+            sa_result = macsec_xpn_sa_init(&sa, cs.constants, ssci, salt);
+        } else {
+            PN = __builtin_bswap32(cs.counter.s[2]);
+            sa_result = macsec_sa_init(&sa, cs.constants, cs.counter.b);
+        }
+
+        operation_result_t protect_result;
+        operation_result_t validate_result;
+        operation_result_t validate_invalid_result;
+        bool ref_frame_match;
+        bool ref_icv_match;
+        bool ref_user_data_match;
+        uint8_t * icv = frame+frame_byte_length;
+        if(xpn) {
+            protect_result = macsec_protect_burst(&sa, &PN, &frame, &frame_byte_length, 1);
+        } else {
+            protect_result = macsec_protect(&sa, PN, frame, frame_byte_length, icv);
+        }
+        ref_frame_match = (memcmp(frame, expected_frame, frame_byte_length) == 0);
+        ref_icv_match = (memcmp(icv, expected_icv, 16) == 0);
+
+        if(xpn) {
+            operation_result_t frame_result;
+            validate_result = macsec_validate_burst(&sa, &PN, &frame, &frame_byte_length, 1, &frame_result);
+            if(frame_result != validate_result) validate_result = INTERNAL_FAILURE;
+        } else {
+            validate_result = macsec_validate(&sa, PN, frame, frame_byte_length, icv);
+        }
+        ref_user_data_match = (memcmp(frame+macsec_aad_byte_length, reference_plaintext, user_data_byte_length) == 0);
+
+        memcpy(frame+macsec_aad_byte_length, expected_frame+macsec_aad_byte_length, user_data_byte_length);
+        memcpy(icv, expected_icv, 16);
+        icv[15] ^= 0x80;
+        validate_invalid_result = macsec_validate(&sa, PN, frame, frame_byte_length, icv);
+
+        if(verbose)
+        {
+            printf("Computed ICV: 0x%016lx_%016lx\n",
+                    __builtin_bswap64(((uint64_t*)expected_icv)[0]),
+                    __builtin_bswap64(((uint64_t*)expected_icv)[1]));
+            printf("Reference frame match %s!\nReference ICV match %s!\nReference User Data match %s!\n",
+                    ref_frame_match ? "success" : "failure", ref_icv_match ? "success" : "failure",
+                    ref_user_data_match ? "success" : "failure");
+        }
+
+        free(frame);
+        free(expected_frame);
+        if(!ref_frame_match || !ref_icv_match || !ref_user_data_match ||
+           (expected_result != SUCCESSFUL_OPERATION) || (sa_result != SUCCESSFUL_OPERATION) ||
+           (protect_result != SUCCESSFUL_OPERATION) || (validate_result != SUCCESSFUL_OPERATION) ||
+           (validate_invalid_result != AUTHENTICATION_FAILURE)) {
+            if(verbose) printf("MACsec failure!\n");
+            success = false;
+        }
+    }
+
+    //// TLS 1.3 TEST
+    //// Seal reference plaintext as the content of a record with the context set up so the per record nonce
+    //// is the reference nonce, check against encrypt_from_state, then open it again, with and without padding
+    for(uint32_t padding_byte_length = 0; padding_byte_length <= 3; padding_byte_length += 3)
+    {
+        uint64_t content_byte_length = plaintext_length>>3;
+        if((cs.constants->mode == AES_GCM_192) || (cs.counter.s[3] != __builtin_bswap32(1u)) || (content_byte_length > 16384 - padding_byte_length)) {
+            if(verbose) printf("\n\nTLS 1.3 TEST skipped\n");
+            continue;
+        }
+        if(verbose) printf("\n\nTLS 1.3 TEST (%u bytes padding)\n", padding_byte_length);
+
+        const uint8_t content_type = 23; // application_data
+        uint64_t sequence_number = 0x0000000100000002ull + padding_byte_length;
+        uint32_t inner_byte_length = content_byte_length + 1 + padding_byte_length;
+        uint32_t expected_record_byte_length = 5 + inner_byte_length + 16;
+        uint8_t * record = (uint8_t *)malloc(expected_record_byte_length+16);
+        uint8_t * expected_record = (uint8_t *)malloc(expected_record_byte_length+16);
+        expected_record[0] = 23;
+        expected_record[1] = 3;
+        expected_record[2] = 3;
+        expected_record[3] = (expected_record_byte_length - 5) >> 8;
+        expected_record[4] = (expected_record_byte_length - 5) & 0xff;
+        memcpy(record, expected_record, 5);
+        memcpy(record+5, reference_plaintext, content_byte_length);
+        record[5+content_byte_length] = content_type;
+        memset(record+5+content_byte_length+1, 0, padding_byte_length);
+
+        cs.current_tag.d[0] = 0;
+        cs.current_tag.d[1] = 0;
+        operation_result_t expected_result = encrypt_from_state(
+                &cs,
+                expected_record, 5<<3,
+                record+5, (uint64_t) inner_byte_length<<3,
+                expected_record+5,
+                expected_record+5+inner_byte_length);
+        cs.counter = temp_counter;
+
+        uint8_t static_iv[12];
+        uint64_t sequence_number_be = __builtin_bswap64(sequence_number);
+        memcpy(static_iv, cs.counter.b, 12);
+        for(int i=0; i<8; ++i) static_iv[4+i] ^= ((uint8_t *) &sequence_number_be)[i];
+        tls13_context_t ctx;
+        operation_result_t ctx_result = tls13_context_init(&ctx, cs.constants, static_iv);
+
+        operation_result_t seal_result = SUCCESSFUL_OPERATION;
+        uint32_t record_byte_length = expected_record_byte_length;
+        if(padding_byte_length == 0) {
+            // seal does not pad, so only compare it with the unpadded record
+            ctx.sequence_number = sequence_number;
+            seal_result = tls13_seal(&ctx, content_type, record, content_byte_length, &record_byte_length);
+        } else {
+            memcpy(record, expected_record, expected_record_byte_length);
+        }
+        bool ref_record_match = (record_byte_length == expected_record_byte_length) &&
+                                (memcmp(record, expected_record, expected_record_byte_length) == 0);
+
+        uint8_t opened_content_type = 0;
+        uint32_t opened_content_byte_length = 0;
+        ctx.sequence_number = sequence_number;
+        operation_result_t open_result = tls13_open(&ctx, record, expected_record_byte_length,
+                                                    &opened_content_type, &opened_content_byte_length);
+        bool ref_content_match = (opened_content_type == content_type) && (opened_content_byte_length == content_byte_length) &&
+                                 (memcmp(record+5, reference_plaintext, content_byte_length) == 0) &&
+                                 (ctx.sequence_number == sequence_number+1);
+
+        memcpy(record, expected_record, expected_record_byte_length);
+        record[expected_record_byte_length-1] ^= 0x80;
+        ctx.sequence_number = sequence_number;
+        operation_result_t open_invalid_result = tls13_open(&ctx, record, expected_record_byte_length,
+                                                            &opened_content_type, &opened_content_byte_length);
+
+        if(verbose)
+        {
+            printf("Reference record match %s!\nReference content match %s!\n",
+                    ref_record_match ? "success" : "failure", ref_content_match ? "success" : "failure");
+        }
+
+        free(record);
+        free(expected_record);
+        if(!ref_record_match || !ref_content_match ||
+           (expected_result != SUCCESSFUL_OPERATION) || (ctx_result != SUCCESSFUL_OPERATION) ||
+           (seal_result != SUCCESSFUL_OPERATION) || (open_result != SUCCESSFUL_OPERATION) ||
+           (open_invalid_result != AUTHENTICATION_FAILURE)) {
+            if(verbose) printf("TLS 1.3 failure!\n");
+            success = false;
+        }
+    }
+
+    //// QUIC TEST
+    //// Protect reference plaintext as the payload of a short (1-RTT) and a long header packet, with the context set
+    //// up so the per packet nonce is the reference nonce, and check against encrypt_from_state for the AEAD and
+    //// a single block of AES-CTR for the header protection mask
+    for(uint32_t long_header = 0; long_header <= 1; ++long_header)
+    {
+        uint32_t pn_length = long_header ? 4 : 2;
+        uint32_t pn_offset = long_header ? 38 : 9;
+        uint32_t header_byte_length = pn_offset + pn_length;
+        uint32_t payload_byte_length = plaintext_length>>3;
+        if((cs.constants->mode == AES_GCM_192) || (cs.counter.s[3] != __builtin_bswap32(1u)) || (payload_byte_length + pn_length < 4)) {
+            if(verbose) printf("\n\nQUIC TEST skipped\n");
+            continue;
+        }
+        if(verbose) printf("\n\nQUIC TEST (%s header)\n", long_header ? "long" : "short");
+
+        uint64_t packet_number = 0x12345678ull + 0x10000ull*long_header;
+        uint32_t packet_byte_length = header_byte_length + payload_byte_length + 16;
+        uint8_t * packet = (uint8_t *)malloc(packet_byte_length+16);
+        uint8_t * expected_packet = (uint8_t *)malloc(packet_byte_length+16);
+        memset(packet, 0, header_byte_length);
+        memcpy(packet+1, aad, (aad_length>>3) < pn_offset-1 ? (aad_length>>3) : pn_offset-1);
+        packet[0] = (long_header ? 0xc0 : 0x40) | (pn_length-1);
+        for(uint32_t i=0; i<pn_length; ++i) {
+            packet[pn_offset+i] = (uint8_t) (packet_number >> (8*(pn_length-1-i)));
+        }
+        memcpy(packet+header_byte_length, reference_plaintext, payload_byte_length);
+        memcpy(expected_packet, packet, header_byte_length);
+
+        cs.current_tag.d[0] = 0;
+        cs.current_tag.d[1] = 0;
+        operation_result_t expected_result = encrypt_from_state(
+                &cs,
+                packet, (uint64_t) header_byte_length<<3,
+                packet+header_byte_length, plaintext_length,
+                expected_packet+header_byte_length,
+                expected_packet+header_byte_length+payload_byte_length);
+        cs.counter = temp_counter;
+
+        // Header protection key and the expected mask - AES of the sample is the keystream for the counter before it
+        uint8_t hp_key[32];
+        uint32_t key_byte_length = (cs.constants->mode == AES_GCM_128) ? 16 : 32;
+        for(uint32_t i=0; i<key_byte_length; ++i) hp_key[i] = key[i] ^ 0x5c;
+        cipher_constants_t hp_cc;
+        operation_result_t hp_result = armv8_aes_gcm_set_constants(cs.constants->mode, 16, hp_key, &hp_cc);
+        cipher_state_t hp_cs = { .current_tag = { .d = {0,0} }, .constants = &hp_cc };
+        uint8_t hp_mask[16] = { 0 };
+        uint8_t hp_mask_tag[16];
+        memcpy(hp_cs.counter.b, expected_packet+pn_offset+4, 16);
+        hp_cs.counter.s[3] = __builtin_bswap32(__builtin_bswap32(hp_cs.counter.s[3]) - 1);
+        hp_result |= encrypt_from_state(&hp_cs, NULL, 0, hp_mask, 128, hp_mask, hp_mask_tag);
+        expected_packet[0] ^= hp_mask[0] & (long_header ? 0x0f : 0x1f);
+        for(uint32_t i=0; i<pn_length; ++i) {
+            expected_packet[pn_offset+i] ^= hp_mask[1+i];
+        }
+
+        uint8_t static_iv[12];
+        uint64_t packet_number_be = __builtin_bswap64(packet_number);
+        memcpy(static_iv, cs.counter.b, 12);
+        for(int i=0; i<8; ++i) static_iv[4+i] ^= ((uint8_t *) &packet_number_be)[i];
+        quic_context_t ctx;
+        operation_result_t ctx_result = quic_context_init(&ctx, cs.constants, &hp_cc, static_iv);
+
+        operation_result_t protect_result;
+        if(long_header) {
+            protect_result = quic_protect_burst(&ctx, &packet_number, &packet, &header_byte_length, &payload_byte_length, 1);
+        } else {
+            protect_result = quic_protect(&ctx, packet_number, packet, header_byte_length, payload_byte_length);
+        }
+        bool ref_packet_match = (memcmp(packet, expected_packet, packet_byte_length) == 0);
+
+        uint64_t largest_pn = packet_number - 100;
+        uint64_t unprotected_packet_number = 0;
+        uint32_t unprotected_header_byte_length = 0;
+        uint32_t unprotected_payload_byte_length = 0;
+        operation_result_t unprotect_result;
+        if(long_header) {
+            operation_result_t packet_result;
+            unprotect_result = quic_unprotect_burst(&ctx, &largest_pn, &packet, &pn_offset, &packet_byte_length, 1,
+                                                    &unprotected_packet_number, &unprotected_header_byte_length,
+                                                    &unprotected_payload_byte_length, &packet_result);
+            if((packet_result != unprotect_result) || (largest_pn != packet_number)) unprotect_result = INTERNAL_FAILURE;
+        } else {
+            unprotect_result = quic_unprotect(&ctx, largest_pn, packet, pn_offset, packet_byte_length,
+                                              &unprotected_packet_number, &unprotected_header_byte_length,
+                                              &unprotected_payload_byte_length);
+        }
+        bool ref_payload_match = (unprotected_packet_number == packet_number) &&
+                                 (unprotected_header_byte_length == header_byte_length) &&
+                                 (unprotected_payload_byte_length == payload_byte_length) &&
+                                 (memcmp(packet+header_byte_length, reference_plaintext, payload_byte_length) == 0);
+
+        memcpy(packet, expected_packet, packet_byte_length);
+        packet[packet_byte_length-1] ^= 0x80;
+        operation_result_t unprotect_invalid_result = quic_unprotect(&ctx, packet_number - 100, packet, pn_offset, packet_byte_length,
+                                                                     &unprotected_packet_number, &unprotected_header_byte_length,
+                                                                     &unprotected_payload_byte_length);
+
+        if(verbose)
+        {
+            printf("Reference packet match %s!\nReference payload match %s!\n",
+                    ref_packet_match ? "success" : "failure", ref_payload_match ? "success" : "failure");
+        }
+
+        free(packet);
+        free(expected_packet);
+        if(!ref_packet_match || !ref_payload_match ||
+           (expected_result != SUCCESSFUL_OPERATION) || (hp_result != SUCCESSFUL_OPERATION) ||
+           (ctx_result != SUCCESSFUL_OPERATION) || (protect_result != SUCCESSFUL_OPERATION) ||
+           (unprotect_result != SUCCESSFUL_OPERATION) || (unprotect_invalid_result != AUTHENTICATION_FAILURE)) {
+            if(verbose) printf("QUIC failure!\n");
+            success = false;
+        }
+    }
+
     tag = (uint8_t *)malloc(cs.constants->tag_byte_length);
 
     //// ENCRYPTION TEST
@@ -870,6 +1367,57 @@ void process_test_file(FILE * fin)
     free(reference_ciphertext);
 }
 
+//// QUIC packet protection known answer test - server Initial packet from RFC 9001 Appendix A.3
+bool test_quic_rfc9001(bool verbose)
+{
+    const char * key_hex     = "cf3a5331653c364c88f0f379b6067e37";
+    const char * iv_hex      = "0ac1493ca1905853b0bba03e";
+    const char * hp_hex      = "c206b8d9b9f0f37644430b490eeaa314";
+    const char * header_hex  = "c1000000010008f067a5502a4262b50040750001";
+    const char * payload_hex = "02000000000600405a020000560303eefce7f7b37ba1d1632e96677825ddf73988cfc79825df566dc5430b9a045a12"
+                               "00130100002e00330024001d00209d3c940d89690b84d08a60993c144eca684d1081287c834d5311bcf32bb9da1a"
+                               "002b00020304";
+    const char * packet_hex  = "cf000000010008f067a5502a4262b5004075c0d95a482cd0991cd25b0aac406a5816b6394100f37a1c69797554780b"
+                               "b38cc5a99f5ede4cf73c3ec2493a1839b3dbcba3f6ea46c5b7684df3548e7ddeb9c3bf9c73cc3f3bded74b562bfb19"
+                               "fb84022f8ef4cdd93795d77d06edbb7aaf2f58891850abbdca3d20398c276456cbc42158407dd074ee";
+    const uint32_t header_byte_length = 20;
+    const uint32_t payload_byte_length = 99;
+    const uint32_t packet_byte_length = header_byte_length + payload_byte_length + 16;
+
+    uint8_t key[16], iv[12], hp[16];
+    uint8_t packet[packet_byte_length+16];
+    uint8_t expected_packet[packet_byte_length];
+    for(uint32_t i=0; i<16; ++i) key[i] = hextobyte(key_hex[2*i], key_hex[2*i+1]);
+    for(uint32_t i=0; i<12; ++i) iv[i]  = hextobyte(iv_hex[2*i],  iv_hex[2*i+1]);
+    for(uint32_t i=0; i<16; ++i) hp[i]  = hextobyte(hp_hex[2*i],  hp_hex[2*i+1]);
+    for(uint32_t i=0; i<header_byte_length; ++i)  packet[i] = hextobyte(header_hex[2*i], header_hex[2*i+1]);
+    for(uint32_t i=0; i<payload_byte_length; ++i) packet[header_byte_length+i] = hextobyte(payload_hex[2*i], payload_hex[2*i+1]);
+    for(uint32_t i=0; i<packet_byte_length; ++i)  expected_packet[i] = hextobyte(packet_hex[2*i], packet_hex[2*i+1]);
+
+    cipher_constants_t cc, hp_cc;
+    quic_context_t ctx;
+    operation_result_t result = armv8_aes_gcm_set_constants(AES_GCM_128, 16, key, &cc);
+    result |= armv8_aes_gcm_set_constants(AES_GCM_128, 16, hp, &hp_cc);
+    result |= quic_context_init(&ctx, &cc, &hp_cc, iv);
+    result |= quic_protect(&ctx, 1, packet, header_byte_length, payload_byte_length);
+    bool packet_match = (memcmp(packet, expected_packet, packet_byte_length) == 0);
+
+    uint64_t packet_number = 0;
+    uint32_t unprotected_header_byte_length = 0;
+    uint32_t unprotected_payload_byte_length = 0;
+    result |= quic_unprotect(&ctx, 0, packet, 18, packet_byte_length,
+                             &packet_number, &unprotected_header_byte_length, &unprotected_payload_byte_length);
+    bool payload_match = (packet_number == 1) && (unprotected_header_byte_length == header_byte_length) &&
+                         (unprotected_payload_byte_length == payload_byte_length);
+    for(uint32_t i=0; i<payload_byte_length; ++i) {
+        if(packet[header_byte_length+i] != hextobyte(payload_hex[2*i], payload_hex[2*i+1])) payload_match = false;
+    }
+
+    if(verbose) printf("RFC 9001 QUIC packet match %s!\nRFC 9001 QUIC payload match %s!\n",
+                       packet_match ? "success" : "failure", payload_match ? "success" : "failure");
+    return packet_match && payload_match && (result == SUCCESSFUL_OPERATION);
+}
+
 int main(int argc, char* argv[]) {
     //// Get reference input file name
     char reference_filename[100];
@@ -885,6 +1433,12 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
+    if(!test_quic_rfc9001(false)) {
+        test_quic_rfc9001(true);
+        printf("RFC 9001 QUIC test failed\n");
+        exit(1);
+    }
+
     process_test_file(fin);
     fclose(fin);
 
@@ -0,0 +1,229 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Random access AES-GCM
+//// An object is encrypted in one go, then byte ranges of it are decrypted on their own with armv8_dec_aes_gcm_range
+//// and must match the plaintext, and the whole object tag is verified from segments hashed on separate threads
+//// Finally the time to decrypt a small range near the end of a large object is compared with decrypting all of it
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "AArch64cryptolib.h"
+#include "test_timing.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define cipher_constants_t  armv8_cipher_constants_t
+#define cipher_state_t      armv8_cipher_state_t
+#define aes_gcm_segment_t   armv8_aes_gcm_segment_t
+
+#define RANGE_OBJECT_BYTES  100003
+#define RANGE_READS         2000
+#define RANGE_THREADS       4
+#define RANGE_LARGE_BYTES   (16u << 20)
+#define RANGE_READ_BYTES    4096
+
+typedef struct segment_thread {
+    pthread_t thread;
+    cipher_constants_t * cc;
+    uint8_t * ciphertext;
+    uint64_t byte_length;
+    aes_gcm_segment_t * segment;
+    operation_result_t result;
+} segment_thread_t;
+
+static uint8_t key[32] = { 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+                           0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 };
+static uint8_t nonce[64];
+static uint8_t aad[37];
+
+static uint64_t rng_next(uint64_t * rng)
+{
+    *rng ^= *rng << 13; *rng ^= *rng >> 7; *rng ^= *rng << 17;
+    return *rng;
+}
+
+static void * segment_thread_main(void * arg)
+{
+    segment_thread_t * t = arg;
+    t->result = armv8_aes_gcm_ghash_segment(t->cc, t->ciphertext, t->byte_length*8, t->segment);
+    return NULL;
+}
+
+// Splits the ciphertext into segment_count segments of random whole block lengths (the last takes the rest) and
+// hashes each on its own thread, at most RANGE_THREADS at a time
+static operation_result_t verify_in_segments(cipher_state_t * cs, uint32_t aad_bytes, uint8_t * ciphertext,
+                                             uint64_t byte_length, uint8_t * tag, uint32_t segment_count, uint64_t * rng)
+{
+    aes_gcm_segment_t segments[RANGE_THREADS * 4];
+    segment_thread_t threads[RANGE_THREADS * 4];
+    uint64_t offset = 0;
+    operation_result_t result = SUCCESSFUL_OPERATION;
+
+    for( uint32_t i=0; i<segment_count; ++i )
+    {
+        uint64_t remaining_blocks = (byte_length - offset) / 16;
+        uint64_t segment_bytes = (i+1 == segment_count) ? byte_length - offset :
+                                 16 * (remaining_blocks ? rng_next(rng) % (remaining_blocks + 1) : 0);
+        threads[i] = (segment_thread_t) { .cc = cs->constants, .ciphertext = ciphertext + offset,
+                                          .byte_length = segment_bytes, .segment = &segments[i] };
+        offset += segment_bytes;
+    }
+    for( uint32_t first=0; first<segment_count; first+=RANGE_THREADS )
+    {
+        uint32_t last = first + RANGE_THREADS < segment_count ? first + RANGE_THREADS : segment_count;
+        for( uint32_t i=first; i<last; ++i ) pthread_create(&threads[i].thread, NULL, segment_thread_main, &threads[i]);
+        for( uint32_t i=first; i<last; ++i )
+        {
+            pthread_join(threads[i].thread, NULL);
+            result |= threads[i].result;
+        }
+    }
+    if(result != SUCCESSFUL_OPERATION) {
+        return result;
+    }
+    return armv8_aes_gcm_verify_segments(cs, aad, aad_bytes*8, segments, segment_count, tag);
+}
+
+static bool test_object(armv8_cipher_mode_t mode, uint32_t nonce_bytes, uint32_t aad_bytes, uint64_t byte_length,
+                        uint8_t * plaintext, uint8_t * ciphertext, uint8_t * decrypted, uint64_t * rng)
+{
+    cipher_constants_t cc;
+    cipher_state_t cs = { .constants = &cc };
+    uint8_t tag[16];
+    bool passed = true;
+
+    operation_result_t result = armv8_aes_gcm_set_constants(mode, 16, key, &cc);
+    result |= armv8_aes_gcm_set_counter(nonce, nonce_bytes*8, &cs);
+    cipher_state_t enc_cs = cs;
+    result |= armv8_enc_aes_gcm_from_state(&enc_cs, aad, aad_bytes*8, plaintext, byte_length*8, ciphertext, tag);
+    if(result != SUCCESSFUL_OPERATION) {
+        printf("Encrypt failed: mode %d, nonce %u bytes\n", mode, nonce_bytes);
+        return false;
+    }
+
+    // Random ranges, plus the whole object, an empty range and a range ending at the very end
+    for( uint32_t r=0; r<RANGE_READS+3 && passed; ++r )
+    {
+        uint64_t start = rng_next(rng) % (byte_length + 1);
+        uint64_t length = rng_next(rng) % (r & 1 ? 64 : 20000);
+        if(r == RANGE_READS) { start = 0; length = byte_length; }
+        if(r == RANGE_READS+1) { length = 0; }
+        if(r == RANGE_READS+2) { start = byte_length - 17; length = 17; }
+        if(length > byte_length - start) length = byte_length - start;
+
+        memset(decrypted, 0, length);
+        result = armv8_dec_aes_gcm_range(&cs, start*8, ciphertext + start, length*8, decrypted);
+        if(result != SUCCESSFUL_OPERATION || memcmp(decrypted, plaintext + start, length) != 0) {
+            printf("Range [%lu, %lu) mismatch: mode %d, nonce %u bytes\n", start, start + length, mode, nonce_bytes);
+            passed = false;
+        }
+    }
+
+    for( uint32_t segment_count=1; segment_count<=RANGE_THREADS*4 && passed; segment_count*=2 )
+    {
+        if(verify_in_segments(&cs, aad_bytes, ciphertext, byte_length, tag, segment_count, rng) != SUCCESSFUL_OPERATION) {
+            printf("Tag of %u segments not verified: mode %d, nonce %u, aad %u bytes\n", segment_count, mode,
+                   nonce_bytes, aad_bytes);
+            passed = false;
+        }
+    }
+    uint64_t corrupt = rng_next(rng) % byte_length;
+    ciphertext[corrupt] ^= 0x80;
+    if(verify_in_segments(&cs, aad_bytes, ciphertext, byte_length, tag, RANGE_THREADS, rng) != AUTHENTICATION_FAILURE) {
+        printf("Corrupted ciphertext byte %lu not caught: mode %d\n", corrupt, mode);
+        passed = false;
+    }
+    ciphertext[corrupt] ^= 0x80;
+    return passed;
+}
+
+// A segment other than the last that isn't whole blocks, and a range beyond the longest message, are rejected
+static bool test_invalid(void)
+{
+    cipher_constants_t cc;
+    cipher_state_t cs = { .constants = &cc };
+    aes_gcm_segment_t segments[2];
+    uint8_t block[32] = { 0 }, tag[16] = { 0 };
+    bool passed = true;
+
+    armv8_aes_gcm_set_constants(AES_GCM_128, 16, key, &cc);
+    armv8_aes_gcm_set_counter(nonce, 96, &cs);
+    armv8_aes_gcm_ghash_segment(&cc, block, 15*8, &segments[0]);
+    armv8_aes_gcm_ghash_segment(&cc, block, 16*8, &segments[1]);
+    if(armv8_aes_gcm_verify_segments(&cs, aad, 0, segments, 2, tag) != INVALID_PARAMETER) {
+        printf("Partial block segment before the last was not rejected\n");
+        passed = false;
+    }
+    if(armv8_dec_aes_gcm_range(&cs, (((1ull << 32) - 2) * 16 - 8) * 8, block, 16*8, block) != INVALID_PARAMETER ||
+       armv8_dec_aes_gcm_range(&cs, 4, block, 16*8, block) != INVALID_PARAMETER) {
+        printf("Invalid range was not rejected\n");
+        passed = false;
+    }
+    return passed;
+}
+
+// Decrypting a small range near the end of a large object against decrypting all of it
+static void time_range_read(uint8_t * plaintext, uint8_t * ciphertext)
+{
+    cipher_constants_t cc;
+    cipher_state_t cs = { .constants = &cc };
+    uint8_t tag[16];
+    uint64_t offset = RANGE_LARGE_BYTES - 3 * RANGE_READ_BYTES + 5;
+
+    armv8_aes_gcm_set_constants(AES_GCM_256, 16, key, &cc);
+    armv8_aes_gcm_set_counter(nonce, 96, &cs);
+    cipher_state_t full_cs = cs;
+    uint64_t start = timing_now_ns();
+    armv8_dec_aes_gcm_from_state(&full_cs, aad, sizeof(aad)*8, ciphertext, RANGE_LARGE_BYTES*8LL, tag, plaintext);
+    uint64_t full_ns = timing_now_ns() - start;
+
+    const uint32_t reads = 100;
+    start = timing_now_ns();
+    for( uint32_t i=0; i<reads; ++i )
+    {
+        armv8_dec_aes_gcm_range(&cs, offset*8, ciphertext + offset, RANGE_READ_BYTES*8, plaintext + offset);
+    }
+    uint64_t range_ns = (timing_now_ns() - start) / reads;
+    printf("AES-GCM-256 %u MB object: decrypt all %.1f us, %u byte range near the end %.1f us\n",
+           RANGE_LARGE_BYTES >> 20, full_ns / 1000.0, RANGE_READ_BYTES, range_ns / 1000.0);
+}
+
+int main(int argc, char* argv[]) {
+    static const uint32_t nonce_lengths[] = { 12, 1, 17, 64 };
+    uint8_t * plaintext = malloc(RANGE_LARGE_BYTES);
+    uint8_t * ciphertext = malloc(RANGE_LARGE_BYTES);
+    uint8_t * decrypted = malloc(RANGE_LARGE_BYTES);
+    uint64_t rng = 0x9e3779b97f4a7c15ull;
+    bool passed = true;
+
+    for( uint32_t i=0; i<sizeof(nonce); ++i ) nonce[i] = (uint8_t) (i * 7 + 1);
+    for( uint32_t i=0; i<sizeof(aad); ++i ) aad[i] = (uint8_t) (i * 13 + 5);
+    for( uint64_t i=0; i<RANGE_LARGE_BYTES; ++i ) plaintext[i] = (uint8_t) rng_next(&rng);
+
+    for( armv8_cipher_mode_t mode = AES_GCM_128; mode <= AES_GCM_256; ++mode )
+    {
+        for( uint32_t n=0; n<sizeof(nonce_lengths)/sizeof(nonce_lengths[0]); ++n )
+        {
+            uint32_t aad_bytes = (n * 11) % (sizeof(aad) + 1);
+            uint64_t byte_length = RANGE_OBJECT_BYTES - 16 * n * (mode + 1);
+            passed &= test_object(mode, nonce_lengths[n], aad_bytes, byte_length, plaintext, ciphertext, decrypted, &rng);
+        }
+    }
+    passed &= test_invalid();
+    time_range_read(plaintext, ciphertext);
+
+    free(plaintext);
+    free(ciphertext);
+    free(decrypted);
+    if(!passed) {
+        printf("Failed\n");
+        return 1;
+    }
+    printf("Success\n");
+    return 0;
+}
@@ -10,7 +10,10 @@
 #include <math.h>
 #include <string.h>
 
+#include <dirent.h>
+
 #include "AArch64cryptolib.h"
+#include "test_timing.h"
 
 #define MAX_LINE_LEN 128
 
@@ -47,10 +50,93 @@ inline uint8_t hextobyte(uint8_t top, uint8_t bot) {
     return (t<<4) + b;
 }
 
+//// Run the selected operation count times on the current reference
+operation_result_t run_operation(cipher_state_t * cs, uint64_t count, bool encrypt, bool IPsec,
+                                 uint8_t * aad, uint64_t aad_length,
+                                 uint8_t * reference_plaintext, uint8_t * reference_ciphertext, uint64_t plaintext_length,
+                                 uint8_t * reference_tag, uint8_t * tag,
+                                 uint8_t * plaintext, uint8_t * ciphertext)
+{
+    operation_result_t result = SUCCESSFUL_OPERATION;
+    // Each generic run starts from the same counter and tag, so every decrypt authenticates
+    quadword_t counter = cs->counter;
+    quadword_t current_tag = cs->current_tag;
+    if(encrypt)
+    {
+        if(IPsec)
+        {
+            #ifdef IPSEC_ENABLED
+            uint32_t salt = cs->counter.s[0];
+            uint64_t ESPIV = (((uint64_t) cs->counter.s[2])<<32) | cs->counter.s[1];
+            for(uint64_t i=0; i<count; ++i) {
+                result = encrypt_from_constants_IPsec(
+                                cs->constants,
+                                salt,
+                                ESPIV,
+                                aad, aad_length>>3,
+                                reference_plaintext, plaintext_length>>3,
+                                tag);
+            }
+            #else
+            result = INVALID_PARAMETER;
+            #endif
+        } else {
+            for(uint64_t i=0; i<count; ++i) {
+                cs->counter = counter;
+                cs->current_tag = current_tag;
+                result |= encrypt_from_state(
+                            cs,
+                            aad, aad_length,
+                            reference_plaintext, plaintext_length,     //Inputs
+                            ciphertext,
+                            tag); //Outputs
+            }
+        }
+    } else {
+        if(IPsec)
+        {
+            #ifdef IPSEC_ENABLED
+            uint32_t salt = cs->counter.s[0];
+            uint64_t ESPIV = (((uint64_t) cs->counter.s[2])<<32) | cs->counter.s[1];
+            uint64_t checksum;
+            for(uint64_t i=0; i<count; ++i) {
+                result = decrypt_from_constants_IPsec(
+                                cs->constants,
+                                salt,
+                                ESPIV,
+                                aad, aad_length>>3,
+                                reference_ciphertext, plaintext_length>>3,
+                                tag,
+                                &checksum);
+            }
+            #else
+            result = INVALID_PARAMETER;
+            #endif
+        } else {
+            for(uint64_t i=0; i<count; ++i) {
+                cs->counter = counter;
+                cs->current_tag = current_tag;
+                result |= decrypt_from_state(
+                            cs,
+                            aad, aad_length,
+                            reference_ciphertext, plaintext_length,
+                            reference_tag,                              //Inputs
+                            plaintext); //Output
+            }
+        }
+    }
+    cs->counter = counter;
+    cs->current_tag = current_tag;
+    return result;
+}
+
 //// Read a reference file and check that encrypt/decrypt operations are
 //// producing the correct outputs without errors
-void process_test_file(FILE * fin, uint64_t test_count, bool encrypt, bool IPsec,
-                       bool overwrite_buffer_length, uint64_t overwritten_buffer_length)
+//// Each reference is run for warm-up, then timed over a number of trials of test_count runs
+//// If test_count is 0 it is taken from the reference file, or from bytes_per_trial if that is set
+void process_test_file(FILE * fin, const char * name, uint64_t test_count, bool encrypt, bool IPsec,
+                       bool overwrite_buffer_length, uint64_t overwritten_buffer_length,
+                       uint64_t bytes_per_trial, const timing_options_t * options, uint64_t * report_index)
 {
     //// Initialise/Default values
     cipher_constants_t cc = { .mode = 0 };
@@ -103,70 +189,44 @@ void process_test_file(FILE * fin, uint64_t test_count, bool encrypt, bool IPsec
                     if(new_reference)
                     {
                         operation_result_t result = SUCCESSFUL_OPERATION;
-                        if(encrypt)
-                        {
-                            if(IPsec)
-                            {
-                                #ifdef IPSEC_ENABLED
-                                uint32_t salt = cs.counter.s[0];
-                                uint64_t ESPIV = (((uint64_t) cs.counter.s[2])<<32) | cs.counter.s[1];
-                                for(uint64_t i=0; i<test_count; ++i) {
-                                    result = encrypt_from_constants_IPsec(
-                                                    cs.constants,
-                                                    salt,
-                                                    ESPIV,
-                                                    aad, aad_length>>3,
-                                                    reference_plaintext, plaintext_length>>3,
-                                                    tag);
-                                }
-                                #else
-                                printf("IPsec not supported on this target\n");
-                                #endif
-                            } else {
-                                for(uint64_t i=0; i<test_count; ++i) {
-                                    result |= encrypt_from_state(
-                                                &cs,
-                                                aad, aad_length,
-                                                reference_plaintext, plaintext_length,     //Inputs
-                                                ciphertext,
-                                                tag); //Outputs
-                                }
-                            }
-                        } else {
-                            if(IPsec)
-                            {
-                                #ifdef IPSEC_ENABLED
-                                uint32_t salt = cs.counter.s[0];
-                                uint64_t ESPIV = (((uint64_t) cs.counter.s[2])<<32) | cs.counter.s[1];
-                                uint64_t checksum;
-                                for(uint64_t i=0; i<test_count; ++i) {
-                                    result = decrypt_from_constants_IPsec(
-                                                    cs.constants,
-                                                    salt,
-                                                    ESPIV,
-                                                    aad, aad_length>>3,
-                                                    reference_ciphertext, plaintext_length>>3,
-                                                    tag,
-                                                    &checksum);
-                                }
-                                #else
-                                printf("IPsec not supported on this target\n");
-                                #endif
-                            } else {
-                                for(uint64_t i=0; i<test_count; ++i) {
-                                    result |= decrypt_from_state(
-                                                &cs,
-                                                aad, aad_length,
-                                                reference_ciphertext, plaintext_length,
-                                                reference_tag,                              //Inputs
-                                                plaintext); //Output
-                                }
-                            }
+                        timing_counters_t counters;
+                        timing_sample_t samples[TIMING_MAX_TRIALS];
+                        uint64_t warmup_count = timing_warmup_count(options, (test_count+9)/10);
+                        timing_counters_open(&counters, options->use_pmu);
+                        if(options->profile) timing_profile_open(&counters);
+
+                        #ifndef IPSEC_ENABLED
+                        if(IPsec) printf("IPsec not supported on this target\n");
+                        #endif
+                        result |= run_operation(&cs, warmup_count, encrypt, IPsec, aad, aad_length,
+                                                reference_plaintext, reference_ciphertext, plaintext_length,
+                                                reference_tag, tag, plaintext, ciphertext);
+                        for(uint32_t trial=0; trial<options->trials; ++trial) {
+                            timing_start(&counters, &samples[trial]);
+                            result |= run_operation(&cs, test_count, encrypt, IPsec, aad, aad_length,
+                                                    reference_plaintext, reference_ciphertext, plaintext_length,
+                                                    reference_tag, tag, plaintext, ciphertext);
+                            timing_stop(&counters, &samples[trial]);
+                        }
+                        timing_counters_close(&counters);
+
+                        const char * mode_names[] = { "AES-GCM-128", "AES-GCM-192", "AES-GCM-256" };
+                        timing_result_t timing = {
+                            .name = name,
+                            .mode = mode_names[cs.constants->mode],
+                            .operation = encrypt ? "encrypt" : "decrypt",
+                            .variant = IPsec ? "IPsec" : "Generic",
+                            .bytes = plaintext_length>>3,
+                            .profiled = options->profile,
+                            .success = (result == SUCCESSFUL_OPERATION) };
+                        timing_summarize(samples, options->trials, test_count, &timing);
+
+                        if(options->format == TIMING_FORMAT_TEXT) {
+                            printf("%s - %s\n%lu runs\n%lu bytes\nResult is %s\n",
+                            encrypt ? "Encrypt" : "Decrypt", IPsec ? "IPsec" : "Generic",
+                            test_count, plaintext_byte_length, (result == SUCCESSFUL_OPERATION) ? "Success" : "Failure");
                         }
-                        printf("%s - %s\n%lu runs\n%lu bytes\nResult is %s\n%s",
-                        encrypt ? "Encrypt" : "Decrypt", IPsec ? "IPsec" : "Generic",
-                        test_count, plaintext_byte_length, (result == SUCCESSFUL_OPERATION) ? "Success" : "Failure",
-                        encrypt ? "" : "(only should be Success with 1 run - need to reset counter and tag between each call)\n");
+                        timing_report(options->format, &timing, (*report_index)++);
                     }
                     new_reference = false;
                 }
@@ -225,6 +285,10 @@ void process_test_file(FILE * fin, uint64_t test_count, bool encrypt, bool IPsec
                 }
                 else if(strncmp(input_buff, "Count", 5) == 0) {
                     //start of new reference
+                    if( test_count == 0 && bytes_per_trial != 0) {
+                        test_count = bytes_per_trial / ((plaintext_length>>3) ? (plaintext_length>>3) : 1);
+                        if( test_count == 0) test_count = 1;
+                    }
                     if( test_count == 0) {
                         test_count = strtoul(input_buff+8, NULL, 10);
                     }
@@ -356,6 +420,66 @@ void process_test_file(FILE * fin, uint64_t test_count, bool encrypt, bool IPsec
     free(reference_ciphertext);
 }
 
+//// Order speedtest<keylen>_<bytes>.rsp by key length then size
+int compare_speedtest_names(const void * a, const void * b)
+{
+    unsigned int key_a = 0, key_b = 0, size_a = 0, size_b = 0;
+    sscanf(*(const char * const *) a, "speedtest%u_%u.rsp", &key_a, &size_a);
+    sscanf(*(const char * const *) b, "speedtest%u_%u.rsp", &key_b, &size_b);
+    if(key_a != key_b) return (key_a > key_b) - (key_a < key_b);
+    return (size_a > size_b) - (size_a < size_b);
+}
+
+//// Run every speedtest*_N.rsp in a directory, for each mode supported on this target
+int sweep_directory(const char * directory, uint64_t test_count, const timing_options_t * options)
+{
+    char * names[256];
+    uint32_t name_count = 0;
+    DIR * dir = opendir(directory);
+    if(dir == NULL) {
+        printf("Could not open directory %s\n", directory);
+        return 1;
+    }
+    struct dirent * entry;
+    while((entry = readdir(dir)) != NULL && name_count < 256) {
+        unsigned int key_length, size;
+        if(sscanf(entry->d_name, "speedtest%u_%u.rsp", &key_length, &size) == 2) {
+            names[name_count++] = strdup(entry->d_name);
+        }
+    }
+    closedir(dir);
+    qsort(names, name_count, sizeof(char *), compare_speedtest_names);
+
+    uint64_t report_index = 0;
+    timing_report_begin(options->format, options->profile);
+    for(uint32_t n=0; n<name_count; ++n) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", directory, names[n]);
+        FILE * fin = fopen(path, "rb");
+        if(fin == NULL) {
+            printf("Could not open reference file %s\n", path);
+            continue;
+        }
+        for(int encrypt=1; encrypt>=0; --encrypt) {
+            #ifdef IPSEC_ENABLED
+            for(int IPsec=0; IPsec<=1; ++IPsec) {
+            #else
+            for(int IPsec=0; IPsec<=0; ++IPsec) {
+            #endif
+                if(options->format == TIMING_FORMAT_TEXT) printf("\nUsing reference file %s\n", path);
+                rewind(fin);
+                // by default keep each trial to around 64MB, so the sweep completes in reasonable time
+                process_test_file(fin, names[n], test_count, encrypt, IPsec, false, 0,
+                                  test_count ? 0 : (64ul << 20), options, &report_index);
+            }
+        }
+        fclose(fin);
+        free(names[n]);
+    }
+    timing_report_end(options->format);
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     //// Get input cipher size
     char reference_filename[100];
@@ -364,32 +488,64 @@ int main(int argc, char* argv[]) {
     bool IPsec = true;
     bool overwrite_buffer_length = false;
     uint64_t overwritten_buffer_length = 0;
-    if(argc>=2) {
-        strcpy(reference_filename, argv[1]);
+    timing_options_t options = TIMING_DEFAULT_OPTIONS;
+    const char * sweep = NULL;
+    char * positional[5];
+    int positional_count = 0;
+
+    for(int i=1; i<argc; ) {
+        int consumed = timing_parse_option(argc, argv, i, &options);
+        if(consumed) {
+            i += consumed;
+        } else if(strcmp(argv[i], "--profile") == 0) {
+            options.profile = true;
+            i++;
+        } else if(strcmp(argv[i], "--sweep") == 0 && i+1 < argc) {
+            sweep = argv[i+1];
+            i += 2;
+        } else {
+            if(positional_count < 5) positional[positional_count++] = argv[i];
+            i++;
+        }
+    }
+
+    if(sweep != NULL) {
+        if(positional_count>=1) {
+            test_count = strtoul(positional[0], NULL, 10);
+        }
+        return sweep_directory(sweep, test_count, &options);
+    }
+
+    if(positional_count>=1) {
+        strcpy(reference_filename, positional[0]);
     } else {
         strcpy(reference_filename, "ref_default");
     }
-    if(argc>=3) {
-        test_count = strtoul(argv[2], NULL, 10);
+    if(positional_count>=2) {
+        test_count = strtoul(positional[1], NULL, 10);
     }
-    if(argc>=4) {
-        encrypt = (bool) strtoul(argv[3], NULL, 10);
+    if(positional_count>=3) {
+        encrypt = (bool) strtoul(positional[2], NULL, 10);
     }
-    if(argc>=5) {
-        IPsec = (bool) strtoul(argv[4], NULL, 10);
+    if(positional_count>=4) {
+        IPsec = (bool) strtoul(positional[3], NULL, 10);
     }
-    if(argc>=6) {
+    if(positional_count>=5) {
         overwrite_buffer_length = true;
-        overwritten_buffer_length = strtoul(argv[5], NULL, 10);
+        overwritten_buffer_length = strtoul(positional[4], NULL, 10);
     }
-    printf("Using reference file %s\n", reference_filename);
+    if(options.format == TIMING_FORMAT_TEXT) printf("Using reference file %s\n", reference_filename);
     FILE * fin = fopen(reference_filename,"rb");
     if(fin == NULL) {
         printf("Could not open reference file\n");
         exit(1);
     }
 
-    process_test_file(fin, test_count, encrypt, IPsec, overwrite_buffer_length, overwritten_buffer_length);
+    uint64_t report_index = 0;
+    timing_report_begin(options.format, options.profile);
+    process_test_file(fin, reference_filename, test_count, encrypt, IPsec, overwrite_buffer_length, overwritten_buffer_length,
+                      0, &options, &report_index);
+    timing_report_end(options.format);
     fclose(fin);
 
     return 0;
@@ -0,0 +1,465 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Stage level AES-GCM microbenchmarks
+//// Times the GHASH half (ghash_kernel), the AES-CTR half (aes_ctr_blk_*_kernel) and each
+//// merged enc/dec kernel variant available for this target on identical data, to show
+//// whether a change in performance comes from the AES side, the GHASH side or how the
+//// two are scheduled together.
+//// The kernels are static, so this test builds AArch64cryptolib_aes_gcm.c into itself,
+//// along with the other variants of the merged kernels under their own names
+
+#define NDEBUG
+#include <assert.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "AArch64cryptolib_aes_gcm.c"
+#include "test_timing.h"
+
+#define cipher_mode_t       armv8_cipher_mode_t
+#define operation_result_t  armv8_operation_result_t
+#define quadword_t          armv8_quadword_t
+#define cipher_constants_t  armv8_cipher_constants_t
+#define cipher_state_t      armv8_cipher_state_t
+
+//// Other variants of the merged kernels for this target, alongside the one built into the library
+#if defined PERF_GCM_LITTLE
+    #define STAGES_BUILT_IN_VARIANT "interleaved"
+    #define aes_gcm_enc_128_kernel aes_gcm_enc_128_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/enc/aes_gcm_enc_128_kernel__not_interleaved.c"
+    #undef aes_gcm_enc_128_kernel
+    #define aes_gcm_enc_256_kernel aes_gcm_enc_256_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/enc/aes_gcm_enc_256_kernel__not_interleaved.c"
+    #undef aes_gcm_enc_256_kernel
+    #define aes_gcm_dec_128_kernel aes_gcm_dec_128_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/dec/aes_gcm_dec_128_kernel__not_interleaved.c"
+    #undef aes_gcm_dec_128_kernel
+    #define aes_gcm_dec_256_kernel aes_gcm_dec_256_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_LITTLE/aes_gcm/dec/aes_gcm_dec_256_kernel__not_interleaved.c"
+    #undef aes_gcm_dec_256_kernel
+    #define STAGES_NOT_INTERLEAVED { aes_gcm_enc_128_kernel__not_interleaved, NULL, aes_gcm_enc_256_kernel__not_interleaved }, \
+                                   { aes_gcm_dec_128_kernel__not_interleaved, NULL, aes_gcm_dec_256_kernel__not_interleaved }
+#elif defined PERF_GCM_BIG
+    #define STAGES_BUILT_IN_VARIANT "interleaved"
+    #define aes_gcm_enc_128_kernel aes_gcm_enc_128_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_big/aes_gcm/enc/aes_gcm_enc_128_kernel__not_interleaved.c"
+    #undef aes_gcm_enc_128_kernel
+    #define aes_gcm_enc_192_kernel aes_gcm_enc_192_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_big/aes_gcm/enc/aes_gcm_enc_192_kernel__not_interleaved.c"
+    #undef aes_gcm_enc_192_kernel
+    #define aes_gcm_enc_256_kernel aes_gcm_enc_256_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_big/aes_gcm/enc/aes_gcm_enc_256_kernel__not_interleaved.c"
+    #undef aes_gcm_enc_256_kernel
+    #define aes_gcm_dec_128_kernel aes_gcm_dec_128_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_big/aes_gcm/dec/aes_gcm_dec_128_kernel__not_interleaved.c"
+    #undef aes_gcm_dec_128_kernel
+    #define aes_gcm_dec_192_kernel aes_gcm_dec_192_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_big/aes_gcm/dec/aes_gcm_dec_192_kernel__not_interleaved.c"
+    #undef aes_gcm_dec_192_kernel
+    #define aes_gcm_dec_256_kernel aes_gcm_dec_256_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_big/aes_gcm/dec/aes_gcm_dec_256_kernel__not_interleaved.c"
+    #undef aes_gcm_dec_256_kernel
+    #define STAGES_NOT_INTERLEAVED { aes_gcm_enc_128_kernel__not_interleaved, aes_gcm_enc_192_kernel__not_interleaved, aes_gcm_enc_256_kernel__not_interleaved }, \
+                                   { aes_gcm_dec_128_kernel__not_interleaved, aes_gcm_dec_192_kernel__not_interleaved, aes_gcm_dec_256_kernel__not_interleaved }
+#elif defined PERF_GCM_BIGGER
+    #define STAGES_BUILT_IN_VARIANT "interleaved"
+    #define aes_gcm_enc_128_kernel aes_gcm_enc_128_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/enc/aes_gcm_enc_128_kernel__not_interleaved.c"
+    #undef aes_gcm_enc_128_kernel
+    #define aes_gcm_enc_192_kernel aes_gcm_enc_192_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/enc/aes_gcm_enc_192_kernel__not_interleaved.c"
+    #undef aes_gcm_enc_192_kernel
+    #define aes_gcm_enc_256_kernel aes_gcm_enc_256_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/enc/aes_gcm_enc_256_kernel__not_interleaved.c"
+    #undef aes_gcm_enc_256_kernel
+    #define aes_gcm_dec_128_kernel aes_gcm_dec_128_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/dec/aes_gcm_dec_128_kernel__not_interleaved.c"
+    #undef aes_gcm_dec_128_kernel
+    #define aes_gcm_dec_192_kernel aes_gcm_dec_192_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/dec/aes_gcm_dec_192_kernel__not_interleaved.c"
+    #undef aes_gcm_dec_192_kernel
+    #define aes_gcm_dec_256_kernel aes_gcm_dec_256_kernel__not_interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/dec/aes_gcm_dec_256_kernel__not_interleaved.c"
+    #undef aes_gcm_dec_256_kernel
+    #define STAGES_NOT_INTERLEAVED { aes_gcm_enc_128_kernel__not_interleaved, aes_gcm_enc_192_kernel__not_interleaved, aes_gcm_enc_256_kernel__not_interleaved }, \
+                                   { aes_gcm_dec_128_kernel__not_interleaved, aes_gcm_dec_192_kernel__not_interleaved, aes_gcm_dec_256_kernel__not_interleaved }
+    //// the EOR3 variants need the SHA3 extension, e.g. -march=armv8.2-a+simd+crypto+sha3
+    #if defined __ARM_FEATURE_SHA3
+    #define aes_gcm_enc_128_kernel aes_gcm_enc_128_kernel_EOR3__interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/enc/aes_gcm_enc_128_kernel_EOR3__interleaved.c"
+    #undef aes_gcm_enc_128_kernel
+    #define aes_gcm_enc_192_kernel aes_gcm_enc_192_kernel_EOR3__interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/enc/aes_gcm_enc_192_kernel_EOR3__interleaved.c"
+    #undef aes_gcm_enc_192_kernel
+    #define aes_gcm_enc_256_kernel aes_gcm_enc_256_kernel_EOR3__interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/enc/aes_gcm_enc_256_kernel_EOR3__interleaved.c"
+    #undef aes_gcm_enc_256_kernel
+    #define aes_gcm_dec_128_kernel aes_gcm_dec_128_kernel_EOR3__interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/dec/aes_gcm_dec_128_kernel_EOR3__interleaved.c"
+    #undef aes_gcm_dec_128_kernel
+    #define aes_gcm_dec_192_kernel aes_gcm_dec_192_kernel_EOR3__interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/dec/aes_gcm_dec_192_kernel_EOR3__interleaved.c"
+    #undef aes_gcm_dec_192_kernel
+    #define aes_gcm_dec_256_kernel aes_gcm_dec_256_kernel_EOR3__interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/dec/aes_gcm_dec_256_kernel_EOR3__interleaved.c"
+    #undef aes_gcm_dec_256_kernel
+    #define STAGES_EOR3_INTERLEAVED { aes_gcm_enc_128_kernel_EOR3__interleaved, aes_gcm_enc_192_kernel_EOR3__interleaved, aes_gcm_enc_256_kernel_EOR3__interleaved }, \
+                                    { aes_gcm_dec_128_kernel_EOR3__interleaved, aes_gcm_dec_192_kernel_EOR3__interleaved, aes_gcm_dec_256_kernel_EOR3__interleaved }
+    #endif
+#elif defined PERF_GCM_BIGGEREOR3
+    #define STAGES_BUILT_IN_VARIANT "EOR3_interleaved"
+#else
+    #define STAGES_BUILT_IN_VARIANT "generic"
+#endif
+
+#if defined PERF_GCM_BIGGEREOR3 || (defined PERF_GCM_BIGGER && defined __ARM_FEATURE_SHA3)
+    #define aes_gcm_enc_128_kernel aes_gcm_enc_128_kernel_EOR3__not_interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/enc/aes_gcm_enc_128_kernel_EOR3__not_interleaved.c"
+    #undef aes_gcm_enc_128_kernel
+    #define aes_gcm_enc_192_kernel aes_gcm_enc_192_kernel_EOR3__not_interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/enc/aes_gcm_enc_192_kernel_EOR3__not_interleaved.c"
+    #undef aes_gcm_enc_192_kernel
+    #define aes_gcm_enc_256_kernel aes_gcm_enc_256_kernel_EOR3__not_interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/enc/aes_gcm_enc_256_kernel_EOR3__not_interleaved.c"
+    #undef aes_gcm_enc_256_kernel
+    #define aes_gcm_dec_128_kernel aes_gcm_dec_128_kernel_EOR3__not_interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/dec/aes_gcm_dec_128_kernel_EOR3__not_interleaved.c"
+    #undef aes_gcm_dec_128_kernel
+    #define aes_gcm_dec_192_kernel aes_gcm_dec_192_kernel_EOR3__not_interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/dec/aes_gcm_dec_192_kernel_EOR3__not_interleaved.c"
+    #undef aes_gcm_dec_192_kernel
+    #define aes_gcm_dec_256_kernel aes_gcm_dec_256_kernel_EOR3__not_interleaved
+    #include "AArch64cryptolib_opt_bigger/aes_gcm/dec/aes_gcm_dec_256_kernel_EOR3__not_interleaved.c"
+    #undef aes_gcm_dec_256_kernel
+    #define STAGES_EOR3_NOT_INTERLEAVED { aes_gcm_enc_128_kernel_EOR3__not_interleaved, aes_gcm_enc_192_kernel_EOR3__not_interleaved, aes_gcm_enc_256_kernel_EOR3__not_interleaved }, \
+                                        { aes_gcm_dec_128_kernel_EOR3__not_interleaved, aes_gcm_dec_192_kernel_EOR3__not_interleaved, aes_gcm_dec_256_kernel_EOR3__not_interleaved }
+#endif
+
+#define STAGES_MAX_SIZES    16
+#define STAGES_MAX_BYTES    (1 << 20)
+
+typedef operation_result_t (*merged_kernel_t)(uint8_t * input, uint64_t input_length, cipher_state_t * restrict cs, uint8_t * output);
+typedef operation_result_t (*ctr_kernel_t)(uint64_t block_count, cipher_state_t * restrict cs, uint8_t * restrict blocks);
+
+//// A merged kernel variant, indexed by key size - NULL where there's no such variant
+typedef struct stage_variant {
+    const char * name;
+    merged_kernel_t enc[3];
+    merged_kernel_t dec[3];
+} stage_variant_t;
+
+static const stage_variant_t stage_variants[] = {
+    { STAGES_BUILT_IN_VARIANT,
+      { aes_gcm_enc_128_kernel, aes_gcm_enc_192_kernel, aes_gcm_enc_256_kernel },
+      { aes_gcm_dec_128_kernel, aes_gcm_dec_192_kernel, aes_gcm_dec_256_kernel } },
+#ifdef STAGES_NOT_INTERLEAVED
+    { "not_interleaved", STAGES_NOT_INTERLEAVED },
+#endif
+#ifdef STAGES_EOR3_INTERLEAVED
+    { "EOR3_interleaved", STAGES_EOR3_INTERLEAVED },
+#endif
+#ifdef STAGES_EOR3_NOT_INTERLEAVED
+    { "EOR3_not_interleaved", STAGES_EOR3_NOT_INTERLEAVED },
+#endif
+};
+
+#define STAGES_VARIANT_COUNT (sizeof(stage_variants) / sizeof(stage_variants[0]))
+
+static const ctr_kernel_t ctr_kernels[3] = { aes_ctr_blk_128_kernel, aes_ctr_blk_192_kernel, aes_ctr_blk_256_kernel };
+static const cipher_mode_t stage_modes[3] = { AES_GCM_128, AES_GCM_192, AES_GCM_256 };
+static const uint32_t stage_key_bits[3] = { 128, 192, 256 };
+static const uint32_t stage_rounds[3] = { 10, 12, 14 };
+
+typedef struct stages_options {
+    bool key_sizes[3];
+    uint32_t sizes[STAGES_MAX_SIZES];
+    uint32_t size_count;
+    uint64_t bytes_per_trial;
+    double aese_per_cycle;      // AESE throughput of the core, 0 if not given
+    double pmull_per_cycle;     // PMULL throughput of the core, 0 if not given
+    timing_options_t timing;
+} stages_options_t;
+
+typedef enum stage_kind { STAGE_GHASH, STAGE_CTR, STAGE_ENC, STAGE_DEC } stage_kind_t;
+
+typedef struct stage_buffers {
+    uint8_t * input;
+    uint8_t * output;
+    cipher_constants_t cc;
+    quadword_t counter;
+} stage_buffers_t;
+
+//// Each run starts from the same counter and tag, so every stage sees identical state and data
+static inline operation_result_t run_stage(stage_kind_t kind, uint32_t key, merged_kernel_t kernel, uint64_t count,
+                                           uint32_t bytes, stage_buffers_t * b, cipher_state_t * cs)
+{
+    operation_result_t result = SUCCESSFUL_OPERATION;
+    for(uint64_t i=0; i<count; ++i) {
+        cs->counter = b->counter;
+        cs->current_tag.d[0] = 0;
+        cs->current_tag.d[1] = 0;
+        switch(kind)
+        {
+            case STAGE_GHASH:
+                result |= ghash_kernel(b->input, (uint64_t) bytes*8, cs);
+                break;
+            case STAGE_CTR:
+                result |= ctr_kernels[key]((bytes + 15) / 16, cs, b->output);
+                break;
+            default:
+                result |= kernel(b->input, (uint64_t) bytes*8, cs, b->output);
+                break;
+        }
+    }
+    return result;
+}
+
+static inline uint64_t runs_for(const stages_options_t * options, uint32_t bytes)
+{
+    uint64_t runs = options->bytes_per_trial / bytes;
+    return runs ? runs : 1;
+}
+
+void time_stage(const stages_options_t * options, stage_kind_t kind, uint32_t key, merged_kernel_t kernel,
+                uint32_t bytes, stage_buffers_t * b, timing_result_t * timing)
+{
+    cipher_state_t cs = { .constants = &b->cc };
+    timing_counters_t counters;
+    timing_sample_t samples[TIMING_MAX_TRIALS];
+    uint64_t runs = runs_for(options, bytes);
+    uint64_t warmup_count = timing_warmup_count(&options->timing, (runs+9)/10);
+    operation_result_t result = run_stage(kind, key, kernel, warmup_count, bytes, b, &cs);
+    timing_counters_open(&counters, options->timing.use_pmu);
+    for(uint32_t trial=0; trial<options->timing.trials; ++trial) {
+        timing_start(&counters, &samples[trial]);
+        result |= run_stage(kind, key, kernel, runs, bytes, b, &cs);
+        timing_stop(&counters, &samples[trial]);
+    }
+    timing_counters_close(&counters);
+    timing->bytes = bytes;
+    timing->success = (result == SUCCESSFUL_OPERATION);
+    timing_summarize(samples, options->timing.trials, runs, timing);
+}
+
+//// Check a merged kernel variant gives the same output and tag as the built in one
+bool check_variant(merged_kernel_t kernel, merged_kernel_t reference, uint32_t bytes, stage_buffers_t * b)
+{
+    cipher_state_t cs = { .constants = &b->cc };
+    uint8_t * expected = malloc(bytes + 16);
+    quadword_t expected_tag;
+    cs.counter = b->counter;
+    cs.current_tag.d[0] = 0;
+    cs.current_tag.d[1] = 0;
+    reference(b->input, (uint64_t) bytes*8, &cs, expected);
+    expected_tag = cs.current_tag;
+    cs.counter = b->counter;
+    cs.current_tag.d[0] = 0;
+    cs.current_tag.d[1] = 0;
+    kernel(b->input, (uint64_t) bytes*8, &cs, b->output);
+    bool match = (memcmp(expected, b->output, bytes) == 0) &&
+                 (expected_tag.d[0] == cs.current_tag.d[0]) && (expected_tag.d[1] == cs.current_tag.d[1]);
+    free(expected);
+    return match;
+}
+
+//// Bytes/cycle bound from the AESE and PMULL throughput given for the core - each block
+//// needs one AESE per round and three PMULLs (Karatsuba), plus two PMULLs for each reduction
+static inline double aese_bound(const stages_options_t * options, uint32_t key)
+{
+    return options->aese_per_cycle > 0.0 ? 16.0 * options->aese_per_cycle / stage_rounds[key] : 0.0;
+}
+
+static inline double pmull_bound(const stages_options_t * options)
+{
+    return options->pmull_per_cycle > 0.0 ? 16.0 * options->pmull_per_cycle / (3.0 + 2.0 / MAX_UNROLL_FACTOR) : 0.0;
+}
+
+void report_begin(timing_format_t format)
+{
+    if(format == TIMING_FORMAT_CSV) {
+        printf("key_bits,bytes,stage,variant,runs,trials,ns_per_run,ns_per_run_stddev,gbps,cycles_per_run,bytes_per_cycle,"
+               "stitching_efficiency,speedup_over_separate,bound_bytes_per_cycle,fraction_of_bound,result\n");
+    } else if(format == TIMING_FORMAT_JSON) {
+        printf("[");
+    }
+}
+
+void report_end(timing_format_t format)
+{
+    if(format == TIMING_FORMAT_JSON) {
+        printf("\n]\n");
+    }
+}
+
+//// For merged kernels ghash and ctr are the two halves, timed separately on the same data - stitching
+//// efficiency is the slower half over the merged kernel (1.0 is perfect overlap), and speedup is the
+//// two halves run one after the other over the merged kernel
+void report(const stages_options_t * options, uint32_t key, const char * stage, const char * variant,
+            const timing_result_t * timing, const timing_result_t * ghash, const timing_result_t * ctr,
+            double bound, bool match, uint64_t index)
+{
+    double gbps = timing_gbps(timing);
+    double bytes_per_cycle = (timing->cycles_per_run > 0.0) ? timing->bytes / timing->cycles_per_run : 0.0;
+    double efficiency = 0.0, speedup = 0.0;
+    if(ghash != NULL && ctr != NULL && timing->ns_per_run > 0.0) {
+        double slower = (ghash->ns_per_run > ctr->ns_per_run) ? ghash->ns_per_run : ctr->ns_per_run;
+        efficiency = slower / timing->ns_per_run;
+        speedup = (ghash->ns_per_run + ctr->ns_per_run) / timing->ns_per_run;
+    }
+    double fraction = (bound > 0.0 && bytes_per_cycle > 0.0) ? bytes_per_cycle / bound : 0.0;
+    bool success = timing->success && match;
+
+    switch(options->timing.format)
+    {
+        case TIMING_FORMAT_CSV:
+            printf("%u,%lu,%s,%s,%lu,%u,%.2f,%.2f,%.3f,%.2f,%.4f,%.3f,%.3f,%.4f,%.3f,%s\n",
+                   stage_key_bits[key], timing->bytes, stage, variant, timing->runs, timing->trials,
+                   timing->ns_per_run, timing->ns_per_run_stddev, gbps, timing->cycles_per_run, bytes_per_cycle,
+                   efficiency, speedup, bound, fraction, success ? "Success" : "Failure");
+            break;
+        case TIMING_FORMAT_JSON:
+            printf("%s\n  {\"key_bits\": %u, \"bytes\": %lu, \"stage\": \"%s\", \"variant\": \"%s\", \"runs\": %lu, "
+                   "\"trials\": %u, \"ns_per_run\": %.2f, \"ns_per_run_stddev\": %.2f, \"gbps\": %.3f, "
+                   "\"cycles_per_run\": %.2f, \"bytes_per_cycle\": %.4f, \"stitching_efficiency\": %.3f, "
+                   "\"speedup_over_separate\": %.3f, \"bound_bytes_per_cycle\": %.4f, \"fraction_of_bound\": %.3f, "
+                   "\"success\": %s}",
+                   index ? "," : "", stage_key_bits[key], timing->bytes, stage, variant, timing->runs, timing->trials,
+                   timing->ns_per_run, timing->ns_per_run_stddev, gbps, timing->cycles_per_run, bytes_per_cycle,
+                   efficiency, speedup, bound, fraction, success ? "true" : "false");
+            break;
+        default:
+            printf("  %-6s %-22s %9.3f Gb/s", stage, variant, gbps);
+            if(bytes_per_cycle > 0.0) printf(" %7.4f B/cycle", bytes_per_cycle);
+            if(efficiency > 0.0) printf("  stitching %5.1f%%, %.2fx separate", 100.0 * efficiency, speedup);
+            if(fraction > 0.0) printf("  %5.1f%% of bound", 100.0 * fraction);
+            printf("  %s\n", success ? "Success" : "Failure");
+            break;
+    }
+}
+
+int run_stages(const stages_options_t * options)
+{
+    stage_buffers_t b;
+    uint32_t largest = 0;
+    for(uint32_t s=0; s<options->size_count; ++s) {
+        if(options->sizes[s] > largest) largest = options->sizes[s];
+    }
+    b.input = aligned_alloc(64, largest + 64);
+    b.output = aligned_alloc(64, largest + 64);
+    uint8_t key_bytes[32];
+    uint8_t nonce[16] = { 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88 };
+    for(uint32_t i=0; i<sizeof(key_bytes); ++i) key_bytes[i] = (uint8_t) (i * 29 + 7);
+    for(uint32_t i=0; i<largest + 64; ++i) b.input[i] = (uint8_t) (i * 13 + 5);
+    uint64_t report_index = 0;
+
+    if(options->timing.format == TIMING_FORMAT_TEXT) {
+        printf("GHASH unroll factor %u, %u merged kernel variant%s\n", MAX_UNROLL_FACTOR,
+               (uint32_t) STAGES_VARIANT_COUNT, STAGES_VARIANT_COUNT > 1 ? "s" : "");
+    }
+    report_begin(options->timing.format);
+    for(uint32_t key=0; key<3; ++key) {
+        if(!options->key_sizes[key]) continue;
+        cipher_state_t cs = { .constants = &b.cc };
+        armv8_aes_gcm_set_constants(stage_modes[key], 16, key_bytes, &b.cc);
+        armv8_aes_gcm_set_counter(nonce, 96, &cs);
+        b.counter = cs.counter;
+        double bound_ctr = aese_bound(options, key);
+        double bound_ghash = pmull_bound(options);
+        double bound_merged = (bound_ctr > 0.0 && bound_ghash > 0.0) ? (bound_ctr < bound_ghash ? bound_ctr : bound_ghash) : 0.0;
+
+        for(uint32_t s=0; s<options->size_count; ++s) {
+            uint32_t bytes = options->sizes[s];
+            timing_result_t ghash = {0}, ctr = {0};
+            if(options->timing.format == TIMING_FORMAT_TEXT) {
+                printf("AES-GCM-%u, %u bytes\n", stage_key_bits[key], bytes);
+            }
+            time_stage(options, STAGE_GHASH, key, NULL, bytes, &b, &ghash);
+            report(options, key, "ghash", "-", &ghash, NULL, NULL, bound_ghash, true, report_index++);
+            time_stage(options, STAGE_CTR, key, NULL, bytes, &b, &ctr);
+            report(options, key, "ctr", "-", &ctr, NULL, NULL, bound_ctr, true, report_index++);
+            for(uint32_t v=0; v<STAGES_VARIANT_COUNT; ++v) {
+                for(stage_kind_t kind=STAGE_ENC; kind<=STAGE_DEC; ++kind) {
+                    merged_kernel_t kernel = (kind == STAGE_ENC) ? stage_variants[v].enc[key] : stage_variants[v].dec[key];
+                    merged_kernel_t reference = (kind == STAGE_ENC) ? stage_variants[0].enc[key] : stage_variants[0].dec[key];
+                    if(kernel == NULL) continue;
+                    timing_result_t merged = {0};
+                    bool match = check_variant(kernel, reference, bytes, &b);
+                    time_stage(options, kind, key, kernel, bytes, &b, &merged);
+                    report(options, key, (kind == STAGE_ENC) ? "enc" : "dec", stage_variants[v].name, &merged,
+                           &ghash, &ctr, bound_merged, match, report_index++);
+                }
+            }
+        }
+    }
+    report_end(options->timing.format);
+
+    free(b.input);
+    free(b.output);
+    return 0;
+}
+
+//// Parse a comma separated list of sizes, returning the number parsed
+uint32_t parse_sizes(const char * list, uint32_t * sizes)
+{
+    uint32_t count = 0;
+    const char * p = list;
+    while(*p && count < STAGES_MAX_SIZES) {
+        char * end;
+        uint64_t size = strtoul(p, &end, 10);
+        if(end == p) break;
+        if(size == 0 || size > STAGES_MAX_BYTES) {
+            printf("Ignoring size %lu - sizes must be up to %u bytes\n", size, STAGES_MAX_BYTES);
+        } else {
+            sizes[count++] = (uint32_t) size;
+        }
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    stages_options_t options = {
+        .key_sizes = { true, true, true },
+        .sizes = { 256, 1024, 4096, 16384 },
+        .size_count = 4,
+        .bytes_per_trial = 16ul << 20,
+        .timing = TIMING_DEFAULT_OPTIONS };
+
+    for(int i=1; i<argc; ) {
+        int consumed = timing_parse_option(argc, argv, i, &options.timing);
+        if(consumed) {
+            i += consumed;
+            continue;
+        }
+        if(i+1 >= argc) {
+            printf("Unknown or incomplete option %s\n", argv[i]);
+            return 1;
+        }
+        if(strcmp(argv[i], "--sizes") == 0) {
+            options.size_count = parse_sizes(argv[i+1], options.sizes);
+        } else if(strcmp(argv[i], "--bytes-per-trial") == 0) {
+            options.bytes_per_trial = strtoull(argv[i+1], NULL, 10);
+            if(options.bytes_per_trial == 0) options.bytes_per_trial = 1;
+        } else if(strcmp(argv[i], "--key-length") == 0) {
+            uint32_t bits = (uint32_t) strtoul(argv[i+1], NULL, 10);
+            options.key_sizes[0] = (bits == 128);
+            options.key_sizes[1] = (bits == 192);
+            options.key_sizes[2] = (bits == 256);
+        } else if(strcmp(argv[i], "--aese-per-cycle") == 0) {
+            options.aese_per_cycle = strtod(argv[i+1], NULL);
+        } else if(strcmp(argv[i], "--pmull-per-cycle") == 0) {
+            options.pmull_per_cycle = strtod(argv[i+1], NULL);
+        } else {
+            printf("Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        i += 2;
+    }
+
+    return run_stages(&options);
+}
@@ -0,0 +1,180 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Chunked stream format
+//// Streams of various lengths are sealed chunk by chunk in reverse order and opened in order, and must round trip
+//// Reordered, truncated and extended streams, a changed header, and a chunk opened with the wrong last flag must fail
+//// A stream cut short inside its last chunk, leaving no room for the tag, must be rejected before any chunk is opened
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "AArch64cryptolib.h"
+
+#define operation_result_t  armv8_operation_result_t
+#define stream_context_t    armv8_stream_context_t
+
+#define STREAM_CHUNK_BYTES  1024
+#define STREAM_MAX_BYTES    (8 * STREAM_CHUNK_BYTES + 7)
+#define STREAM_STORED_BYTES (STREAM_CHUNK_BYTES + ARMV8_STREAM_TAG_BYTES)
+
+static uint8_t key[32] = { 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+                           0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 };
+static uint8_t nonce_prefix[ARMV8_STREAM_NONCE_PREFIX_BYTES] = { 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb };
+
+static uint64_t chunk_count(uint64_t byte_length)
+{
+    return byte_length ? (byte_length + STREAM_CHUNK_BYTES - 1) / STREAM_CHUNK_BYTES : 1;
+}
+
+// Seal into header | chunk | tag | chunk | tag ..., returning the stored length
+static uint64_t seal_stream(armv8_cipher_mode_t mode, uint8_t * plaintext, uint64_t byte_length, uint8_t * stream)
+{
+    stream_context_t ctx;
+    armv8_stream_init_seal(&ctx, mode, key, nonce_prefix, STREAM_CHUNK_BYTES);
+    memcpy(stream, ctx.header, ARMV8_STREAM_HEADER_BYTES);
+    uint64_t n = chunk_count(byte_length);
+    for( uint64_t i=n; i-- > 0; )
+    {
+        uint64_t chunk_bytes = (i + 1 == n) ? byte_length - i * STREAM_CHUNK_BYTES : STREAM_CHUNK_BYTES;
+        uint8_t * out = stream + ARMV8_STREAM_HEADER_BYTES + i * STREAM_STORED_BYTES;
+        armv8_stream_seal_chunk(&ctx, i, i + 1 == n, plaintext + i * STREAM_CHUNK_BYTES, chunk_bytes*8,
+                                out, out + chunk_bytes);
+    }
+    return ARMV8_STREAM_HEADER_BYTES + (n - 1) * STREAM_STORED_BYTES + (byte_length - (n - 1) * STREAM_CHUNK_BYTES) +
+           ARMV8_STREAM_TAG_BYTES;
+}
+
+// Open a stored stream the way a reader would, taking the chunk at the end as the last
+static operation_result_t open_stream(uint8_t * stream, uint64_t stored_bytes, uint8_t * plaintext, uint64_t * byte_length)
+{
+    stream_context_t ctx;
+    operation_result_t result = armv8_stream_init_open(&ctx, key, stream);
+    if(result != SUCCESSFUL_OPERATION) {
+        return result;
+    }
+    uint64_t body = stored_bytes - ARMV8_STREAM_HEADER_BYTES;
+    uint64_t n = (body + STREAM_STORED_BYTES - 1) / STREAM_STORED_BYTES;
+    // a last chunk must hold its tag, and a last chunk of just a tag only ends an empty stream
+    uint64_t last_stored = body % STREAM_STORED_BYTES;
+    if(n > 1 && last_stored != 0 && last_stored <= ARMV8_STREAM_TAG_BYTES) {
+        return INVALID_PARAMETER;
+    }
+    *byte_length = 0;
+    for( uint64_t i=0; i<n && result == SUCCESSFUL_OPERATION; ++i )
+    {
+        uint8_t * in = stream + ARMV8_STREAM_HEADER_BYTES + i * STREAM_STORED_BYTES;
+        uint64_t chunk_bytes = ((i + 1 == n) ? body - i * STREAM_STORED_BYTES : STREAM_STORED_BYTES) - ARMV8_STREAM_TAG_BYTES;
+        result = armv8_stream_open_chunk(&ctx, i, i + 1 == n, in, chunk_bytes*8, in + chunk_bytes, plaintext + *byte_length);
+        *byte_length += chunk_bytes;
+    }
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    static const uint64_t lengths[] = { 0, 1, 15, 16, STREAM_CHUNK_BYTES - 1, STREAM_CHUNK_BYTES, STREAM_CHUNK_BYTES + 1,
+                                        3 * STREAM_CHUNK_BYTES, STREAM_MAX_BYTES };
+    uint8_t plaintext[STREAM_MAX_BYTES], decrypted[STREAM_MAX_BYTES];
+    uint8_t stream[ARMV8_STREAM_HEADER_BYTES + 9 * STREAM_STORED_BYTES];
+    uint8_t tampered[sizeof(stream) + STREAM_STORED_BYTES];
+    bool passed = true;
+
+    for( uint32_t i=0; i<sizeof(plaintext); ++i ) plaintext[i] = (uint8_t) (i * 29 + 3);
+
+    for( armv8_cipher_mode_t mode = AES_GCM_128; mode <= AES_GCM_256; ++mode )
+    {
+        for( uint32_t l=0; l<sizeof(lengths)/sizeof(lengths[0]); ++l )
+        {
+            uint64_t byte_length = lengths[l], opened_length;
+            uint64_t stored = seal_stream(mode, plaintext, byte_length, stream);
+            if(open_stream(stream, stored, decrypted, &opened_length) != SUCCESSFUL_OPERATION ||
+               opened_length != byte_length || memcmp(decrypted, plaintext, byte_length) != 0) {
+                printf("Round trip failed: mode %d, %lu bytes\n", mode, byte_length);
+                passed = false;
+                continue;
+            }
+            uint64_t n = chunk_count(byte_length);
+
+            // header bit flipped, in the nonce prefix and in a reserved byte
+            for( uint32_t b=12; b<ARMV8_STREAM_HEADER_BYTES; b+=19 )
+            {
+                memcpy(tampered, stream, stored);
+                tampered[b] ^= 1;
+                if(open_stream(tampered, stored, decrypted, &opened_length) == SUCCESSFUL_OPERATION) {
+                    printf("Changed header byte %u not caught: mode %d, %lu bytes\n", b, mode, byte_length);
+                    passed = false;
+                }
+            }
+            if(n < 2) continue;
+
+            // truncated at a chunk boundary - the new last chunk was not sealed as the last
+            if(open_stream(stream, stored - (stored - ARMV8_STREAM_HEADER_BYTES - (n - 1) * STREAM_STORED_BYTES),
+                           decrypted, &opened_length) != AUTHENTICATION_FAILURE) {
+                printf("Truncated stream not caught: mode %d, %lu bytes\n", mode, byte_length);
+                passed = false;
+            }
+            // truncated inside the last chunk, leaving it too short to hold its tag or just a tag
+            static const uint64_t kept[] = { 1, ARMV8_STREAM_TAG_BYTES - 1, ARMV8_STREAM_TAG_BYTES };
+            for( uint32_t k=0; k<sizeof(kept)/sizeof(kept[0]); ++k )
+            {
+                uint64_t truncated = ARMV8_STREAM_HEADER_BYTES + (n - 1) * STREAM_STORED_BYTES + kept[k];
+                if(open_stream(stream, truncated, decrypted, &opened_length) != INVALID_PARAMETER) {
+                    printf("Stream truncated to %lu bytes of its last chunk not rejected: mode %d, %lu bytes\n",
+                           kept[k], mode, byte_length);
+                    passed = false;
+                }
+            }
+            // extended with a copy of the first chunk
+            memcpy(tampered, stream, stored);
+            memcpy(tampered + stored, stream + ARMV8_STREAM_HEADER_BYTES, STREAM_STORED_BYTES);
+            if(open_stream(tampered, stored + STREAM_STORED_BYTES, decrypted, &opened_length) != AUTHENTICATION_FAILURE) {
+                printf("Extended stream not caught: mode %d, %lu bytes\n", mode, byte_length);
+                passed = false;
+            }
+            // first two chunks swapped
+            if(n > 2) {
+                memcpy(tampered, stream, stored);
+                memcpy(tampered + ARMV8_STREAM_HEADER_BYTES, stream + ARMV8_STREAM_HEADER_BYTES + STREAM_STORED_BYTES,
+                       STREAM_STORED_BYTES);
+                memcpy(tampered + ARMV8_STREAM_HEADER_BYTES + STREAM_STORED_BYTES, stream + ARMV8_STREAM_HEADER_BYTES,
+                       STREAM_STORED_BYTES);
+                if(open_stream(tampered, stored, decrypted, &opened_length) != AUTHENTICATION_FAILURE) {
+                    printf("Reordered chunks not caught: mode %d, %lu bytes\n", mode, byte_length);
+                    passed = false;
+                }
+            }
+        }
+    }
+
+    // Parameters
+    stream_context_t ctx;
+    if(armv8_stream_init_seal(&ctx, AES_GCM_128, key, nonce_prefix, 1000) != INVALID_PARAMETER ||
+       armv8_stream_init_seal(&ctx, AES_GCM_128, key, nonce_prefix, 0) != INVALID_PARAMETER) {
+        printf("Invalid chunk length was not rejected\n");
+        passed = false;
+    }
+    armv8_stream_init_seal(&ctx, AES_GCM_128, key, nonce_prefix, STREAM_CHUNK_BYTES);
+    uint8_t tag[16];
+    if(armv8_stream_seal_chunk(&ctx, 0, 0, plaintext, (STREAM_CHUNK_BYTES - 16)*8, decrypted, tag) != INVALID_PARAMETER ||
+       armv8_stream_seal_chunk(&ctx, 0, 1, plaintext, (STREAM_CHUNK_BYTES + 16)*8, decrypted, tag) != INVALID_PARAMETER ||
+       armv8_stream_seal_chunk(&ctx, ARMV8_STREAM_MAX_CHUNKS, 1, plaintext, 8, decrypted, tag) != INVALID_PARAMETER) {
+        printf("Chunk of the wrong length or index was not rejected\n");
+        passed = false;
+    }
+    memcpy(tampered, ctx.header, ARMV8_STREAM_HEADER_BYTES);
+    tampered[0] = 'X';
+    if(armv8_stream_init_open(&ctx, key, tampered) != INVALID_PARAMETER) {
+        printf("Invalid header was not rejected\n");
+        passed = false;
+    }
+
+    if(!passed) {
+        printf("Failed\n");
+        return 1;
+    }
+    printf("Success\n");
+    return 0;
+}
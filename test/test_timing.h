@@ -0,0 +1,516 @@
+//Copyright (c) 2023, ARM Limited. All rights reserved.
+//
+//SPDX-License-Identifier:        BSD-3-Clause
+
+//// Timing helpers shared by the speed tests
+//// - wall time from clock_gettime and the generic timer (CNTVCT_EL0)
+//// - CPU cycles from the PMU through perf_event_open, where the kernel allows it
+//// - optionally, the Arm PMU events for top-down analysis (stalls, cache refills, SIMD and crypto ops)
+//// - median/stddev over repeated trials, and reporting as text, CSV or JSON
+
+#ifndef TEST_TIMING_H
+#define TEST_TIMING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define TIMING_MAX_TRIALS 101
+#define TIMING_WARMUP_DEFAULT UINT64_MAX        // warmup_count when --warmup isn't given, so that 0 means no warm-up
+
+//// Arm PMUv3 common events read in profile mode, as raw event numbers
+typedef enum timing_event {
+    TIMING_EVENT_INST_RETIRED,
+    TIMING_EVENT_STALL_FRONTEND,
+    TIMING_EVENT_STALL_BACKEND,
+    TIMING_EVENT_L1I_CACHE_REFILL,
+    TIMING_EVENT_L1D_CACHE_REFILL,
+    TIMING_EVENT_ASE_SPEC,
+    TIMING_EVENT_CRYPTO_SPEC,
+    TIMING_EVENT_COUNT
+} timing_event_t;
+
+static const char * timing_event_names[TIMING_EVENT_COUNT] = {
+    "inst_retired",
+    "stall_frontend",
+    "stall_backend",
+    "l1i_cache_refill",
+    "l1d_cache_refill",
+    "ase_spec",
+    "crypto_spec",
+};
+
+static const uint64_t timing_event_numbers[TIMING_EVENT_COUNT] = { 0x08, 0x23, 0x24, 0x01, 0x03, 0x74, 0x77 };
+
+typedef enum timing_format { TIMING_FORMAT_TEXT, TIMING_FORMAT_CSV, TIMING_FORMAT_JSON } timing_format_t;
+
+typedef struct timing_options {
+    uint64_t warmup_count;      // runs before the timed trials, TIMING_WARMUP_DEFAULT for the test's default
+    uint32_t trials;            // timed trials of test_count runs each
+    timing_format_t format;
+    bool use_pmu;               // try to count cycles with perf_event_open
+    bool profile;               // also read the top-down events, for the tests with a profile mode
+} timing_options_t;
+
+#define TIMING_DEFAULT_OPTIONS { .warmup_count = TIMING_WARMUP_DEFAULT, .trials = 5, .format = TIMING_FORMAT_TEXT, .use_pmu = true, .profile = false }
+
+typedef struct timing_counters {
+    int cycles_fd;              // -1 if cycles are not available
+    int event_fds[TIMING_EVENT_COUNT];      // -1 if not profiling or the event is not available
+} timing_counters_t;
+
+typedef struct timing_sample {
+    uint64_t ns;
+    uint64_t ticks;
+    uint64_t cycles;
+    double events[TIMING_EVENT_COUNT];      // scaled for multiplexing, -1 if not available
+} timing_sample_t;
+
+// One row of results - all per run values are medians over the trials
+typedef struct timing_result {
+    const char * name;          // reference file or other label
+    const char * mode;          // e.g. AES-GCM-128
+    const char * operation;     // encrypt or decrypt
+    const char * variant;       // e.g. Generic or IPsec
+    uint64_t bytes;             // bytes processed per run
+    uint64_t runs;              // runs per trial
+    uint32_t trials;
+    double ns_per_run;
+    double ns_per_run_stddev;
+    double ticks_per_run;
+    double cycles_per_run;      // 0 if cycles are not available
+    bool profiled;
+    double events_per_run[TIMING_EVENT_COUNT];  // -1 if not available
+    bool success;
+} timing_result_t;
+
+static inline uint64_t timing_now_ns(void)
+{
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC_RAW
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+// Generic timer count - the isb stops the read being hoisted above the code being timed
+static inline uint64_t timing_now_ticks(void)
+{
+#if defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0" : "=r" (ticks) : : "memory");
+    return ticks;
+#else
+    return timing_now_ns();
+#endif
+}
+
+static inline uint64_t timing_tick_frequency(void)
+{
+#if defined(__aarch64__)
+    uint64_t frequency;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r" (frequency));
+    return frequency;
+#else
+    return 1000000000ull;
+#endif
+}
+
+static inline void timing_counters_open(timing_counters_t * counters, bool use_pmu)
+{
+    counters->cycles_fd = -1;
+    for(uint32_t e=0; e<TIMING_EVENT_COUNT; ++e) counters->event_fds[e] = -1;
+#ifdef __linux__
+    if(use_pmu) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        counters->cycles_fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#else
+    (void) use_pmu;
+#endif
+}
+
+//// Open the top-down events on top of the cycle counter. Each event is opened on its own rather
+//// than as a group, so if there are more events than counters the kernel multiplexes them and
+//// the counts are scaled up by the time each was running. Events the core or kernel doesn't
+//// support (or any event when not on AArch64, e.g. under emulation) are left unavailable
+static inline void timing_profile_open(timing_counters_t * counters)
+{
+#if defined(__linux__) && defined(__aarch64__)
+    for(uint32_t e=0; e<TIMING_EVENT_COUNT; ++e) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_RAW;
+        attr.size = sizeof(attr);
+        attr.config = timing_event_numbers[e];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        counters->event_fds[e] = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#else
+    (void) counters;
+#endif
+}
+
+static inline bool timing_profile_available(const timing_counters_t * counters)
+{
+    for(uint32_t e=0; e<TIMING_EVENT_COUNT; ++e) {
+        if(counters->event_fds[e] >= 0) return true;
+    }
+    return false;
+}
+
+static inline void timing_counters_close(timing_counters_t * counters)
+{
+#ifdef __linux__
+    if(counters->cycles_fd >= 0) close(counters->cycles_fd);
+    for(uint32_t e=0; e<TIMING_EVENT_COUNT; ++e) {
+        if(counters->event_fds[e] >= 0) close(counters->event_fds[e]);
+    }
+#endif
+    counters->cycles_fd = -1;
+    for(uint32_t e=0; e<TIMING_EVENT_COUNT; ++e) counters->event_fds[e] = -1;
+}
+
+static inline uint64_t timing_read_cycles(const timing_counters_t * counters)
+{
+#ifdef __linux__
+    uint64_t cycles = 0;
+    if(counters->cycles_fd >= 0 && read(counters->cycles_fd, &cycles, sizeof(cycles)) == sizeof(cycles)) {
+        return cycles;
+    }
+#else
+    (void) counters;
+#endif
+    return 0;
+}
+
+// Count for an event scaled by the fraction of the time it was scheduled, -1 if it never was
+static inline double timing_read_event(int fd)
+{
+#ifdef __linux__
+    uint64_t values[3];     // count, time enabled, time running
+    if(fd >= 0 && read(fd, values, sizeof(values)) == sizeof(values) && values[2] > 0) {
+        return (double) values[0] * ((double) values[1] / (double) values[2]);
+    }
+#else
+    (void) fd;
+#endif
+    return -1.0;
+}
+
+static inline void timing_start(const timing_counters_t * counters, timing_sample_t * sample)
+{
+#ifdef __linux__
+    for(uint32_t e=0; e<TIMING_EVENT_COUNT; ++e) {
+        if(counters->event_fds[e] >= 0) {
+            ioctl(counters->event_fds[e], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counters->event_fds[e], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    if(counters->cycles_fd >= 0) {
+        ioctl(counters->cycles_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters->cycles_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+    sample->cycles = 0;
+    sample->ns = timing_now_ns();
+    sample->ticks = timing_now_ticks();
+}
+
+static inline void timing_stop(const timing_counters_t * counters, timing_sample_t * sample)
+{
+    uint64_t ticks = timing_now_ticks();
+    uint64_t ns = timing_now_ns();
+#ifdef __linux__
+    if(counters->cycles_fd >= 0) {
+        ioctl(counters->cycles_fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+    for(uint32_t e=0; e<TIMING_EVENT_COUNT; ++e) {
+        if(counters->event_fds[e] >= 0) {
+            ioctl(counters->event_fds[e], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+#endif
+    sample->cycles = timing_read_cycles(counters);
+    for(uint32_t e=0; e<TIMING_EVENT_COUNT; ++e) {
+        sample->events[e] = timing_read_event(counters->event_fds[e]);
+    }
+    sample->ticks = ticks - sample->ticks;
+    sample->ns = ns - sample->ns;
+}
+
+static int timing_compare_double(const void * a, const void * b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static inline double timing_median(const double * values, uint32_t count)
+{
+    double sorted[TIMING_MAX_TRIALS];
+    if(count == 0) return 0.0;
+    memcpy(sorted, values, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), timing_compare_double);
+    return (count & 1) ? sorted[count/2] : 0.5 * (sorted[count/2 - 1] + sorted[count/2]);
+}
+
+static inline double timing_stddev(const double * values, uint32_t count)
+{
+    double mean = 0.0;
+    double variance = 0.0;
+    if(count < 2) return 0.0;
+    for(uint32_t i=0; i<count; ++i) mean += values[i];
+    mean /= count;
+    for(uint32_t i=0; i<count; ++i) variance += (values[i] - mean) * (values[i] - mean);
+    return sqrt(variance / (count - 1));
+}
+
+// Reduce per trial samples of runs each into per run medians
+static inline void timing_summarize(const timing_sample_t * samples, uint32_t trials, uint64_t runs, timing_result_t * result)
+{
+    double ns[TIMING_MAX_TRIALS];
+    double ticks[TIMING_MAX_TRIALS];
+    double cycles[TIMING_MAX_TRIALS];
+    for(uint32_t i=0; i<trials; ++i) {
+        ns[i] = (double) samples[i].ns / runs;
+        ticks[i] = (double) samples[i].ticks / runs;
+        cycles[i] = (double) samples[i].cycles / runs;
+    }
+    result->runs = runs;
+    result->trials = trials;
+    result->ns_per_run = timing_median(ns, trials);
+    result->ns_per_run_stddev = timing_stddev(ns, trials);
+    result->ticks_per_run = timing_median(ticks, trials);
+    result->cycles_per_run = timing_median(cycles, trials);
+    for(uint32_t e=0; e<TIMING_EVENT_COUNT; ++e) {
+        double events[TIMING_MAX_TRIALS];
+        bool available = (trials > 0);
+        for(uint32_t i=0; i<trials; ++i) {
+            available &= (samples[i].events[e] >= 0.0);
+            events[i] = samples[i].events[e] / runs;
+        }
+        result->events_per_run[e] = available ? timing_median(events, trials) : -1.0;
+    }
+}
+
+static inline double timing_gbps(const timing_result_t * result)
+{
+    return (result->ns_per_run > 0.0) ? (8.0 * result->bytes) / result->ns_per_run : 0.0;
+}
+
+//// Top-down metrics derived from the profile events - each is -1 if the events it needs are not available
+typedef struct timing_profile {
+    double ipc;
+    double frontend_bound;      // fraction of cycles the frontend delivered no instructions (I-cache, branches)
+    double backend_bound;       // fraction of cycles the backend couldn't accept instructions (execution ports, memory)
+    double l1i_refills_per_kinst;
+    double l1d_refills_per_line;        // per 64B of message - around 1 or more means the data is streaming from beyond L1
+    double ase_spec_per_block;          // SIMD ops per 16B block
+    double crypto_spec_per_block;       // AESE/AESMC/PMULL/SHA ops per 16B block
+} timing_profile_t;
+
+#define TIMING_PROFILE_METRIC_COUNT (sizeof(timing_profile_t) / sizeof(double))
+
+static const char * timing_profile_names[TIMING_PROFILE_METRIC_COUNT] = {
+    "ipc",
+    "frontend_bound",
+    "backend_bound",
+    "l1i_refills_per_kinst",
+    "l1d_refills_per_line",
+    "ase_spec_per_block",
+    "crypto_spec_per_block",
+};
+
+static inline double timing_ratio(double numerator, double denominator, double scale)
+{
+    return (numerator >= 0.0 && denominator > 0.0) ? scale * numerator / denominator : -1.0;
+}
+
+static inline timing_profile_t timing_profile(const timing_result_t * result)
+{
+    const double * events = result->events_per_run;
+    double cycles = result->cycles_per_run;
+    double blocks = result->bytes / 16.0;
+    timing_profile_t profile = {
+        .ipc = timing_ratio(events[TIMING_EVENT_INST_RETIRED], cycles, 1.0),
+        .frontend_bound = timing_ratio(events[TIMING_EVENT_STALL_FRONTEND], cycles, 1.0),
+        .backend_bound = timing_ratio(events[TIMING_EVENT_STALL_BACKEND], cycles, 1.0),
+        .l1i_refills_per_kinst = (events[TIMING_EVENT_INST_RETIRED] >= 0.0) ?
+            timing_ratio(events[TIMING_EVENT_L1I_CACHE_REFILL], events[TIMING_EVENT_INST_RETIRED], 1000.0) : -1.0,
+        .l1d_refills_per_line = timing_ratio(events[TIMING_EVENT_L1D_CACHE_REFILL], result->bytes / 64.0, 1.0),
+        .ase_spec_per_block = timing_ratio(events[TIMING_EVENT_ASE_SPEC], blocks, 1.0),
+        .crypto_spec_per_block = timing_ratio(events[TIMING_EVENT_CRYPTO_SPEC], blocks, 1.0),
+    };
+    return profile;
+}
+
+// Profile values as extra CSV columns or JSON fields - empty/null where not available
+static inline void timing_report_profile(timing_format_t format, const timing_result_t * result)
+{
+    timing_profile_t profile = timing_profile(result);
+    const double * metrics = (const double *) &profile;
+    for(uint32_t e=0; e<TIMING_EVENT_COUNT + TIMING_PROFILE_METRIC_COUNT; ++e) {
+        bool event = (e < TIMING_EVENT_COUNT);
+        const char * name = event ? timing_event_names[e] : timing_profile_names[e - TIMING_EVENT_COUNT];
+        double value = event ? result->events_per_run[e] : metrics[e - TIMING_EVENT_COUNT];
+        if(format == TIMING_FORMAT_CSV) {
+            if(value >= 0.0) printf(",%.4f", value);
+            else printf(",");
+        } else if(value >= 0.0) {
+            printf(", \"%s%s\": %.4f", name, event ? "_per_run" : "", value);
+        } else {
+            printf(", \"%s%s\": null", name, event ? "_per_run" : "");
+        }
+    }
+}
+
+static inline void timing_print_metric(const char * label, double value, const char * unit)
+{
+    if(value >= 0.0) printf("%s %.3f%s", label, value, unit);
+    else printf("%s n/a", label);
+}
+
+// CSV header/JSON opening bracket - with the profile columns when profiling
+static inline void timing_report_begin(timing_format_t format, bool profile)
+{
+    if(format == TIMING_FORMAT_CSV) {
+        printf("name,mode,operation,variant,bytes,runs,trials,ns_per_run,ns_per_run_stddev,"
+               "gbps,ticks_per_run,cycles_per_run,bytes_per_cycle,cycles_per_byte,result");
+        if(profile) {
+            for(uint32_t e=0; e<TIMING_EVENT_COUNT; ++e) printf(",%s_per_run", timing_event_names[e]);
+            for(uint32_t m=0; m<TIMING_PROFILE_METRIC_COUNT; ++m) printf(",%s", timing_profile_names[m]);
+        }
+        printf("\n");
+    } else if(format == TIMING_FORMAT_JSON) {
+        printf("[");
+    }
+}
+
+static inline void timing_report_end(timing_format_t format)
+{
+    if(format == TIMING_FORMAT_JSON) {
+        printf("\n]\n");
+    }
+}
+
+// index is the number of rows already reported, for JSON separators
+static inline void timing_report(timing_format_t format, const timing_result_t * result, uint64_t index)
+{
+    double gbps = timing_gbps(result);
+    double bytes_per_cycle = (result->cycles_per_run > 0.0) ? result->bytes / result->cycles_per_run : 0.0;
+    double cycles_per_byte = (result->bytes > 0) ? result->cycles_per_run / result->bytes : 0.0;
+    switch(format)
+    {
+        case TIMING_FORMAT_CSV:
+            printf("%s,%s,%s,%s,%lu,%lu,%u,%.2f,%.2f,%.3f,%.2f,%.2f,%.4f,%.4f,%s",
+                   result->name, result->mode, result->operation, result->variant,
+                   result->bytes, result->runs, result->trials,
+                   result->ns_per_run, result->ns_per_run_stddev, gbps,
+                   result->ticks_per_run, result->cycles_per_run, bytes_per_cycle, cycles_per_byte,
+                   result->success ? "Success" : "Failure");
+            if(result->profiled) timing_report_profile(format, result);
+            printf("\n");
+            break;
+        case TIMING_FORMAT_JSON:
+            printf("%s\n  {\"name\": \"%s\", \"mode\": \"%s\", \"operation\": \"%s\", \"variant\": \"%s\", "
+                   "\"bytes\": %lu, \"runs\": %lu, \"trials\": %u, \"ns_per_run\": %.2f, \"ns_per_run_stddev\": %.2f, "
+                   "\"gbps\": %.3f, \"ticks_per_run\": %.2f, \"cycles_per_run\": %.2f, \"bytes_per_cycle\": %.4f, "
+                   "\"cycles_per_byte\": %.4f, \"success\": %s",
+                   index ? "," : "",
+                   result->name, result->mode, result->operation, result->variant,
+                   result->bytes, result->runs, result->trials,
+                   result->ns_per_run, result->ns_per_run_stddev, gbps,
+                   result->ticks_per_run, result->cycles_per_run, bytes_per_cycle, cycles_per_byte,
+                   result->success ? "true" : "false");
+            if(result->profiled) timing_report_profile(format, result);
+            printf("}");
+            break;
+        default:
+            printf("%u trials of %lu runs (after warm-up)\n", result->trials, result->runs);
+            printf("Median %.2f ns/run (stddev %.2f ns), %.3f Gb/s\n", result->ns_per_run, result->ns_per_run_stddev, gbps);
+            printf("Generic timer %.2f ticks/run at %lu Hz\n", result->ticks_per_run, timing_tick_frequency());
+            if(result->cycles_per_run > 0.0) {
+                printf("%.2f cycles/run, %.4f B/cycle, %.4f cycles/B\n", result->cycles_per_run, bytes_per_cycle, cycles_per_byte);
+            } else {
+                printf("Cycles not available (perf_event_open not permitted or not supported)\n");
+            }
+            if(result->profiled) {
+                timing_profile_t profile = timing_profile(result);
+                const double * events = result->events_per_run;
+                printf("Profile per run:");
+                for(uint32_t e=0; e<TIMING_EVENT_COUNT; ++e) {
+                    if(events[e] >= 0.0) printf(" %s %.1f", timing_event_names[e], events[e]);
+                    else printf(" %s n/a", timing_event_names[e]);
+                }
+                printf("\n");
+                timing_print_metric("IPC", profile.ipc, "");
+                timing_print_metric(", frontend bound", 100.0 * profile.frontend_bound, "%");
+                timing_print_metric(", backend bound", 100.0 * profile.backend_bound, "%");
+                printf("\n");
+                timing_print_metric("L1I refills/kinst", profile.l1i_refills_per_kinst, "");
+                timing_print_metric(", L1D refills/64B", profile.l1d_refills_per_line, "");
+                timing_print_metric(", ASE_SPEC/block", profile.ase_spec_per_block, "");
+                timing_print_metric(", CRYPTO_SPEC/block", profile.crypto_spec_per_block, "");
+                printf("\n");
+            }
+            break;
+    }
+}
+
+// Parse the options shared by the speed tests, returning the number of argv entries consumed (0 if not an option)
+// Runs before the timed trials - as given with --warmup, including 0, or otherwise default_count
+static inline uint64_t timing_warmup_count(const timing_options_t * options, uint64_t default_count)
+{
+    return options->warmup_count == TIMING_WARMUP_DEFAULT ? default_count : options->warmup_count;
+}
+
+static inline int timing_parse_option(int argc, char * argv[], int i, timing_options_t * options)
+{
+    if(strcmp(argv[i], "--trials") == 0 && i+1 < argc) {
+        options->trials = (uint32_t) strtoul(argv[i+1], NULL, 10);
+        if(options->trials == 0) options->trials = 1;
+        if(options->trials > TIMING_MAX_TRIALS) options->trials = TIMING_MAX_TRIALS;
+        return 2;
+    }
+    if(strcmp(argv[i], "--warmup") == 0 && i+1 < argc) {
+        options->warmup_count = strtoul(argv[i+1], NULL, 10);
+        return 2;
+    }
+    if(strcmp(argv[i], "--format") == 0 && i+1 < argc) {
+        if(strcmp(argv[i+1], "csv") == 0) options->format = TIMING_FORMAT_CSV;
+        else if(strcmp(argv[i+1], "json") == 0) options->format = TIMING_FORMAT_JSON;
+        else options->format = TIMING_FORMAT_TEXT;
+        return 2;
+    }
+    if(strcmp(argv[i], "--no-pmu") == 0) {
+        options->use_pmu = false;
+        return 1;
+    }
+    return 0;
+}
+
+#endif